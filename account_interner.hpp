@@ -0,0 +1,64 @@
+#ifndef ACCOUNT_INTERNER_HPP_
+#define ACCOUNT_INTERNER_HPP_
+
+#include "engine_allocator.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Maps external account id strings to dense integer handles.
+ *
+ * Each id is hashed once when it enters the engine; from then on per-account
+ * state is reached by indexing arrays with the handle. Handles are assigned
+ * 0, 1, 2, ... in first-seen order and are never reused, so they stay valid
+ * for ids whose account was merged away or re-created.
+ */
+class AccountInterner {
+ public:
+  using Handle = uint32_t;
+  static constexpr Handle kInvalid = UINT32_MAX;
+
+  /**
+   * The handle for `account_id`, assigning the next one if it is new.
+   */
+  Handle intern(const std::string& account_id) {
+    auto [it, inserted] = handles_.try_emplace(account_id, static_cast<Handle>(names_.size()));
+    if (inserted) {
+      names_.push_back(account_id);
+      // Ids beyond the short-string buffer are held on the heap twice: key and name
+      if (names_.back().capacity() > std::string().capacity()) {
+        heapIdBytes_ += 2 * (names_.back().capacity() + 1);
+      }
+    }
+    return it->second;
+  }
+
+  /**
+   * The handle for `account_id`, or kInvalid if it was never interned.
+   */
+  Handle find(const std::string& account_id) const {
+    auto it = handles_.find(account_id);
+    return it == handles_.end() ? kInvalid : it->second;
+  }
+
+  const std::string& name(Handle handle) const { return names_[handle]; }
+  size_t size() const { return names_.size(); }
+
+  // Heap bytes of ids too long for the short-string buffer
+  size_t heapIdBytes() const { return heapIdBytes_; }
+
+ private:
+  template <typename T>
+  using Allocator = EngineAllocator<T, EngineStructure::ACCOUNT_IDS>;
+
+  std::unordered_map<std::string, Handle, std::hash<std::string>, std::equal_to<std::string>,
+                     Allocator<std::pair<const std::string, Handle>>>
+      handles_;
+  std::vector<std::string, Allocator<std::string>> names_;
+  size_t heapIdBytes_ = 0;
+};
+
+#endif  // ACCOUNT_INTERNER_HPP_
@@ -10,13 +10,30 @@ namespace banking {
 namespace ai {
 
 FraudDetectionAgent::FraudDetectionAgent(size_t analysis_window_seconds,
-                                       size_t max_transactions_per_account)
+                                       size_t max_transactions_per_account,
+                                       size_t analysis_queue_capacity,
+                                       size_t analysis_workers,
+                                       std::vector<int> worker_cpus,
+                                       size_t snapshot_slots)
     : analysis_window_seconds_(analysis_window_seconds),
-      max_transactions_per_account_(max_transactions_per_account),
+      max_transactions_per_account_(std::max<size_t>(1, max_transactions_per_account)),
+      snapshot_slots_(std::max<size_t>(1, snapshot_slots)),
       running_(false),
       transactions_analyzed_(0),
       fraud_alerts_generated_(0),
-      total_risk_score_(0.0) {
+      transactions_dropped_(0),
+      worker_cpus_(std::move(worker_cpus)) {
+  snapshots_ = std::make_unique<Snapshot[]>(snapshot_slots_);
+  if (analysis_workers == 0) {
+    analysis_workers = !worker_cpus_.empty() ? worker_cpus_.size()
+                                             : std::max(1u, std::thread::hardware_concurrency());
+  }
+  const size_t per_worker_capacity =
+      analysis_queue_capacity > 0 ? std::max<size_t>(1, analysis_queue_capacity / analysis_workers) : 0;
+  workers_.reserve(analysis_workers);
+  for (size_t i = 0; i < analysis_workers; ++i) {
+    workers_.push_back(std::make_unique<Worker>(per_worker_capacity));
+  }
 }
 
 FraudDetectionAgent::~FraudDetectionAgent() {
@@ -27,33 +44,123 @@ bool FraudDetectionAgent::start() {
   if (running_) return true;
 
   running_ = true;
-  analysis_thread_ = std::make_unique<std::thread>(&FraudDetectionAgent::analysisWorker, this);
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->thread = std::thread(&FraudDetectionAgent::analysisWorker, this, std::ref(*workers_[i]));
+    const int cpu = concurrent::cpuFor(worker_cpus_, i);
+    if (!concurrent::pinThread(workers_[i]->thread, cpu)) {
+      std::cerr << "Could not pin fraud analysis worker " << i << " to CPU " << cpu << std::endl;
+    }
+  }
 
-  std::cout << "Fraud detection agent started" << std::endl;
+  std::cout << "Fraud detection agent started with " << workers_.size() << " workers" << std::endl;
   return true;
 }
 
 void FraudDetectionAgent::stop() {
   if (!running_) return;
 
+  // Workers drain whatever is still queued before exiting
   running_ = false;
-
-  // Submit empty transaction to wake up worker
-  submitTransaction(TransactionData("", "", 0, 0));
-
-  if (analysis_thread_ && analysis_thread_->joinable()) {
-    analysis_thread_->join();
+  for (auto& worker : workers_) {
+    std::lock_guard<std::mutex> lock(worker->wait_mutex);
+    worker->not_empty.notify_all();
+  }
+  for (auto& worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
   }
 
   std::cout << "Fraud detection agent stopped" << std::endl;
 }
 
 FraudResult FraudDetectionAgent::analyzeTransaction(const TransactionData& transaction) {
-  return performAnalysis(transaction);
+  return performAnalysis(workerFor(transaction.account_id).shard, transaction);
 }
 
-void FraudDetectionAgent::submitTransaction(const TransactionData& transaction) {
-  analysis_queue_.enqueue(transaction);
+std::vector<FraudResult> FraudDetectionAgent::analyzeBatch(const std::vector<TransactionData>& transactions) {
+  FeatureColumns features;
+  features.resize(transactions.size());
+
+  // Rows grouped by shard, each group in submission order so per-account history stays ordered
+  std::vector<std::vector<size_t>> rows_by_shard(workers_.size());
+  for (size_t row = 0; row < transactions.size(); ++row) {
+    rows_by_shard[std::hash<std::string>{}(transactions[row].account_id) % workers_.size()].push_back(row);
+  }
+  for (size_t shard = 0; shard < workers_.size(); ++shard) {
+    if (rows_by_shard[shard].empty()) continue;
+    Shard& owned = workers_[shard]->shard;
+    std::lock_guard<std::mutex> lock(owned.mutex);
+    for (size_t row : rows_by_shard[shard]) {
+      extractFeatures(owned, transactions[row], features, row);
+    }
+  }
+
+  scoreFeatures(features);
+
+  std::vector<FraudResult> results;
+  results.reserve(transactions.size());
+  for (size_t row = 0; row < transactions.size(); ++row) {
+    results.push_back(makeResult(features, row));
+  }
+  return results;
+}
+
+std::optional<double> FraudDetectionAgent::quickScore(const std::string& account_id, int amount,
+                                                     int timestamp) const {
+  const uint64_t account_hash = std::max<uint64_t>(1, std::hash<std::string>{}(account_id));
+  const Snapshot& snapshot = snapshots_[account_hash % snapshot_slots_];
+
+  for (int attempt = 0; attempt < 4; ++attempt) {
+    const uint32_t before = snapshot.sequence.load(std::memory_order_acquire);
+    if (before & 1) continue;
+    const uint64_t owner = snapshot.account_hash.load(std::memory_order_relaxed);
+    const double mean = snapshot.mean.load(std::memory_order_relaxed);
+    const double spread = snapshot.spread.load(std::memory_order_relaxed);
+    const double velocity = snapshot.velocity.load(std::memory_order_relaxed);
+    const int last_timestamp = snapshot.last_timestamp.load(std::memory_order_relaxed);
+    const uint32_t window_count = snapshot.window_count.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (snapshot.sequence.load(std::memory_order_relaxed) != before) continue;
+
+    if (owner == 0) return 0.0;  // No history, as in extractFeatures()
+    // Evicted by an account sharing the slot; its history is unknown, not empty
+    if (owner != account_hash) return std::nullopt;
+
+    // The same features and weights as scoreFeatures(), less the location factor
+    const double elapsed = std::max(0, timestamp - last_timestamp);
+    const double amount_z = mean != 0.0 ? std::abs(amount - mean) / spread : 0.0;
+    const double spend = velocity * std::exp(-elapsed / 3600.0) + amount;
+    // The count only grows stale as the window slides, so it is an upper bound until it empties
+    const bool window_passed = timestamp / kWindowBucketSeconds - last_timestamp / kWindowBucketSeconds >=
+                               static_cast<int>(kWindowBuckets);
+    const double frequency = window_passed ? 0.0 : window_count;
+
+    const double amount_score = std::min(1.0, amount_z / amount_anomaly_threshold_);
+    const double frequency_score = frequency > frequency_anomaly_threshold_
+        ? std::min(1.0, frequency / (frequency_anomaly_threshold_ * 2.0)) : 0.0;
+    const double velocity_score = spend > velocity_threshold_
+        ? std::min(1.0, spend / (velocity_threshold_ * 2.0)) : 0.0;
+    return std::min(1.0, amount_score * 0.4 + frequency_score * 0.3 + velocity_score * 0.2);
+  }
+  return std::nullopt;
+}
+
+bool FraudDetectionAgent::submitTransaction(const TransactionData& transaction) {
+  Worker& worker = workerFor(transaction.account_id);
+  if (!worker.push(transaction)) {
+    transactions_dropped_.fetch_add(1);
+    return false;
+  }
+
+  // Pairs with the fence in waitForWork: either the worker's final check sees
+  // this transaction, or this load sees the worker registered as a sleeper
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (worker.sleepers.load() > 0) {
+    std::lock_guard<std::mutex> lock(worker.wait_mutex);
+    worker.not_empty.notify_one();
+  }
+  return true;
 }
 
 void FraudDetectionAgent::setAlertCallback(AlertCallback callback) {
@@ -64,15 +171,16 @@ FraudDetectionAgent::Stats FraudDetectionAgent::getStats() const {
   Stats stats;
   stats.transactions_analyzed = transactions_analyzed_.load();
   stats.fraud_alerts_generated = fraud_alerts_generated_.load();
-  stats.analysis_queue_size = analysis_queue_.size();
+  stats.transactions_dropped = transactions_dropped_.load();
+  stats.analysis_queue_size = 0;
 
-  size_t total_tx = transactions_analyzed_.load();
-  if (total_tx > 0) {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats.average_risk_score = total_risk_score_ / total_tx;
-  } else {
-    stats.average_risk_score = 0.0;
+  double total_risk_score = 0.0;
+  for (const auto& worker : workers_) {
+    stats.analysis_queue_size += worker->size();
+    total_risk_score += worker->risk_score_sum.load();
   }
+  stats.average_risk_score =
+      stats.transactions_analyzed > 0 ? total_risk_score / stats.transactions_analyzed : 0.0;
 
   return stats;
 }
@@ -95,27 +203,41 @@ void FraudDetectionAgent::updateModels() {
   std::cout << "Fraud detection models updated" << std::endl;
 }
 
-void FraudDetectionAgent::analysisWorker() {
-  while (running_) {
-    auto transaction_opt = analysis_queue_.dequeue();
+bool FraudDetectionAgent::Worker::push(const TransactionData& transaction) {
+  if (bounded) return bounded->tryEnqueue(transaction);
+  queue.enqueue(transaction);
+  return true;
+}
+
+FraudDetectionAgent::Worker& FraudDetectionAgent::workerFor(const std::string& account_id) {
+  return *workers_[std::hash<std::string>{}(account_id) % workers_.size()];
+}
+
+bool FraudDetectionAgent::waitForWork(Worker& worker) {
+  // Announce the sleep before the final check so a producer either sees the
+  // sleeper and notifies, or its transaction is already visible here
+  std::unique_lock<std::mutex> lock(worker.wait_mutex);
+  worker.sleepers.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  worker.not_empty.wait(lock, [&] { return !worker.empty() || !running_; });
+  worker.sleepers.fetch_sub(1);
+  return !worker.empty();
+}
+
+void FraudDetectionAgent::analysisWorker(Worker& worker) {
+  while (true) {
+    auto transaction_opt = worker.pop();
     if (!transaction_opt.has_value()) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      if (!running_ && worker.empty()) break;
+      waitForWork(worker);
       continue;
     }
 
     const TransactionData& transaction = *transaction_opt;
-
-    // Empty transaction signals shutdown
-    if (transaction.account_id.empty()) {
-      break;
-    }
-
-    FraudResult result = performAnalysis(transaction);
+    FraudResult result = performAnalysis(worker.shard, transaction);
     transactions_analyzed_.fetch_add(1);
-    {
-      std::lock_guard<std::mutex> lock(stats_mutex_);
-      total_risk_score_ += result.risk_score;
-    }
+    worker.risk_score_sum.store(worker.risk_score_sum.load(std::memory_order_relaxed) + result.risk_score,
+                                std::memory_order_relaxed);
 
     // Trigger alert if fraudulent or needs review
     if ((result.isFraudulent() || result.needsReview()) && alert_callback_) {
@@ -127,22 +249,124 @@ void FraudDetectionAgent::analysisWorker() {
   }
 }
 
-FraudResult FraudDetectionAgent::performAnalysis(const TransactionData& transaction) {
-  FraudResult result;
-  result.risk_factors.clear();
+FraudResult FraudDetectionAgent::performAnalysis(Shard& shard, const TransactionData& transaction) {
+  FeatureColumns features;
+  features.resize(1);
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    extractFeatures(shard, transaction, features, 0);
+  }
+  scoreFeatures(features);
+  return makeResult(features, 0);
+}
+
+void FraudDetectionAgent::extractFeatures(Shard& shard, const TransactionData& transaction,
+                                          FeatureColumns& features, size_t row) const {
+  uint32_t location = 0;
+  if (!transaction.location.empty()) {
+    auto [interned, inserted] = shard.locations.try_emplace(
+        transaction.location, static_cast<uint32_t>(shard.locations.size() + 1));
+    location = interned->second;
+  }
+
+  const uint64_t account_hash = std::max<uint64_t>(1, std::hash<std::string>{}(transaction.account_id));
+  auto [it, inserted] = shard.accounts.try_emplace(transaction.account_id);
+  AccountState& state = it->second;
+  const double amount = static_cast<double>(transaction.amount);
+
+  // Without history there is nothing to deviate from
+  features.amount_z[row] = 0.0;
+  features.frequency[row] = 0.0;
+  features.velocity[row] = 0.0;
+  features.location_share[row] = 1.0;
+  if (state.count > 0) {
+    if (state.mean != 0.0) {
+      features.amount_z[row] = std::abs(amount - state.mean) / state.spread();
+    }
+    features.frequency[row] = state.transactionsInWindow(transaction.timestamp);
+    features.velocity[row] = state.decayedVelocity(transaction.timestamp) + amount;
+
+    if (location != 0 && !state.location_counts.empty()) {
+      uint32_t total = 0;
+      uint32_t here = 0;
+      for (const auto& [id, count] : state.location_counts) {
+        total += count;
+        if (id == location) here = count;
+      }
+      features.location_share[row] = total > 0 ? static_cast<double>(here) / total : 1.0;
+    }
+  }
 
-  // Calculate different risk scores
-  double amount_score = calculateAmountAnomalyScore(transaction);
-  double frequency_score = calculateFrequencyAnomalyScore(transaction);
-  double velocity_score = calculateVelocityAnomalyScore(transaction);
-  double location_score = calculateLocationAnomalyScore(transaction);
+  state.record(transaction.timestamp, transaction.amount, location, max_transactions_per_account_);
+  publishSnapshot(account_hash, state);
+}
+
+void FraudDetectionAgent::publishSnapshot(uint64_t account_hash, const AccountState& state) const {
+  Snapshot& snapshot = snapshots_[account_hash % snapshot_slots_];
+  uint32_t sequence = snapshot.sequence.load(std::memory_order_relaxed);
+  if ((sequence & 1) ||
+      !snapshot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed)) {
+    return;
+  }
+  // Readers that see any of the stores below also see the odd sequence
+  std::atomic_thread_fence(std::memory_order_release);
+
+  snapshot.account_hash.store(account_hash, std::memory_order_relaxed);
+  snapshot.mean.store(state.mean, std::memory_order_relaxed);
+  snapshot.spread.store(state.spread(), std::memory_order_relaxed);
+  snapshot.velocity.store(state.velocity, std::memory_order_relaxed);
+  snapshot.last_timestamp.store(state.last_timestamp, std::memory_order_relaxed);
+  snapshot.window_count.store(state.transactionsInWindow(state.last_timestamp), std::memory_order_relaxed);
+  snapshot.sequence.store(sequence + 2, std::memory_order_release);
+}
 
-  // Combine scores with weights
-  result.risk_score = (amount_score * 0.4) + (frequency_score * 0.3) +
-                     (velocity_score * 0.2) + (location_score * 0.1);
+void FraudDetectionAgent::scoreFeatures(FeatureColumns& features) const {
+  const size_t n = features.risk_score.size();
+  const double amount_threshold = amount_anomaly_threshold_;
+  const double frequency_threshold = frequency_anomaly_threshold_;
+  const double velocity_threshold = velocity_threshold_;
+
+  // Plain loops over contiguous columns, which the compiler vectorizes
+  const double* amount_z = features.amount_z.data();
+  const double* frequency = features.frequency.data();
+  const double* velocity = features.velocity.data();
+  const double* location_share = features.location_share.data();
+  double* amount_score = features.amount_score.data();
+  double* frequency_score = features.frequency_score.data();
+  double* velocity_score = features.velocity_score.data();
+  double* location_score = features.location_score.data();
+  double* risk_score = features.risk_score.data();
+
+  // One column per loop; each ratio is computed unconditionally and then selected
+  for (size_t i = 0; i < n; ++i) {
+    const double ratio = amount_z[i] / amount_threshold;
+    amount_score[i] = ratio < 1.0 ? ratio : 1.0;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    const double ratio = frequency[i] / (frequency_threshold * 2.0);
+    const double capped = ratio < 1.0 ? ratio : 1.0;
+    frequency_score[i] = frequency[i] > frequency_threshold ? capped : 0.0;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    const double ratio = velocity[i] / (velocity_threshold * 2.0);
+    const double capped = ratio < 1.0 ? ratio : 1.0;
+    velocity_score[i] = velocity[i] > velocity_threshold ? capped : 0.0;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    const double rarity = 1.0 - location_share[i];  // Rarer location, higher score
+    location_score[i] = rarity > 0.0 ? rarity : 0.0;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    // Combine scores with weights, clamped to [0, 1]
+    const double combined = (amount_score[i] * 0.4) + (frequency_score[i] * 0.3) +
+                            (velocity_score[i] * 0.2) + (location_score[i] * 0.1);
+    risk_score[i] = std::max(0.0, std::min(1.0, combined));
+  }
+}
 
-  // Clamp to [0, 1]
-  result.risk_score = std::max(0.0, std::min(1.0, result.risk_score));
+FraudResult FraudDetectionAgent::makeResult(const FeatureColumns& features, size_t row) {
+  FraudResult result;
+  result.risk_score = features.risk_score[row];
 
   // Determine recommendation
   if (result.risk_score > 0.8) {
@@ -160,158 +384,87 @@ FraudResult FraudDetectionAgent::performAnalysis(const TransactionData& transact
   }
 
   // Add risk factors
-  if (amount_score > 0.5) {
+  if (features.amount_score[row] > 0.5) {
     result.risk_factors.push_back("Unusual transaction amount");
   }
-  if (frequency_score > 0.5) {
+  if (features.frequency_score[row] > 0.5) {
     result.risk_factors.push_back("High transaction frequency");
   }
-  if (velocity_score > 0.5) {
+  if (features.velocity_score[row] > 0.5) {
     result.risk_factors.push_back("High velocity spending");
   }
-  if (location_score > 0.5) {
+  if (features.location_score[row] > 0.5) {
     result.risk_factors.push_back("Unusual location pattern");
   }
 
   return result;
 }
 
-double FraudDetectionAgent::calculateAmountAnomalyScore(const TransactionData& transaction) {
-  std::lock_guard<std::mutex> lock(histories_mutex_);
-  auto it = account_histories_.find(transaction.account_id);
-  if (it == account_histories_.end() || it->second.average_transaction_amount == 0.0) {
-    return 0.0;  // No history available
+void FraudDetectionAgent::FeatureColumns::resize(size_t n) {
+  for (auto* column : {&amount_z, &frequency, &velocity, &location_share, &amount_score,
+                       &frequency_score, &velocity_score, &location_score, &risk_score}) {
+    column->resize(n);
   }
-
-  const AccountHistory& history = it->second;
-  double mean = history.average_transaction_amount;
-  double amount = static_cast<double>(transaction.amount);
-
-  // Simple z-score calculation (assuming normal distribution)
-  double std_dev = mean * 0.5;  // Rough estimate
-  double z_score = std::abs(amount - mean) / std_dev;
-
-  // Convert to risk score [0, 1]
-  return std::min(1.0, z_score / amount_anomaly_threshold_);
 }
 
-double FraudDetectionAgent::calculateFrequencyAnomalyScore(const TransactionData& transaction) {
-  std::lock_guard<std::mutex> lock(histories_mutex_);
-  auto it = account_histories_.find(transaction.account_id);
-  if (it == account_histories_.end()) {
-    return 0.0;
-  }
-
-  const AccountHistory& history = it->second;
-  double current_freq = history.transaction_frequency_per_hour;
-
-  // Compare to threshold
-  if (current_freq > frequency_anomaly_threshold_) {
-    return std::min(1.0, current_freq / (frequency_anomaly_threshold_ * 2.0));
-  }
-
-  return 0.0;
+double FraudDetectionAgent::AccountState::decayedVelocity(int timestamp) const {
+  const double elapsed = std::max(0, timestamp - last_timestamp);
+  return velocity * std::exp(-elapsed / 3600.0);
 }
 
-double FraudDetectionAgent::calculateVelocityAnomalyScore(const TransactionData& transaction) {
-  std::lock_guard<std::mutex> lock(histories_mutex_);
-  auto it = account_histories_.find(transaction.account_id);
-  if (it == account_histories_.end() || it->second.recent_transactions.empty()) {
-    return 0.0;
-  }
-
-  const AccountHistory& history = it->second;
-
-  // Calculate total amount in last hour
-  auto one_hour_ago = transaction.timestamp - 3600;
-  int total_amount_last_hour = 0;
-
-  for (const auto& tx : history.recent_transactions) {
-    if (tx.timestamp >= one_hour_ago) {
-      total_amount_last_hour += tx.amount;
+uint32_t FraudDetectionAgent::AccountState::transactionsInWindow(int timestamp) const {
+  const int64_t bucket = timestamp / kWindowBucketSeconds;
+  uint32_t total = 0;
+  for (size_t age = 0; age < kWindowBuckets; ++age) {
+    const int64_t index = window_bucket - static_cast<int64_t>(age);
+    if (index <= bucket && index > bucket - static_cast<int64_t>(kWindowBuckets)) {
+      total += window[windowSlot(index)];
     }
   }
-
-  total_amount_last_hour += transaction.amount;
-
-  if (total_amount_last_hour > velocity_threshold_) {
-    return std::min(1.0, static_cast<double>(total_amount_last_hour) / (velocity_threshold_ * 2.0));
-  }
-
-  return 0.0;
+  return total;
 }
 
-double FraudDetectionAgent::calculateLocationAnomalyScore(const TransactionData& transaction) {
-  if (transaction.location.empty()) {
-    return 0.0;  // No location data
-  }
+size_t FraudDetectionAgent::AccountState::windowSlot(int64_t bucket) {
+  // Signed remainder: mixing in the unsigned bucket count would turn -1 into a huge index
+  const int64_t buckets = static_cast<int64_t>(kWindowBuckets);
+  return static_cast<size_t>((bucket % buckets + buckets) % buckets);
+}
 
-  std::lock_guard<std::mutex> lock(histories_mutex_);
-  auto it = account_histories_.find(transaction.account_id);
-  if (it == account_histories_.end() || it->second.location_counts.empty()) {
-    return 0.0;
+void FraudDetectionAgent::AccountState::record(int timestamp, int amount, uint32_t location, size_t max_count) {
+  // Welford's update; past max_count it becomes an exponentially weighted average
+  const bool saturated = count >= max_count;
+  if (!saturated) ++count;
+  const double delta = amount - mean;
+  mean += delta / count;
+  m2 += delta * (amount - mean);
+  if (saturated) {
+    m2 *= static_cast<double>(count - 1) / count;  // Forget the oldest share of the spread
   }
 
-  const auto& location_counts = it->second.location_counts;
-  int total_locations = 0;
-  int current_location_count = 0;
+  velocity = decayedVelocity(timestamp) + amount;
+  last_timestamp = std::max(last_timestamp, timestamp);
 
-  for (const auto& pair : location_counts) {
-    total_locations += pair.second;
-    if (pair.first == transaction.location) {
-      current_location_count = pair.second;
+  // Clear the buckets the window slid past, then count this transaction
+  const int64_t bucket = timestamp / kWindowBucketSeconds;
+  if (bucket > window_bucket) {
+    const int64_t last_cleared = std::min(bucket, window_bucket + static_cast<int64_t>(kWindowBuckets));
+    for (int64_t b = window_bucket + 1; b <= last_cleared; ++b) {
+      window[windowSlot(b)] = 0;
     }
+    window_bucket = bucket;
   }
-
-  if (total_locations == 0) return 0.0;
-
-  double location_ratio = static_cast<double>(current_location_count) / total_locations;
-
-  // Lower ratio means more unusual location
-  return std::max(0.0, 1.0 - location_ratio);
-}
-
-void FraudDetectionAgent::AccountHistory::addTransaction(const TransactionData& tx) {
-  recent_transactions.push_back(tx);
-
-  // Maintain max size
-  while (recent_transactions.size() > 1000) {  // Configurable
-    recent_transactions.pop_front();
+  if (bucket > window_bucket - static_cast<int64_t>(kWindowBuckets)) {
+    ++window[windowSlot(bucket)];
   }
 
-  // Update statistics
-  if (!recent_transactions.empty()) {
-    double total_amount = 0.0;
-    for (const auto& t : recent_transactions) {
-      total_amount += t.amount;
+  if (location != 0) {
+    auto it = std::find_if(location_counts.begin(), location_counts.end(),
+                           [location](const auto& entry) { return entry.first == location; });
+    if (it != location_counts.end()) {
+      ++it->second;
+    } else {
+      location_counts.emplace_back(location, 1);
     }
-    average_transaction_amount = total_amount / recent_transactions.size();
-
-    // Update location and IP counts
-    if (!tx.location.empty()) {
-      location_counts[tx.location]++;
-    }
-    if (!tx.source_ip.empty()) {
-      ip_counts[tx.source_ip]++;
-    }
-
-    // Calculate frequency (transactions per hour)
-    if (recent_transactions.size() >= 2) {
-      auto time_span = recent_transactions.back().timestamp - recent_transactions.front().timestamp;
-      if (time_span > 0) {
-        transaction_frequency_per_hour = (recent_transactions.size() * 3600.0) / time_span;
-      }
-    }
-  }
-
-  last_update = std::chrono::steady_clock::now();
-}
-
-void FraudDetectionAgent::AccountHistory::cleanupOldTransactions(int current_timestamp) {
-  int cutoff_time = current_timestamp - 3600;  // 1 hour window
-
-  while (!recent_transactions.empty() && recent_transactions.front().timestamp < cutoff_time) {
-    recent_transactions.pop_front();
   }
 }
 
@@ -0,0 +1,328 @@
+#include "balance_log.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+BalanceLog::BalanceLog() : BalanceLog(Config{}) {
+}
+
+BalanceLog::BalanceLog(const Config& config) : config_(config) {
+}
+
+BalanceLog::~BalanceLog() {
+  if (spillBase_ != nullptr) {
+    munmap(spillBase_, spillCapacity_ * sizeof(Chunk));
+  }
+  if (spillFd_ >= 0) {
+    close(spillFd_);
+  }
+}
+
+BalanceLog::Chunk* BalanceLog::chunk(uint32_t ref) {
+  if (ref & kSpilled) {
+    return spillBase_ + (ref & ~kSpilled);
+  }
+  return &blocks_[ref / kChunksPerBlock][ref % kChunksPerBlock];
+}
+
+const BalanceLog::Chunk* BalanceLog::chunk(uint32_t ref) const {
+  return const_cast<BalanceLog*>(this)->chunk(ref);
+}
+
+void BalanceLog::record(uint32_t account, int timestamp, int delta) {
+  if (delta == 0) {
+    return;  // Leaves every balance a query could see unchanged
+  }
+  if (account >= segments_.size()) {
+    segments_.resize(account + 1);
+  }
+  Directory& segments = segments_[account];
+
+  const Chunk* tail = segments.empty() ? nullptr : chunk(segments.back().ref);
+  if (tail == nullptr || tail->points[tail->count - 1].timestamp < timestamp) {
+    Point point{timestamp, (tail == nullptr ? 0 : tail->points[tail->count - 1].balance) + delta};
+    if (tail == nullptr || tail->count == kChunkPoints) {
+      uint32_t ref = allocate(account);
+      chunk(ref)->points[0] = point;
+      chunk(ref)->count = 1;
+      segments.push_back({timestamp, ref});
+      enforceBudget();
+    } else {
+      Chunk* appendTo = chunk(segments.back().ref);
+      appendTo->points[appendTo->count++] = point;
+    }
+    return;
+  }
+
+  // Out of order (or the same timestamp as the last change): find the chunk it belongs to
+  auto it = std::upper_bound(segments.begin(), segments.end(), timestamp,
+                             [](int ts, const Segment& segment) { return ts < segment.firstTimestamp; });
+  size_t index = it == segments.begin() ? 0 : static_cast<size_t>(it - segments.begin()) - 1;
+  Chunk* c = chunk(segments[index].ref);
+  size_t pos = std::lower_bound(c->points, c->points + c->count, timestamp,
+                                [](const Point& point, int ts) { return point.timestamp < ts; }) - c->points;
+
+  if (pos == c->count || c->points[pos].timestamp != timestamp) {
+    if (c->count == kChunkPoints) {
+      split(account, index);
+      c = chunk(segments[index].ref);
+      if (pos > c->count) {
+        pos -= c->count;
+        c = chunk(segments[++index].ref);
+      }
+    }
+    int previous = 0;
+    if (pos > 0) {
+      previous = c->points[pos - 1].balance;
+    } else if (index > 0) {
+      const Chunk* before = chunk(segments[index - 1].ref);
+      previous = before->points[before->count - 1].balance;
+    }
+    std::memmove(c->points + pos + 1, c->points + pos, (c->count - pos) * sizeof(Point));
+    c->points[pos] = {timestamp, previous};
+    ++c->count;
+    segments[index].firstTimestamp = c->points[0].timestamp;
+  }
+
+  shiftFrom(account, index, pos, delta);
+  enforceBudget();
+}
+
+int BalanceLog::balanceAt(uint32_t account, int time_at) const {
+  if (account >= segments_.size()) {
+    return 0;
+  }
+  const Directory& segments = segments_[account];
+  auto it = std::upper_bound(segments.begin(), segments.end(), time_at,
+                             [](int ts, const Segment& segment) { return ts < segment.firstTimestamp; });
+  if (it == segments.begin()) {
+    return 0;
+  }
+  const Chunk* c = chunk(std::prev(it)->ref);
+  const Point* point = std::upper_bound(c->points, c->points + c->count, time_at,
+                                        [](int ts, const Point& p) { return ts < p.timestamp; });
+  return std::prev(point)->balance;
+}
+
+void BalanceLog::forEachPoint(uint32_t account,
+                              const std::function<void(int timestamp, int balance)>& visit) const {
+  if (account >= segments_.size()) {
+    return;
+  }
+  for (const Segment& segment : segments_[account]) {
+    const Chunk* c = chunk(segment.ref);
+    for (uint32_t i = 0; i < c->count; ++i) {
+      visit(c->points[i].timestamp, c->points[i].balance);
+    }
+  }
+}
+
+void BalanceLog::compact(int before_timestamp) {
+  for (Directory& segments : segments_) {
+    auto it = std::lower_bound(segments.begin(), segments.end(), before_timestamp,
+                               [](const Segment& segment, int ts) { return segment.firstTimestamp < ts; });
+    if (it == segments.begin()) {
+      continue;
+    }
+    // Chunk `index` holds the last point before the horizon
+    const size_t index = static_cast<size_t>(it - segments.begin()) - 1;
+    Chunk* c = chunk(segments[index].ref);
+    size_t pos = std::lower_bound(c->points, c->points + c->count, before_timestamp,
+                                  [](const Point& point, int ts) { return point.timestamp < ts; }) - c->points;
+    const int lastBalance = c->points[pos - 1].balance;
+
+    // The last dropped point still answers queries between the horizon and the next change
+    const bool changedAtHorizon =
+        pos < c->count ? c->points[pos].timestamp == before_timestamp
+                       : index + 1 < segments.size() && segments[index + 1].firstTimestamp == before_timestamp;
+    if (!changedAtHorizon) {
+      c->points[--pos] = {before_timestamp, lastBalance};
+    }
+    std::memmove(c->points, c->points + pos, (c->count - pos) * sizeof(Point));
+    c->count -= static_cast<uint32_t>(pos);
+
+    size_t dropped = index;
+    if (c->count == 0) {
+      ++dropped;
+    } else {
+      segments[index].firstTimestamp = c->points[0].timestamp;
+    }
+    for (size_t i = 0; i < dropped; ++i) {
+      release(segments[i].ref);
+    }
+    segments.erase(segments.begin(), segments.begin() + dropped);
+  }
+}
+
+void BalanceLog::drop(uint32_t account) {
+  if (account >= segments_.size()) {
+    return;
+  }
+  for (const Segment& segment : segments_[account]) {
+    release(segment.ref);
+  }
+  Directory().swap(segments_[account]);
+}
+
+size_t BalanceLog::residentBytes() const {
+  return residentInUse_ * sizeof(Chunk);
+}
+
+uint32_t BalanceLog::allocate(uint32_t account) {
+  uint32_t id;
+  if (!residentFree_.empty()) {
+    id = residentFree_.back();
+    residentFree_.pop_back();
+  } else {
+    id = static_cast<uint32_t>(residentOwner_.size());
+    if (id % kChunksPerBlock == 0) {
+      blocks_.emplace_back(kChunksPerBlock);
+    }
+    residentOwner_.push_back(kNoOwner);
+    residentQueued_.push_back(0);
+  }
+
+  residentOwner_[id] = account;
+  chunk(id)->count = 0;
+  if (!residentQueued_[id]) {
+    spillOrder_.push_back(id);
+    residentQueued_[id] = 1;
+  }
+  ++residentInUse_;
+  return id;
+}
+
+void BalanceLog::release(uint32_t ref) {
+  if (ref & kSpilled) {
+    spillFree_.push_back(ref & ~kSpilled);
+    --spillInUse_;
+    return;
+  }
+  residentOwner_[ref] = kNoOwner;
+  residentFree_.push_back(ref);
+  --residentInUse_;
+}
+
+void BalanceLog::split(uint32_t account, size_t index) {
+  Directory& segments = segments_[account];
+  uint32_t ref = allocate(account);
+  Chunk* source = chunk(segments[index].ref);
+  Chunk* upper = chunk(ref);
+
+  const uint32_t keep = source->count / 2;
+  upper->count = source->count - keep;
+  std::memcpy(upper->points, source->points + keep, upper->count * sizeof(Point));
+  source->count = keep;
+  segments.insert(segments.begin() + index + 1, Segment{upper->points[0].timestamp, ref});
+}
+
+void BalanceLog::shiftFrom(uint32_t account, size_t segment, size_t position, int delta) {
+  Directory& segments = segments_[account];
+  for (size_t s = segment; s < segments.size(); ++s) {
+    Chunk* c = chunk(segments[s].ref);
+    for (size_t i = s == segment ? position : 0; i < c->count; ++i) {
+      c->points[i].balance += delta;
+    }
+  }
+}
+
+// Spill oldest-allocated chunks until back under budget. Only called between
+// operations, so no caller holds a chunk pointer while chunks move.
+void BalanceLog::enforceBudget() {
+  if (spillFailed_) {
+    return;
+  }
+
+  size_t candidates = spillOrder_.size() - spillOrderHead_;
+  while (residentBytes() > config_.memory_budget_bytes && candidates-- > 0) {
+    uint32_t id = spillOrder_[spillOrderHead_++];
+    residentQueued_[id] = 0;
+    const uint32_t owner = residentOwner_[id];
+    if (owner == kNoOwner) {
+      continue;
+    }
+    if (segments_[owner].back().ref == id) {
+      // An account's tail still takes appends: keep it resident, revisit later
+      spillOrder_.push_back(id);
+      residentQueued_[id] = 1;
+      continue;
+    }
+    if (!spill(id)) {
+      break;
+    }
+  }
+
+  if (spillOrderHead_ > kChunksPerBlock && spillOrderHead_ * 2 > spillOrder_.size()) {
+    spillOrder_.erase(spillOrder_.begin(), spillOrder_.begin() + spillOrderHead_);
+    spillOrderHead_ = 0;
+  }
+}
+
+bool BalanceLog::spill(uint32_t id) {
+  uint32_t slot;
+  if (!spillFree_.empty()) {
+    slot = spillFree_.back();
+    spillFree_.pop_back();
+  } else {
+    if (spillNext_ == spillCapacity_ && !growSpillFile()) {
+      return false;
+    }
+    slot = static_cast<uint32_t>(spillNext_++);
+  }
+
+  std::memcpy(spillBase_ + slot, chunk(id), sizeof(Chunk));
+  for (Segment& segment : segments_[residentOwner_[id]]) {
+    if (segment.ref == id) {
+      segment.ref = slot | kSpilled;
+      break;
+    }
+  }
+  ++spillInUse_;
+  release(id);
+  return true;
+}
+
+bool BalanceLog::growSpillFile() {
+  if (spillFd_ < 0) {
+    if (config_.spill_path.empty()) {
+      char path[] = "/tmp/balance_log_XXXXXX";
+      spillFd_ = mkstemp(path);
+      if (spillFd_ >= 0) {
+        unlink(path);
+      }
+    } else {
+      spillFd_ = open(config_.spill_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    }
+    if (spillFd_ < 0) {
+      std::cerr << "Failed to open balance log spill file: " << std::strerror(errno) << std::endl;
+      spillFailed_ = true;
+      return false;
+    }
+  }
+
+  const size_t capacity = std::max(kChunksPerBlock, spillCapacity_ * 2);
+  if (ftruncate(spillFd_, static_cast<off_t>(capacity * sizeof(Chunk))) != 0) {
+    std::cerr << "Failed to grow balance log spill file: " << std::strerror(errno) << std::endl;
+    spillFailed_ = true;
+    return false;
+  }
+  // Map the larger file before dropping the old view so spilled chunks stay reachable
+  void* base = mmap(nullptr, capacity * sizeof(Chunk), PROT_READ | PROT_WRITE, MAP_SHARED, spillFd_, 0);
+  if (base == MAP_FAILED) {
+    std::cerr << "Failed to map balance log spill file: " << std::strerror(errno) << std::endl;
+    spillFailed_ = true;
+    return false;
+  }
+  if (spillBase_ != nullptr) {
+    munmap(spillBase_, spillCapacity_ * sizeof(Chunk));
+  }
+  spillBase_ = static_cast<Chunk*>(base);
+  spillCapacity_ = capacity;
+  return true;
+}
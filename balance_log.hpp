@@ -0,0 +1,138 @@
+#ifndef BALANCE_LOG_HPP_
+#define BALANCE_LOG_HPP_
+
+#include "engine_allocator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Append-mostly balance history for every account, stored in fixed-size chunks.
+ *
+ * Each account's history is a list of chunks holding (timestamp, cumulative
+ * balance) points in timestamp order. Chunks come from shared arenas that grow
+ * in blocks and never shrink; freed chunks are reused. Once resident chunks
+ * exceed the memory budget, the coldest ones (oldest allocated, never an
+ * account's tail) are copied into a memory-mapped spill file and read from
+ * there, so the kernel can page old history out instead of it pinning RSS.
+ *
+ * Queries binary-search a per-account directory of chunk start times, so
+ * spilled chunks are only touched when a query actually lands in them.
+ */
+class BalanceLog {
+ public:
+  struct Config {
+    size_t memory_budget_bytes = 256 * 1024 * 1024;
+    // Spill file; empty means an anonymous temporary file
+    std::string spill_path;
+  };
+
+  BalanceLog();
+  explicit BalanceLog(const Config& config);
+  ~BalanceLog();
+
+  // Non-copyable
+  BalanceLog(const BalanceLog&) = delete;
+  BalanceLog& operator=(const BalanceLog&) = delete;
+
+  /**
+   * Apply `delta` at `timestamp`. Changes normally arrive in timestamp order;
+   * one that doesn't is inserted in place and shifts every later balance.
+   */
+  void record(uint32_t account, int timestamp, int delta);
+
+  /**
+   * Balance after all changes at or before `time_at` (0 before the first change).
+   */
+  int balanceAt(uint32_t account, int time_at) const;
+
+  /**
+   * Visit every (timestamp, cumulative balance) point of one account, oldest first.
+   */
+  void forEachPoint(uint32_t account, const std::function<void(int timestamp, int balance)>& visit) const;
+
+  /**
+   * Drop points before `before_timestamp`, keeping one checkpoint at it per account.
+   */
+  void compact(int before_timestamp);
+
+  /**
+   * Drop every point of one account, returning its chunks to the arena.
+   */
+  void drop(uint32_t account);
+
+  size_t residentBytes() const;
+  size_t spilledChunks() const { return spillInUse_; }
+
+ private:
+  struct Point {
+    int timestamp;
+    int balance;
+  };
+
+  static constexpr size_t kChunkPoints = 63;
+  static constexpr size_t kChunksPerBlock = 128;
+  static constexpr uint32_t kSpilled = 1u << 31;
+  static constexpr uint32_t kNoOwner = UINT32_MAX;
+
+  // 512 bytes: a count and 63 points
+  struct Chunk {
+    uint32_t count;
+    uint32_t reserved;
+    Point points[kChunkPoints];
+  };
+
+  // A directory entry: where a chunk lives and the first timestamp in it
+  struct Segment {
+    int firstTimestamp;
+    uint32_t ref;  // Arena index, or spill slot with kSpilled set
+  };
+
+  template <typename T>
+  using Vector = std::vector<T, EngineAllocator<T, EngineStructure::BALANCE_HISTORY>>;
+  using Directory = Vector<Segment>;
+
+  Chunk* chunk(uint32_t ref);
+  const Chunk* chunk(uint32_t ref) const;
+
+  uint32_t allocate(uint32_t account);
+  void release(uint32_t ref);
+
+  // Split a full chunk at `index` in the account's directory into two half-full ones
+  void split(uint32_t account, size_t index);
+
+  // Add `delta` to every point from (segment, position) to the end of the history
+  void shiftFrom(uint32_t account, size_t segment, size_t position, int delta);
+
+  void enforceBudget();
+  bool spill(uint32_t id);
+  bool growSpillFile();
+
+  Config config_;
+
+  Vector<Directory> segments_;  // By account handle
+
+  // Resident arena: blocks of kChunksPerBlock chunks
+  Vector<Vector<Chunk>> blocks_;
+  Vector<uint32_t> residentOwner_;  // Account per arena chunk, kNoOwner if free
+  Vector<uint8_t> residentQueued_;  // Whether the chunk is in spillOrder_
+  Vector<uint32_t> residentFree_;
+  Vector<uint32_t> spillOrder_;  // Arena chunks in allocation order, oldest first
+  size_t spillOrderHead_ = 0;
+  size_t residentInUse_ = 0;
+
+  // Spill file
+  int spillFd_ = -1;
+  bool spillFailed_ = false;
+  Chunk* spillBase_ = nullptr;
+  size_t spillCapacity_ = 0;  // In chunks
+  size_t spillNext_ = 0;  // Slots ever handed out
+  size_t spillInUse_ = 0;
+  Vector<uint32_t> spillFree_;
+};
+
+#endif  // BALANCE_LOG_HPP_
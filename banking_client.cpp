@@ -13,8 +13,10 @@ using namespace banking::network;
  */
 class BankingClient {
  public:
-  BankingClient(const std::string& host, int port)
-      : client_(host, port), session_token_(""), client_id_("client_123") {}
+  BankingClient(const std::string& host, int port,
+                protocol::Encoding encoding = protocol::Encoding::BINARY)
+      : client_(host, port), session_token_(""), client_id_("client_123"),
+        encoding_(encoding) {}
 
   bool connect() {
     return client_.connect();
@@ -29,11 +31,11 @@ class BankingClient {
     request.client_id = client_id_;
 
     try {
-      std::string response_json = client_.sendRequest(protocol::serializeRequest(request));
-      auto response = protocol::deserializeResponse(response_json);
+      std::string response_bytes = client_.sendRequest(protocol::encodeRequest(request, encoding_));
+      auto response = protocol::decodeResponse(response_bytes);
 
-      if (response.status == protocol::Status::SUCCESS) {
-        session_token_ = response.payload["session_token"];
+      if (response.status == protocol::Status::SUCCESS && response.session_token) {
+        session_token_ = *response.session_token;
         std::cout << "Authentication successful! Session: " << session_token_ << std::endl;
         return true;
       } else {
@@ -81,16 +83,16 @@ class BankingClient {
  private:
   void sendRequest(const protocol::Request& request, const std::string& operation_name) {
     try {
-      std::string request_json = protocol::serializeRequest(request);
-      std::string response_json = client_.sendRequest(request_json);
-      auto response = protocol::deserializeResponse(response_json);
+      std::string response_bytes = client_.sendRequest(protocol::encodeRequest(request, encoding_));
+      auto response = protocol::decodeResponse(response_bytes);
 
       std::cout << operation_name << " - Status: "
                 << (response.status == protocol::Status::SUCCESS ? "SUCCESS" : "ERROR")
                 << " - Message: " << response.message << std::endl;
 
-      if (!response.payload.empty()) {
-        std::cout << "Response data: " << response.payload.dump(2) << std::endl;
+      if (response.hasPayload()) {
+        // JSON is only used here for display
+        std::cout << "Response data: " << protocol::serializeResponse(response) << std::endl;
       }
 
     } catch (const std::exception& e) {
@@ -107,6 +109,7 @@ class BankingClient {
   TCPClient client_;
   std::string session_token_;
   std::string client_id_;
+  protocol::Encoding encoding_;
 };
 
 void demonstrateBankingOperations(BankingClient& client) {
@@ -161,9 +164,13 @@ int main(int argc, char* argv[]) {
   if (argc >= 2) host = argv[1];
   if (argc >= 3) port = std::stoi(argv[2]);
 
+  // Pass "json" as the third argument to send human-readable requests
+  protocol::Encoding encoding = protocol::Encoding::BINARY;
+  if (argc >= 4 && std::string(argv[3]) == "json") encoding = protocol::Encoding::JSON;
+
   std::cout << "Connecting to banking server at " << host << ":" << port << std::endl;
 
-  BankingClient client(host, port);
+  BankingClient client(host, port, encoding);
 
   if (!client.connect()) {
     std::cerr << "Failed to connect to server" << std::endl;
@@ -1,240 +1,501 @@
-#include "banking_system_impl.hpp"
+#include "banking_core_impl.hpp"
+
+#include "observability/metrics.hpp"
 
 #include <algorithm>
+#include <charconv>
 #include <string>
+#include <tuple>
+
+BankingSystemImpl::BankingSystemImpl(const BalanceLog::Config& history_config)
+    : history_(history_config) {
+}
+
+BankingSystemImpl::Handle BankingSystemImpl::liveHandle(const std::string& account_id) const {
+  Handle account = interner_.find(account_id);
+  return isLive(account) ? account : AccountInterner::kInvalid;
+}
+
+bool BankingSystemImpl::isLive(Handle account) const {
+  return account != AccountInterner::kInvalid && accounts_.live[account];
+}
+
+BankingSystemImpl::Handle BankingSystemImpl::handleFor(const std::string& account_id) {
+  Handle account = interner_.intern(account_id);
+  if (account == accounts_.live.size()) {
+    accounts_.balance.push_back(0);
+    accounts_.outgoing.push_back(0);
+    accounts_.live.push_back(0);
+    accounts_.creationTime.push_back(std::numeric_limits<int>::max());
+    accounts_.mergeParent.push_back(AccountInterner::kInvalid);
+    accounts_.mergeTime.push_back(0);
+  }
+  return account;
+}
 
 // Internal: process scheduled payments that are due at or before the given timestamp.
 void BankingSystemImpl::processDuePayments(int timestamp) {
-  auto it = dueTimeToPaymentIds_.begin();
-  while (it != dueTimeToPaymentIds_.end() && it->first <= timestamp) {
-    std::vector<std::string> paymentIdsAtThisTime = std::move(it->second);
-    auto toErase = it++;
-    dueTimeToPaymentIds_.erase(toErase);
-
-    for (const std::string& paymentId : paymentIdsAtThisTime) {
-      auto itInfo = paymentById_.find(paymentId);
-      if (itInfo == paymentById_.end()) {
-        continue;
-      }
-      PaymentInfo& info = itInfo->second;
-      if (info.canceled) {
-        continue;
-      }
-
-      auto itAcc = accountBalances_.find(info.accountId);
-      if (itAcc == accountBalances_.end()) {
-        continue;
-      }
-      if (itAcc->second >= info.amount) {
-        itAcc->second -= info.amount;
-        balanceEvents_[info.accountId].emplace_back(info.dueTimestamp, -info.amount);
-        accountOutgoing_[info.accountId] += info.amount;
-      }
-      info.processed = true;
-    }
+  latestTimestamp_ = std::max(latestTimestamp_, timestamp);
+  scheduler_.advance(latestTimestamp_, [this](const PendingPayment& payment) { applyPayment(payment); });
+}
+
+void BankingSystemImpl::settleAccount(Handle account, int timestamp) {
+  latestTimestamp_ = std::max(latestTimestamp_, timestamp);
+  if (account == AccountInterner::kInvalid) {
+    return;
   }
+  scheduler_.advanceAccount(account, latestTimestamp_,
+                            [this](const PendingPayment& payment) { applyPayment(payment); });
 }
 
-// Resolve current owner at a given time by following merges with mergeTimestamp <= time_at.
-std::string BankingSystemImpl::rootAtTime(const std::string& account_id, int time_at) const {
-  auto it = mergedInto_.find(account_id);
-  if (it == mergedInto_.end()) return account_id;
-  const auto& [parent, mergeTs] = it->second;
-  if (mergeTs <= time_at) {
-    return rootAtTime(parent, time_at);
+void BankingSystemImpl::applyPayment(const PendingPayment& payment) {
+  if (!isLive(payment.account)) {
+    return;
+  }
+  int& balance = accounts_.balance[payment.account];
+  if (balance >= payment.amount) {
+    balance -= payment.amount;
+    recordBalanceChange(payment.account, payment.dueTimestamp, -payment.amount);
+    addOutgoing(payment.account, payment.amount);
   }
-  return account_id;
+}
+
+void BankingSystemImpl::recordBalanceChange(Handle account, int timestamp, int delta) {
+  history_.record(account, timestamp, delta);
 }
 
 // Creates a new account with zero balance if it doesn't exist yet.
 bool BankingSystemImpl::CreateAccount(int timestamp, const std::string& account_id) {
-  processDuePayments(timestamp);
+  // A missing account has no pending payments, and an existing one is left untouched
+  latestTimestamp_ = std::max(latestTimestamp_, timestamp);
+  return applyCreateAccount(timestamp, account_id);
+}
 
-  if (accountBalances_.find(account_id) != accountBalances_.end()) {
+bool BankingSystemImpl::applyCreateAccount(int timestamp, const std::string& account_id) {
+  Handle account = handleFor(account_id);
+  if (accounts_.live[account]) {
     return false;
   }
-  accountBalances_[account_id] = 0;
-  // Level 4: record creation time (multiple lifetimes supported)
-  creationTimes_[account_id].push_back(timestamp);
-  accountCreationTime_[account_id] = accountCreationTime_.count(account_id) ? accountCreationTime_[account_id] : timestamp;
-  balanceEvents_[account_id].emplace_back(timestamp, 0);  // mark creation point
+  accounts_.live[account] = 1;
+  spenderIndex_.emplace(accounts_.outgoing[account], account);
+  // Level 4: existence checks use the first lifetime's creation time
+  accounts_.creationTime[account] = std::min(accounts_.creationTime[account], timestamp);
   // Clear prior merge edge for new lifetime
-  mergedInto_.erase(account_id);
+  accounts_.mergeParent[account] = AccountInterner::kInvalid;
   return true;
 }
 
 // Deposits the given amount and returns the new balance; nullopt if account is missing.
 std::optional<int> BankingSystemImpl::Deposit(int timestamp, const std::string& account_id, int amount) {
-  processDuePayments(timestamp);
+  Handle account = liveHandle(account_id);
+  settleAccount(account, timestamp);
+  return applyDeposit(timestamp, account, amount);
+}
 
-  auto it = accountBalances_.find(account_id);
-  if (it == accountBalances_.end()) {
+std::optional<int> BankingSystemImpl::applyDeposit(int timestamp, Handle account, int amount) {
+  if (!isLive(account)) {
     return std::nullopt;
   }
-  it->second += amount;
-  balanceEvents_[account_id].emplace_back(timestamp, amount);
-  return it->second;
+  int& balance = accounts_.balance[account];
+  balance += amount;
+  recordBalanceChange(account, timestamp, amount);
+  return balance;
 }
 
 // Transfers funds between two different existing accounts if the source has enough money.
 std::optional<int> BankingSystemImpl::Transfer(int timestamp, const std::string& source_account_id, const std::string& target_account_id, int amount) {
-  processDuePayments(timestamp);
-
-  if (source_account_id == target_account_id) {
-    return std::nullopt;
-  }
+  Handle source = liveHandle(source_account_id);
+  Handle target = liveHandle(target_account_id);
+  settleAccount(source, timestamp);
+  settleAccount(target, timestamp);
+  return applyTransfer(timestamp, source, target, amount);
+}
 
-  auto itSource = accountBalances_.find(source_account_id);
-  auto itTarget = accountBalances_.find(target_account_id);
-  if (itSource == accountBalances_.end() || itTarget == accountBalances_.end()) {
+std::optional<int> BankingSystemImpl::applyTransfer(int timestamp, Handle source, Handle target, int amount) {
+  if (!isLive(source) || !isLive(target) || source == target) {
     return std::nullopt;
   }
-  if (itSource->second < amount) {
+  if (accounts_.balance[source] < amount) {
     return std::nullopt;
   }
 
-  itSource->second -= amount;
-  itTarget->second += amount;
-  balanceEvents_[source_account_id].emplace_back(timestamp, -amount);
-  balanceEvents_[target_account_id].emplace_back(timestamp, amount);
+  accounts_.balance[source] -= amount;
+  accounts_.balance[target] += amount;
+  recordBalanceChange(source, timestamp, -amount);
+  recordBalanceChange(target, timestamp, amount);
 
-  accountOutgoing_[source_account_id] += amount;
+  addOutgoing(source, amount);
 
-  return itSource->second;
+  return accounts_.balance[source];
 }
 
 std::vector<std::string> BankingSystemImpl::TopSpenders(int timestamp, int n) {
-  processDuePayments(timestamp);
-
-  std::vector<std::pair<std::string, int>> accountAndOutgoing;
-  accountAndOutgoing.reserve(accountBalances_.size());
-
-  for (const auto& [accountId, _] : accountBalances_) {
-    int outgoing = 0;
-    auto it = accountOutgoing_.find(accountId);
-    if (it != accountOutgoing_.end()) {
-      outgoing = it->second;
-    }
-    accountAndOutgoing.emplace_back(accountId, outgoing);
+  std::vector<std::string> result;
+  for (const auto& [id, outgoing] : TopSpenderTotals(timestamp, n)) {
+    result.emplace_back(id + "(" + std::to_string(outgoing) + ")");
   }
+  return result;
+}
 
-  std::sort(accountAndOutgoing.begin(), accountAndOutgoing.end(), [](const auto& a, const auto& b) {
-    if (a.second != b.second) return a.second > b.second;
-    return a.first < b.first;
-  });
+std::vector<std::pair<std::string, int>> BankingSystemImpl::TopSpenderTotals(int timestamp, int n) {
+  processDuePayments(timestamp);
 
   if (n < 0) n = 0;
-  const int limit = std::min<int>(n, static_cast<int>(accountAndOutgoing.size()));
+  const size_t limit = std::min(static_cast<size_t>(n), spenderIndex_.size());
 
-  std::vector<std::string> result;
+  std::vector<std::pair<std::string, int>> result;
   result.reserve(limit);
-  for (int i = 0; i < limit; ++i) {
-    const auto& [id, outgoing] = accountAndOutgoing[i];
-    result.emplace_back(id + "(" + std::to_string(outgoing) + ")");
+  for (auto it = spenderIndex_.begin(); result.size() < limit; ++it) {
+    result.emplace_back(interner_.name(it->second), it->first);
   }
   return result;
 }
 
+void BankingSystemImpl::addOutgoing(Handle account, int amount) {
+  int& outgoing = accounts_.outgoing[account];
+  auto node = spenderIndex_.extract({outgoing, account});
+  outgoing += amount;
+  if (node) {
+    node.value().first = outgoing;
+    spenderIndex_.insert(std::move(node));
+  }
+}
+
 std::optional<std::string> BankingSystemImpl::SchedulePayment(int timestamp, const std::string& account_id, int amount, int delay) {
-  processDuePayments(timestamp);
+  Handle account = liveHandle(account_id);
+  settleAccount(account, timestamp);
+  return applySchedulePayment(timestamp, account, amount, delay);
+}
 
-  if (accountBalances_.find(account_id) == accountBalances_.end()) {
+std::optional<std::string> BankingSystemImpl::applySchedulePayment(int timestamp, Handle account, int amount, int delay) {
+  if (!isLive(account)) {
     return std::nullopt;
   }
 
   const int dueTime = timestamp + delay;
-  const int ordinal = nextPaymentOrdinal_++;
+  const int ordinal = sharedPaymentOrdinal_ ? sharedPaymentOrdinal_->fetch_add(1) : nextPaymentOrdinal_++;
   const std::string paymentId = std::string("payment") + std::to_string(ordinal);
 
-  PaymentInfo info{account_id, amount, dueTime, false, false, ordinal};
-  paymentById_.emplace(paymentId, std::move(info));
-  dueTimeToPaymentIds_[dueTime].push_back(paymentId);
+  scheduler_.schedule(PendingPayment{account, amount, dueTime, ordinal});
 
   return paymentId;
 }
 
 bool BankingSystemImpl::CancelPayment(int timestamp, const std::string& account_id, const std::string& payment_id) {
-  processDuePayments(timestamp);
+  Handle account = liveHandle(account_id);
+  settleAccount(account, timestamp);
+  return applyCancelPayment(account, payment_id);
+}
 
-  auto it = paymentById_.find(payment_id);
-  if (it == paymentById_.end()) {
+bool BankingSystemImpl::applyCancelPayment(Handle account, const std::string& payment_id) {
+  // Ids are "payment<ordinal>"; anything that doesn't round-trip was never issued
+  static const std::string kPrefix = "payment";
+  if (payment_id.size() <= kPrefix.size() || payment_id.compare(0, kPrefix.size(), kPrefix) != 0) {
     return false;
   }
-  PaymentInfo& info = it->second;
-  if (info.canceled) {
+  int ordinal = 0;
+  const char* digits = payment_id.data() + kPrefix.size();
+  const char* end = payment_id.data() + payment_id.size();
+  auto [ptr, ec] = std::from_chars(digits, end, ordinal);
+  if (ec != std::errc() || ptr != end || payment_id != kPrefix + std::to_string(ordinal)) {
     return false;
   }
-  if (info.processed) {
-    return false;
+
+  const PendingPayment* payment = scheduler_.findPending(ordinal);
+  if (payment == nullptr) {
+    return false;  // Unknown, already run, or already canceled
   }
-  if (info.accountId != account_id) {
+  if (account == AccountInterner::kInvalid || payment->account != account) {
     return false;
   }
 
-  info.canceled = true;
-  return true;
+  return scheduler_.cancel(ordinal);
 }
 
-bool BankingSystemImpl::MergeAccounts(int timestamp, const std::string& account_id_1, const std::string& account_id_2) {
+// Applies every operation at `timestamp` after a single pass over due payments.
+std::vector<BatchResult> BankingSystemImpl::ApplyBatch(int timestamp, const std::vector<BatchOperation>& operations) {
   processDuePayments(timestamp);
 
-  if (account_id_1 == account_id_2) return false;
-  auto it1 = accountBalances_.find(account_id_1);
-  auto it2 = accountBalances_.find(account_id_2);
-  if (it1 == accountBalances_.end() || it2 == accountBalances_.end()) return false;
-
-  // Move funds
-  it1->second += it2->second;
-  balanceEvents_[account_id_1].emplace_back(timestamp, it2->second);
-  balanceEvents_[account_id_2].emplace_back(timestamp, -it2->second);
-  it2->second = 0;
-
-  // Sum outgoing
-  accountOutgoing_[account_id_1] += accountOutgoing_[account_id_2];
-  accountOutgoing_.erase(account_id_2);
-
-  // Reassign scheduled payments from account2 to account1
-  for (auto& kv : paymentById_) {
-    PaymentInfo& info = kv.second;
-    if (!info.processed && !info.canceled && info.accountId == account_id_2) {
-      info.accountId = account_id_1;
+  std::vector<BatchResult> results;
+  results.reserve(operations.size());
+  for (const auto& op : operations) {
+    BatchResult result;
+    switch (op.type) {
+      case BatchOperation::Type::CREATE_ACCOUNT:
+        result.success = applyCreateAccount(timestamp, op.account_id);
+        break;
+      case BatchOperation::Type::DEPOSIT:
+        result.balance = applyDeposit(timestamp, liveHandle(op.account_id), op.amount);
+        result.success = result.balance.has_value();
+        break;
+      case BatchOperation::Type::TRANSFER:
+        result.balance = applyTransfer(timestamp, liveHandle(op.account_id), liveHandle(op.target_account_id), op.amount);
+        result.success = result.balance.has_value();
+        break;
+      case BatchOperation::Type::SCHEDULE_PAYMENT:
+        result.payment_id = applySchedulePayment(timestamp, liveHandle(op.account_id), op.amount, op.delay);
+        result.success = result.payment_id.has_value();
+        break;
+      case BatchOperation::Type::CANCEL_PAYMENT:
+        result.success = applyCancelPayment(liveHandle(op.account_id), op.payment_id);
+        break;
     }
+    results.push_back(std::move(result));
   }
+  return results;
+}
+
+bool BankingSystemImpl::MergeAccounts(int timestamp, const std::string& account_id_1, const std::string& account_id_2) {
+  Handle survivor = liveHandle(account_id_1);
+  Handle merged = liveHandle(account_id_2);
+  settleAccount(survivor, timestamp);
+  settleAccount(merged, timestamp);
+  if (!isLive(survivor) || !isLive(merged) || survivor == merged) return false;
+
+  // Within one instance pending payments just change owner in place
+  scheduler_.reassign(merged, survivor);
+  attachAccount(timestamp, survivor, detachAccount(timestamp, merged, survivor));
+  return true;
+}
+
+// Removes a live account, recording the merge edge and handing back what the absorbing account inherits.
+BankingSystemImpl::DetachedAccount BankingSystemImpl::detachAccount(int timestamp, Handle account, Handle merged_into) {
+  DetachedAccount detached;
+
+  detached.balance = accounts_.balance[account];
+  recordBalanceChange(account, timestamp, -detached.balance);
+  detached.outgoing = accounts_.outgoing[account];
+  spenderIndex_.erase({detached.outgoing, account});
+  accounts_.balance[account] = 0;
+  accounts_.outgoing[account] = 0;
+  accounts_.live[account] = 0;
+
+  // Pending payments follow the money
+  detached.payments = scheduler_.takePending(account);
 
   // Record merge edge for historical GetBalance
-  mergedInto_[account_id_2] = {account_id_1, timestamp};
+  accounts_.mergeParent[account] = merged_into;
+  accounts_.mergeTime[account] = timestamp;
+  return detached;
+}
 
-  // Remove account2 from active maps
-  accountBalances_.erase(account_id_2);
+void BankingSystemImpl::attachAccount(int timestamp, Handle account, DetachedAccount detached) {
+  accounts_.balance[account] += detached.balance;
+  recordBalanceChange(account, timestamp, detached.balance);
+  addOutgoing(account, detached.outgoing);
 
-  return true;
+  // Ordinals travel with the payments, so same-timestamp ones keep their creation order
+  for (auto& payment : detached.payments) {
+    payment.account = account;
+    scheduler_.schedule(std::move(payment));
+  }
+}
+
+void BankingSystemImpl::SetPaymentOrdinalCounter(std::atomic<int>* counter) {
+  sharedPaymentOrdinal_ = counter;
+}
+
+bool BankingSystemImpl::HasAccount(const std::string& account_id) const {
+  return liveHandle(account_id) != AccountInterner::kInvalid;
+}
+
+std::optional<int> BankingSystemImpl::Withdraw(int timestamp, const std::string& account_id, int amount) {
+  Handle account = liveHandle(account_id);
+  settleAccount(account, timestamp);
+
+  if (!isLive(account) || accounts_.balance[account] < amount) {
+    return std::nullopt;
+  }
+  accounts_.balance[account] -= amount;
+  recordBalanceChange(account, timestamp, -amount);
+  addOutgoing(account, amount);
+  return accounts_.balance[account];
+}
+
+std::optional<BankingSystemImpl::DetachedAccount> BankingSystemImpl::DetachAccount(int timestamp, const std::string& account_id, const std::string& merged_into) {
+  Handle account = liveHandle(account_id);
+  settleAccount(account, timestamp);
+  if (!isLive(account)) {
+    return std::nullopt;
+  }
+  // The survivor lives in another instance; its handle here only marks the merge edge
+  return detachAccount(timestamp, account, handleFor(merged_into));
+}
+
+void BankingSystemImpl::AttachAccount(int timestamp, const std::string& account_id, DetachedAccount detached) {
+  Handle account = liveHandle(account_id);
+  if (!isLive(account)) {
+    return;
+  }
+  settleAccount(account, timestamp);
+  attachAccount(timestamp, account, std::move(detached));
 }
 
 std::optional<int> BankingSystemImpl::GetBalance(int timestamp, const std::string& account_id, int time_at) {
-  processDuePayments(timestamp);
+  Handle account = interner_.find(account_id);
+  settleAccount(isLive(account) ? account : AccountInterner::kInvalid, timestamp);
+
+  // History before the compaction horizon is no longer retained
+  if (time_at < historyHorizon_) {
+    return std::nullopt;
+  }
 
-  // Resolve to owner at time_at
-  const std::string owner = rootAtTime(account_id, time_at);
   // If merged into another account by or at time_at, it's considered non-existent then
   // (Use direct merge timestamp check to avoid misclassifying pre-merge times)
-  auto itMerged = mergedInto_.find(account_id);
-  if (itMerged != mergedInto_.end() && itMerged->second.second < time_at) {
+  if (account == AccountInterner::kInvalid) {
+    return std::nullopt;
+  }
+  if (accounts_.mergeParent[account] != AccountInterner::kInvalid && accounts_.mergeTime[account] < time_at) {
     return std::nullopt;
   }
 
   // Ensure the account existed at time_at
-  auto itCreated = accountCreationTime_.find(account_id);
-  if (itCreated == accountCreationTime_.end() || itCreated->second > time_at) {
+  if (accounts_.creationTime[account] > time_at) {
     return std::nullopt;
   }
 
-  // Sum deltas for this account up to time_at (history is recorded via balanceEvents_)
-  int sum = 0;
-  auto itEvents = balanceEvents_.find(account_id);
-  if (itEvents != balanceEvents_.end()) {
-    for (const auto& [ts, delta] : itEvents->second) {
-      if (ts <= time_at) sum += delta;
+  // Balance at time_at is the last cumulative point at or before it
+  return history_.balanceAt(account, time_at);
+}
+
+// Folds every timeline point before `before_timestamp` into a single checkpoint.
+void BankingSystemImpl::CompactHistory(int before_timestamp) {
+  if (before_timestamp <= historyHorizon_) {
+    return;
+  }
+  historyHorizon_ = before_timestamp;
+  history_.compact(before_timestamp);
+
+  // GetBalance refuses every time after a lifetime's merge, and those all lie past the
+  // horizon now; the log ends at 0 after the merge, just as an empty one reads
+  for (Handle account = 0; account < interner_.size(); ++account) {
+    if (!accounts_.live[account] && accounts_.mergeParent[account] != AccountInterner::kInvalid &&
+        accounts_.mergeTime[account] < before_timestamp) {
+      history_.drop(account);
+    }
+  }
+}
+
+void BankingSystemImpl::ReclaimMemory() {
+  ReleaseSpareCapacity();
+  memoryUsage().publish();
+}
+
+void BankingSystemImpl::ReleaseSpareCapacity() {
+  scheduler_.shrink();
+}
+
+BankingSystemImpl::MemoryUsage& BankingSystemImpl::MemoryUsage::operator+=(const MemoryUsage& other) {
+  accounts += other.accounts;
+  live_accounts += other.live_accounts;
+  account_column_bytes += other.account_column_bytes;
+  account_id_heap_bytes += other.account_id_heap_bytes;
+  history_resident_bytes += other.history_resident_bytes;
+  history_spilled_chunks += other.history_spilled_chunks;
+  pending_payments += other.pending_payments;
+  payment_entries += other.payment_entries;
+  spender_index_entries += other.spender_index_entries;
+  return *this;
+}
+
+void BankingSystemImpl::MemoryUsage::publish() const {
+  auto& metrics = banking::observability::getGlobalMetrics();
+  metrics.setGauge("engine_accounts", static_cast<double>(accounts));
+  metrics.setGauge("engine_live_accounts", static_cast<double>(live_accounts));
+  metrics.setGauge("engine_account_column_bytes", static_cast<double>(account_column_bytes));
+  metrics.setGauge("engine_account_id_heap_bytes", static_cast<double>(account_id_heap_bytes));
+  metrics.setGauge("engine_history_resident_bytes", static_cast<double>(history_resident_bytes));
+  metrics.setGauge("engine_history_spilled_chunks", static_cast<double>(history_spilled_chunks));
+  metrics.setGauge("engine_pending_payments", static_cast<double>(pending_payments));
+  metrics.setGauge("engine_payment_entries", static_cast<double>(payment_entries));
+  metrics.setGauge("engine_spender_index_entries", static_cast<double>(spender_index_entries));
+}
+
+BankingSystemImpl::MemoryUsage BankingSystemImpl::memoryUsage() const {
+  MemoryUsage usage;
+  usage.accounts = interner_.size();
+  usage.live_accounts = spenderIndex_.size();
+  usage.account_column_bytes =
+      (accounts_.balance.capacity() + accounts_.outgoing.capacity() + accounts_.creationTime.capacity() +
+       accounts_.mergeTime.capacity()) * sizeof(int) +
+      accounts_.live.capacity() * sizeof(uint8_t) + accounts_.mergeParent.capacity() * sizeof(Handle);
+  usage.account_id_heap_bytes = interner_.heapIdBytes();
+  usage.history_resident_bytes = history_.residentBytes();
+  usage.history_spilled_chunks = history_.spilledChunks();
+  usage.pending_payments = scheduler_.pendingCount();
+  usage.payment_entries = scheduler_.entryCount();
+  usage.spender_index_entries = spenderIndex_.size();
+  return usage;
+}
+
+void BankingSystemImpl::Restore(const SavedState& state) {
+  for (const SavedAccount& saved : state.accounts) {
+    const Handle account = handleFor(saved.id);
+    accounts_.creationTime[account] = saved.creationTime;
+    if (saved.live) {
+      accounts_.live[account] = 1;
+      accounts_.balance[account] = saved.balance;
+      accounts_.outgoing[account] = saved.outgoing;
+      spenderIndex_.emplace(saved.outgoing, account);
+    }
+    if (!saved.mergedInto.empty()) {
+      const Handle parent = handleFor(saved.mergedInto);
+      accounts_.mergeParent[account] = parent;
+      accounts_.mergeTime[account] = saved.mergeTime;
+    }
+  }
+
+  // In (account, time) order every change takes the balance log's append path
+  std::vector<std::tuple<Handle, int, int>> changes;
+  changes.reserve(state.history.size());
+  for (const SavedBalanceChange& change : state.history) {
+    changes.emplace_back(handleFor(change.account), change.timestamp, change.delta);
+  }
+  std::sort(changes.begin(), changes.end(), [](const auto& a, const auto& b) {
+    return std::tie(std::get<0>(a), std::get<1>(a)) < std::tie(std::get<0>(b), std::get<1>(b));
+  });
+  for (const auto& [account, timestamp, delta] : changes) {
+    recordBalanceChange(account, timestamp, delta);
+  }
+
+  for (const SavedPayment& payment : state.pendingPayments) {
+    scheduler_.schedule(PendingPayment{handleFor(payment.account), payment.amount, payment.dueTimestamp,
+                                       payment.ordinal});
+  }
+  nextPaymentOrdinal_ = std::max(nextPaymentOrdinal_, state.nextPaymentOrdinal);
+  latestTimestamp_ = std::max(latestTimestamp_, state.latestTimestamp);
+  historyHorizon_ = std::max(historyHorizon_, state.historyHorizon);
+}
+
+BankingSystemImpl::SavedState BankingSystemImpl::ExportState() const {
+  SavedState state;
+  state.accounts.reserve(interner_.size());
+  for (Handle account = 0; account < interner_.size(); ++account) {
+    SavedAccount saved;
+    saved.id = interner_.name(account);
+    saved.creationTime = accounts_.creationTime[account];
+    saved.live = accounts_.live[account] != 0;
+    saved.balance = accounts_.balance[account];
+    saved.outgoing = accounts_.outgoing[account];
+    if (accounts_.mergeParent[account] != AccountInterner::kInvalid) {
+      saved.mergedInto = interner_.name(accounts_.mergeParent[account]);
+      saved.mergeTime = accounts_.mergeTime[account];
     }
+
+    int previous = 0;
+    history_.forEachPoint(account, [&](int timestamp, int balance) {
+      state.history.push_back(SavedBalanceChange{saved.id, timestamp, balance - previous});
+      previous = balance;
+    });
+    state.accounts.push_back(std::move(saved));
   }
-  return sum;
-}
\ No newline at end of file
+
+  for (const PendingPayment& payment : scheduler_.pendingPayments()) {
+    state.pendingPayments.push_back(
+        SavedPayment{interner_.name(payment.account), payment.ordinal, payment.amount, payment.dueTimestamp});
+  }
+  state.nextPaymentOrdinal = sharedPaymentOrdinal_ ? sharedPaymentOrdinal_->load() : nextPaymentOrdinal_;
+  state.latestTimestamp = latestTimestamp_;
+  state.historyHorizon = historyHorizon_;
+  return state;
+}
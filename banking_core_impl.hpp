@@ -1,13 +1,20 @@
 #ifndef BANKING_SYSTEM_IMPL_HPP_
 #define BANKING_SYSTEM_IMPL_HPP_
 
+#include "account_interner.hpp"
+#include "balance_log.hpp"
 #include "banking_system.hpp"
+#include "engine_allocator.hpp"
+#include "payment_scheduler.hpp"
 
+#include <atomic>
+#include <cstdint>
+#include <limits>
 #include <optional>
 #include <string>
-#include <unordered_map>
 #include <vector>
-#include <map>
+#include <set>
+#include <utility>
 
 // Level 1 implementation notes:
 // - Stores everything in memory using a simple map of account_id -> balance.
@@ -26,6 +33,15 @@ class BankingSystemImpl : public BankingSystem {
  public:
   BankingSystemImpl() = default;
 
+  /**
+   * Keeps balance history within `history_config`'s memory budget, spilling the rest to disk.
+   */
+  explicit BankingSystemImpl(const BalanceLog::Config& history_config);
+
+  // Non-copyable: spenderIndex_ orders by names held in interner_
+  BankingSystemImpl(const BankingSystemImpl&) = delete;
+  BankingSystemImpl& operator=(const BankingSystemImpl&) = delete;
+
   /**
    * Creates a new account with zero balance.
    */
@@ -54,51 +70,203 @@ class BankingSystemImpl : public BankingSystem {
   bool MergeAccounts(int timestamp, const std::string& account_id_1, const std::string& account_id_2) override;
   std::optional<int> GetBalance(int timestamp, const std::string& account_id, int time_at) override;
 
+  /**
+   * Drops per-change history before `before_timestamp`, keeping one checkpoint per
+   * account. GetBalance for earlier times returns nullopt afterwards. Accounts merged
+   * away before it lose their history entirely, since no query can reach it any more.
+   */
+  void CompactHistory(int before_timestamp);
+
+  /**
+   * Releases spare scheduler capacity, then publishes this instance's memoryUsage().
+   */
+  void ReclaimMemory() override;
+
+  /**
+   * Releases capacity the payment scheduler kept from earlier peaks. Answers are unchanged.
+   */
+  void ReleaseSpareCapacity();
+
+  /** What the engine holds, for the engine_* gauges (see publish()). Kept in O(1) per field. */
+  struct MemoryUsage {
+    size_t accounts = 0;  // Ids ever seen; merged-away and live alike
+    size_t live_accounts = 0;
+    size_t account_column_bytes = 0;
+    size_t account_id_heap_bytes = 0;  // Ids too long for the short-string buffer
+    size_t history_resident_bytes = 0;
+    size_t history_spilled_chunks = 0;
+    size_t pending_payments = 0;
+    size_t payment_entries = 0;  // Timing wheel entries; one per pending payment
+    size_t spender_index_entries = 0;
+
+    MemoryUsage& operator+=(const MemoryUsage& other);
+
+    // Set the engine_* gauges of the global MetricsCollector
+    void publish() const;
+  };
+
+  MemoryUsage memoryUsage() const;
+
+  /** Batch of mutations sharing one due-payment pass. */
+  std::vector<BatchResult> ApplyBatch(int timestamp, const std::vector<BatchOperation>& operations) override;
+
+  // Shard hooks: let several instances partition one account space (see ShardedBankingSystem).
+
+  /** A scheduled payment that has neither run nor been canceled; attaching re-owns it. */
+  using PendingPayment = PaymentScheduler::Payment;
+
+  /** State carried from a merged-away account into the account absorbing it. */
+  struct DetachedAccount {
+    int balance = 0;
+    int outgoing = 0;
+    std::vector<PendingPayment> payments;
+  };
+
+  // Draw payment ordinals from a counter shared with other instances so ids stay unique.
+  void SetPaymentOrdinalCounter(std::atomic<int>* counter);
+
+  // Existence is unaffected by due payments, so no timestamp is needed.
+  bool HasAccount(const std::string& account_id) const;
+
+  // Debit leg of a transfer whose target lives elsewhere; counts toward outgoing.
+  std::optional<int> Withdraw(int timestamp, const std::string& account_id, int amount);
+
+  // Top n (account, outgoing) pairs, ordered as TopSpenders reports them.
+  std::vector<std::pair<std::string, int>> TopSpenderTotals(int timestamp, int n);
+
+  // Merge halves: remove `account_id` as merged into `merged_into`, then absorb it there.
+  std::optional<DetachedAccount> DetachAccount(int timestamp, const std::string& account_id, const std::string& merged_into);
+  void AttachAccount(int timestamp, const std::string& account_id, DetachedAccount detached);
+
+  // Bulk restore: rebuild an instance from state saved elsewhere (see BankingSystemPersistent
+  // and BankingSystemDurable).
+
+  /** An account as of the end of its latest lifetime. */
+  struct SavedAccount {
+    std::string id;
+    int creationTime = 0;
+    bool live = false;
+    int balance = 0;
+    int outgoing = 0;
+    // Where the latest lifetime was merged, if it ended that way
+    std::string mergedInto;
+    int mergeTime = 0;
+  };
+
+  struct SavedBalanceChange {
+    std::string account;
+    int timestamp = 0;
+    int delta = 0;
+  };
+
+  struct SavedPayment {
+    std::string account;
+    int ordinal = 0;
+    int amount = 0;
+    int dueTimestamp = 0;
+  };
+
+  struct SavedState {
+    std::vector<SavedAccount> accounts;
+    std::vector<SavedBalanceChange> history;  // Any order
+    std::vector<SavedPayment> pendingPayments;
+    int nextPaymentOrdinal = 1;
+    int latestTimestamp = std::numeric_limits<int>::min();
+    int historyHorizon = std::numeric_limits<int>::min();
+  };
+
+  // Load `state` into an instance that has not run any operation yet.
+  void Restore(const SavedState& state);
+
+  // Everything Restore needs to rebuild this instance: accounts in handle order,
+  // history as per-account deltas in time order, pending payments by ordinal.
+  SavedState ExportState() const;
+
  private:
-  // Process all scheduled payments due at or before `timestamp`.
+  using Handle = AccountInterner::Handle;
+
+  // Handle of a live account, or kInvalid if `account_id` has none right now.
+  Handle liveHandle(const std::string& account_id) const;
+  bool isLive(Handle account) const;
+
+  // Handle for `account_id`, growing the per-account columns if it is new.
+  Handle handleFor(const std::string& account_id);
+
+  // Process all scheduled payments due at or before `timestamp`, across every account.
   void processDuePayments(int timestamp);
 
-  // Resolve the owner id for `account_id` at a specific time point.
-  std::string rootAtTime(const std::string& account_id, int time_at) const;
+  // Process only one account's payments due at or before `timestamp`. Payments touch
+  // nothing but their own account, so this is all a single-account operation needs.
+  void settleAccount(Handle account, int timestamp);
 
-  // Current balance per account identifier (smallest currency unit, e.g. cents).
-  std::unordered_map<std::string, int> accountBalances_;
-  // Total outgoing (successful transfers and, in future levels, payments) per account.
-  std::unordered_map<std::string, int> accountOutgoing_;
+  // Debit a due payment if the balance covers it; it is consumed either way.
+  void applyPayment(const PendingPayment& payment);
 
-  // Global payment ordinal counter for generating unique ids.
-  int nextPaymentOrdinal_ = 1;
+  // Operation bodies; callers must have processed payments due by `timestamp`.
+  bool applyCreateAccount(int timestamp, const std::string& account_id);
+  std::optional<int> applyDeposit(int timestamp, Handle account, int amount);
+  std::optional<int> applyTransfer(int timestamp, Handle source, Handle target, int amount);
+  std::optional<std::string> applySchedulePayment(int timestamp, Handle account, int amount, int delay);
+  bool applyCancelPayment(Handle account, const std::string& payment_id);
+  DetachedAccount detachAccount(int timestamp, Handle account, Handle merged_into);
+  void attachAccount(int timestamp, Handle account, DetachedAccount detached);
 
-  // Payment record stored for tracking and cancellation.
-  struct PaymentInfo {
-    std::string accountId;
-    int amount;
-    int dueTimestamp;
-    bool canceled = false;
-    bool processed = false;  // set when attempted (success or skipped)
-    int creationOrder;  // strictly increasing
-  };
+  // Add to an account's outgoing total, keeping spenderIndex_ in step.
+  void addOutgoing(Handle account, int amount);
 
-  // Map payment id -> info (for cancel and lookup validations)
-  std::unordered_map<std::string, PaymentInfo> paymentById_;
+  // Apply `delta` at `timestamp` to the account's balance timeline.
+  void recordBalanceChange(Handle account, int timestamp, int delta);
 
-  // For processing by timestamp in order, and by creation order for same timestamp (global creation order).
-  // map keyed by dueTimestamp -> vector of payment_ids to preserve insertion order for same timestamp.
-  std::map<int, std::vector<std::string>> dueTimeToPaymentIds_;
+  // Every account id the engine has seen; handles index the columns below.
+  AccountInterner interner_;
 
-  // Track balance deltas per account for historical queries.
-  // Each entry: (timestamp, delta). Sum of deltas up to time_at yields balance at that time for that account.
-  std::unordered_map<std::string, std::vector<std::pair<int, int>>> balanceEvents_;
+  // Per-account state as parallel arrays indexed by handle, so one lookup at the
+  // API boundary serves every table an operation touches.
+  template <typename T>
+  using Column = std::vector<T, EngineAllocator<T, EngineStructure::ACCOUNT_COLUMNS>>;
+  struct AccountColumns {
+    // Balance and outgoing total (smallest currency unit, e.g. cents); 0 unless live.
+    Column<int> balance;
+    Column<int> outgoing;
+    Column<uint8_t> live;
+    // First creation time; accounts are treated as nonexistent before it (INT_MAX if never created).
+    Column<int> creationTime;
+    // Direct merge edge of the current lifetime: parent and merge time (kInvalid if none).
+    Column<Handle> mergeParent;
+    Column<int> mergeTime;
+  };
+  AccountColumns accounts_;
+
+  // Balance timeline per account handle for historical queries, kept across lifetimes.
+  BalanceLog history_;
+
+  // Live accounts ordered as TopSpenders reports them: outgoing desc, then id asc.
+  // Maintained on every outgoing change so a top-n query only walks n entries.
+  struct SpenderOrder {
+    const AccountInterner* interner;
+    bool operator()(const std::pair<int, Handle>& a, const std::pair<int, Handle>& b) const {
+      if (a.first != b.first) return a.first > b.first;
+      return interner->name(a.second) < interner->name(b.second);
+    }
+  };
+  std::set<std::pair<int, Handle>, SpenderOrder,
+           EngineAllocator<std::pair<int, Handle>, EngineStructure::SPENDER_INDEX>>
+      spenderIndex_{SpenderOrder{&interner_}};
 
-  // Direct merge edges: child -> (parent, mergeTimestamp)
-  std::unordered_map<std::string, std::pair<std::string, int>> mergedInto_;
+  // Global payment ordinal counter for generating unique ids.
+  int nextPaymentOrdinal_ = 1;
+  // Replaces nextPaymentOrdinal_ when set by SetPaymentOrdinalCounter.
+  std::atomic<int>* sharedPaymentOrdinal_ = nullptr;
 
-  // Account creation time for existence checks in GetBalance
-  std::unordered_map<std::string, int> accountCreationTime_;
+  // Pending payments by due time and by owning account. Fired and canceled
+  // payments are dropped, so a payment id that isn't pending can't be canceled.
+  PaymentScheduler scheduler_;
+  // Latest timestamp seen by any operation. Payments due by then count as run even
+  // if their account was settled lazily, so an earlier-stamped call still sees them.
+  int latestTimestamp_ = std::numeric_limits<int>::min();
 
-  // Level 4: support multiple lifetimes of the same account id (re-creation after merge)
-  std::unordered_map<std::string, std::vector<int>> creationTimes_;
-  std::unordered_map<std::string, std::vector<int>> deletionTimes_;  // merge timestamps per id
+  // GetBalance answers nothing before this time once CompactHistory has run.
+  int historyHorizon_ = std::numeric_limits<int>::min();
 };
 
 #endif  // BANKING_SYSTEM_IMPL_HPP_
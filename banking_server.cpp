@@ -1,32 +1,81 @@
 #include "banking_server.hpp"
 
-#include "banking_core_impl.hpp"
+#include "banking_system_sharded.hpp"
+#include "concurrent/operation_table.hpp"
+#include "network/binary_codec.hpp"
 #include "network/protocol.hpp"
 #include "ai/fraud_detection_agent.hpp"
+#include "observability/metrics.hpp"
 
 #include <iostream>
+#include <sstream>
 #include <chrono>
 
 namespace banking {
 
+namespace {
+
+// Queue bounds; a full processor queue answers requests with an error
+constexpr size_t kProcessorQueueCapacity = 16 * 1024;
+constexpr size_t kFraudQueueCapacity = 64 * 1024;
+
+// The screened account of a financial operation, or nullptr for anything else
+const std::string* screenedAccount(const network::protocol::Request& op) {
+  const auto account = concurrent::operationFor(op.type).screened_account;
+  return account ? &(op.*account) : nullptr;
+}
+
+}  // namespace
+
 BankingServer::BankingServer(int port, size_t num_worker_threads, size_t analysis_window_seconds)
-    : port_(port) {
-  // Initialize components with default in-memory system
-  auto banking_impl = std::make_unique<BankingSystemImpl>();
-  banking_system_ = std::make_unique<BankingSystemThreadSafe>(std::move(banking_impl));
+    : BankingServer(Config{port, num_worker_threads, analysis_window_seconds, {}, {}}) {
 }
 
 BankingServer::BankingServer(int port, size_t num_worker_threads, size_t analysis_window_seconds,
                            std::unique_ptr<BankingSystem> banking_system)
-    : port_(port), banking_system_(std::move(banking_system)) {
+    : BankingServer(Config{port, num_worker_threads, analysis_window_seconds, {}, {}},
+                    std::move(banking_system)) {
+}
+
+BankingServer::BankingServer(const Config& config)
+    : port_(config.port) {
+  // Initialize components with default in-memory system, sharded across accounts;
+  // a pinned server runs one shard per worker, built on that worker's node
+  ShardedBankingSystem::Config engine_config;
+  if (!config.placement.worker_cpus.empty()) {
+    engine_config.num_shards = config.placement.worker_cpus.size();
+    engine_config.shard_cpus = config.placement.worker_cpus;
+  }
+  banking_system_ = std::make_unique<ShardedBankingSystem>(engine_config);
+  initializeComponents(config);
+}
+
+BankingServer::BankingServer(const Config& config, std::unique_ptr<BankingSystem> banking_system)
+    : port_(config.port), banking_system_(std::move(banking_system)) {
   // Banking system is provided externally (e.g., persistent version)
+  initializeComponents(config);
 }
 
+void BankingServer::initializeComponents(const Config& config) {
+  topology_ = concurrent::CpuTopology::detect();
+  placement_ = config.placement;
+
+  // Pipelined clients rely on requests for one account being applied in order
+  concurrent::TransactionProcessor::Config processor_config;
+  processor_config.num_workers = placement_.worker_cpus.empty() ? config.num_worker_threads
+                                                                : placement_.worker_cpus.size();
+  processor_config.dispatch_mode = concurrent::TransactionProcessor::DispatchMode::ACCOUNT_AFFINITY;
+  processor_config.queue_capacity = kProcessorQueueCapacity;
+  processor_config.worker_cpus = placement_.worker_cpus;
   transaction_processor_ = std::make_unique<concurrent::TransactionProcessor>(
-      banking_system_.get(), num_worker_threads);
+      banking_system_.get(), processor_config);
+
+  idempotency_cache_ = std::make_unique<IdempotencyCache>(config.idempotency);
 
+  // Analysis is advisory, so under a burst it sheds load instead of queueing without bound
   fraud_agent_ = std::make_unique<ai::FraudDetectionAgent>(
-      analysis_window_seconds);
+      config.analysis_window_seconds, 1000, kFraudQueueCapacity, 0, placement_.fraud_cpus,
+      config.fraud_snapshot_slots);
 
   // Set up fraud alert handling
   fraud_agent_->setAlertCallback(
@@ -34,11 +83,27 @@ BankingServer::BankingServer(int port, size_t num_worker_threads, size_t analysi
         handleFraudAlert(tx, result);
       });
 
-  // Create TCP server with request handler
+  auto& metrics = observability::getGlobalMetrics();
+  for (size_t type = 0; type < network::protocol::kMessageTypeCount; ++type) {
+    const char* name = network::protocol::messageTypeName(static_cast<network::protocol::MessageType>(type));
+    request_counters_.push_back(&metrics.counter("banking_requests_total", {{"operation", name}}));
+    parse_latency_.push_back(&metrics.latency("request_parse_seconds", {{"operation", name}}));
+    total_latency_.push_back(&metrics.latency("request_total_seconds", {{"operation", name}}));
+  }
+
+  // Create TCP server with request handler; pinned reactors need the event loop
+  network::TCPServer::Config tcp_config;
+  if (!placement_.reactor_cpus.empty()) {
+    tcp_config.io_model = network::TCPServer::IoModel::EVENT_LOOP;
+    tcp_config.reactor_cpus = placement_.reactor_cpus;
+  }
   tcp_server_ = std::make_unique<network::TCPServer>(
-      port_, [this](const std::string& request) {
-        return handleRequest(request);
-      });
+      port_,
+      network::TCPServer::AsyncHandler(
+          [this](std::string_view request, network::TCPServer::Responder respond) {
+            handleRequest(request, std::move(respond));
+          }),
+      tcp_config);
 }
 
 BankingServer::~BankingServer() {
@@ -94,94 +159,267 @@ void BankingServer::stop() {
   std::cout << "Banking Server stopped" << std::endl;
 }
 
+void BankingServer::enablePreAuthorization(std::chrono::microseconds budget, double reject_threshold) {
+  preauth_enabled_ = true;
+  preauth_budget_ = budget;
+  preauth_reject_threshold_ = reject_threshold;
+
+  // Decisions take microseconds, far below the default buckets
+  const std::vector<double> buckets = {1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3};
+  auto& metrics = observability::getGlobalMetrics();
+  preauth_decision_seconds_ = &metrics.histogram("fraud_preauth_decision_seconds", {}, buckets);
+  preauth_overrun_seconds_ = &metrics.histogram("fraud_preauth_overrun_seconds", {}, buckets);
+  preauth_fallbacks_ = &metrics.counter("fraud_preauth_fallbacks_total");
+  preauth_rejections_ = &metrics.counter("fraud_preauth_rejections_total");
+}
+
+void BankingServer::setReadOnly(std::function<bool()> is_fresh) {
+  read_only_ = true;
+  replica_fresh_ = std::move(is_fresh);
+}
+
 BankingServer::Stats BankingServer::getStats() const {
   Stats stats;
   stats.is_running = tcp_server_ && tcp_server_->isRunning();
   stats.active_connections = tcp_server_ ? tcp_server_->getConnectionCount() : 0;
   stats.transaction_stats = transaction_processor_->getStats();
   stats.fraud_stats = fraud_agent_->getStats();
+  stats.topology = topology_;
+  stats.placement = placement_;
+  stats.idempotency_stats = idempotency_cache_->getStats();
+  for (size_t type = 0; type < total_latency_.size(); ++type) {
+    observability::LatencySummary total = total_latency_[type]->snapshot().summary();
+    if (total.count == 0) continue;
+    stats.request_latency.push_back({static_cast<network::protocol::MessageType>(type),
+                                     parse_latency_[type]->snapshot().summary(), total});
+  }
   return stats;
 }
 
-std::string BankingServer::handleRequest(const std::string& request_json) {
+void BankingServer::reclaimEngineMemory() {
+  banking_system_->ReclaimMemory();
+}
+
+void BankingServer::handleRequest(std::string_view request_bytes, network::TCPServer::Responder respond) {
+  // The reactor hands frames over as they complete, so this is when the request arrived
+  const auto accepted = std::chrono::steady_clock::now();
+  auto encoding = network::protocol::detectEncoding(request_bytes);
+  auto fail = [encoding](network::TCPServer::Responder& respond) {
+    std::string out;
+    auto error_response = network::protocol::Response::error(
+        network::protocol::Status::ERROR, "Request processing failed", 0);
+    network::protocol::encodeResponse(error_response, encoding, out);
+    respond(std::move(out));
+  };
+
+  // Nothing below throws once the request is handed on, so it is answered exactly once
   try {
-    auto request = network::protocol::deserializeRequest(request_json);
-
-    // Basic authentication check (simplified)
-    if (request.type != network::protocol::MessageType::AUTHENTICATE &&
-        request.type != network::protocol::MessageType::HEARTBEAT) {
-      {
-        std::shared_lock<std::shared_mutex> lock(sessions_mutex_);
-        auto it = active_sessions_.find(request.client_id);
-        if (it == active_sessions_.end() || it->second != request.session_token) {
-          auto error_response = network::protocol::Response::error(
-              network::protocol::Status::UNAUTHORIZED, "Invalid session", request.timestamp);
-          return network::protocol::serializeResponse(error_response);
-        }
+    std::optional<network::protocol::RequestView> view;
+    network::protocol::Request request;
+    if (encoding == network::protocol::Encoding::BINARY) {
+      view = network::protocol::BinaryCodec::decodeRequest(request_bytes);
+    } else {
+      request = network::protocol::deserializeRequest(request_bytes);
+    }
+    const auto parsed = std::chrono::steady_clock::now();
+    const size_t type = static_cast<size_t>(view ? view->type : request.type);
+
+    ResponseCallback finish = [this, encoding, accepted, parsed, type, fail,
+                               respond](network::protocol::Response response) mutable {
+      std::string out;
+      try {
+        network::protocol::encodeResponse(response, encoding, out);
+      } catch (const std::exception& e) {
+        std::cerr << "Error encoding response: " << e.what() << std::endl;
+        return fail(respond);
+      }
+      if (type < total_latency_.size()) {
+        parse_latency_[type]->record(parsed - accepted);
+        total_latency_[type]->record(std::chrono::steady_clock::now() - accepted);
       }
+      respond(std::move(out));
+    };
+
+    if (auto answer = view ? admitRequest(*view) : admitRequest(request)) {
+      return finish(std::move(*answer));
+    }
+    if (view) {
+      // Only now copied: from here on the request is answered after its frame is gone
+      request = view->materialize();
     }
+    processRequest(std::move(request), std::move(finish));
 
-    // Handle authentication
-    if (request.type == network::protocol::MessageType::AUTHENTICATE) {
-      // Simplified authentication - in production, verify credentials
-      std::string session_token = "session_" + request.client_id + "_" +
-                                 std::to_string(request.timestamp);
+  } catch (const std::exception& e) {
+    std::cerr << "Error handling request: " << e.what() << std::endl;
+    fail(respond);
+  }
+}
 
-      {
-        std::unique_lock<std::shared_mutex> lock(sessions_mutex_);
-        active_sessions_[request.client_id] = session_token;
-      }
+template <typename RequestT>
+std::optional<network::protocol::Response> BankingServer::admitRequest(const RequestT& request) {
+  const size_t type = static_cast<size_t>(request.type);
+  if (type < request_counters_.size()) {
+    request_counters_[type]->increment();
+  }
 
-      auto response = network::protocol::Response::authenticated(session_token, request.timestamp);
-      return network::protocol::serializeResponse(response);
+  // Basic authentication check (simplified)
+  if (request.type != network::protocol::MessageType::AUTHENTICATE &&
+      request.type != network::protocol::MessageType::HEARTBEAT) {
+    std::shared_lock<std::shared_mutex> lock(sessions_mutex_);
+    auto it = active_sessions_.find(request.client_id);
+    if (it == active_sessions_.end() || it->second != request.session_token) {
+      return network::protocol::Response::error(
+          network::protocol::Status::UNAUTHORIZED, "Invalid session", request.timestamp);
     }
+  }
+
+  // Handle authentication
+  if (request.type == network::protocol::MessageType::AUTHENTICATE) {
+    // Simplified authentication - in production, verify credentials
+    std::string client_id(request.client_id);
+    std::string session_token = "session_" + client_id + "_" + std::to_string(request.timestamp);
 
-    // Handle heartbeat
-    if (request.type == network::protocol::MessageType::HEARTBEAT) {
-      auto response = network::protocol::Response::success("Heartbeat acknowledged",
-                                                          request.timestamp);
-      return network::protocol::serializeResponse(response);
+    {
+      std::unique_lock<std::shared_mutex> lock(sessions_mutex_);
+      active_sessions_[std::move(client_id)] = session_token;
+    }
+
+    return network::protocol::Response::authenticated(session_token, request.timestamp);
+  }
+
+  // Handle heartbeat
+  if (request.type == network::protocol::MessageType::HEARTBEAT) {
+    return network::protocol::Response::success("Heartbeat acknowledged", request.timestamp);
+  }
+
+  if (read_only_) {
+    if (!concurrent::operationFor(request.type).read_only) {
+      return network::protocol::Response::error(
+          network::protocol::Status::INVALID_REQUEST, "Read-only replica; send writes to the primary",
+          request.timestamp);
+    }
+    if (replica_fresh_ && !replica_fresh_()) {
+      return network::protocol::Response::error(
+          network::protocol::Status::ERROR, "Replica is behind the primary", request.timestamp);
     }
+  }
+  return std::nullopt;
+}
 
-    // Submit transaction for processing
-    transaction_processor_->submitTransaction(request_json);
+void BankingServer::processRequest(network::protocol::Request request, ResponseCallback done) {
+  // A retry is answered before it is screened or applied a second time; only
+  // the processor turning the first attempt away lets a retry run again
+  if (!request.idempotency_key.empty()) {
+    const std::string client_id = request.client_id;
+    const std::string key = request.idempotency_key;
+    const int timestamp = request.timestamp;
+    return idempotency_cache_->executeAsync(
+        client_id, key,
+        [&](IdempotencyCache::Finish finish) { applyRequest(std::move(request), std::move(finish)); },
+        [](const network::protocol::Response& response) {
+          return !concurrent::TransactionProcessor::isRejection(response);
+        },
+        [done = std::move(done), timestamp](const network::protocol::Response* response) {
+          // Nothing to replay if the first attempt failed outright
+          done(response ? *response
+                        : network::protocol::Response::error(
+                              network::protocol::Status::ERROR, "Request processing failed", timestamp));
+        });
+  }
+  applyRequest(std::move(request), std::move(done));
+}
 
-    // Submit to fraud detection if it's a financial transaction
-    if (request.type == network::protocol::MessageType::TRANSFER ||
-        request.type == network::protocol::MessageType::DEPOSIT ||
-        request.type == network::protocol::MessageType::SCHEDULE_PAYMENT) {
+void BankingServer::applyRequest(network::protocol::Request request, ResponseCallback done) {
+  if (preauth_enabled_) {
+    if (auto rejection = preAuthorize(request)) {
+      return done(std::move(*rejection));
+    }
+  }
 
-      ai::TransactionData tx_data = extractTransactionData(request);
+  // Submit to fraud detection if it's a financial transaction
+  auto screen = [this](const network::protocol::Request& op, int timestamp) {
+    if (screenedAccount(op)) {
+      ai::TransactionData tx_data = extractTransactionData(op);
+      tx_data.timestamp = timestamp;
       fraud_agent_->submitTransaction(tx_data);
     }
+  };
+  if (request.type == network::protocol::MessageType::BATCH) {
+    for (const auto& op : request.operations) {
+      screen(op, request.timestamp);
+    }
+  } else {
+    screen(request, request.timestamp);
+  }
 
-    // For synchronous operations, wait for result (simplified - in production, use async)
-    // For now, return acknowledgment
-    auto response = network::protocol::Response::success("Request queued for processing",
-                                                        request.timestamp);
-    return network::protocol::serializeResponse(response);
+  // Hand the decoded request to the processor; a worker answers through `done`
+  transaction_processor_->submitRequest(std::move(request), std::move(done));
+}
 
-  } catch (const std::exception& e) {
-    std::cerr << "Error handling request: " << e.what() << std::endl;
-    auto error_response = network::protocol::Response::error(
-        network::protocol::Status::ERROR, "Request processing failed", 0);
-    return network::protocol::serializeResponse(error_response);
+std::optional<network::protocol::Response> BankingServer::preAuthorize(
+    const network::protocol::Request& request) {
+  using Clock = std::chrono::steady_clock;
+  const auto started = Clock::now();
+  const auto deadline = started + preauth_budget_;
+
+  // A batch is declined as a whole if any of its operations is
+  bool reject = false;
+  bool decided = true;
+  auto score = [&](const network::protocol::Request& op) {
+    const std::string* account = screenedAccount(op);
+    if (!account) return;
+    auto risk = fraud_agent_->quickScore(*account, op.amount, request.timestamp);
+    if (!risk) {
+      decided = false;
+    } else if (*risk >= preauth_reject_threshold_) {
+      reject = true;
+    }
+  };
+  if (request.type == network::protocol::MessageType::BATCH) {
+    for (const auto& op : request.operations) {
+      if (reject || !decided || Clock::now() > deadline) break;
+      score(op);
+    }
+  } else {
+    score(request);
   }
+
+  const auto elapsed = Clock::now() - started;
+  preauth_decision_seconds_->observe(std::chrono::duration<double>(elapsed).count());
+
+  // Too late (or unable) to decide: apply it and let the asynchronous review flag it
+  if (elapsed > preauth_budget_ || !decided) {
+    if (elapsed > preauth_budget_) {
+      preauth_overrun_seconds_->observe(std::chrono::duration<double>(elapsed - preauth_budget_).count());
+    }
+    preauth_fallbacks_->increment();
+    return std::nullopt;
+  }
+  if (!reject) {
+    return std::nullopt;
+  }
+
+  preauth_rejections_->increment();
+  return network::protocol::Response::error(
+      network::protocol::Status::REJECTED_FRAUD, "Declined by fraud pre-authorization", request.timestamp);
 }
 
 void BankingServer::handleFraudAlert(const ai::TransactionData& transaction,
                                     const ai::FraudResult& result) {
-  std::cout << "FRAUD ALERT: Account " << transaction.account_id
-            << " - Risk Score: " << result.risk_score
-            << " - Recommendation: " << result.recommendation << std::endl;
+  // Analysis workers raise alerts concurrently, so each is written in one piece
+  std::ostringstream alert;
+  alert << "FRAUD ALERT: Account " << transaction.account_id
+        << " - Risk Score: " << result.risk_score
+        << " - Recommendation: " << result.recommendation << '\n';
 
   if (!result.risk_factors.empty()) {
-    std::cout << "Risk Factors: ";
+    alert << "Risk Factors: ";
     for (const auto& factor : result.risk_factors) {
-      std::cout << factor << "; ";
+      alert << factor << "; ";
     }
-    std::cout << std::endl;
+    alert << '\n';
   }
+  std::cout << alert.str() << std::flush;
 
   // In production, this would trigger additional actions:
   // - Send alerts to compliance team
@@ -195,32 +433,17 @@ ai::TransactionData BankingServer::extractTransactionData(
 
   ai::TransactionData tx_data(request.client_id, "", 0, request.timestamp);
 
-  switch (request.type) {
-    case network::protocol::MessageType::DEPOSIT:
-      tx_data.transaction_type = "DEPOSIT";
-      tx_data.amount = request.payload["amount"];
-      break;
-
-    case network::protocol::MessageType::TRANSFER:
-      tx_data.transaction_type = "TRANSFER";
-      tx_data.amount = request.payload["amount"];
-      break;
-
-    case network::protocol::MessageType::SCHEDULE_PAYMENT:
-      tx_data.transaction_type = "PAYMENT";
-      tx_data.amount = request.payload["amount"];
-      break;
-
-    default:
-      tx_data.transaction_type = "UNKNOWN";
-      break;
+  const concurrent::OperationDescriptor& operation = concurrent::operationFor(request.type);
+  if (operation.screened_account) {
+    tx_data.transaction_type = operation.screened_as;
+    tx_data.amount = request.amount;
+    tx_data.account_id = request.*operation.screened_account;
+  } else {
+    tx_data.transaction_type = "UNKNOWN";
   }
 
   // Add metadata for fraud analysis
   tx_data.metadata["operation"] = std::to_string(static_cast<int>(request.type));
-  if (request.payload.contains("account_id")) {
-    tx_data.account_id = request.payload["account_id"];
-  }
 
   return tx_data;
 }
@@ -0,0 +1,153 @@
+#include "banking_system_durable.hpp"
+#include "banking_core_impl.hpp"
+#include "operation_log.hpp"
+#include "storage/snapshot_file.hpp"
+#include "observability/metrics.hpp"
+
+#include <iostream>
+
+namespace banking {
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point started) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+}  // namespace
+
+BankingSystemDurable::BankingSystemDurable(const Config& config)
+    : config_(config),
+      wal_(storage::WriteAheadLog::Config{config.data_directory, config.sync_interval}) {
+}
+
+BankingSystemDurable::~BankingSystemDurable() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  checkpoint_cv_.notify_one();
+  if (snapshotter_.joinable()) {
+    snapshotter_.join();
+  }
+  wal_.close();
+}
+
+bool BankingSystemDurable::open() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (opened_) return true;
+  const auto started = std::chrono::steady_clock::now();
+
+  uint64_t sequence = 0;
+  if (std::optional<storage::SnapshotFile> snapshot = storage::SnapshotFile::latest(config_.data_directory)) {
+    BankingSystemImpl::SavedState state;
+    if (!oplog::decodeState(snapshot->data(), snapshot->size(), state)) {
+      std::cerr << "Snapshot " << snapshot->path() << " is inconsistent" << std::endl;
+      return false;
+    }
+    impl_->Restore(state);
+    sequence = snapshot->walSequence();
+    recovery_.snapshot_sequence = sequence;
+    recovery_.snapshot_accounts = state.accounts.size();
+  }
+
+  bool replayed = true;
+  const std::optional<uint64_t> last =
+      wal_.replay(sequence, [&](uint64_t record_sequence, const std::string& record) {
+        if (!replayed) return;
+        if (!oplog::applyRecord(*impl_, record)) {
+          std::cerr << "WAL record " << record_sequence << " does not replay cleanly" << std::endl;
+          replayed = false;
+          return;
+        }
+        ++recovery_.replayed_operations;
+      });
+  if (!last || !replayed || !wal_.open(*last + 1)) {
+    return false;
+  }
+
+  opened_ = true;
+  operations_since_snapshot_ = recovery_.replayed_operations;
+  recovery_.duration =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+  observability::getGlobalMetrics().setGauge("recovery_duration_seconds", secondsSince(started));
+  std::cout << "Recovered " << recovery_.snapshot_accounts << " accounts from snapshot " << sequence << " and "
+            << recovery_.replayed_operations << " WAL records in " << recovery_.duration.count() << " ms"
+            << std::endl;
+
+  if (config_.snapshot_every_operations > 0) {
+    snapshotter_ = std::thread(&BankingSystemDurable::snapshotterLoop, this);
+  }
+  return true;
+}
+
+bool BankingSystemDurable::Checkpoint() {
+  std::lock_guard<std::mutex> checkpoint_lock(checkpoint_mutex_);
+  const auto started = std::chrono::steady_clock::now();
+
+  BankingSystemImpl::SavedState state;
+  uint64_t sequence;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!opened_) return false;
+    state = impl_->ExportState();
+    sequence = wal_.lastSequence();
+    operations_since_snapshot_ = 0;
+    checkpoint_requested_ = false;
+  }
+
+  // Later records go to a fresh segment, so the ones the snapshot covers can be deleted whole
+  if (!wal_.rotate()) {
+    return false;
+  }
+  const std::string body = oplog::encodeState(state);
+  if (!storage::SnapshotFile::write(config_.data_directory, sequence, body)) {
+    return false;
+  }
+  wal_.removeSegmentsThrough(sequence);
+  storage::SnapshotFile::removeOlderThan(config_.data_directory, sequence);
+
+  auto& metrics = observability::getGlobalMetrics();
+  metrics.observeHistogram("snapshot_duration_seconds", secondsSince(started));
+  metrics.setGauge("snapshot_bytes", static_cast<double>(body.size()));
+  return true;
+}
+
+BankingSystemDurable::RecoveryStats BankingSystemDurable::getRecoveryStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return recovery_;
+}
+
+uint64_t BankingSystemDurable::appendRecord(std::string record) {
+  const uint64_t sequence = wal_.append(record);
+  if (sequence != 0 && config_.snapshot_every_operations > 0 &&
+      ++operations_since_snapshot_ >= config_.snapshot_every_operations && !checkpoint_requested_) {
+    checkpoint_requested_ = true;
+    checkpoint_cv_.notify_one();
+  }
+  return sequence;
+}
+
+bool BankingSystemDurable::awaitRecord(uint64_t sequence) {
+  if (sequence != 0 && (!config_.wait_for_sync || wal_.waitDurable(sequence))) {
+    return true;
+  }
+  // Like the database write-through: the change stays in memory but is reported as failed
+  std::cerr << "Operation could not be written to the WAL in " << config_.data_directory << std::endl;
+  return false;
+}
+
+void BankingSystemDurable::snapshotterLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    checkpoint_cv_.wait(lock, [this] { return stopping_ || checkpoint_requested_; });
+    if (stopping_) break;
+    lock.unlock();
+    if (!Checkpoint()) {
+      std::cerr << "Background snapshot of " << config_.data_directory << " failed" << std::endl;
+    }
+    lock.lock();
+  }
+}
+
+}  // namespace banking
@@ -0,0 +1,158 @@
+#include "banking_system_logged.hpp"
+#include "banking_core_impl.hpp"
+#include "operation_log.hpp"
+
+#include <algorithm>
+
+namespace banking {
+
+namespace {
+
+using oplog::kNoWatermark;
+using oplog::Operation;
+using oplog::RecordWriter;
+
+}  // namespace
+
+BankingSystemLogged::BankingSystemLogged() : impl_(std::make_unique<BankingSystemImpl>()) {
+}
+
+BankingSystemLogged::~BankingSystemLogged() = default;
+
+bool BankingSystemLogged::CreateAccount(int timestamp, const std::string& account_id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!impl_->CreateAccount(timestamp, account_id)) {
+    observe(timestamp);
+    return false;
+  }
+  return record(lock, RecordWriter(Operation::CREATE_ACCOUNT, timestamp, takeReadWatermark(timestamp))
+                          .text(account_id));
+}
+
+std::optional<int> BankingSystemLogged::Deposit(int timestamp, const std::string& account_id, int amount) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::optional<int> result = impl_->Deposit(timestamp, account_id, amount);
+  if (!result) {
+    observe(timestamp);
+    return result;
+  }
+  const bool recorded = record(lock, RecordWriter(Operation::DEPOSIT, timestamp, takeReadWatermark(timestamp))
+                                         .text(account_id)
+                                         .int32(amount));
+  return recorded ? result : std::nullopt;
+}
+
+std::optional<int> BankingSystemLogged::Transfer(int timestamp, const std::string& source_account_id,
+                                                 const std::string& target_account_id, int amount) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::optional<int> result = impl_->Transfer(timestamp, source_account_id, target_account_id, amount);
+  if (!result) {
+    observe(timestamp);
+    return result;
+  }
+  const bool recorded = record(lock, RecordWriter(Operation::TRANSFER, timestamp, takeReadWatermark(timestamp))
+                                         .text(source_account_id)
+                                         .text(target_account_id)
+                                         .int32(amount));
+  return recorded ? result : std::nullopt;
+}
+
+std::vector<std::string> BankingSystemLogged::TopSpenders(int timestamp, int n) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  observe(timestamp);
+  return impl_->TopSpenders(timestamp, n);
+}
+
+std::optional<std::string> BankingSystemLogged::SchedulePayment(int timestamp, const std::string& account_id,
+                                                                int amount, int delay) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::optional<std::string> result = impl_->SchedulePayment(timestamp, account_id, amount, delay);
+  if (!result) {
+    observe(timestamp);
+    return result;
+  }
+  const bool recorded =
+      record(lock, RecordWriter(Operation::SCHEDULE_PAYMENT, timestamp, takeReadWatermark(timestamp))
+                       .text(account_id)
+                       .int32(amount)
+                       .int32(delay));
+  return recorded ? result : std::nullopt;
+}
+
+bool BankingSystemLogged::CancelPayment(int timestamp, const std::string& account_id,
+                                        const std::string& payment_id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!impl_->CancelPayment(timestamp, account_id, payment_id)) {
+    observe(timestamp);
+    return false;
+  }
+  return record(lock, RecordWriter(Operation::CANCEL_PAYMENT, timestamp, takeReadWatermark(timestamp))
+                          .text(account_id)
+                          .text(payment_id));
+}
+
+bool BankingSystemLogged::MergeAccounts(int timestamp, const std::string& account_id_1,
+                                        const std::string& account_id_2) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!impl_->MergeAccounts(timestamp, account_id_1, account_id_2)) {
+    observe(timestamp);
+    return false;
+  }
+  return record(lock, RecordWriter(Operation::MERGE_ACCOUNTS, timestamp, takeReadWatermark(timestamp))
+                          .text(account_id_1)
+                          .text(account_id_2));
+}
+
+std::optional<int> BankingSystemLogged::GetBalance(int timestamp, const std::string& account_id, int time_at) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  observe(timestamp);
+  return impl_->GetBalance(timestamp, account_id, time_at);
+}
+
+std::vector<BatchResult> BankingSystemLogged::ApplyBatch(int timestamp,
+                                                         const std::vector<BatchOperation>& operations) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<BatchResult> results = impl_->ApplyBatch(timestamp, operations);
+  if (std::none_of(results.begin(), results.end(), [](const BatchResult& result) { return result.success; })) {
+    observe(timestamp);
+    return results;
+  }
+
+  // Recorded whole: replaying the failed operations fails them again
+  if (!record(lock, RecordWriter(Operation::APPLY_BATCH, timestamp, takeReadWatermark(timestamp)).batch(operations))) {
+    for (BatchResult& result : results) {
+      result = BatchResult{};
+    }
+  }
+  return results;
+}
+
+void BankingSystemLogged::ReclaimMemory() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  impl_->ReclaimMemory();
+}
+
+void BankingSystemLogged::CompactHistory(int before_timestamp) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  impl_->CompactHistory(before_timestamp);
+  // Compaction does not move the clock, so any pending watermark is carried
+  record(lock, RecordWriter(Operation::COMPACT_HISTORY, before_timestamp, takeReadWatermark(kNoWatermark)));
+}
+
+bool BankingSystemLogged::record(std::unique_lock<std::mutex>& lock, const RecordWriter& writer) {
+  const uint64_t ticket = appendRecord(writer.data());
+  lock.unlock();
+  return awaitRecord(ticket);
+}
+
+void BankingSystemLogged::observe(int timestamp) {
+  read_watermark_ = std::max(read_watermark_, timestamp);
+}
+
+int BankingSystemLogged::takeReadWatermark(int timestamp) {
+  const int watermark = read_watermark_ > timestamp ? read_watermark_ : kNoWatermark;
+  read_watermark_ = kNoWatermark;
+  return watermark;
+}
+
+}  // namespace banking
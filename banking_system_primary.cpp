@@ -0,0 +1,40 @@
+#include "banking_system_primary.hpp"
+#include "banking_core_impl.hpp"
+#include "operation_log.hpp"
+
+#include <utility>
+
+namespace banking {
+
+BankingSystemPrimary::BankingSystemPrimary(const replication::ReplicationPublisher::Config& config)
+    : publisher_(config, [this](uint64_t& sequence) { return snapshot(sequence); }) {
+}
+
+BankingSystemPrimary::~BankingSystemPrimary() {
+  stop();
+}
+
+bool BankingSystemPrimary::start() {
+  return publisher_.start();
+}
+
+void BankingSystemPrimary::stop() {
+  publisher_.stop();
+}
+
+uint64_t BankingSystemPrimary::appendRecord(std::string record) {
+  return publisher_.publish(std::move(record));
+}
+
+std::string BankingSystemPrimary::snapshot(uint64_t& sequence) {
+  BankingSystemImpl::SavedState state;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    state = impl_->ExportState();
+    sequence = publisher_.lastSequence();
+  }
+  // Encoded outside the lock so writers only wait for the export
+  return oplog::encodeState(state);
+}
+
+}  // namespace banking
@@ -0,0 +1,130 @@
+#include "banking_system_replica.hpp"
+#include "banking_core_impl.hpp"
+#include "operation_log.hpp"
+#include "observability/metrics.hpp"
+
+#include <iostream>
+
+namespace banking {
+
+BankingSystemReplica::BankingSystemReplica(const Config& config)
+    : config_(config),
+      impl_(std::make_unique<BankingSystemImpl>()),
+      subscriber_(config.primary,
+                  replication::ReplicationSubscriber::Handler{
+                      [this](uint64_t sequence, const std::string& body) { return loadSnapshot(sequence, body); },
+                      [this](uint64_t sequence, std::string_view record) { return applyRecord(sequence, record); },
+                      [this](uint64_t) { caughtUp(); }}) {
+}
+
+BankingSystemReplica::~BankingSystemReplica() {
+  stop();
+}
+
+void BankingSystemReplica::start() {
+  subscriber_.start();
+}
+
+void BankingSystemReplica::stop() {
+  subscriber_.stop();
+}
+
+bool BankingSystemReplica::isFresh() const {
+  const Clock::rep caught_up_at = caught_up_at_.load(std::memory_order_acquire);
+  if (caught_up_at == 0) return false;
+  return Clock::now() - Clock::time_point(Clock::duration(caught_up_at)) <= config_.max_staleness;
+}
+
+bool BankingSystemReplica::CreateAccount(int, const std::string&) {
+  return false;
+}
+
+std::optional<int> BankingSystemReplica::Deposit(int, const std::string&, int) {
+  return std::nullopt;
+}
+
+std::optional<int> BankingSystemReplica::Transfer(int, const std::string&, const std::string&, int) {
+  return std::nullopt;
+}
+
+std::optional<std::string> BankingSystemReplica::SchedulePayment(int, const std::string&, int, int) {
+  return std::nullopt;
+}
+
+bool BankingSystemReplica::CancelPayment(int, const std::string&, const std::string&) {
+  return false;
+}
+
+bool BankingSystemReplica::MergeAccounts(int, const std::string&, const std::string&) {
+  return false;
+}
+
+std::vector<BatchResult> BankingSystemReplica::ApplyBatch(int, const std::vector<BatchOperation>& operations) {
+  return std::vector<BatchResult>(operations.size());
+}
+
+void BankingSystemReplica::ReclaimMemory() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  impl_->ReclaimMemory();
+}
+
+std::vector<std::string> BankingSystemReplica::TopSpenders(int, int n) {
+  if (!isFresh()) return {};
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The lowest timestamp leaves the clock where the log put it
+  return impl_->TopSpenders(oplog::kNoWatermark, n);
+}
+
+std::optional<int> BankingSystemReplica::GetBalance(int, const std::string& account_id, int time_at) {
+  if (!isFresh()) return std::nullopt;
+  std::lock_guard<std::mutex> lock(mutex_);
+  return impl_->GetBalance(oplog::kNoWatermark, account_id, time_at);
+}
+
+BankingSystemReplica::Stats BankingSystemReplica::getStats() const {
+  Stats stats;
+  stats.connected = subscriber_.isConnected();
+  stats.applied_sequence = subscriber_.appliedSequence();
+  stats.snapshots_loaded = snapshots_loaded_.load();
+  const Clock::rep caught_up_at = caught_up_at_.load(std::memory_order_acquire);
+  if (caught_up_at != 0) {
+    stats.staleness = std::chrono::duration_cast<std::chrono::milliseconds>(
+        Clock::now() - Clock::time_point(Clock::duration(caught_up_at)));
+  }
+  return stats;
+}
+
+bool BankingSystemReplica::loadSnapshot(uint64_t sequence, const std::string& body) {
+  BankingSystemImpl::SavedState state;
+  if (!oplog::decodeState(body.data(), body.size(), state)) {
+    std::cerr << "Replication snapshot at sequence " << sequence << " is inconsistent" << std::endl;
+    return false;
+  }
+  // Restored off to the side, so reads keep being answered meanwhile
+  auto restored = std::make_unique<BankingSystemImpl>();
+  restored->Restore(state);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    impl_.swap(restored);
+  }
+  ++snapshots_loaded_;
+  observability::getGlobalMetrics().incrementCounter("replication_snapshots_loaded_total");
+  std::cout << "Loaded replication snapshot of " << state.accounts.size() << " accounts at sequence "
+            << sequence << std::endl;
+  return true;
+}
+
+bool BankingSystemReplica::applyRecord(uint64_t sequence, std::string_view record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!oplog::applyRecord(*impl_, record)) {
+    std::cerr << "Replication record " << sequence << " does not replay cleanly" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void BankingSystemReplica::caughtUp() {
+  caught_up_at_.store(Clock::now().time_since_epoch().count(), std::memory_order_release);
+}
+
+}  // namespace banking
@@ -0,0 +1,263 @@
+#include "banking_system_sharded.hpp"
+#include "banking_core_impl.hpp"
+#include "concurrent/thread_placement.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+namespace banking {
+
+struct ShardedBankingSystem::Shard {
+  std::mutex mutex;
+  BankingSystemImpl impl;
+};
+
+ShardedBankingSystem::ShardedBankingSystem() : ShardedBankingSystem(Config{}) {
+}
+
+ShardedBankingSystem::ShardedBankingSystem(const Config& config)
+    : next_payment_ordinal_(1) {
+  size_t num_shards = std::max<size_t>(1, config.num_shards);
+  shards_.reserve(num_shards);
+  for (size_t i = 0; i < num_shards; ++i) {
+    const int cpu = concurrent::cpuFor(config.shard_cpus, i);
+    if (cpu < 0) {
+      shards_.push_back(std::make_unique<Shard>());
+    } else {
+      // Pages are placed on the node of the thread that first writes them, so
+      // the shard is built from a thread running on its worker's CPU
+      std::unique_ptr<Shard> shard;
+      std::thread builder([&shard, cpu] {
+        if (!concurrent::pinThread(pthread_self(), cpu)) {
+          std::cerr << "Could not place shard memory on CPU " << cpu << std::endl;
+        }
+        shard = std::make_unique<Shard>();
+      });
+      builder.join();
+      shards_.push_back(std::move(shard));
+    }
+    shards_.back()->impl.SetPaymentOrdinalCounter(&next_payment_ordinal_);
+  }
+}
+
+ShardedBankingSystem::~ShardedBankingSystem() = default;
+
+size_t ShardedBankingSystem::shardIndex(const std::string& account_id) const {
+  return std::hash<std::string>{}(account_id) % shards_.size();
+}
+
+ShardedBankingSystem::Shard& ShardedBankingSystem::shardFor(const std::string& account_id) {
+  return *shards_[shardIndex(account_id)];
+}
+
+std::vector<std::unique_lock<std::mutex>> ShardedBankingSystem::lockShards(
+    const std::vector<size_t>& indices) {
+  std::vector<std::unique_lock<std::mutex>> locks;
+  locks.reserve(indices.size());
+  for (size_t index : indices) {
+    locks.emplace_back(shards_[index]->mutex);
+  }
+  return locks;
+}
+
+bool ShardedBankingSystem::CreateAccount(int timestamp, const std::string& account_id) {
+  Shard& shard = shardFor(account_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.impl.CreateAccount(timestamp, account_id);
+}
+
+std::optional<int> ShardedBankingSystem::Deposit(int timestamp,
+                                                 const std::string& account_id,
+                                                 int amount) {
+  Shard& shard = shardFor(account_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.impl.Deposit(timestamp, account_id, amount);
+}
+
+std::optional<int> ShardedBankingSystem::Transfer(int timestamp,
+                                                  const std::string& source_account_id,
+                                                  const std::string& target_account_id,
+                                                  int amount) {
+  size_t source = shardIndex(source_account_id);
+  size_t target = shardIndex(target_account_id);
+  if (source == target) {
+    std::lock_guard<std::mutex> lock(shards_[source]->mutex);
+    return shards_[source]->impl.Transfer(timestamp, source_account_id, target_account_id, amount);
+  }
+
+  auto locks = lockShards({std::min(source, target), std::max(source, target)});
+  return transferLocked(timestamp, source_account_id, target_account_id, amount);
+}
+
+std::optional<int> ShardedBankingSystem::transferLocked(int timestamp,
+                                                        const std::string& source_account_id,
+                                                        const std::string& target_account_id,
+                                                        int amount) {
+  Shard& source = shardFor(source_account_id);
+  Shard& target = shardFor(target_account_id);
+  if (&source == &target) {
+    return source.impl.Transfer(timestamp, source_account_id, target_account_id, amount);
+  }
+
+  // Check the target first so a failed transfer leaves the source untouched
+  if (!target.impl.HasAccount(target_account_id)) {
+    return std::nullopt;
+  }
+  auto balance = source.impl.Withdraw(timestamp, source_account_id, amount);
+  if (balance.has_value()) {
+    target.impl.Deposit(timestamp, target_account_id, amount);
+  }
+  return balance;
+}
+
+std::vector<std::string> ShardedBankingSystem::TopSpenders(int timestamp, int n) {
+  std::vector<size_t> all(shards_.size());
+  for (size_t i = 0; i < all.size(); ++i) all[i] = i;
+
+  // Merges move outgoing totals between shards, so read them all at one point
+  std::vector<std::pair<std::string, int>> totals;
+  {
+    auto locks = lockShards(all);
+    for (auto& shard : shards_) {
+      auto shard_totals = shard->impl.TopSpenderTotals(timestamp, n);
+      totals.insert(totals.end(), std::make_move_iterator(shard_totals.begin()),
+                    std::make_move_iterator(shard_totals.end()));
+    }
+  }
+
+  std::sort(totals.begin(), totals.end(), [](const auto& a, const auto& b) {
+    if (a.second != b.second) return a.second > b.second;
+    return a.first < b.first;
+  });
+
+  if (n < 0) n = 0;
+  const size_t limit = std::min(static_cast<size_t>(n), totals.size());
+
+  std::vector<std::string> result;
+  result.reserve(limit);
+  for (size_t i = 0; i < limit; ++i) {
+    result.emplace_back(totals[i].first + "(" + std::to_string(totals[i].second) + ")");
+  }
+  return result;
+}
+
+std::optional<std::string> ShardedBankingSystem::SchedulePayment(int timestamp,
+                                                                 const std::string& account_id,
+                                                                 int amount, int delay) {
+  Shard& shard = shardFor(account_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.impl.SchedulePayment(timestamp, account_id, amount, delay);
+}
+
+bool ShardedBankingSystem::CancelPayment(int timestamp,
+                                         const std::string& account_id,
+                                         const std::string& payment_id) {
+  // A pending payment always lives in the shard of the account that owns it
+  Shard& shard = shardFor(account_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.impl.CancelPayment(timestamp, account_id, payment_id);
+}
+
+bool ShardedBankingSystem::MergeAccounts(int timestamp,
+                                         const std::string& account_id_1,
+                                         const std::string& account_id_2) {
+  size_t first = shardIndex(account_id_1);
+  size_t second = shardIndex(account_id_2);
+  if (first == second) {
+    std::lock_guard<std::mutex> lock(shards_[first]->mutex);
+    return shards_[first]->impl.MergeAccounts(timestamp, account_id_1, account_id_2);
+  }
+
+  auto locks = lockShards({std::min(first, second), std::max(first, second)});
+  return mergeLocked(timestamp, account_id_1, account_id_2);
+}
+
+bool ShardedBankingSystem::mergeLocked(int timestamp,
+                                       const std::string& account_id_1,
+                                       const std::string& account_id_2) {
+  Shard& survivor = shardFor(account_id_1);
+  Shard& merged = shardFor(account_id_2);
+  if (&survivor == &merged) {
+    return survivor.impl.MergeAccounts(timestamp, account_id_1, account_id_2);
+  }
+
+  if (!survivor.impl.HasAccount(account_id_1)) {
+    return false;
+  }
+  auto detached = merged.impl.DetachAccount(timestamp, account_id_2, account_id_1);
+  if (!detached.has_value()) {
+    return false;
+  }
+  survivor.impl.AttachAccount(timestamp, account_id_1, std::move(*detached));
+  return true;
+}
+
+std::optional<int> ShardedBankingSystem::GetBalance(int timestamp,
+                                                    const std::string& account_id,
+                                                    int time_at) {
+  Shard& shard = shardFor(account_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.impl.GetBalance(timestamp, account_id, time_at);
+}
+
+std::vector<BatchResult> ShardedBankingSystem::ApplyBatch(
+    int timestamp, const std::vector<BatchOperation>& operations) {
+  std::vector<size_t> indices;
+  indices.reserve(operations.size() * 2);
+  for (const auto& op : operations) {
+    indices.push_back(shardIndex(op.account_id));
+    if (op.type == BatchOperation::Type::TRANSFER) {
+      indices.push_back(shardIndex(op.target_account_id));
+    }
+  }
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+  auto locks = lockShards(indices);
+  if (indices.size() == 1) {
+    return shards_[indices.front()]->impl.ApplyBatch(timestamp, operations);
+  }
+
+  std::vector<BatchResult> results;
+  results.reserve(operations.size());
+  for (const auto& op : operations) {
+    BankingSystemImpl& impl = shardFor(op.account_id).impl;
+    BatchResult result;
+    switch (op.type) {
+      case BatchOperation::Type::CREATE_ACCOUNT:
+        result.success = impl.CreateAccount(timestamp, op.account_id);
+        break;
+      case BatchOperation::Type::DEPOSIT:
+        result.balance = impl.Deposit(timestamp, op.account_id, op.amount);
+        result.success = result.balance.has_value();
+        break;
+      case BatchOperation::Type::TRANSFER:
+        result.balance = transferLocked(timestamp, op.account_id, op.target_account_id, op.amount);
+        result.success = result.balance.has_value();
+        break;
+      case BatchOperation::Type::SCHEDULE_PAYMENT:
+        result.payment_id = impl.SchedulePayment(timestamp, op.account_id, op.amount, op.delay);
+        result.success = result.payment_id.has_value();
+        break;
+      case BatchOperation::Type::CANCEL_PAYMENT:
+        result.success = impl.CancelPayment(timestamp, op.account_id, op.payment_id);
+        break;
+    }
+    results.push_back(std::move(result));
+  }
+  return results;
+}
+
+void ShardedBankingSystem::ReclaimMemory() {
+  BankingSystemImpl::MemoryUsage usage;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->impl.ReleaseSpareCapacity();
+    usage += shard->impl.memoryUsage();
+  }
+  usage.publish();
+}
+
+}  // namespace banking
@@ -1,6 +1,5 @@
 #include "banking_system_thread_safe.hpp"
-
-#include <algorithm>
+#include "banking_system_persistent.hpp"
 
 namespace banking {
 
@@ -8,92 +7,89 @@ BankingSystemThreadSafe::BankingSystemThreadSafe(std::unique_ptr<BankingSystem>
     : impl_(std::move(impl)) {
 }
 
+BankingSystemThreadSafe::BankingSystemThreadSafe(std::unique_ptr<BankingSystemPersistent> impl)
+    : persistent_(impl.get()) {
+  persistent_->deferCommits();
+  impl_ = std::move(impl);
+}
+
+template <typename Result, typename Call>
+Result BankingSystemThreadSafe::commitAfterUnlock(Call call, Result failed) {
+  Result result;
+  BankingSystemPersistent::PendingCommit commit;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    result = call();
+    if (persistent_) commit = persistent_->takeCommit();
+  }
+  if (persistent_ && !persistent_->awaitCommit(std::move(commit))) {
+    return failed;
+  }
+  return result;
+}
+
 bool BankingSystemThreadSafe::CreateAccount(int timestamp, const std::string& account_id) {
-  // Global lock for account creation to ensure uniqueness
-  std::unique_lock<std::shared_mutex> global_lock(global_mutex_);
-  return impl_->CreateAccount(timestamp, account_id);
+  return commitAfterUnlock([&] { return impl_->CreateAccount(timestamp, account_id); }, false);
 }
 
 std::optional<int> BankingSystemThreadSafe::Deposit(int timestamp,
                                                    const std::string& account_id,
                                                    int amount) {
-  std::unique_lock<std::shared_mutex> account_lock(getAccountMutex(account_id));
-  return impl_->Deposit(timestamp, account_id, amount);
+  return commitAfterUnlock([&] { return impl_->Deposit(timestamp, account_id, amount); },
+                           std::optional<int>{});
 }
 
 std::optional<int> BankingSystemThreadSafe::Transfer(int timestamp,
                                                     const std::string& source_account_id,
                                                     const std::string& target_account_id,
                                                     int amount) {
-  // Acquire locks in consistent order to prevent deadlocks
-  std::unique_lock<std::shared_mutex> source_lock(getAccountMutex(source_account_id));
-  std::unique_lock<std::shared_mutex> target_lock(getAccountMutex(target_account_id));
-
-  // Ensure consistent locking order
-  if (source_account_id > target_account_id) {
-    source_lock.swap(target_lock);
-  }
-
-  return impl_->Transfer(timestamp, source_account_id, target_account_id, amount);
+  return commitAfterUnlock(
+      [&] { return impl_->Transfer(timestamp, source_account_id, target_account_id, amount); },
+      std::optional<int>{});
 }
 
 std::vector<std::string> BankingSystemThreadSafe::TopSpenders(int timestamp, int n) {
-  // Global read lock for top spenders operation
-  std::shared_lock<std::shared_mutex> global_lock(global_mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
   return impl_->TopSpenders(timestamp, n);
 }
 
 std::optional<std::string> BankingSystemThreadSafe::SchedulePayment(int timestamp,
                                                                    const std::string& account_id,
                                                                    int amount, int delay) {
-  std::unique_lock<std::shared_mutex> account_lock(getAccountMutex(account_id));
-  return impl_->SchedulePayment(timestamp, account_id, amount, delay);
+  return commitAfterUnlock([&] { return impl_->SchedulePayment(timestamp, account_id, amount, delay); },
+                           std::optional<std::string>{});
 }
 
 bool BankingSystemThreadSafe::CancelPayment(int timestamp,
                                            const std::string& account_id,
                                            const std::string& payment_id) {
-  std::unique_lock<std::shared_mutex> account_lock(getAccountMutex(account_id));
-  return impl_->CancelPayment(timestamp, account_id, payment_id);
+  return commitAfterUnlock([&] { return impl_->CancelPayment(timestamp, account_id, payment_id); }, false);
 }
 
 bool BankingSystemThreadSafe::MergeAccounts(int timestamp,
                                            const std::string& account_id_1,
                                            const std::string& account_id_2) {
-  // Acquire locks in consistent order
-  std::unique_lock<std::shared_mutex> lock1(getAccountMutex(account_id_1));
-  std::unique_lock<std::shared_mutex> lock2(getAccountMutex(account_id_2));
-
-  // Ensure consistent locking order
-  if (account_id_1 > account_id_2) {
-    lock1.swap(lock2);
-  }
-
-  return impl_->MergeAccounts(timestamp, account_id_1, account_id_2);
+  return commitAfterUnlock([&] { return impl_->MergeAccounts(timestamp, account_id_1, account_id_2); },
+                           false);
 }
 
 std::optional<int> BankingSystemThreadSafe::GetBalance(int timestamp,
                                                       const std::string& account_id,
                                                       int time_at) {
-  // Read lock for balance queries
-  std::shared_lock<std::shared_mutex> account_lock(getAccountMutex(account_id));
+  std::lock_guard<std::mutex> lock(mutex_);
   return impl_->GetBalance(timestamp, account_id, time_at);
 }
 
-std::shared_mutex& BankingSystemThreadSafe::getAccountMutex(const std::string& account_id) {
-  // Double-checked locking pattern for thread-safe mutex creation
-  auto it = account_mutexes_.find(account_id);
-  if (it != account_mutexes_.end()) {
-    return *it->second;
-  }
+std::vector<BatchResult> BankingSystemThreadSafe::ApplyBatch(
+    int timestamp, const std::vector<BatchOperation>& operations) {
+  // The engine persists a batch as one write, so a failed commit fails all of it
+  return commitAfterUnlock([&] { return impl_->ApplyBatch(timestamp, operations); },
+                           std::vector<BatchResult>(operations.size()));
+}
 
-  // Create new mutex for this account
-  std::unique_lock<std::shared_mutex> global_lock(global_mutex_);
-  auto& mutex_ptr = account_mutexes_[account_id];
-  if (!mutex_ptr) {
-    mutex_ptr = std::make_unique<std::shared_mutex>();
-  }
-  return *mutex_ptr;
+void BankingSystemThreadSafe::ReclaimMemory() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  impl_->ReclaimMemory();
 }
 
 }  // namespace banking
@@ -0,0 +1,562 @@
+#include "../banking_core_impl.hpp"
+#include "../include/banking_server.hpp"
+#include "../include/concurrent/lockfree_queue.hpp"
+#include "../include/network/binary_codec.hpp"
+#include "../include/network/protocol.hpp"
+#include "../include/network/tcp_client.hpp"
+#include "../include/observability/latency_histogram.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Benchmarks for regression checks. Run with
+//   banking_bench --benchmark_out=results.json --benchmark_out_format=json
+// to keep results for comparison; see parseLoadFlags() for the load generator's options.
+
+using namespace banking;
+namespace protocol = banking::network::protocol;
+
+namespace {
+
+std::string accountName(int64_t index) {
+  return "acc" + std::to_string(index);
+}
+
+/**
+ * Zipfian account picker: account i is chosen with probability proportional
+ * to 1 / (i + 1)^skew, so skew 0 is uniform and skew near 1 concentrates
+ * traffic on a few hot accounts.
+ */
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(size_t count, double skew, uint64_t seed) : cdf_(count), rng_(seed) {
+    double total = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+      total += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+      cdf_[i] = total;
+    }
+    for (double& value : cdf_) value /= total;
+  }
+
+  size_t next() {
+    const double u = uniform_(rng_);
+    return static_cast<size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+  }
+
+ private:
+  std::vector<double> cdf_;
+  std::mt19937_64 rng_;
+  std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+};
+
+// Engine with `accounts` funded accounts; returns the next free timestamp
+int populate(BankingSystemImpl& system, int64_t accounts) {
+  int timestamp = 1;
+  for (int64_t i = 0; i < accounts; ++i) {
+    system.CreateAccount(timestamp, accountName(i));
+    system.Deposit(timestamp, accountName(i), 1000000);
+    ++timestamp;
+  }
+  return timestamp;
+}
+
+// ---------------------------------------------------------------------------
+// Engine operations
+// ---------------------------------------------------------------------------
+
+void BM_EngineDeposit(benchmark::State& state) {
+  const int64_t accounts = state.range(0);
+  BankingSystemImpl system;
+  int timestamp = populate(system, accounts);
+  std::vector<std::string> names;
+  for (int64_t i = 0; i < accounts; ++i) names.push_back(accountName(i));
+
+  size_t next = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(system.Deposit(timestamp++, names[next], 10));
+    next = (next + 7919) % names.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EngineDeposit)->Arg(100)->Arg(10000)->Arg(100000);
+
+void BM_EngineTransfer(benchmark::State& state) {
+  const int64_t accounts = state.range(0);
+  BankingSystemImpl system;
+  int timestamp = populate(system, accounts);
+  std::vector<std::string> names;
+  for (int64_t i = 0; i < accounts; ++i) names.push_back(accountName(i));
+
+  size_t next = 0;
+  for (auto _ : state) {
+    const size_t target = (next + 1) % names.size();
+    benchmark::DoNotOptimize(system.Transfer(timestamp++, names[next], names[target], 1));
+    next = (next + 7919) % names.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EngineTransfer)->Arg(100)->Arg(10000)->Arg(100000);
+
+void BM_EngineTopSpenders(benchmark::State& state) {
+  const int64_t accounts = state.range(0);
+  BankingSystemImpl system;
+  int timestamp = populate(system, accounts);
+  for (int64_t i = 0; i + 1 < accounts; ++i) {
+    system.Transfer(timestamp++, accountName(i), accountName(i + 1), static_cast<int>(i % 1000) + 1);
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(system.TopSpenders(timestamp, 10));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EngineTopSpenders)->Arg(100)->Arg(10000)->Arg(100000);
+
+// Historical balance lookups on one account with `depth` balance changes
+void BM_EngineHistoricalBalance(benchmark::State& state) {
+  const int64_t depth = state.range(0);
+  BankingSystemImpl system;
+  system.CreateAccount(1, "acc");
+  int timestamp = 2;
+  for (int64_t i = 0; i < depth; ++i) {
+    system.Deposit(timestamp++, "acc", 1);
+  }
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> time_at(2, timestamp - 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(system.GetBalance(timestamp, "acc", time_at(rng)));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EngineHistoricalBalance)->Arg(100)->Arg(10000)->Arg(1000000);
+
+// ---------------------------------------------------------------------------
+// LockFreeQueue
+// ---------------------------------------------------------------------------
+
+// Each iteration moves a fixed number of items from `producers` to `consumers` threads
+void BM_LockFreeQueue(benchmark::State& state) {
+  const int producers = static_cast<int>(state.range(0));
+  const int consumers = static_cast<int>(state.range(1));
+  constexpr int kItemsPerProducer = 50000;
+  const int64_t total = int64_t{kItemsPerProducer} * producers;
+
+  for (auto _ : state) {
+    concurrent::LockFreeQueue<int64_t> queue;
+    std::atomic<int64_t> consumed{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+      threads.emplace_back([&queue] {
+        for (int i = 0; i < kItemsPerProducer; ++i) queue.enqueue(i);
+      });
+    }
+    for (int c = 0; c < consumers; ++c) {
+      threads.emplace_back([&] {
+        while (consumed.load(std::memory_order_relaxed) < total) {
+          if (auto item = queue.dequeue()) {
+            benchmark::DoNotOptimize(*item);
+            consumed.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+  state.SetItemsProcessed(state.iterations() * total);
+}
+BENCHMARK(BM_LockFreeQueue)
+    ->ArgNames({"producers", "consumers"})
+    ->Args({1, 1})->Args({4, 1})->Args({8, 1})->Args({4, 4})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// ---------------------------------------------------------------------------
+// Protocol
+// ---------------------------------------------------------------------------
+
+protocol::Request sampleTransfer() {
+  return protocol::Request::transfer(1700000000, "client_123", "session_client_123_1000",
+                                     "acc_source", "acc_target", 2500);
+}
+
+// range(0): 0 = JSON, 1 = binary
+protocol::Encoding encodingArg(const benchmark::State& state) {
+  return state.range(0) == 0 ? protocol::Encoding::JSON : protocol::Encoding::BINARY;
+}
+
+void BM_EncodeRequest(benchmark::State& state) {
+  const protocol::Request request = sampleTransfer();
+  const protocol::Encoding encoding = encodingArg(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(protocol::encodeRequest(request, encoding));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EncodeRequest)->ArgName("binary")->Arg(0)->Arg(1);
+
+void BM_DecodeRequest(benchmark::State& state) {
+  const std::string bytes = protocol::encodeRequest(sampleTransfer(), encodingArg(state));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(protocol::decodeRequest(bytes));
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(bytes.size()));
+}
+BENCHMARK(BM_DecodeRequest)->ArgName("binary")->Arg(0)->Arg(1);
+
+// Zero-copy binary decode, as the server does it
+void BM_DecodeRequestView(benchmark::State& state) {
+  const std::string bytes = protocol::encodeRequest(sampleTransfer(), protocol::Encoding::BINARY);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(protocol::BinaryCodec::decodeRequest(bytes));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeRequestView);
+
+void BM_EncodeResponse(benchmark::State& state) {
+  const protocol::Response response = protocol::Response::transferResult(997500, 1700000000);
+  const protocol::Encoding encoding = encodingArg(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(protocol::encodeResponse(response, encoding));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EncodeResponse)->ArgName("binary")->Arg(0)->Arg(1);
+
+// Frame then extract 64 binary requests per iteration; range(0) is the framing version
+void BM_Framing(benchmark::State& state) {
+  const auto version = static_cast<protocol::FramingVersion>(state.range(0));
+  const std::string payload = protocol::encodeRequest(sampleTransfer(), protocol::Encoding::BINARY);
+  constexpr int kFrames = 64;
+
+  std::string wire;
+  protocol::FrameBuffer buffer;
+  for (auto _ : state) {
+    wire.clear();
+    for (int i = 0; i < kFrames; ++i) {
+      protocol::MessageFramer::appendFrame(wire, payload, version, static_cast<uint32_t>(i));
+    }
+    buffer.append(wire.data(), wire.size());
+
+    std::string_view frame;
+    uint32_t request_id;
+    while (protocol::MessageFramer::nextFrame(buffer, version, frame, request_id)) {
+      benchmark::DoNotOptimize(frame.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kFrames);
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(wire.size()));
+}
+BENCHMARK(BM_Framing)->ArgName("version")->Arg(1)->Arg(2)->Arg(3);
+
+// ---------------------------------------------------------------------------
+// Network load generator
+// ---------------------------------------------------------------------------
+
+struct LoadOptions {
+  int port = 19090;
+  int clients = 8;
+  int accounts = 10000;
+  double skew = 0.99;     // Zipfian exponent; 0 = uniform
+  double rate = 0.0;      // Requests per second across clients; 0 = closed loop
+  int seconds = 3;
+  int pipeline = 1;       // Closed loop: requests each client keeps in flight
+  bool binary = true;
+  bool enabled = true;
+};
+
+LoadOptions load_options;
+
+/**
+ * One simulated client: a TCPClient with its own session, account picker and
+ * latency histogram. Operations are 40% deposits, 40% transfers and 20%
+ * balance reads.
+ */
+class LoadClient {
+ public:
+  LoadClient(const LoadOptions& options, int index, std::atomic<int>& clock)
+      : options_(options), client_("127.0.0.1", options.port),
+        client_id_("load_" + std::to_string(index)), clock_(clock),
+        accounts_(static_cast<size_t>(options.accounts), options.skew, 1000 + index), rng_(index) {}
+
+  bool connect() {
+    if (!client_.connect()) return false;
+    auto request = protocol::Request::authenticate(clock_++, client_id_, "load");
+    request.client_id = client_id_;
+    const auto response = protocol::decodeResponse(client_.sendRequest(encode(request)));
+    if (response.status != protocol::Status::SUCCESS || !response.session_token) return false;
+    session_token_ = *response.session_token;
+    return true;
+  }
+
+  std::string nextRequest() {
+    const int timestamp = clock_.fetch_add(1, std::memory_order_relaxed);
+    const size_t source = accounts_.next();
+    const std::string account = accountName(static_cast<int64_t>(source));
+    const int choice = static_cast<int>(rng_() % 10);
+    if (choice < 4) {
+      return encode(protocol::Request::deposit(timestamp, client_id_, session_token_, account, 10));
+    }
+    if (choice < 8) {
+      size_t target_index = accounts_.next();
+      if (target_index == source) target_index = (source + 1) % static_cast<size_t>(options_.accounts);
+      const std::string target = accountName(static_cast<int64_t>(target_index));
+      return encode(protocol::Request::transfer(timestamp, client_id_, session_token_, account, target, 1));
+    }
+    return encode(protocol::Request::getBalance(timestamp, client_id_, session_token_, account, timestamp));
+  }
+
+  void record(std::chrono::steady_clock::time_point started, const std::string& response) {
+    latency_.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - started).count()));
+    if (protocol::decodeResponse(response).status != protocol::Status::SUCCESS) ++errors_;
+  }
+
+  // Keep `pipeline` requests in flight until `deadline`
+  void runClosedLoop(std::chrono::steady_clock::time_point deadline) {
+    std::deque<std::pair<std::chrono::steady_clock::time_point, std::future<std::string>>> in_flight;
+    while (std::chrono::steady_clock::now() < deadline) {
+      while (static_cast<int>(in_flight.size()) < options_.pipeline) {
+        in_flight.emplace_back(std::chrono::steady_clock::now(), client_.sendRequestAsync(nextRequest()));
+      }
+      complete(in_flight.front());
+      in_flight.pop_front();
+    }
+    for (auto& request : in_flight) complete(request);
+  }
+
+  /**
+   * Send at a fixed `rate` regardless of responses. Latency is measured from
+   * each request's scheduled send time, so a stalled server is charged for
+   * the requests it delayed instead of hiding them (coordinated omission).
+   */
+  void runOpenLoop(std::chrono::steady_clock::time_point deadline, double rate) {
+    using Pending = std::pair<std::chrono::steady_clock::time_point, std::future<std::string>>;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Pending> pending;
+    bool done = false;
+
+    std::thread collector([&] {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true) {
+        cv.wait(lock, [&] { return done || !pending.empty(); });
+        if (pending.empty()) return;
+        Pending request = std::move(pending.front());
+        pending.pop_front();
+        lock.unlock();
+        complete(request);
+        lock.lock();
+      }
+    });
+
+    const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / rate));
+    auto scheduled = std::chrono::steady_clock::now();
+    while (scheduled < deadline) {
+      std::this_thread::sleep_until(scheduled);
+      auto future = client_.sendRequestAsync(nextRequest());
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.emplace_back(scheduled, std::move(future));
+      }
+      cv.notify_one();
+      scheduled += interval;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      done = true;
+    }
+    cv.notify_one();
+    collector.join();
+  }
+
+  const observability::LatencyHistogram& latency() const { return latency_; }
+  uint64_t errors() const { return errors_; }
+
+ private:
+  std::string encode(const protocol::Request& request) const {
+    return protocol::encodeRequest(request, options_.binary ? protocol::Encoding::BINARY
+                                                            : protocol::Encoding::JSON);
+  }
+
+  void complete(std::pair<std::chrono::steady_clock::time_point, std::future<std::string>>& request) {
+    try {
+      record(request.first, request.second.get());
+    } catch (const std::exception&) {
+      ++errors_;
+    }
+  }
+
+  const LoadOptions& options_;
+  network::TCPClient client_;
+  std::string client_id_;
+  std::string session_token_;
+  std::atomic<int>& clock_;
+  ZipfianGenerator accounts_;
+  std::mt19937 rng_;
+  observability::LatencyHistogram latency_;
+  uint64_t errors_ = 0;
+};
+
+// Drive a BankingServer on options.port for options.seconds and report TPS and latency counters
+void runServerLoad(benchmark::State& state, const LoadOptions& options) {
+  BankingServer server(options.port, 4, 3600);
+  if (!server.start()) {
+    state.SkipWithError("Failed to start the banking server");
+    return;
+  }
+
+  std::atomic<int> clock{1};
+  std::vector<std::unique_ptr<LoadClient>> clients;
+  for (int i = 0; i < options.clients; ++i) {
+    clients.push_back(std::make_unique<LoadClient>(options, i, clock));
+    if (!clients.back()->connect()) {
+      state.SkipWithError("Failed to connect a load client");
+      server.stop();
+      return;
+    }
+  }
+
+  // Accounts the generators pick from, funded so transfers mostly succeed
+  {
+    network::TCPClient setup("127.0.0.1", options.port);
+    if (!setup.connect()) {
+      state.SkipWithError("Failed to connect the setup client");
+      server.stop();
+      return;
+    }
+    auto auth = protocol::Request::authenticate(clock++, "load_setup", "load");
+    auth.client_id = "load_setup";
+    const auto session =
+        protocol::decodeResponse(setup.sendRequest(protocol::encodeRequest(auth, protocol::Encoding::BINARY)));
+    const std::string token = session.session_token.value_or("");
+    std::vector<std::future<std::string>> created;
+    for (int i = 0; i < options.accounts; ++i) {
+      const int timestamp = clock++;
+      auto create = protocol::Request::createAccount(timestamp, "load_setup", token, accountName(i));
+      auto fund = protocol::Request::deposit(timestamp, "load_setup", token, accountName(i), 1000000);
+      created.push_back(setup.sendRequestAsync(protocol::encodeRequest(
+          protocol::Request::batch(timestamp, "load_setup", token, {create, fund}), protocol::Encoding::BINARY)));
+    }
+    for (auto& response : created) response.get();
+  }
+
+  for (auto _ : state) {
+    const auto started = std::chrono::steady_clock::now();
+    const auto deadline = started + std::chrono::seconds(options.seconds);
+    std::vector<std::thread> threads;
+    for (auto& client : clients) {
+      threads.emplace_back([&, raw = client.get()] {
+        if (options.rate > 0.0) {
+          raw->runOpenLoop(deadline, options.rate / options.clients);
+        } else {
+          raw->runClosedLoop(deadline);
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    state.SetIterationTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+  }
+
+  observability::LatencyHistogram merged;
+  uint64_t errors = 0;
+  for (const auto& client : clients) {
+    merged.merge(client->latency());
+    errors += client->errors();
+  }
+  const observability::LatencySummary summary = merged.summary();
+  state.counters["tps"] = benchmark::Counter(static_cast<double>(merged.count()), benchmark::Counter::kIsRate);
+  state.counters["p50_us"] = summary.p50_us;
+  state.counters["p99_us"] = summary.p99_us;
+  state.counters["p999_us"] = summary.p999_us;
+  state.counters["max_us"] = summary.max_us;
+  state.counters["errors"] = static_cast<double>(errors);
+  state.SetItemsProcessed(static_cast<int64_t>(merged.count()));
+
+  server.stop();
+}
+
+/**
+ * Load generator flags, consumed before Google Benchmark sees the rest:
+ *   --load=false            skip the network benchmark
+ *   --load_port=19090       port for the in-process server
+ *   --load_clients=8        concurrent TCPClients
+ *   --load_accounts=10000   accounts to spread requests over
+ *   --load_skew=0.99        Zipfian skew of account choice (0 = uniform)
+ *   --load_rate=0           open loop at this total requests/second; 0 = closed loop
+ *   --load_pipeline=1       closed loop: requests in flight per client
+ *   --load_seconds=3        measurement time
+ *   --load_encoding=binary  or json
+ */
+void parseLoadFlags(int& argc, char** argv) {
+  int kept = 1;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto value = [&](const char* name) -> const char* {
+      const std::string prefix = std::string("--") + name + "=";
+      return arg.compare(0, prefix.size(), prefix) == 0 ? argv[i] + prefix.size() : nullptr;
+    };
+    if (const char* v = value("load")) {
+      load_options.enabled = std::string(v) != "false";
+    } else if (const char* v = value("load_port")) {
+      load_options.port = std::atoi(v);
+    } else if (const char* v = value("load_clients")) {
+      load_options.clients = std::max(1, std::atoi(v));
+    } else if (const char* v = value("load_accounts")) {
+      load_options.accounts = std::max(2, std::atoi(v));
+    } else if (const char* v = value("load_skew")) {
+      load_options.skew = std::atof(v);
+    } else if (const char* v = value("load_rate")) {
+      load_options.rate = std::atof(v);
+    } else if (const char* v = value("load_pipeline")) {
+      load_options.pipeline = std::max(1, std::atoi(v));
+    } else if (const char* v = value("load_seconds")) {
+      load_options.seconds = std::max(1, std::atoi(v));
+    } else if (const char* v = value("load_encoding")) {
+      load_options.binary = std::string(v) != "json";
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  parseLoadFlags(argc, argv);
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+  if (load_options.enabled) {
+    const std::string name = std::string("BM_ServerLoad/") + (load_options.rate > 0.0 ? "open" : "closed") +
+                             "/clients:" + std::to_string(load_options.clients) +
+                             "/skew:" + std::to_string(load_options.skew).substr(0, 4);
+    benchmark::RegisterBenchmark(name.c_str(), [](benchmark::State& state) { runServerLoad(state, load_options); })
+        ->Iterations(1)
+        ->UseManualTime()
+        ->Unit(benchmark::kMillisecond);
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
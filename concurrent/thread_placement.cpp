@@ -0,0 +1,137 @@
+#include "thread_placement.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace banking {
+namespace concurrent {
+
+namespace {
+
+// Parse a kernel CPU list such as "0-3,8-11"
+std::vector<int> parseCpuList(const std::string& list) {
+  std::vector<int> cpus;
+  std::stringstream ranges(list);
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    if (range.empty() || range == "\n") continue;
+    const size_t dash = range.find('-');
+    const int first = std::atoi(range.c_str());
+    const int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::string formatCpuList(const std::vector<int>& cpus) {
+  std::string out;
+  for (size_t i = 0; i < cpus.size();) {
+    size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+    if (!out.empty()) out += ',';
+    out += std::to_string(cpus[i]);
+    if (j > i) out += "-" + std::to_string(cpus[j]);
+    i = j + 1;
+  }
+  return out;
+}
+
+}  // namespace
+
+CpuTopology CpuTopology::detect() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  const bool have_mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+  auto usable = [&](int cpu) { return !have_mask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)); };
+
+  CpuTopology topology;
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+    const std::string name = entry.path().filename().string();
+    if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+        !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+      continue;
+    }
+    std::ifstream cpulist(entry.path() / "cpulist");
+    std::string list;
+    std::getline(cpulist, list);
+
+    Node node;
+    node.id = std::atoi(name.c_str() + 4);
+    for (int cpu : parseCpuList(list)) {
+      if (usable(cpu)) node.cpus.push_back(cpu);
+    }
+    if (!node.cpus.empty()) topology.nodes.push_back(std::move(node));
+  }
+  std::sort(topology.nodes.begin(), topology.nodes.end(),
+            [](const Node& a, const Node& b) { return a.id < b.id; });
+
+  if (topology.nodes.empty()) {
+    Node node;
+    const int count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int cpu = 0; cpu < std::max(count, have_mask ? CPU_SETSIZE : 0); ++cpu) {
+      if (have_mask ? CPU_ISSET(cpu, &allowed) : cpu < count) node.cpus.push_back(cpu);
+    }
+    topology.nodes.push_back(std::move(node));
+  }
+  return topology;
+}
+
+size_t CpuTopology::cpuCount() const {
+  size_t count = 0;
+  for (const Node& node : nodes) {
+    count += node.cpus.size();
+  }
+  return count;
+}
+
+int CpuTopology::nodeOf(int cpu) const {
+  for (const Node& node : nodes) {
+    if (std::binary_search(node.cpus.begin(), node.cpus.end(), cpu)) return node.id;
+  }
+  return -1;
+}
+
+std::string CpuTopology::describe() const {
+  std::string out;
+  for (const Node& node : nodes) {
+    if (!out.empty()) out += "; ";
+    out += "node" + std::to_string(node.id) + ": " + formatCpuList(node.cpus);
+  }
+  return out;
+}
+
+ThreadPlacement ThreadPlacement::shardPerCore(const CpuTopology& topology, size_t reactors,
+                                              size_t fraud_workers) {
+  // Interleave nodes: node0's first CPU, node1's first CPU, node0's second, ...
+  std::vector<int> order;
+  for (size_t rank = 0; order.size() < topology.cpuCount(); ++rank) {
+    for (const CpuTopology::Node& node : topology.nodes) {
+      if (rank < node.cpus.size()) order.push_back(node.cpus[rank]);
+    }
+  }
+
+  ThreadPlacement placement;
+  if (order.empty()) return placement;
+
+  // Too few CPUs to dedicate any: every kind of thread shares all of them
+  if (order.size() <= reactors + fraud_workers) {
+    for (size_t i = 0; i < reactors; ++i) placement.reactor_cpus.push_back(order[i % order.size()]);
+    for (size_t i = 0; i < fraud_workers; ++i) placement.fraud_cpus.push_back(order[i % order.size()]);
+    placement.worker_cpus = order;
+    return placement;
+  }
+
+  placement.reactor_cpus.assign(order.begin(), order.begin() + reactors);
+  placement.fraud_cpus.assign(order.begin() + reactors, order.begin() + reactors + fraud_workers);
+  placement.worker_cpus.assign(order.begin() + reactors + fraud_workers, order.end());
+  return placement;
+}
+
+}  // namespace concurrent
+}  // namespace banking
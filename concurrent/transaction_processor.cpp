@@ -1,21 +1,62 @@
 #include "transaction_processor.hpp"
-#include "../network/protocol.hpp"
+#include "operation_table.hpp"
+#include "thread_placement.hpp"
+#include "observability/metrics.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <functional>
 #include <iostream>
 
 namespace banking {
 namespace concurrent {
 
+namespace protocol = network::protocol;
+
+namespace {
+
+// Answers to requests no worker ran
+constexpr const char* kStoppedMessage = "Transaction processor stopped";
+constexpr const char* kQueueFullMessage = "Transaction queue full";
+
+}  // namespace
+
 TransactionProcessor::TransactionProcessor(BankingSystem* banking_system,
                                          size_t num_worker_threads,
                                          size_t batch_size)
+    : TransactionProcessor(banking_system, [&] {
+        Config config;
+        config.num_workers = num_worker_threads;
+        config.batch_size = batch_size;
+        return config;
+      }()) {
+}
+
+TransactionProcessor::TransactionProcessor(BankingSystem* banking_system, const Config& config)
     : banking_system_(banking_system),
-      num_workers_(num_worker_threads),
-      batch_size_(batch_size),
+      num_workers_(std::max<size_t>(1, config.num_workers)),
+      batch_size_(config.batch_size),
+      dispatch_mode_(config.dispatch_mode),
+      spin_iterations_(config.spin_iterations),
+      worker_cpus_(config.worker_cpus),
       running_(false),
+      next_batch_id_(0),
       transactions_processed_(0),
+      transactions_rejected_(0),
       total_processing_time_us_(0) {
+  auto& metrics = observability::getGlobalMetrics();
+  for (size_t type = 0; type < protocol::kMessageTypeCount; ++type) {
+    const observability::Labels labels = {
+        {"operation", protocol::messageTypeName(static_cast<protocol::MessageType>(type))}};
+    queue_latency_[type] = &metrics.latency("transaction_queue_seconds", labels);
+    execute_latency_[type] = &metrics.latency("transaction_execute_seconds", labels);
+  }
+  throughput_ = &metrics.rate("transactions_throughput_tps");
+
+  size_t num_lanes = dispatch_mode_ == DispatchMode::ACCOUNT_AFFINITY ? num_workers_ : 1;
+  for (size_t i = 0; i < num_lanes; ++i) {
+    lanes_.push_back(std::make_unique<Lane>(config.queue_capacity));
+  }
 }
 
 TransactionProcessor::~TransactionProcessor() {
@@ -27,10 +68,15 @@ bool TransactionProcessor::start() {
 
   running_ = true;
 
-  // Start worker threads
+  // Start worker threads; with one lane they all share it
   for (size_t i = 0; i < num_workers_; ++i) {
+    Lane& lane = *lanes_[i % lanes_.size()];
     worker_threads_.emplace_back(
-        std::make_unique<std::thread>(&TransactionProcessor::workerThread, this));
+        std::make_unique<std::thread>(&TransactionProcessor::workerThread, this, std::ref(lane)));
+    const int cpu = cpuFor(worker_cpus_, i);
+    if (!pinThread(*worker_threads_.back(), cpu)) {
+      std::cerr << "Could not pin transaction worker " << i << " to CPU " << cpu << std::endl;
+    }
   }
 
   std::cout << "Transaction processor started with " << num_workers_ << " worker threads" << std::endl;
@@ -40,11 +86,15 @@ bool TransactionProcessor::start() {
 void TransactionProcessor::stop() {
   if (!running_) return;
 
-  running_ = false;
-
-  // Wake up workers by submitting dummy transactions
-  for (size_t i = 0; i < num_workers_; ++i) {
-    submitTransaction("");  // Empty string signals shutdown
+  // Workers drain whatever is still queued before exiting. No multi-lane request
+  // is queued after this, so a worker never waits on a part nobody will dequeue
+  {
+    std::lock_guard<std::mutex> lock(submit_mutex_);
+    running_ = false;
+  }
+  for (auto& lane : lanes_) {
+    std::lock_guard<std::mutex> lock(lane->wait_mutex);
+    lane->not_empty.notify_all();
   }
 
   // Wait for all workers to finish
@@ -55,11 +105,126 @@ void TransactionProcessor::stop() {
   }
   worker_threads_.clear();
 
+  // Anything that raced in after the workers exited is rejected, not dropped
+  for (auto& lane : lanes_) {
+    while (auto task = lane->pop()) {
+      if (!task->primary) continue;
+      task->done(protocol::Response::error(
+          protocol::Status::ERROR, kStoppedMessage, task->request.timestamp));
+    }
+  }
+
   std::cout << "Transaction processor stopped" << std::endl;
 }
 
+std::future<protocol::Response> TransactionProcessor::submitRequest(protocol::Request request) {
+  auto result = std::make_shared<std::promise<protocol::Response>>();
+  auto future = result->get_future();
+  submitRequest(std::move(request), [result](protocol::Response response) {
+    result->set_value(std::move(response));
+  });
+  return future;
+}
+
+void TransactionProcessor::submitRequest(protocol::Request request, ResponseCallback done) {
+  Task task;
+  task.request = std::move(request);
+  task.done = std::move(done);
+
+  if (!running_) {
+    task.done(protocol::Response::error(
+        protocol::Status::ERROR, kStoppedMessage, task.request.timestamp));
+    return;
+  }
+
+  const std::vector<Lane*> lanes = lanesFor(task.request);
+  task.enqueued = std::chrono::steady_clock::now();
+  const int timestamp = task.request.timestamp;
+  auto reject = [&](ResponseCallback& done) {
+    // Backpressure: the caller learns now instead of the queue growing without bound
+    transactions_rejected_.fetch_add(1);
+    done(protocol::Response::error(protocol::Status::ERROR, kQueueFullMessage, timestamp));
+  };
+
+  if (lanes.size() == 1) {
+    if (!lanes.front()->push(std::move(task))) return reject(task.done);
+    wake(*lanes.front());
+    return;
+  }
+
+  auto rendezvous = std::make_shared<Rendezvous>(lanes.size());
+  task.rendezvous = rendezvous;
+  std::unique_lock<std::mutex> lock(submit_mutex_);
+  if (!running_) {
+    lock.unlock();
+    task.done(protocol::Response::error(protocol::Status::ERROR, kStoppedMessage, timestamp));
+    return;
+  }
+  // Placeholders first: a worker that dequeues the request itself finds the rest already queued
+  size_t queued = 1;
+  for (; queued < lanes.size(); ++queued) {
+    Task placeholder;
+    placeholder.primary = false;
+    placeholder.rendezvous = rendezvous;
+    if (!lanes[queued]->push(std::move(placeholder))) break;
+  }
+  if (queued < lanes.size() || !lanes.front()->push(std::move(task))) {
+    finish(*rendezvous);  // Releases workers already waiting on queued placeholders
+    lock.unlock();
+    for (size_t i = 1; i < queued; ++i) wake(*lanes[i]);
+    return reject(task.done);
+  }
+  lock.unlock();
+  for (Lane* lane : lanes) wake(*lane);
+}
+
+void TransactionProcessor::wake(Lane& lane) {
+  // Pairs with the fence in waitForWork: either the worker's final check sees
+  // this task, or this load sees the worker registered as a sleeper
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (lane.sleepers.load() > 0) {
+    std::lock_guard<std::mutex> lock(lane.wait_mutex);
+    lane.not_empty.notify_one();
+  }
+}
+
+bool TransactionProcessor::meet(Task& task) {
+  const std::shared_ptr<Rendezvous> rendezvous = task.rendezvous;
+  std::unique_lock<std::mutex> lock(rendezvous->mutex);
+  if (rendezvous->done) return false;  // Abandoned at submission
+  if (task.primary) rendezvous->task = std::move(task);
+  if (--rendezvous->remaining > 0) {
+    // Hold this lane until the request has run, so nothing queued after it overtakes it
+    rendezvous->finished.wait(lock, [&] { return rendezvous->done; });
+    return false;
+  }
+  task = std::move(*rendezvous->task);
+  rendezvous->task.reset();
+  return true;
+}
+
+void TransactionProcessor::finish(Rendezvous& rendezvous) {
+  std::lock_guard<std::mutex> lock(rendezvous.mutex);
+  rendezvous.done = true;
+  rendezvous.finished.notify_all();
+}
+
+bool TransactionProcessor::isRejection(const protocol::Response& response) {
+  return response.status == protocol::Status::ERROR &&
+         (response.message == kQueueFullMessage || response.message == kStoppedMessage);
+}
+
 void TransactionProcessor::submitTransaction(const std::string& transaction_json) {
-  transaction_queue_.enqueue(transaction_json);
+  try {
+    // The transaction callback reports the result
+    submitRequest(protocol::deserializeRequest(transaction_json), [](protocol::Response) {});
+  } catch (const std::exception& e) {
+    std::cerr << "Error parsing transaction: " << e.what() << std::endl;
+    if (callback_) {
+      callback_(protocol::serializeResponse(protocol::Response::error(
+          protocol::Status::INVALID_REQUEST, "Invalid transaction format", 0)));
+    }
+  }
 }
 
 void TransactionProcessor::setTransactionCallback(TransactionCallback callback) {
@@ -67,13 +232,18 @@ void TransactionProcessor::setTransactionCallback(TransactionCallback callback)
 }
 
 size_t TransactionProcessor::getQueueSize() const {
-  return transaction_queue_.size();
+  size_t total = 0;
+  for (const auto& lane : lanes_) {
+    total += lane->size();
+  }
+  return total;
 }
 
 TransactionProcessor::Stats TransactionProcessor::getStats() const {
   Stats stats;
   stats.transactions_processed = transactions_processed_.load();
-  stats.transactions_queued = transaction_queue_.size();
+  stats.transactions_queued = getQueueSize();
+  stats.transactions_rejected = transactions_rejected_.load();
 
   size_t total_time = total_processing_time_us_.load();
   if (stats.transactions_processed > 0) {
@@ -83,166 +253,177 @@ TransactionProcessor::Stats TransactionProcessor::getStats() const {
     stats.avg_processing_time_ms = 0.0;
   }
 
-  // Simple throughput calculation (could be improved with time windows)
-  stats.throughput_tps = stats.transactions_processed / 1.0;  // per second approximation
+  stats.throughput_tps = throughput_->perSecond();
+  for (size_t type = 0; type < protocol::kMessageTypeCount; ++type) {
+    observability::LatencySummary execute = execute_latency_[type]->snapshot().summary();
+    if (execute.count == 0) continue;
+    stats.latency.push_back({static_cast<protocol::MessageType>(type),
+                             queue_latency_[type]->snapshot().summary(), execute});
+  }
 
   return stats;
 }
 
-void TransactionProcessor::workerThread() {
-  while (running_) {
-    auto transaction_opt = transaction_queue_.dequeue();
-    if (!transaction_opt.has_value()) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
-      continue;
-    }
+bool TransactionProcessor::Lane::push(Task&& task) {
+  if (bounded) return bounded->tryEnqueue(std::move(task));
+  queue.enqueue(std::move(task));
+  return true;
+}
 
-    std::string transaction_json = *transaction_opt;
+std::vector<TransactionProcessor::Lane*> TransactionProcessor::lanesFor(const protocol::Request& request) {
+  if (lanes_.size() == 1) return {lanes_.front().get()};
 
-    // Empty transaction signals shutdown
-    if (transaction_json.empty()) {
-      break;
+  // Key on every account the request touches, the one it changes first leading
+  std::vector<const std::string*> keys;
+  auto addKeys = [&keys](const protocol::Request& keyed) {
+    switch (keyed.type) {
+      case protocol::MessageType::TRANSFER:
+        keys.push_back(&keyed.source_account);
+        keys.push_back(&keyed.target_account);
+        break;
+      case protocol::MessageType::MERGE_ACCOUNTS:
+        keys.push_back(&keyed.account_id_1);
+        keys.push_back(&keyed.account_id_2);
+        break;
+      case protocol::MessageType::TOP_SPENDERS: keys.push_back(&keyed.client_id); break;
+      default: keys.push_back(&keyed.account_id); break;
     }
+  };
+  if (request.type == protocol::MessageType::BATCH && !request.operations.empty()) {
+    for (const protocol::Request& op : request.operations) addKeys(op);
+  } else {
+    addKeys(request);
+  }
 
-    auto start_time = std::chrono::high_resolution_clock::now();
-    processTransaction(transaction_json);
-    auto end_time = std::chrono::high_resolution_clock::now();
-
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-        end_time - start_time);
-
-    transactions_processed_.fetch_add(1);
-    total_processing_time_us_.fetch_add(duration.count());
+  std::vector<Lane*> lanes;
+  for (const std::string* key : keys) {
+    Lane* lane = lanes_[std::hash<std::string>{}(*key) % lanes_.size()].get();
+    if (std::find(lanes.begin(), lanes.end(), lane) == lanes.end()) lanes.push_back(lane);
   }
+  return lanes;
 }
 
-void TransactionProcessor::processTransaction(const std::string& transaction_json) {
-  try {
-    // Parse the transaction
-    auto request = protocol::deserializeRequest(transaction_json);
-
-    // Process based on request type
-    protocol::Response response = protocol::Response::error(
-        protocol::Status::ERROR, "Unknown operation", request.timestamp);
-
-    switch (request.type) {
-      case protocol::MessageType::CREATE_ACCOUNT: {
-        bool success = banking_system_->CreateAccount(
-            request.timestamp, request.payload["account_id"]);
-        if (success) {
-          response = protocol::Response::accountCreated(
-              request.payload["account_id"], request.timestamp);
-        } else {
-          response = protocol::Response::error(
-              protocol::Status::ERROR, "Account creation failed", request.timestamp);
-        }
-        break;
-      }
-
-      case protocol::MessageType::DEPOSIT: {
-        auto result = banking_system_->Deposit(
-            request.timestamp, request.payload["account_id"], request.payload["amount"]);
-        if (result.has_value()) {
-          response = protocol::Response::depositResult(*result, request.timestamp);
-        } else {
-          response = protocol::Response::error(
-              protocol::Status::ACCOUNT_NOT_FOUND, "Account not found", request.timestamp);
-        }
-        break;
-      }
+bool TransactionProcessor::waitForWork(Lane& lane) {
+  // Spin briefly: under load the next task usually arrives within microseconds
+  for (size_t i = 0; i < spin_iterations_; ++i) {
+    if (!lane.empty()) return true;
+    if (!running_) return false;
+    std::this_thread::yield();
+  }
 
-      case protocol::MessageType::TRANSFER: {
-        auto result = banking_system_->Transfer(
-            request.timestamp,
-            request.payload["source_account"],
-            request.payload["target_account"],
-            request.payload["amount"]);
-        if (result.has_value()) {
-          response = protocol::Response::transferResult(*result, request.timestamp);
-        } else {
-          response = protocol::Response::error(
-              protocol::Status::INSUFFICIENT_FUNDS, "Transfer failed", request.timestamp);
-        }
-        break;
-      }
+  // Announce the sleep before the final check so a producer either sees the
+  // sleeper and notifies, or its task is already visible here
+  std::unique_lock<std::mutex> lock(lane.wait_mutex);
+  lane.sleepers.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  lane.not_empty.wait(lock, [&] { return !lane.empty() || !running_; });
+  lane.sleepers.fetch_sub(1);
+  return !lane.empty();
+}
 
-      case protocol::MessageType::GET_BALANCE: {
-        auto result = banking_system_->GetBalance(
-            request.timestamp, request.payload["account_id"], request.payload["time_at"]);
-        if (result.has_value()) {
-          response = protocol::Response::balanceResult(*result, request.timestamp);
-        } else {
-          response = protocol::Response::error(
-              protocol::Status::ACCOUNT_NOT_FOUND, "Account not found", request.timestamp);
-        }
-        break;
-      }
+void TransactionProcessor::workerThread(Lane& lane) {
+  while (true) {
+    auto task_opt = lane.pop();
+    if (!task_opt.has_value()) {
+      if (!running_ && lane.empty()) break;
+      waitForWork(lane);
+      continue;
+    }
+    if (task_opt->rendezvous && !meet(*task_opt)) continue;
+
+    const size_t type = static_cast<size_t>(task_opt->request.type);
+    auto start_time = std::chrono::steady_clock::now();
+    const auto enqueued = task_opt->enqueued;
+    runTask(*task_opt);
+    if (task_opt->rendezvous) finish(*task_opt->rendezvous);
+    recordCompletion(type, enqueued, start_time, std::chrono::steady_clock::now());
+  }
+}
 
-      case protocol::MessageType::TOP_SPENDERS: {
-        auto spenders = banking_system_->TopSpenders(
-            request.timestamp, request.payload["n"]);
-        response = protocol::Response::topSpendersResult(spenders, request.timestamp);
-        break;
-      }
+void TransactionProcessor::recordCompletion(size_t type, std::chrono::steady_clock::time_point enqueued,
+                                            std::chrono::steady_clock::time_point start_time,
+                                            std::chrono::steady_clock::time_point end_time) {
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      end_time - start_time);
+
+  transactions_processed_.fetch_add(1);
+  total_processing_time_us_.fetch_add(duration.count());
+  throughput_->record();
+  if (type < protocol::kMessageTypeCount) {
+    queue_latency_[type]->record(start_time - enqueued);
+    execute_latency_[type]->record(end_time - start_time);
+  }
+}
 
-      case protocol::MessageType::SCHEDULE_PAYMENT: {
-        auto payment_id = banking_system_->SchedulePayment(
-            request.timestamp, request.payload["account_id"],
-            request.payload["amount"], request.payload["delay"]);
-        if (payment_id.has_value()) {
-          response = protocol::Response::paymentScheduled(*payment_id, request.timestamp);
-        } else {
-          response = protocol::Response::error(
-              protocol::Status::ACCOUNT_NOT_FOUND, "Payment scheduling failed", request.timestamp);
-        }
-        break;
-      }
+void TransactionProcessor::runTask(Task& task) {
+  task.done(execute(task.request));
+}
 
-      case protocol::MessageType::CANCEL_PAYMENT: {
-        bool success = banking_system_->CancelPayment(
-            request.timestamp, request.payload["account_id"], request.payload["payment_id"]);
-        if (success) {
-          response = protocol::Response::paymentCancelled(request.timestamp);
-        } else {
-          response = protocol::Response::error(
-              protocol::Status::ERROR, "Payment cancellation failed", request.timestamp);
-        }
-        break;
-      }
+protocol::Response TransactionProcessor::execute(const protocol::Request& request) {
+  protocol::Response response;
+  try {
+    response = processTransaction(request);
+  } catch (const std::exception& e) {
+    std::cerr << "Error processing transaction: " << e.what() << std::endl;
+    response = protocol::Response::error(
+        protocol::Status::ERROR, "Processing error", request.timestamp);
+  }
 
-      case protocol::MessageType::MERGE_ACCOUNTS: {
-        bool success = banking_system_->MergeAccounts(
-            request.timestamp, request.payload["account_id_1"], request.payload["account_id_2"]);
-        if (success) {
-          response = protocol::Response::accountsMerged(request.timestamp);
-        } else {
-          response = protocol::Response::error(
-              protocol::Status::ERROR, "Account merge failed", request.timestamp);
-        }
-        break;
-      }
+  // Call callback if set
+  if (callback_) {
+    callback_(protocol::serializeResponse(response));
+  }
+  return response;
+}
 
-      default:
-        response = protocol::Response::error(
-            protocol::Status::INVALID_REQUEST, "Unsupported operation", request.timestamp);
-        break;
-    }
+protocol::Response TransactionProcessor::processTransaction(const protocol::Request& request) {
+  // Batches are split into engine batches here; everything else runs its table entry
+  if (request.type == protocol::MessageType::BATCH) {
+    return processBatch(request);
+  }
+  const OperationDescriptor& operation = operationFor(request.type);
+  if (!operation.execute) {
+    return protocol::Response::error(
+        protocol::Status::INVALID_REQUEST, "Unsupported operation", request.timestamp);
+  }
+  return operation.execute(*banking_system_, request);
+}
 
-    // Call callback if set
-    if (callback_) {
-      callback_(protocol::serializeResponse(response));
+protocol::Response TransactionProcessor::processBatch(const protocol::Request& request) {
+  std::vector<protocol::Response> results(request.operations.size());
+
+  // Every sub-operation runs at the batch's timestamp; chunks of batch_size_
+  // bound how long a single ApplyBatch call holds the engine.
+  size_t chunk_size = batch_size_ > 0 ? batch_size_ : request.operations.size();
+  for (size_t begin = 0; begin < request.operations.size(); begin += chunk_size) {
+    size_t end = std::min(begin + chunk_size, request.operations.size());
+
+    TransactionBatch<BatchOperation> batch(next_batch_id_.fetch_add(1));
+    std::vector<size_t> positions;
+    batch.transactions.reserve(end - begin);
+    positions.reserve(end - begin);
+
+    for (size_t i = begin; i < end; ++i) {
+      const OperationDescriptor& operation = operationFor(request.operations[i].type);
+      if (operation.to_batch) {
+        batch.transactions.emplace_back();
+        operation.to_batch(request.operations[i], batch.transactions.back());
+        positions.push_back(i);
+      } else {
+        results[i] = protocol::Response::error(
+            protocol::Status::INVALID_REQUEST, "Operation not allowed in batch", request.timestamp);
+      }
     }
+    if (batch.transactions.empty()) continue;
 
-  } catch (const std::exception& e) {
-    std::cerr << "Error processing transaction: " << e.what() << std::endl;
-
-    protocol::Response error_response = protocol::Response::error(
-        protocol::Status::ERROR, "Processing error", 0);
-
-    if (callback_) {
-      callback_(protocol::serializeResponse(error_response));
+    auto batch_results = banking_system_->ApplyBatch(request.timestamp, batch.transactions);
+    for (size_t j = 0; j < batch_results.size() && j < positions.size(); ++j) {
+      const protocol::Request& op = request.operations[positions[j]];
+      results[positions[j]] = operationFor(op.type).from_batch(batch_results[j], op, request.timestamp);
     }
   }
+
+  return protocol::Response::batchResult(std::move(results), request.timestamp);
 }
 
 }  // namespace concurrent
@@ -1,16 +1,310 @@
 #include "banking_persistence.hpp"
+#include "binary_copy.hpp"
+#include "param_buffer.hpp"
 
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <climits>
+#include <ctime>
+#include <cstring>
+#include <iterator>
+#include <thread>
+#include <tuple>
 
 namespace banking {
 namespace database {
 
-BankingPersistence::BankingPersistence(std::shared_ptr<PostgresConnection> conn)
-    : conn_(conn) {
+namespace {
+
+// PostgreSQL caps bind parameters per statement at 65535
+constexpr size_t kMaxStatementParams = 65535;
+
+constexpr int kSecondsPerDay = 86400;
+
+// UTC day of an epoch timestamp, rounding down for times before the epoch
+int checkpointDay(int timestamp) {
+  return timestamp >= 0 ? timestamp / kSecondsPerDay : -((-(timestamp + 1)) / kSecondsPerDay) - 1;
+}
+
+// UTC month of an epoch timestamp, counted from year 0, matching the partition bounds
+int partitionMonth(int timestamp) {
+  const std::time_t time = timestamp;
+  std::tm utc{};
+  gmtime_r(&time, &utc);
+  return (utc.tm_year + 1900) * 12 + utc.tm_mon;
+}
+
+// Earliest and latest timestamp of the rows about to be written
+struct TimeRange {
+  int from = INT_MAX;
+  int to = INT_MIN;
+
+  void add(int timestamp) {
+    from = std::min(from, timestamp);
+    to = std::max(to, timestamp);
+  }
+  bool empty() const { return from > to; }
+};
+
+/**
+ * Builds "head (row), (row), ... tail" statements. Each '?' in the row
+ * template becomes the next $n placeholder; statements are split before
+ * they would exceed the bind parameter limit. The statement text and the
+ * parameter buffer are reused across flushes.
+ */
+class MultiRowStatement {
+ public:
+  MultiRowStatement(PostgresConnection& conn, std::string head, std::string row, std::string tail = "")
+      : conn_(conn),
+        head_(std::move(head)),
+        row_(std::move(row)),
+        tail_(std::move(tail)),
+        row_params_(static_cast<size_t>(std::count(row_.begin(), row_.end(), '?'))) {}
+
+  /**
+   * Start a row, flushing first if it would not fit. The caller then adds
+   * exactly one value per '?' to params().
+   */
+  bool nextRow() {
+    if (params_.size() + row_params_ > kMaxStatementParams && !flush()) {
+      return false;
+    }
+    if (params_.size() > 0) {
+      rows_ += ", ";
+    }
+    size_t placeholder = params_.size();
+    char digits[24];
+    for (char c : row_) {
+      if (c != '?') {
+        rows_ += c;
+        continue;
+      }
+      const auto result = std::to_chars(digits, digits + sizeof(digits), ++placeholder);
+      rows_ += '$';
+      rows_.append(digits, result.ptr);
+    }
+    return true;
+  }
+
+  ParamBuffer& params() { return params_; }
+
+  bool flush() {
+    if (params_.size() == 0) return true;
+
+    statement_.assign(head_).append(rows_).append(tail_);
+    auto result = conn_.executeParameterizedQuery(statement_, params_.count(), params_.values());
+    rows_.clear();
+    params_.clear();
+    if (!result) return false;
+    PQclear(result);
+    return true;
+  }
+
+ private:
+  PostgresConnection& conn_;
+  std::string head_;
+  std::string row_;
+  std::string tail_;
+  size_t row_params_;
+  std::string rows_;
+  std::string statement_;
+  ParamBuffer params_;
+};
+
+// Append `metadata` to `json` as a JSON object of strings
+void appendMetadataJson(std::string& json, const std::map<std::string, std::string>& metadata) {
+  auto appendString = [&json](const std::string& text) {
+    json += '"';
+    for (char c : text) {
+      if (c == '"' || c == '\\') json += '\\';
+      json += c;
+    }
+    json += '"';
+  };
+  const size_t start = json.size();
+  json += '{';
+  for (const auto& [key, value] : metadata) {
+    if (json.size() > start + 1) json += ',';
+    appendString(key);
+    json += ':';
+    appendString(value);
+  }
+  json += '}';
+}
+
+bool insertTransactions(PostgresConnection& conn, const std::vector<TransactionRecord>& records) {
+  MultiRowStatement statement(conn, R"(
+    INSERT INTO transactions (
+      id, account_id, transaction_type, amount, balance_before, balance_after,
+      timestamp, reference_id, description, metadata
+    ) VALUES )",
+    "(COALESCE(?::uuid, uuid_generate_v4()), ?, ?::transaction_type, ?, ?, ?, TO_TIMESTAMP(?), ?, ?, ?::jsonb)");
+  std::string metadata;
+  for (const auto& record : records) {
+    if (!statement.nextRow()) return false;
+    metadata.clear();
+    appendMetadataJson(metadata, record.metadata);
+    statement.params()
+        .addOrNull(record.id)
+        .add(record.account_id)
+        .add(record.transaction_type)
+        .add(record.amount)
+        .add(record.balance_before)
+        .add(record.balance_after)
+        .add(record.timestamp)
+        .addOrNull(record.reference_id)
+        .addOrNull(record.description)
+        .add(metadata);
+  }
+  return statement.flush();
+}
+
+/**
+ * Fold per-(account, day) deltas into balance_checkpoints. Days without a
+ * checkpoint are first seeded from the account's previous one; the deltas are
+ * then added to that day and every later checkpoint, so events arriving out
+ * of order stay correct. The table lock keeps concurrent writers from seeding
+ * from each other's uncommitted checkpoints.
+ */
+bool updateCheckpoints(PostgresConnection& conn, const std::map<std::pair<std::string, int>, long long>& day_deltas) {
+  if (day_deltas.empty()) return true;
+  if (!conn.executeQuery("LOCK TABLE balance_checkpoints IN SHARE ROW EXCLUSIVE MODE")) return false;
+
+  MultiRowStatement seeds(conn, R"(
+    INSERT INTO balance_checkpoints (account_id, checkpoint_day, balance)
+    SELECT v.account_id, v.checkpoint_day,
+           COALESCE((SELECT c.balance FROM balance_checkpoints c
+                     WHERE c.account_id = v.account_id AND c.checkpoint_day < v.checkpoint_day
+                     ORDER BY c.checkpoint_day DESC LIMIT 1), 0)
+    FROM (VALUES )",
+    "(?, ?::int)",
+    ") AS v(account_id, checkpoint_day) ON CONFLICT (account_id, checkpoint_day) DO NOTHING");
+  for (const auto& [key, delta] : day_deltas) {
+    if (!seeds.nextRow()) return false;
+    seeds.params().add(key.first).add(key.second);
+  }
+  if (!seeds.flush()) return false;
+
+  MultiRowStatement deltas(conn, R"(
+    UPDATE balance_checkpoints c SET balance = c.balance + d.delta
+    FROM (SELECT c2.account_id, c2.checkpoint_day, SUM(v.delta) AS delta
+          FROM balance_checkpoints c2
+          JOIN (VALUES )",
+    "(?, ?::int, ?::bigint)", R"() AS v(account_id, checkpoint_day, delta)
+            ON c2.account_id = v.account_id AND c2.checkpoint_day >= v.checkpoint_day
+          GROUP BY c2.account_id, c2.checkpoint_day) AS d
+    WHERE c.account_id = d.account_id AND c.checkpoint_day = d.checkpoint_day)");
+  for (const auto& [key, delta] : day_deltas) {
+    if (!deltas.nextRow()) return false;
+    deltas.params().add(key.first).add(key.second).add(delta);
+  }
+  return deltas.flush();
+}
+
+bool insertBalanceEvents(PostgresConnection& conn,
+                         const std::vector<std::pair<std::string, BalanceEvent>>& events) {
+  // One multi-row upsert may not touch the same row twice, so sum duplicates first
+  std::map<std::tuple<std::string, int, std::string>, int> balance_deltas;
+  for (const auto& [account_id, event] : events) {
+    balance_deltas[{account_id, event.timestamp, event.event_type}] += event.balance_delta;
+  }
+  MultiRowStatement statement(conn,
+    "INSERT INTO balance_events (account_id, timestamp, balance_delta, event_type) VALUES ",
+    "(?, TO_TIMESTAMP(?), ?, ?)",
+    " ON CONFLICT (account_id, timestamp, event_type)"
+    " DO UPDATE SET balance_delta = balance_events.balance_delta + EXCLUDED.balance_delta");
+  std::map<std::pair<std::string, int>, long long> day_deltas;
+  for (const auto& [key, delta] : balance_deltas) {
+    if (!statement.nextRow()) return false;
+    statement.params().add(std::get<0>(key)).add(std::get<1>(key)).add(delta).add(std::get<2>(key));
+    day_deltas[{std::get<0>(key), checkpointDay(std::get<1>(key))}] += delta;
+  }
+  if (!statement.flush()) return false;
+  return updateCheckpoints(conn, day_deltas);
+}
+
+bool updateBalances(PostgresConnection& conn, const std::vector<std::pair<std::string, int>>& balances) {
+  // UPDATE ... FROM applies at most one source row per account, so keep the last of each
+  std::map<std::string, int> latest;
+  for (const auto& [account_id, balance] : balances) {
+    latest[account_id] = balance;
+  }
+  MultiRowStatement statement(conn,
+    "UPDATE accounts SET balance = v.balance, updated_at = CURRENT_TIMESTAMP FROM (VALUES ",
+    "(?, ?::bigint)",
+    ") AS v(account_id, balance) WHERE accounts.account_id = v.account_id AND accounts.is_active = TRUE");
+  for (const auto& [account_id, balance] : latest) {
+    if (!statement.nextRow()) return false;
+    statement.params().add(account_id).add(balance);
+  }
+  return statement.flush();
+}
+
+// Below this many rows per thread, decoding is quicker than starting threads
+constexpr size_t kMinRowsPerDecodeThread = 16 * 1024;
+
+bool copyTable(PostgresConnection& conn, const std::string& query, size_t fields, BinaryCopyBuffer& buffer) {
+  if (!conn.copyOut(query, [&buffer](const char* data, int length) {
+        buffer.append(data, static_cast<size_t>(length));
+      })) {
+    return false;
+  }
+  if (!buffer.index(fields)) {
+    std::cerr << "Malformed binary COPY output for: " << query << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Decode every row of `buffer` into `out`, splitting the rows across threads
+template <typename Record, typename Decode>
+void decodeRows(const BinaryCopyBuffer& buffer, std::vector<Record>& out, Decode decode) {
+  const size_t rows = buffer.rowCount();
+  out.resize(rows);
+  const size_t threads = std::max<size_t>(
+      1, std::min<size_t>(std::thread::hardware_concurrency(), rows / kMinRowsPerDecodeThread));
+  const size_t per_thread = (rows + threads - 1) / threads;
+
+  auto decodeRange = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      out[i] = decode(buffer.row(i));
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < threads; ++t) {
+    workers.emplace_back(decodeRange, t * per_thread, std::min(rows, (t + 1) * per_thread));
+  }
+  decodeRange(0, std::min(rows, per_thread));
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+template <typename T>
+void moveAppend(std::vector<T>& to, std::vector<T>& from) {
+  to.insert(to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+  from.clear();
+}
+
+}  // namespace
+
+void WriteBatch::append(WriteBatch&& other) {
+  moveAppend(created_accounts, other.created_accounts);
+  moveAppend(transactions, other.transactions);
+  moveAppend(balance_events, other.balance_events);
+  moveAppend(scheduled_payments, other.scheduled_payments);
+  moveAppend(canceled_payments, other.canceled_payments);
+  moveAppend(merges, other.merges);
+  moveAppend(system_events, other.system_events);
+}
+
+BankingPersistence::BankingPersistence(std::shared_ptr<ConnectionPool> pool)
+    : pool_(pool) {
 }
 
 bool BankingPersistence::initializeSchema() {
@@ -33,37 +327,35 @@ bool BankingPersistence::initializeSchema() {
 
 bool BankingPersistence::createAccount(const std::string& account_id, int initial_balance) {
   try {
-    const char* paramValues[3] = {
-      account_id.c_str(),
-      std::to_string(initial_balance).c_str(),
-      account_id.c_str()  // for balance event
-    };
-
-    TransactionGuard transaction(*conn_);
-
-    // Insert account
-    std::string query = R"(
-      INSERT INTO accounts (account_id, balance)
-      VALUES ($1, $2)
-      ON CONFLICT (account_id) DO NOTHING
-    )";
-
-    auto result = conn_->executeParameterizedQuery(query, 2, paramValues);
-    if (!result) return false;
-    PQclear(result);
+    ParamBuffer params;
+    params.add(account_id).add(initial_balance);
+
+    const int created_at = static_cast<int>(std::time(nullptr));
+
+    // Scoped so the connection is back in the pool before logSystemEvent checks one out
+    {
+      PooledConnection conn = pool_->acquire();
+      if (!ensurePartitions(*conn, created_at, created_at)) return false;
+      TransactionGuard transaction(*conn);
+
+      // Insert account
+      std::string query = R"(
+        INSERT INTO accounts (account_id, balance)
+        VALUES ($1, $2)
+        ON CONFLICT (account_id) DO NOTHING
+      )";
 
-    // Insert balance event for creation
-    std::string eventQuery = R"(
-      INSERT INTO balance_events (account_id, timestamp, balance_delta, event_type)
-      VALUES ($1, CURRENT_TIMESTAMP, $2, 'CREATION')
-    )";
+      auto result = conn->executePrepared("create_account", query, params.count(), params.values());
+      if (!result) return false;
+      PQclear(result);
 
-    const char* eventParams[2] = {account_id.c_str(), std::to_string(initial_balance).c_str()};
-    result = conn_->executeParameterizedQuery(eventQuery, 2, eventParams);
-    if (!result) return false;
-    PQclear(result);
+      // Insert balance event for creation
+      if (!insertBalanceEvents(*conn, {{account_id, BalanceEvent(created_at, initial_balance, "CREATION")}})) {
+        return false;
+      }
 
-    transaction.commit();
+      transaction.commit();
+    }
 
     logSystemEvent("ACCOUNT_CREATED", "INFO",
                   "Account created: " + account_id + " with balance " + std::to_string(initial_balance),
@@ -81,7 +373,8 @@ bool BankingPersistence::accountExists(const std::string& account_id) {
     std::string query = "SELECT 1 FROM accounts WHERE account_id = $1 AND is_active = TRUE";
 
     const char* paramValues[1] = {account_id.c_str()};
-    auto result = conn_->executeParameterizedQuery(query, 1, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("account_exists", query, 1, paramValues);
 
     if (!result) return false;
 
@@ -100,7 +393,8 @@ std::optional<int> BankingPersistence::getAccountBalance(const std::string& acco
     std::string query = "SELECT balance FROM accounts WHERE account_id = $1 AND is_active = TRUE";
 
     const char* paramValues[1] = {account_id.c_str()};
-    auto result = conn_->executeParameterizedQuery(query, 1, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("get_account_balance", query, 1, paramValues);
 
     if (!result || PQntuples(result) == 0) {
       if (result) PQclear(result);
@@ -125,16 +419,16 @@ bool BankingPersistence::updateAccountBalance(const std::string& account_id, int
       WHERE account_id = $1 AND is_active = TRUE
     )";
 
-    const char* paramValues[2] = {
-      account_id.c_str(),
-      std::to_string(new_balance).c_str()
-    };
+    ParamBuffer params;
+    params.add(account_id).add(new_balance);
 
-    auto result = conn_->executeParameterizedQuery(query, 2, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("update_account_balance", query, params.count(), params.values());
     if (!result) return false;
 
     bool updated = std::string(PQcmdTuples(result)) != "0";
     PQclear(result);
+    conn.release();  // logSystemEvent checks out its own
 
     if (updated) {
       logSystemEvent("BALANCE_UPDATED", "INFO",
@@ -162,31 +456,24 @@ bool BankingPersistence::saveTransaction(const TransactionRecord& transaction) {
       )
     )";
 
-    // Convert metadata to JSON string
-    std::stringstream metadata_ss;
-    metadata_ss << "{";
-    bool first = true;
-    for (const auto& [key, value] : transaction.metadata) {
-      if (!first) metadata_ss << ",";
-      metadata_ss << "\"" << key << "\":\"" << value << "\"";
-      first = false;
-    }
-    metadata_ss << "}";
-
-    const char* paramValues[10] = {
-      transaction.id.empty() ? nullptr : transaction.id.c_str(),
-      transaction.account_id.c_str(),
-      transaction.transaction_type.c_str(),
-      std::to_string(transaction.amount).c_str(),
-      std::to_string(transaction.balance_before).c_str(),
-      std::to_string(transaction.balance_after).c_str(),
-      std::to_string(transaction.timestamp).c_str(),
-      transaction.reference_id.empty() ? nullptr : transaction.reference_id.c_str(),
-      transaction.description.empty() ? nullptr : transaction.description.c_str(),
-      metadata_ss.str().c_str()
-    };
-
-    auto result = conn_->executeParameterizedQuery(query, 10, paramValues);
+    std::string metadata;
+    appendMetadataJson(metadata, transaction.metadata);
+
+    ParamBuffer params;
+    params.addOrNull(transaction.id)
+        .add(transaction.account_id)
+        .add(transaction.transaction_type)
+        .add(transaction.amount)
+        .add(transaction.balance_before)
+        .add(transaction.balance_after)
+        .add(transaction.timestamp)
+        .addOrNull(transaction.reference_id)
+        .addOrNull(transaction.description)
+        .add(metadata);
+
+    PooledConnection conn = pool_->acquire();
+    if (!ensurePartitions(*conn, transaction.timestamp, transaction.timestamp)) return false;
+    auto result = conn->executePrepared("save_transaction", query, params.count(), params.values());
     if (!result) return false;
     PQclear(result);
 
@@ -214,13 +501,11 @@ std::vector<TransactionRecord> BankingPersistence::getAccountTransactions(const
       LIMIT $2 OFFSET $3
     )";
 
-    const char* paramValues[3] = {
-      account_id.c_str(),
-      std::to_string(limit).c_str(),
-      std::to_string(offset).c_str()
-    };
+    ParamBuffer params;
+    params.add(account_id).add(limit).add(offset);
 
-    auto result = conn_->executeParameterizedQuery(query, 3, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("get_account_transactions", query, params.count(), params.values());
     if (!result) return transactions;
 
     int numRows = PQntuples(result);
@@ -257,7 +542,8 @@ std::optional<int> BankingPersistence::getAccountOutgoingTotal(const std::string
     )";
 
     const char* paramValues[1] = {account_id.c_str()};
-    auto result = conn_->executeParameterizedQuery(query, 1, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("get_account_outgoing_total", query, 1, paramValues);
 
     if (!result || PQntuples(result) == 0) {
       if (result) PQclear(result);
@@ -283,15 +569,15 @@ bool BankingPersistence::saveScheduledPayment(const ScheduledPaymentRecord& paym
       ON CONFLICT (payment_id) DO NOTHING
     )";
 
-    const char* paramValues[5] = {
-      payment.payment_id.c_str(),
-      payment.account_id.c_str(),
-      std::to_string(payment.amount).c_str(),
-      std::to_string(payment.due_timestamp).c_str(),
-      std::to_string(payment.creation_order).c_str()
-    };
+    ParamBuffer params;
+    params.add(payment.payment_id)
+        .add(payment.account_id)
+        .add(payment.amount)
+        .add(payment.due_timestamp)
+        .add(payment.creation_order);
 
-    auto result = conn_->executeParameterizedQuery(query, 5, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("save_scheduled_payment", query, params.count(), params.values());
     if (!result) return false;
     PQclear(result);
 
@@ -318,7 +604,8 @@ std::optional<ScheduledPaymentRecord> BankingPersistence::getScheduledPayment(co
     )";
 
     const char* paramValues[1] = {payment_id.c_str()};
-    auto result = conn_->executeParameterizedQuery(query, 1, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("get_scheduled_payment", query, 1, paramValues);
 
     if (!result || PQntuples(result) == 0) {
       if (result) PQclear(result);
@@ -348,7 +635,8 @@ bool BankingPersistence::updateScheduledPayment(const std::string& payment_id, b
                                               int processing_timestamp) {
   try {
     std::string query;
-    const char* paramValues[3];
+    ParamBuffer params;
+    params.add(payment_id);
 
     if (is_processed) {
       query = R"(
@@ -356,21 +644,18 @@ bool BankingPersistence::updateScheduledPayment(const std::string& payment_id, b
         SET is_processed = TRUE, processing_timestamp = TO_TIMESTAMP($2)
         WHERE payment_id = $1 AND NOT is_processed
       )";
-      paramValues[0] = payment_id.c_str();
-      paramValues[1] = std::to_string(processing_timestamp).c_str();
-      paramValues[2] = nullptr;
+      params.add(processing_timestamp);
     } else {
       query = R"(
         UPDATE scheduled_payments
         SET is_canceled = TRUE
         WHERE payment_id = $1 AND NOT is_processed AND NOT is_canceled
       )";
-      paramValues[0] = payment_id.c_str();
-      paramValues[1] = nullptr;
-      paramValues[2] = nullptr;
     }
 
-    auto result = conn_->executeParameterizedQuery(query, is_processed ? 2 : 1, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared(is_processed ? "mark_payment_processed" : "mark_payment_canceled",
+                                        query, params.count(), params.values());
     if (!result) return false;
 
     bool updated = std::string(PQcmdTuples(result)) != "0";
@@ -399,8 +684,10 @@ std::vector<ScheduledPaymentRecord> BankingPersistence::getDuePayments(int curre
       ORDER BY creation_order
     )";
 
-    const char* paramValues[1] = {std::to_string(current_timestamp).c_str()};
-    auto result = conn_->executeParameterizedQuery(query, 1, paramValues);
+    ParamBuffer params;
+    params.add(current_timestamp);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("get_due_payments", query, params.count(), params.values());
 
     if (!result) return payments;
 
@@ -432,28 +719,8 @@ bool BankingPersistence::cancelScheduledPayment(const std::string& payment_id) {
 }
 
 bool BankingPersistence::saveBalanceEvent(const std::string& account_id, const BalanceEvent& event) {
-  try {
-    std::string query = R"(
-      INSERT INTO balance_events (account_id, timestamp, balance_delta, event_type)
-      VALUES ($1, TO_TIMESTAMP($2), $3, $4)
-    )";
-
-    const char* paramValues[4] = {
-      account_id.c_str(),
-      std::to_string(event.timestamp).c_str(),
-      std::to_string(event.balance_delta).c_str(),
-      event.event_type.c_str()
-    };
-
-    auto result = conn_->executeParameterizedQuery(query, 4, paramValues);
-    if (!result) return false;
-    PQclear(result);
-
-    return true;
-  } catch (const std::exception& e) {
-    std::cerr << "Failed to save balance event: " << e.what() << std::endl;
-    return false;
-  }
+  // Goes through the batch path so the day's checkpoint is kept up to date
+  return saveBalanceEvents({{account_id, event}});
 }
 
 std::vector<BalanceEvent> BankingPersistence::getBalanceEvents(const std::string& account_id,
@@ -471,13 +738,11 @@ std::vector<BalanceEvent> BankingPersistence::getBalanceEvents(const std::string
       ORDER BY timestamp
     )";
 
-    const char* paramValues[3] = {
-      account_id.c_str(),
-      std::to_string(start_time).c_str(),
-      std::to_string(end_time).c_str()
-    };
+    ParamBuffer params;
+    params.add(account_id).add(start_time).add(end_time);
 
-    auto result = conn_->executeParameterizedQuery(query, 3, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("get_balance_events", query, params.count(), params.values());
     if (!result) return events;
 
     int numRows = PQntuples(result);
@@ -503,19 +768,23 @@ std::optional<int> BankingPersistence::getBalanceAtTime(const std::string& accou
     // Get the resolved account ID at the given time
     std::string resolved_account = resolveAccountAtTime(account_id, time_at);
 
+    // The last checkpoint before this day, then this day's events up to time_at
     std::string query = R"(
-      SELECT SUM(balance_delta) as balance
-      FROM balance_events
-      WHERE account_id = $1
-      AND timestamp <= TO_TIMESTAMP($2)
+      SELECT COALESCE((SELECT balance FROM balance_checkpoints
+                       WHERE account_id = $1 AND checkpoint_day < $3
+                       ORDER BY checkpoint_day DESC LIMIT 1), 0)
+           + COALESCE((SELECT SUM(balance_delta) FROM balance_events
+                       WHERE account_id = $1
+                       AND timestamp >= TO_TIMESTAMP($4)
+                       AND timestamp <= TO_TIMESTAMP($2)), 0) as balance
     )";
 
-    const char* paramValues[2] = {
-      resolved_account.c_str(),
-      std::to_string(time_at).c_str()
-    };
+    const int day = checkpointDay(time_at);
+    ParamBuffer params;
+    params.add(resolved_account).add(time_at).add(day).add(static_cast<long long>(day) * kSecondsPerDay);
 
-    auto result = conn_->executeParameterizedQuery(query, 2, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("get_balance_at_time", query, params.count(), params.values());
     if (!result || PQntuples(result) == 0) {
       if (result) PQclear(result);
       return std::nullopt;
@@ -546,21 +815,18 @@ bool BankingPersistence::saveAccountMerge(const std::string& child_account_id,
       VALUES ($1, $2, TO_TIMESTAMP($3), $4)
     )";
 
-    const char* paramValues[4] = {
-      child_account_id.c_str(),
-      parent_account_id.c_str(),
-      std::to_string(merge_timestamp).c_str(),
-      std::to_string(balance_transferred).c_str()
-    };
+    ParamBuffer params;
+    params.add(child_account_id).add(parent_account_id).add(merge_timestamp).add(balance_transferred);
 
-    auto result = conn_->executeParameterizedQuery(query, 4, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("save_account_merge", query, params.count(), params.values());
     if (!result) return false;
     PQclear(result);
 
     // Mark child account as inactive
     std::string deactivateQuery = "UPDATE accounts SET is_active = FALSE WHERE account_id = $1";
     const char* deactivateParams[1] = {child_account_id.c_str()};
-    result = conn_->executeParameterizedQuery(deactivateQuery, 1, deactivateParams);
+    result = conn->executePrepared("deactivate_account", deactivateQuery, 1, deactivateParams);
     if (!result) return false;
     PQclear(result);
 
@@ -582,7 +848,8 @@ std::optional<std::pair<std::string, int>> BankingPersistence::getAccountMergeIn
     )";
 
     const char* paramValues[1] = {account_id.c_str()};
-    auto result = conn_->executeParameterizedQuery(query, 1, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("get_account_merge_info", query, 1, paramValues);
 
     if (!result || PQntuples(result) == 0) {
       if (result) PQclear(result);
@@ -621,8 +888,10 @@ std::vector<std::pair<std::string, int>> BankingPersistence::getTopSpenders(int
       LIMIT $1
     )";
 
-    const char* paramValues[1] = {std::to_string(limit).c_str()};
-    auto result = conn_->executeParameterizedQuery(query, 1, paramValues);
+    ParamBuffer params;
+    params.add(limit);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("get_top_spenders", query, params.count(), params.values());
 
     if (!result) return spenders;
 
@@ -647,7 +916,8 @@ std::map<std::string, int> BankingPersistence::getAccountCreationTimes() {
   try {
     std::string query = "SELECT account_id, EXTRACT(epoch FROM created_at)::int as created_at FROM accounts";
 
-    auto result = conn_->executeQueryWithResult(query);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executeQueryWithResult(query);
     if (!result) return creation_times;
 
     int numRows = PQntuples(result);
@@ -670,13 +940,14 @@ bool BankingPersistence::saveFraudAlert(const std::string& account_id, const std
                                        const std::string& recommendation, int confidence_level) {
   try {
     // Convert risk factors array to PostgreSQL array syntax
-    std::stringstream factors_ss;
-    factors_ss << "{";
+    std::string factors = "{";
     for (size_t i = 0; i < risk_factors.size(); ++i) {
-      if (i > 0) factors_ss << ",";
-      factors_ss << "\"" << risk_factors[i] << "\"";
+      if (i > 0) factors += ',';
+      factors += '"';
+      factors += risk_factors[i];
+      factors += '"';
     }
-    factors_ss << "}";
+    factors += '}';
 
     std::string query = R"(
       INSERT INTO fraud_alerts (
@@ -685,16 +956,16 @@ bool BankingPersistence::saveFraudAlert(const std::string& account_id, const std
       ) VALUES ($1, $2, $3, $4, $5, $6)
     )";
 
-    const char* paramValues[6] = {
-      account_id.c_str(),
-      transaction_id.empty() ? nullptr : transaction_id.c_str(),
-      std::to_string(risk_score).c_str(),
-      factors_ss.str().c_str(),
-      recommendation.c_str(),
-      std::to_string(confidence_level).c_str()
-    };
+    ParamBuffer params;
+    params.add(account_id)
+        .addOrNull(transaction_id)
+        .add(std::to_string(risk_score))
+        .add(factors)
+        .add(recommendation)
+        .add(confidence_level);
 
-    auto result = conn_->executeParameterizedQuery(query, 6, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("save_fraud_alert", query, params.count(), params.values());
     if (!result) return false;
     PQclear(result);
 
@@ -705,6 +976,221 @@ bool BankingPersistence::saveFraudAlert(const std::string& account_id, const std
   }
 }
 
+bool BankingPersistence::saveBatch(const WriteBatch& batch) {
+  if (batch.empty()) return true;
+
+  try {
+    TimeRange range;
+    for (const auto& record : batch.transactions) range.add(record.timestamp);
+    for (const auto& [account_id, event] : batch.balance_events) range.add(event.timestamp);
+
+    PooledConnection conn = pool_->acquire();
+    if (!range.empty() && !ensurePartitions(*conn, range.from, range.to)) return false;
+    TransactionGuard transaction(*conn);
+
+    // Parents before children: accounts are referenced by every other table
+    MultiRowStatement accounts(*conn, "INSERT INTO accounts (account_id, balance, created_at) VALUES ",
+                               "(?, 0, TO_TIMESTAMP(?))", " ON CONFLICT (account_id) DO NOTHING");
+    for (const auto& account : batch.created_accounts) {
+      if (!accounts.nextRow()) return false;
+      accounts.params().add(account.account_id).add(account.timestamp);
+    }
+    if (!accounts.flush()) return false;
+
+    if (!insertTransactions(*conn, batch.transactions)) return false;
+    if (!insertBalanceEvents(*conn, batch.balance_events)) return false;
+
+    MultiRowStatement payments(*conn, R"(
+      INSERT INTO scheduled_payments (
+        payment_id, account_id, amount, due_timestamp, creation_order
+      ) VALUES )",
+      "(?, ?, ?, TO_TIMESTAMP(?), ?)", " ON CONFLICT (payment_id) DO NOTHING");
+    for (const auto& payment : batch.scheduled_payments) {
+      if (!payments.nextRow()) return false;
+      payments.params()
+          .add(payment.payment_id)
+          .add(payment.account_id)
+          .add(payment.amount)
+          .add(payment.due_timestamp)
+          .add(payment.creation_order);
+    }
+    if (!payments.flush()) return false;
+
+    MultiRowStatement cancels(*conn, "UPDATE scheduled_payments SET is_canceled = TRUE WHERE payment_id IN (",
+                              "?", ") AND NOT is_processed AND NOT is_canceled");
+    for (const auto& payment_id : batch.canceled_payments) {
+      if (!cancels.nextRow()) return false;
+      cancels.params().add(payment_id);
+    }
+    if (!cancels.flush()) return false;
+
+    MultiRowStatement merges(*conn, R"(
+      INSERT INTO account_merges (child_account_id, parent_account_id, merge_timestamp, balance_transferred)
+      VALUES )",
+      "(?, ?, TO_TIMESTAMP(?), ?)");
+    MultiRowStatement deactivations(*conn, "UPDATE accounts SET is_active = FALSE WHERE account_id IN (",
+                                    "?", ")");
+    for (const auto& merge : batch.merges) {
+      if (!merges.nextRow() || !deactivations.nextRow()) return false;
+      merges.params()
+          .add(merge.child_account_id)
+          .add(merge.parent_account_id)
+          .add(merge.merge_timestamp)
+          .add(merge.balance_transferred);
+      deactivations.params().add(merge.child_account_id);
+    }
+    if (!merges.flush() || !deactivations.flush()) return false;
+
+    MultiRowStatement events(*conn,
+      "INSERT INTO system_events (event_type, severity, message, component) VALUES ", "(?, ?, ?, ?)");
+    for (const auto& event : batch.system_events) {
+      if (!events.nextRow()) return false;
+      events.params().add(event.event_type).add(event.severity).add(event.message).addOrNull(event.component);
+    }
+    if (!events.flush()) return false;
+
+    return transaction.commit();
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to save write batch: " << e.what() << std::endl;
+    return false;
+  }
+}
+
+bool BankingPersistence::saveTransactions(const std::vector<TransactionRecord>& transactions) {
+  if (transactions.empty()) return true;
+
+  try {
+    TimeRange range;
+    for (const auto& record : transactions) range.add(record.timestamp);
+
+    PooledConnection conn = pool_->acquire();
+    if (!ensurePartitions(*conn, range.from, range.to)) return false;
+    TransactionGuard transaction(*conn);
+    return insertTransactions(*conn, transactions) && transaction.commit();
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to save " << transactions.size() << " transactions: " << e.what() << std::endl;
+    return false;
+  }
+}
+
+bool BankingPersistence::saveBalanceEvents(const std::vector<std::pair<std::string, BalanceEvent>>& events) {
+  if (events.empty()) return true;
+
+  try {
+    TimeRange range;
+    for (const auto& [account_id, event] : events) range.add(event.timestamp);
+
+    PooledConnection conn = pool_->acquire();
+    if (!ensurePartitions(*conn, range.from, range.to)) return false;
+    TransactionGuard transaction(*conn);
+    return insertBalanceEvents(*conn, events) && transaction.commit();
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to save " << events.size() << " balance events: " << e.what() << std::endl;
+    return false;
+  }
+}
+
+bool BankingPersistence::updateAccountBalances(const std::vector<std::pair<std::string, int>>& balances) {
+  if (balances.empty()) return true;
+
+  try {
+    PooledConnection conn = pool_->acquire();
+    TransactionGuard transaction(*conn);
+    return updateBalances(*conn, balances) && transaction.commit();
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to update " << balances.size() << " account balances: " << e.what() << std::endl;
+    return false;
+  }
+}
+
+bool BankingPersistence::bulkLoad(BulkLoadData& data, const BulkLoadProgress& progress) {
+  using Row = BinaryCopyBuffer::Row;
+
+  // Each loader streams one table and returns its (rows, bytes), or nullopt on failure
+  struct TableLoader {
+    const char* table;
+    std::function<std::optional<std::pair<size_t, size_t>>(PostgresConnection&)> load;
+  };
+
+  auto loader = [](const char* query, size_t fields, auto& out, auto decode) {
+    return [query, fields, &out, decode](PostgresConnection& conn) -> std::optional<std::pair<size_t, size_t>> {
+      BinaryCopyBuffer buffer;
+      if (!copyTable(conn, query, fields, buffer)) return std::nullopt;
+      decodeRows(buffer, out, decode);
+      return std::make_pair(buffer.rowCount(), buffer.byteCount());
+    };
+  };
+
+  const std::vector<TableLoader> tables = {
+    {"accounts", loader(R"(
+      COPY (SELECT account_id::text, EXTRACT(epoch FROM created_at)::int4, is_active
+            FROM accounts) TO STDOUT (FORMAT binary)
+    )", 3, data.accounts, [](const Row& row) {
+      return BulkLoadData::Account{row.text(0), row.int32(1), row.boolean(2)};
+    })},
+    {"balance_events", loader(R"(
+      COPY (SELECT account_id::text, EXTRACT(epoch FROM timestamp)::int4, balance_delta::int4, event_type::text
+            FROM balance_events) TO STDOUT (FORMAT binary)
+    )", 4, data.balance_events, [](const Row& row) {
+      return std::make_pair(row.text(0), BalanceEvent(row.int32(1), row.int32(2), row.text(3)));
+    })},
+    {"scheduled_payments", loader(R"(
+      COPY (SELECT payment_id::text, account_id::text, amount::int4,
+                   EXTRACT(epoch FROM due_timestamp)::int4, EXTRACT(epoch FROM created_at)::int4,
+                   is_canceled, is_processed, creation_order::int4
+            FROM scheduled_payments) TO STDOUT (FORMAT binary)
+    )", 8, data.scheduled_payments, [](const Row& row) {
+      ScheduledPaymentRecord payment(row.text(0), row.text(1), row.int32(2), row.int32(3), row.int32(4),
+                                     row.boolean(5), row.boolean(6));
+      payment.processing_timestamp = 0;
+      payment.creation_order = row.int32(7);
+      return payment;
+    })},
+    {"account_merges", loader(R"(
+      COPY (SELECT child_account_id::text, parent_account_id::text,
+                   EXTRACT(epoch FROM merge_timestamp)::int4, balance_transferred::int4
+            FROM account_merges) TO STDOUT (FORMAT binary)
+    )", 4, data.merges, [](const Row& row) {
+      return WriteBatch::AccountMerge{row.text(0), row.text(1), row.int32(2), row.int32(3)};
+    })},
+  };
+
+  std::atomic<size_t> next_table{0};
+  std::atomic<bool> success{true};
+  auto worker = [&]() {
+    for (size_t i = next_table++; i < tables.size(); i = next_table++) {
+      const auto started = std::chrono::steady_clock::now();
+      try {
+        PooledConnection conn = pool_->acquire();
+        auto loaded = tables[i].load(*conn);
+        if (!loaded) {
+          success = false;
+          continue;
+        }
+        if (progress) {
+          progress(tables[i].table, loaded->first, loaded->second,
+                   std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started));
+        }
+      } catch (const std::exception& e) {
+        std::cerr << "Failed to bulk load " << tables[i].table << ": " << e.what() << std::endl;
+        success = false;
+      }
+    }
+  };
+
+  // One stream per connection the pool can spare
+  const size_t streams = std::max<size_t>(1, std::min(pool_->size(), tables.size()));
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < streams; ++i) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : workers) {
+    thread.join();
+  }
+  return success;
+}
+
 bool BankingPersistence::logSystemEvent(const std::string& event_type, const std::string& severity,
                                        const std::string& message, const std::string& component,
                                        const std::string& correlation_id) {
@@ -722,7 +1208,8 @@ bool BankingPersistence::logSystemEvent(const std::string& event_type, const std
       correlation_id.empty() ? nullptr : correlation_id.c_str()
     };
 
-    auto result = conn_->executeParameterizedQuery(query, 5, paramValues);
+    PooledConnection conn = pool_->acquire();
+    auto result = conn->executePrepared("log_system_event", query, 5, paramValues);
     if (!result) return false;
     PQclear(result);
 
@@ -743,25 +1230,39 @@ bool BankingPersistence::executeSchemaFile(const std::string& schema_path) {
 
     std::stringstream buffer;
     buffer << schema_file.rdbuf();
-    std::string schema_sql = buffer.str();
+    const std::string schema_sql = buffer.str();
+
+    // Split on semicolons outside comments, quotes and $$-quoted function bodies
+    PooledConnection conn = pool_->acquire();
+    auto execute = [&conn](const std::string& stmt) {
+      if (!std::any_of(stmt.begin(), stmt.end(), ::isalnum)) return true;
+      if (!conn->executeQuery(stmt)) {
+        std::cerr << "Failed to execute schema statement: " << stmt.substr(0, 100) << "..." << std::endl;
+        return false;
+      }
+      return true;
+    };
 
-    // Split by semicolon and execute each statement
-    std::stringstream ss(schema_sql);
-    std::string statement;
+    size_t start = 0;
     size_t pos = 0;
-    std::string delimiter = ";";
-
-    while ((pos = schema_sql.find(delimiter, pos)) != std::string::npos) {
-      std::string stmt = schema_sql.substr(0, pos);
-      if (!stmt.empty() && std::any_of(stmt.begin(), stmt.end(), ::isalnum)) {
-        if (!conn_->executeQuery(stmt)) {
-          std::cerr << "Failed to execute schema statement: " << stmt.substr(0, 100) << "..." << std::endl;
-          return false;
-        }
+    while (pos < schema_sql.size()) {
+      const char c = schema_sql[pos];
+      if (c == '-' && schema_sql.compare(pos, 2, "--") == 0) {
+        pos = schema_sql.find('\n', pos);
+      } else if (c == '\'') {
+        pos = schema_sql.find('\'', pos + 1);
+        if (pos != std::string::npos) ++pos;
+      } else if (c == '$' && schema_sql.compare(pos, 2, "$$") == 0) {
+        pos = schema_sql.find("$$", pos + 2);
+        if (pos != std::string::npos) pos += 2;
+      } else if (c == ';') {
+        if (!execute(schema_sql.substr(start, pos - start))) return false;
+        start = ++pos;
+      } else {
+        ++pos;
       }
-      schema_sql.erase(0, pos + delimiter.length());
-      pos = 0;
     }
+    if (start < schema_sql.size() && !execute(schema_sql.substr(start))) return false;
 
     return true;
   } catch (const std::exception& e) {
@@ -770,5 +1271,36 @@ bool BankingPersistence::executeSchemaFile(const std::string& schema_path) {
   }
 }
 
+bool BankingPersistence::ensurePartitions(PostgresConnection& conn, int from_ts, int to_ts) {
+  const int first = partitionMonth(from_ts);
+  const int last = partitionMonth(to_ts);
+  {
+    std::lock_guard<std::mutex> lock(partitions_mutex_);
+    auto it = partition_months_.lower_bound(first);
+    int month = first;
+    while (it != partition_months_.end() && *it == month && month <= last) {
+      ++it;
+      ++month;
+    }
+    if (month > last) return true;
+  }
+
+  ParamBuffer params;
+  params.add(from_ts).add(to_ts);
+  auto result = conn.executePrepared("ensure_time_partitions", "SELECT ensure_time_partitions($1, $2)",
+                                     params.count(), params.values());
+  if (!result) {
+    std::cerr << "Failed to create partitions for " << from_ts << ".." << to_ts << std::endl;
+    return false;
+  }
+  PQclear(result);
+
+  std::lock_guard<std::mutex> lock(partitions_mutex_);
+  for (int month = first; month <= last; ++month) {
+    partition_months_.insert(month);
+  }
+  return true;
+}
+
 }  // namespace database
 }  // namespace banking
@@ -0,0 +1,119 @@
+#include "connection_pool.hpp"
+#include "observability/metrics.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace banking {
+namespace database {
+
+PooledConnection::PooledConnection(ConnectionPool* pool, std::unique_ptr<PostgresConnection> conn)
+    : pool_(pool), conn_(std::move(conn)) {
+}
+
+PooledConnection::~PooledConnection() {
+  release();
+}
+
+PooledConnection::PooledConnection(PooledConnection&& other) noexcept
+    : pool_(other.pool_), conn_(std::move(other.conn_)) {
+  other.pool_ = nullptr;
+}
+
+PooledConnection& PooledConnection::operator=(PooledConnection&& other) noexcept {
+  if (this != &other) {
+    release();
+    pool_ = other.pool_;
+    conn_ = std::move(other.conn_);
+    other.pool_ = nullptr;
+  }
+  return *this;
+}
+
+void PooledConnection::release() {
+  if (pool_ && conn_) {
+    pool_->checkin(std::move(conn_));
+  }
+  pool_ = nullptr;
+}
+
+ConnectionPool::ConnectionPool(const PostgresConnection::Config& config)
+    : config_(config),
+      connections_(static_cast<size_t>(std::max(1, config.max_connections))),
+      wait_seconds_metric_(observability::getGlobalMetrics().histogram("db_pool_wait_seconds")),
+      timeouts_metric_(observability::getGlobalMetrics().counter("db_pool_checkout_timeouts_total")),
+      in_use_metric_(observability::getGlobalMetrics().gauge("db_pool_connections_in_use")),
+      utilization_metric_(observability::getGlobalMetrics().gauge("db_pool_utilization")) {
+  idle_.reserve(connections_);
+  for (size_t i = 0; i < connections_; ++i) {
+    idle_.push_back(std::make_unique<PostgresConnection>(config_));
+  }
+}
+
+bool ConnectionPool::connect() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& conn : idle_) {
+    if (!conn->isConnected() && !conn->connect()) {
+      return false;
+    }
+  }
+  reportUsage(connections_ - idle_.size());
+  return true;
+}
+
+PooledConnection ConnectionPool::acquire() {
+  const auto started = std::chrono::steady_clock::now();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!available_.wait_for(lock, std::chrono::seconds(config_.connection_timeout),
+                           [this] { return !idle_.empty(); })) {
+    timeouts_metric_.increment();
+    throw std::runtime_error("Timed out waiting for a database connection");
+  }
+  std::unique_ptr<PostgresConnection> conn = std::move(idle_.back());
+  idle_.pop_back();
+  const size_t in_use = connections_ - idle_.size();
+  lock.unlock();
+
+  wait_seconds_metric_.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+  reportUsage(in_use);
+
+  // Prepared statements belong to the session, so a reconnect starts them over
+  if (!conn->isConnected() && !conn->connect()) {
+    std::cerr << "Pooled connection is down: " << conn->getLastError() << std::endl;
+  }
+  return PooledConnection(this, std::move(conn));
+}
+
+size_t ConnectionPool::idleCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return idle_.size();
+}
+
+std::string ConnectionPool::getConnectionInfo() const {
+  std::stringstream ss;
+  ss << connections_ << " x " << config_.username << "@" << config_.host << ":" << config_.port
+     << "/" << config_.database;
+  return ss.str();
+}
+
+void ConnectionPool::checkin(std::unique_ptr<PostgresConnection> conn) {
+  size_t in_use;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(std::move(conn));
+    in_use = connections_ - idle_.size();
+  }
+  available_.notify_one();
+  reportUsage(in_use);
+}
+
+void ConnectionPool::reportUsage(size_t in_use) const {
+  in_use_metric_.set(static_cast<double>(in_use));
+  utilization_metric_.set(static_cast<double>(in_use) / static_cast<double>(connections_));
+}
+
+}  // namespace database
+}  // namespace banking
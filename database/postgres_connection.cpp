@@ -19,7 +19,7 @@ bool PostgresConnection::connect() {
   std::lock_guard<std::mutex> lock(mutex_);
 
   if (connection_) {
-    disconnect();
+    disconnectLocked();
   }
 
   // Build connection string
@@ -35,14 +35,14 @@ bool PostgresConnection::connect() {
 
   if (PQstatus(connection_) != CONNECTION_OK) {
     std::cerr << "Database connection failed: " << PQerrorMessage(connection_) << std::endl;
-    disconnect();
+    disconnectLocked();
     return false;
   }
 
   // Set session parameters for better performance
-  executeQuery("SET SESSION synchronous_commit = off;");
-  executeQuery("SET SESSION work_mem = '64MB';");
-  executeQuery("SET SESSION maintenance_work_mem = '256MB';");
+  executeQueryLocked("SET SESSION synchronous_commit = off;");
+  executeQueryLocked("SET SESSION work_mem = '64MB';");
+  executeQueryLocked("SET SESSION maintenance_work_mem = '256MB';");
 
   std::cout << "Connected to PostgreSQL database: " << getConnectionInfo() << std::endl;
   return true;
@@ -50,13 +50,18 @@ bool PostgresConnection::connect() {
 
 void PostgresConnection::disconnect() {
   std::lock_guard<std::mutex> lock(mutex_);
+  disconnectLocked();
+}
 
+void PostgresConnection::disconnectLocked() {
   if (connection_) {
     if (in_transaction_) {
-      rollbackTransaction();
+      executeQueryLocked("ROLLBACK");
+      in_transaction_ = false;
     }
     PQfinish(connection_);
     connection_ = nullptr;
+    prepared_.clear();
   }
 }
 
@@ -67,7 +72,10 @@ bool PostgresConnection::isConnected() const {
 
 bool PostgresConnection::executeQuery(const std::string& query) {
   std::lock_guard<std::mutex> lock(mutex_);
+  return executeQueryLocked(query);
+}
 
+bool PostgresConnection::executeQueryLocked(const std::string& query) {
   if (!connection_) return false;
 
   PGresult* result = PQexec(connection_, query.c_str());
@@ -137,10 +145,84 @@ PGresult* PostgresConnection::executeParameterizedQuery(const std::string& query
   return result;
 }
 
+PGresult* PostgresConnection::executePrepared(const std::string& name,
+                                             const std::string& query,
+                                             int nParams,
+                                             const char* const* paramValues) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (!connection_) return nullptr;
+
+  if (prepared_.count(name) == 0) {
+    PGresult* prepared = PQprepare(connection_, name.c_str(), query.c_str(), nParams, nullptr);
+    if (!prepared || PQresultStatus(prepared) != PGRES_COMMAND_OK) {
+      std::cerr << "Failed to prepare statement " << name << ": "
+                << (prepared ? PQresultErrorMessage(prepared) : PQerrorMessage(connection_)) << std::endl;
+      if (prepared) PQclear(prepared);
+      return nullptr;
+    }
+    PQclear(prepared);
+    prepared_.insert(name);
+  }
+
+  PGresult* result = PQexecPrepared(connection_, name.c_str(), nParams, paramValues, nullptr, nullptr, 0);
+
+  if (!result) {
+    std::cerr << "Prepared statement execution failed: connection lost" << std::endl;
+    return nullptr;
+  }
+
+  ExecStatusType status = PQresultStatus(result);
+  if (status != PGRES_TUPLES_OK && status != PGRES_COMMAND_OK) {
+    std::cerr << "Prepared statement " << name << " failed: " << PQresultErrorMessage(result) << std::endl;
+    PQclear(result);
+    return nullptr;
+  }
+
+  return result;
+}
+
+bool PostgresConnection::copyOut(const std::string& query,
+                                 const std::function<void(const char* data, int length)>& on_data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (!connection_) return false;
+
+  PGresult* result = PQexec(connection_, query.c_str());
+  if (!result || PQresultStatus(result) != PGRES_COPY_OUT) {
+    std::cerr << "COPY failed to start: "
+              << (result ? PQresultErrorMessage(result) : PQerrorMessage(connection_)) << std::endl;
+    if (result) PQclear(result);
+    return false;
+  }
+  PQclear(result);
+
+  char* buffer = nullptr;
+  int length;
+  while ((length = PQgetCopyData(connection_, &buffer, 0)) > 0) {
+    on_data(buffer, length);
+    PQfreemem(buffer);
+  }
+  if (length == -2) {
+    std::cerr << "COPY read failed: " << PQerrorMessage(connection_) << std::endl;
+  }
+
+  // The command's final status follows the data
+  bool success = length == -1;
+  while ((result = PQgetResult(connection_)) != nullptr) {
+    if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+      std::cerr << "COPY failed: " << PQresultErrorMessage(result) << std::endl;
+      success = false;
+    }
+    PQclear(result);
+  }
+  return success;
+}
+
 bool PostgresConnection::beginTransaction() {
   std::lock_guard<std::mutex> lock(mutex_);
 
-  if (!executeQuery("BEGIN")) {
+  if (!executeQueryLocked("BEGIN")) {
     return false;
   }
 
@@ -155,7 +237,7 @@ bool PostgresConnection::commitTransaction() {
     return false;
   }
 
-  bool success = executeQuery("COMMIT");
+  bool success = executeQueryLocked("COMMIT");
   in_transaction_ = false;
   return success;
 }
@@ -167,7 +249,7 @@ bool PostgresConnection::rollbackTransaction() {
     return false;
   }
 
-  bool success = executeQuery("ROLLBACK");
+  bool success = executeQueryLocked("ROLLBACK");
   in_transaction_ = false;
   return success;
 }
@@ -202,10 +284,11 @@ TransactionGuard::~TransactionGuard() {
   }
 }
 
-void TransactionGuard::commit() {
+bool TransactionGuard::commit() {
   if (!committed_ && conn_.commitTransaction()) {
     committed_ = true;
   }
+  return committed_;
 }
 
 void TransactionGuard::rollback() {
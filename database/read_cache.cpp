@@ -0,0 +1,183 @@
+#include "read_cache.hpp"
+#include "observability/metrics.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+namespace banking {
+namespace database {
+
+namespace {
+
+// Distinct `n` values kept per epoch; callers only ever use a handful
+constexpr size_t kMaxTopSpendersEntries = 64;
+
+}  // namespace
+
+struct ReadCache::Shard {
+  using Key = std::pair<std::string, int>;  // (account, time_at)
+
+  struct Entry {
+    int balance;
+    std::list<Key>::iterator position;  // In lru
+  };
+
+  void erase(std::map<int, Entry>& times, std::map<int, Entry>::iterator it) {
+    lru.erase(it->second.position);
+    times.erase(it);
+    --size;
+  }
+
+  std::mutex mutex;
+  uint64_t generation = 0;  // Bumped by every invalidation
+  std::list<Key> lru;       // Most recently used first
+  std::unordered_map<std::string, std::map<int, Entry>> accounts;
+  size_t size = 0;
+};
+
+ReadCache::ReadCache(const Config& config)
+    : hits_metric_(observability::getGlobalMetrics().counter("read_cache_hits_total")),
+      misses_metric_(observability::getGlobalMetrics().counter("read_cache_misses_total")),
+      evictions_metric_(observability::getGlobalMetrics().counter("read_cache_evictions_total")),
+      hit_ratio_metric_(observability::getGlobalMetrics().gauge("read_cache_hit_ratio")) {
+  const size_t shards = std::max<size_t>(1, config.shards);
+  capacity_per_shard_ = config.capacity == 0 ? 0 : std::max<size_t>(1, config.capacity / shards);
+  shards_.reserve(shards);
+  for (size_t i = 0; i < shards; ++i) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+ReadCache::~ReadCache() = default;
+
+ReadCache::Shard& ReadCache::shardFor(const std::string& account) const {
+  return *shards_[std::hash<std::string>{}(account) % shards_.size()];
+}
+
+std::optional<int> ReadCache::findBalance(const std::string& account, int time_at, uint64_t& generation) {
+  Shard& shard = shardFor(account);
+  std::optional<int> found;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    generation = shard.generation;
+    auto account_it = shard.accounts.find(account);
+    if (account_it != shard.accounts.end()) {
+      auto it = account_it->second.find(time_at);
+      if (it != account_it->second.end()) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.position);
+        found = it->second.balance;
+      }
+    }
+  }
+  recordLookup(found.has_value());
+  return found;
+}
+
+void ReadCache::storeBalance(const std::string& account, int time_at, int balance, uint64_t generation) {
+  Shard& shard = shardFor(account);
+  size_t evicted = 0;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.generation != generation) return;  // Invalidated while loading
+
+    auto& times = shard.accounts[account];
+    auto it = times.find(time_at);
+    if (it != times.end()) {
+      it->second.balance = balance;
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second.position);
+      return;
+    }
+    shard.lru.emplace_front(account, time_at);
+    times.emplace(time_at, Shard::Entry{balance, shard.lru.begin()});
+    ++shard.size;
+
+    while (shard.size > capacity_per_shard_) {
+      const Shard::Key& oldest = shard.lru.back();
+      auto oldest_account = shard.accounts.find(oldest.first);
+      shard.erase(oldest_account->second, oldest_account->second.find(oldest.second));
+      if (oldest_account->second.empty()) {
+        shard.accounts.erase(oldest_account);
+      }
+      ++evicted;
+    }
+  }
+  if (evicted > 0) {
+    evictions_ += evicted;
+    evictions_metric_.increment(static_cast<double>(evicted));
+  }
+}
+
+void ReadCache::invalidateBalances(const std::string& account, int from_time) {
+  if (!enabled()) return;
+
+  Shard& shard = shardFor(account);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  ++shard.generation;
+  auto account_it = shard.accounts.find(account);
+  if (account_it == shard.accounts.end()) return;
+
+  auto& times = account_it->second;
+  for (auto it = times.lower_bound(from_time); it != times.end();) {
+    shard.erase(times, it++);
+    ++invalidations_;
+  }
+  if (times.empty()) {
+    shard.accounts.erase(account_it);
+  }
+}
+
+std::optional<std::vector<std::string>> ReadCache::findTopSpenders(int n, uint64_t& epoch) {
+  std::optional<std::vector<std::string>> found;
+  {
+    std::lock_guard<std::mutex> lock(spenders_mutex_);
+    epoch = spenders_epoch_;
+    auto it = spenders_.find(n);
+    if (it != spenders_.end()) {
+      found = it->second;
+    }
+  }
+  recordLookup(found.has_value());
+  return found;
+}
+
+void ReadCache::storeTopSpenders(int n, const std::vector<std::string>& result, uint64_t epoch) {
+  std::lock_guard<std::mutex> lock(spenders_mutex_);
+  if (epoch != spenders_epoch_) return;  // A write landed while loading
+  if (spenders_.size() >= kMaxTopSpendersEntries && spenders_.count(n) == 0) return;
+  spenders_[n] = result;
+}
+
+void ReadCache::invalidateTopSpenders() {
+  if (!enabled()) return;
+
+  std::lock_guard<std::mutex> lock(spenders_mutex_);
+  ++spenders_epoch_;
+  invalidations_ += spenders_.size();
+  spenders_.clear();
+}
+
+ReadCache::Stats ReadCache::getStats() const {
+  Stats stats;
+  stats.hits = hits_.load();
+  stats.misses = misses_.load();
+  stats.evictions = evictions_.load();
+  stats.invalidations = invalidations_.load();
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    stats.entries += shard->size;
+  }
+  return stats;
+}
+
+void ReadCache::recordLookup(bool hit) {
+  const uint64_t hits = hit ? ++hits_ : hits_.load();
+  const uint64_t misses = hit ? misses_.load() : ++misses_;
+
+  (hit ? hits_metric_ : misses_metric_).increment();
+  hit_ratio_metric_.set(static_cast<double>(hits) / static_cast<double>(hits + misses));
+}
+
+}  // namespace database
+}  // namespace banking
@@ -1,5 +1,5 @@
 -- Banking System Database Schema
--- PostgreSQL 12+ compatible
+-- PostgreSQL 13+ compatible (row triggers on partitioned tables)
 
 -- Enable UUID extension for transaction IDs
 CREATE EXTENSION IF NOT EXISTS "uuid-ossp";
@@ -29,9 +29,11 @@ CREATE TYPE transaction_type AS ENUM (
     'ACCOUNT_CREATION'
 );
 
--- Transactions table (immutable audit trail)
+-- Transactions table (immutable audit trail), range-partitioned by month.
+-- Partitions are created by ensure_time_partitions() before rows arrive;
+-- anything outside them lands in transactions_default.
 CREATE TABLE IF NOT EXISTS transactions (
-    id UUID PRIMARY KEY DEFAULT uuid_generate_v4(),
+    id UUID NOT NULL DEFAULT uuid_generate_v4(),
     account_id VARCHAR(50) NOT NULL REFERENCES accounts(account_id),
     transaction_type transaction_type NOT NULL,
     amount BIGINT NOT NULL,
@@ -40,8 +42,12 @@ CREATE TABLE IF NOT EXISTS transactions (
     timestamp TIMESTAMP WITH TIME ZONE NOT NULL DEFAULT CURRENT_TIMESTAMP,
     reference_id VARCHAR(100), -- For related transactions (transfers, etc.)
     description TEXT,
-    metadata JSONB -- Additional transaction data
-);
+    metadata JSONB, -- Additional transaction data
+
+    PRIMARY KEY (id, timestamp) -- A partitioned table's keys must include the partition key
+) PARTITION BY RANGE (timestamp);
+
+CREATE TABLE IF NOT EXISTS transactions_default PARTITION OF transactions DEFAULT;
 
 -- =============================================
 -- SCHEDULED PAYMENTS
@@ -83,15 +89,27 @@ CREATE TABLE IF NOT EXISTS account_merges (
 -- HISTORICAL BALANCE TRACKING
 -- =============================================
 
--- Balance events for time-travel queries
+-- Balance events for time-travel queries, range-partitioned by month like transactions.
+-- The key carries balance_delta so range sums are index-only scans.
 CREATE TABLE IF NOT EXISTS balance_events (
-    id SERIAL PRIMARY KEY,
     account_id VARCHAR(50) NOT NULL REFERENCES accounts(account_id),
     timestamp TIMESTAMP WITH TIME ZONE NOT NULL,
     balance_delta BIGINT NOT NULL,
     event_type VARCHAR(50) NOT NULL, -- 'TRANSACTION', 'CREATION', 'MERGE', etc.
 
-    UNIQUE(account_id, timestamp, event_type)
+    PRIMARY KEY (account_id, timestamp, event_type) INCLUDE (balance_delta)
+) PARTITION BY RANGE (timestamp);
+
+CREATE TABLE IF NOT EXISTS balance_events_default PARTITION OF balance_events DEFAULT;
+
+-- Balance at the end of each UTC day that has events, per account. A balance
+-- at time t is the last checkpoint before t's day plus that day's events up to t.
+CREATE TABLE IF NOT EXISTS balance_checkpoints (
+    account_id VARCHAR(50) NOT NULL REFERENCES accounts(account_id),
+    checkpoint_day INTEGER NOT NULL, -- Days since the epoch
+    balance BIGINT NOT NULL, -- Sum of every balance_delta before the day ends
+
+    PRIMARY KEY (account_id, checkpoint_day)
 );
 
 -- =============================================
@@ -114,7 +132,7 @@ CREATE TABLE IF NOT EXISTS system_events (
 CREATE TABLE IF NOT EXISTS fraud_alerts (
     id SERIAL PRIMARY KEY,
     account_id VARCHAR(50) REFERENCES accounts(account_id),
-    transaction_id UUID REFERENCES transactions(id),
+    transaction_id UUID, -- transactions(id); not a foreign key, ids are unique only with their timestamp
     risk_score DECIMAL(3,2) NOT NULL CHECK (risk_score >= 0 AND risk_score <= 1),
     risk_factors TEXT[] NOT NULL DEFAULT '{}',
     recommendation VARCHAR(20) NOT NULL DEFAULT 'REVIEW',
@@ -129,10 +147,9 @@ CREATE TABLE IF NOT EXISTS fraud_alerts (
 -- INDEXES FOR PERFORMANCE
 -- =============================================
 
--- Core banking indexes
-CREATE INDEX IF NOT EXISTS idx_transactions_account_id ON transactions(account_id);
-CREATE INDEX IF NOT EXISTS idx_transactions_timestamp ON transactions(timestamp DESC);
-CREATE INDEX IF NOT EXISTS idx_transactions_type ON transactions(transaction_type);
+-- Core banking indexes (per-account history and outgoing totals, index-only)
+CREATE INDEX IF NOT EXISTS idx_transactions_account_timestamp
+    ON transactions(account_id, timestamp DESC) INCLUDE (transaction_type, amount);
 CREATE INDEX IF NOT EXISTS idx_accounts_active ON accounts(is_active) WHERE is_active = TRUE;
 
 -- Scheduled payments indexes
@@ -140,8 +157,7 @@ CREATE INDEX IF NOT EXISTS idx_scheduled_payments_account_id ON scheduled_paymen
 CREATE INDEX IF NOT EXISTS idx_scheduled_payments_due ON scheduled_payments(due_timestamp) WHERE NOT is_processed AND NOT is_canceled;
 CREATE INDEX IF NOT EXISTS idx_scheduled_payments_creation_order ON scheduled_payments(creation_order);
 
--- Historical data indexes
-CREATE INDEX IF NOT EXISTS idx_balance_events_account_timestamp ON balance_events(account_id, timestamp DESC);
+-- Historical data indexes (balance_events is served by its primary key)
 CREATE INDEX IF NOT EXISTS idx_account_merges_child ON account_merges(child_account_id);
 
 -- Audit and monitoring indexes
@@ -242,6 +258,66 @@ BEGIN
 END;
 $$ LANGUAGE plpgsql;
 
+-- Create the month partition of `parent` starting at `month_start` (UTC), moving
+-- any of its rows out of the default partition first
+CREATE OR REPLACE FUNCTION create_time_partition(parent TEXT, month_start TIMESTAMP)
+RETURNS VOID AS $$
+DECLARE
+    partition_name TEXT := parent || '_' || to_char(month_start, 'YYYY_MM');
+    range_start TIMESTAMPTZ := month_start AT TIME ZONE 'UTC';
+    range_end TIMESTAMPTZ := (month_start + INTERVAL '1 month') AT TIME ZONE 'UTC';
+BEGIN
+    IF to_regclass(partition_name) IS NOT NULL THEN
+        RETURN;
+    END IF;
+
+    -- Serialize creators; whoever waited finds the partition on the second look
+    PERFORM pg_advisory_xact_lock(hashtext('create_time_partition'));
+    IF to_regclass(partition_name) IS NOT NULL THEN
+        RETURN;
+    END IF;
+
+    EXECUTE format('CREATE TABLE %I (LIKE %I INCLUDING DEFAULTS INCLUDING CONSTRAINTS)',
+                   partition_name, parent);
+    EXECUTE format('WITH moved AS (DELETE FROM %I WHERE timestamp >= $1 AND timestamp < $2 RETURNING *)
+                    INSERT INTO %I SELECT * FROM moved', parent || '_default', partition_name)
+        USING range_start, range_end;
+    EXECUTE format('ALTER TABLE %I ATTACH PARTITION %I FOR VALUES FROM (%L) TO (%L)',
+                   parent, partition_name, range_start, range_end);
+END;
+$$ LANGUAGE plpgsql;
+
+-- Make sure every month between two epoch timestamps has its partitions
+CREATE OR REPLACE FUNCTION ensure_time_partitions(from_ts BIGINT, to_ts BIGINT)
+RETURNS VOID AS $$
+DECLARE
+    month_start TIMESTAMP := date_trunc('month', to_timestamp(from_ts) AT TIME ZONE 'UTC');
+BEGIN
+    WHILE month_start <= to_timestamp(to_ts) AT TIME ZONE 'UTC' LOOP
+        PERFORM create_time_partition('transactions', month_start);
+        PERFORM create_time_partition('balance_events', month_start);
+        month_start := month_start + INTERVAL '1 month';
+    END LOOP;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Recompute every balance checkpoint from balance_events, for data loaded
+-- without going through BankingPersistence
+CREATE OR REPLACE FUNCTION rebuild_balance_checkpoints()
+RETURNS VOID AS $$
+BEGIN
+    LOCK TABLE balance_checkpoints IN SHARE ROW EXCLUSIVE MODE;
+    DELETE FROM balance_checkpoints;
+    INSERT INTO balance_checkpoints (account_id, checkpoint_day, balance)
+    SELECT account_id, checkpoint_day,
+           SUM(SUM(balance_delta)) OVER (PARTITION BY account_id ORDER BY checkpoint_day)
+    FROM (SELECT account_id, balance_delta,
+                 floor(EXTRACT(epoch FROM timestamp) / 86400)::int AS checkpoint_day
+          FROM balance_events) AS events
+    GROUP BY account_id, checkpoint_day;
+END;
+$$ LANGUAGE plpgsql;
+
 -- =============================================
 -- VIEWS FOR ANALYTICS
 -- =============================================
@@ -273,6 +349,10 @@ ORDER BY total_outgoing DESC, account_id ASC;
 -- INITIAL DATA
 -- =============================================
 
+-- Partitions for this month and the next
+SELECT ensure_time_partitions(EXTRACT(epoch FROM CURRENT_TIMESTAMP)::bigint,
+                              EXTRACT(epoch FROM CURRENT_TIMESTAMP + INTERVAL '1 month')::bigint);
+
 -- Insert initial system event
 INSERT INTO system_events (event_type, severity, message, component)
 VALUES ('SYSTEM_STARTUP', 'INFO', 'Database schema initialized', 'database')
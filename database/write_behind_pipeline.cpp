@@ -0,0 +1,285 @@
+#include "write_behind_pipeline.hpp"
+#include "observability/metrics.hpp"
+
+#include <iostream>
+#include <iterator>
+
+namespace banking {
+namespace database {
+
+namespace {
+
+double toSeconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+std::future<bool> readyFuture(bool value) {
+  std::promise<bool> promise;
+  promise.set_value(value);
+  return promise.get_future();
+}
+
+std::array<size_t, 7> tableSizes(const WriteBatch& batch) {
+  return {batch.created_accounts.size(), batch.transactions.size(), batch.balance_events.size(),
+          batch.scheduled_payments.size(), batch.canceled_payments.size(), batch.merges.size(),
+          batch.system_events.size()};
+}
+
+template <typename T>
+void takeRecords(std::vector<T>& to, std::vector<T>& from, size_t& offset, size_t count) {
+  auto first = from.begin() + static_cast<std::ptrdiff_t>(offset);
+  to.assign(std::make_move_iterator(first), std::make_move_iterator(first + static_cast<std::ptrdiff_t>(count)));
+  offset += count;
+}
+
+// Move each submission's records back out of the batch they were merged into
+template <typename Submission>
+std::vector<WriteBatch> splitBatch(WriteBatch& batch, const std::vector<Submission>& submissions) {
+  std::array<size_t, 7> offsets{};
+  std::vector<WriteBatch> parts(submissions.size());
+  for (size_t i = 0; i < submissions.size(); ++i) {
+    const auto& records = submissions[i].records;
+    takeRecords(parts[i].created_accounts, batch.created_accounts, offsets[0], records[0]);
+    takeRecords(parts[i].transactions, batch.transactions, offsets[1], records[1]);
+    takeRecords(parts[i].balance_events, batch.balance_events, offsets[2], records[2]);
+    takeRecords(parts[i].scheduled_payments, batch.scheduled_payments, offsets[3], records[3]);
+    takeRecords(parts[i].canceled_payments, batch.canceled_payments, offsets[4], records[4]);
+    takeRecords(parts[i].merges, batch.merges, offsets[5], records[5]);
+    takeRecords(parts[i].system_events, batch.system_events, offsets[6], records[6]);
+  }
+  return parts;
+}
+
+}  // namespace
+
+WriteBehindPipeline::WriteBehindPipeline(BankingPersistence& persistence, const Config& config)
+    : persistence_(persistence), config_(config) {
+}
+
+WriteBehindPipeline::~WriteBehindPipeline() {
+  stop();
+}
+
+void WriteBehindPipeline::start() {
+  if (config_.mode == DurabilityMode::SYNC) return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) return;
+  running_ = true;
+  stopping_ = false;
+  flusher_ = std::thread(&WriteBehindPipeline::flusherLoop, this);
+}
+
+void WriteBehindPipeline::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) return;
+    stopping_ = true;
+  }
+  work_cv_.notify_one();
+  space_cv_.notify_all();
+  flusher_.join();
+
+  // Submitters can still queue between the flusher's last look and here; running_
+  // stays set until that is written too, so no synchronous write overtakes it
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!pending_.empty() || !waiters_.empty()) {
+    writePending(lock);
+  }
+  running_ = false;
+  stopping_ = false;
+}
+
+bool WriteBehindPipeline::submit(WriteBatch batch) {
+  return enqueue(std::move(batch)).get();
+}
+
+std::future<bool> WriteBehindPipeline::enqueue(WriteBatch batch) {
+  if (batch.empty()) return readyFuture(true);
+
+  auto write_now = [this](WriteBatch records) {
+    Submission submission;
+    submission.records = tableSizes(records);
+    std::vector<Submission> submissions;
+    submissions.push_back(std::move(submission));
+    return readyFuture(writeBatch(std::move(records), std::move(submissions), {}, Clock::now()));
+  };
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  stats_.records_submitted += batch.size();
+  if (config_.mode == DurabilityMode::SYNC || !running_) {
+    lock.unlock();
+    return write_now(std::move(batch));
+  }
+
+  if (config_.max_queued_records > 0) {
+    space_cv_.wait(lock, [this] {
+      return stopping_ || pending_.size() < config_.max_queued_records;
+    });
+    if (!running_) {
+      // Stopped while waiting for room: nothing drains the queue any more
+      lock.unlock();
+      return write_now(std::move(batch));
+    }
+  }
+
+  Submission submission;
+  submission.records = tableSizes(batch);
+  std::future<bool> result;
+  if (config_.mode == DurabilityMode::ASYNC) {
+    result = readyFuture(true);
+  } else {
+    submission.committed.emplace();
+    result = submission.committed->get_future();
+  }
+  submissions_.push_back(std::move(submission));
+
+  const bool was_empty = pending_.empty();
+  if (was_empty) {
+    oldest_pending_ = Clock::now();
+  }
+  pending_.append(std::move(batch));
+  if (was_empty || pending_.size() >= config_.max_batch_records) {
+    work_cv_.notify_one();
+  }
+  return result;
+}
+
+bool WriteBehindPipeline::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!running_) return true;  // SYNC mode, or nothing can be queued
+
+  std::promise<bool> drained;
+  std::future<bool> result = drained.get_future();
+  waiters_.push_back(std::move(drained));
+  flush_requested_ = true;
+  work_cv_.notify_one();
+  lock.unlock();
+  return result.get();
+}
+
+WriteBehindPipeline::Stats WriteBehindPipeline::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.queued_records = pending_.size() + in_flight_records_;
+
+  // Whatever is in flight was queued before anything still pending
+  if (in_flight_records_ > 0 || !pending_.empty()) {
+    const Clock::time_point oldest = in_flight_records_ > 0 ? oldest_in_flight_ : oldest_pending_;
+    stats.flush_lag = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - oldest);
+  }
+  return stats;
+}
+
+void WriteBehindPipeline::flusherLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this] { return stopping_ || !pending_.empty() || !waiters_.empty(); });
+
+    // Give the batch until the oldest record has waited one interval to fill up
+    if (!stopping_ && !flush_requested_ && pending_.size() < config_.max_batch_records) {
+      work_cv_.wait_until(lock, oldest_pending_ + config_.flush_interval, [this] {
+        return stopping_ || flush_requested_ || pending_.size() >= config_.max_batch_records;
+      });
+    }
+
+    if (pending_.empty() && waiters_.empty()) {
+      if (stopping_) break;
+      continue;
+    }
+
+    writePending(lock);
+  }
+}
+
+void WriteBehindPipeline::writePending(std::unique_lock<std::mutex>& lock) {
+  WriteBatch batch = std::move(pending_);
+  pending_ = WriteBatch{};
+  std::vector<Submission> submissions = std::move(submissions_);
+  submissions_.clear();
+  std::vector<std::promise<bool>> waiters = std::move(waiters_);
+  waiters_.clear();
+  flush_requested_ = false;
+  const Clock::time_point oldest = oldest_pending_;
+  oldest_in_flight_ = oldest;
+  in_flight_records_ = batch.size();
+  space_cv_.notify_all();
+
+  lock.unlock();
+  writeBatch(std::move(batch), std::move(submissions), std::move(waiters), oldest);
+  lock.lock();
+}
+
+bool WriteBehindPipeline::writeBatch(WriteBatch batch, std::vector<Submission> submissions,
+                                     std::vector<std::promise<bool>> waiters, Clock::time_point oldest) {
+  bool success = true;
+  if (!batch.empty()) {
+    const size_t records = batch.size();
+    size_t written = 0;
+    bool retried = false;
+    std::vector<bool> committed(submissions.size(), true);
+
+    const Clock::time_point started = Clock::now();
+    {
+      std::lock_guard<std::mutex> write_lock(write_mutex_);
+      if (persistence_.saveBatch(batch)) {
+        written = records;
+      } else {
+        // Write each operation's records again in its own transaction, in order,
+        // so a transient error costs a retry and a bad record fails only its owner
+        retried = true;
+        std::vector<WriteBatch> parts = splitBatch(batch, submissions);
+        for (size_t i = 0; i < parts.size(); ++i) {
+          committed[i] = persistence_.saveBatch(parts[i]);
+          if (committed[i]) {
+            written += parts[i].size();
+          }
+        }
+      }
+    }
+    const Clock::time_point finished = Clock::now();
+    success = written == records;
+
+    {
+      // Done before waking waiters, so they never see their own records as queued
+      std::lock_guard<std::mutex> lock(mutex_);
+      in_flight_records_ = 0;
+      ++stats_.flushes;
+      stats_.records_flushed += written;
+      if (retried) {
+        ++stats_.retried_flushes;
+      }
+      if (!success) {
+        ++stats_.failed_flushes;
+      }
+      stats_.last_flush_duration = std::chrono::duration_cast<std::chrono::microseconds>(finished - started);
+    }
+
+    auto& metrics = observability::getGlobalMetrics();
+    metrics.observeHistogram("persistence_flush_duration_seconds", toSeconds(finished - started));
+    metrics.setGauge("persistence_flush_lag_seconds", toSeconds(finished - oldest));
+    metrics.incrementCounter("persistence_flushed_records_total", static_cast<double>(written));
+    if (retried) {
+      metrics.incrementCounter("persistence_flush_retries_total");
+    }
+    if (!success) {
+      metrics.incrementCounter("persistence_flush_failures_total");
+      std::cerr << "Write-behind flush left " << records - written << " of " << records
+                << " records unwritten" << std::endl;
+    }
+
+    for (size_t i = 0; i < submissions.size(); ++i) {
+      if (submissions[i].committed) {
+        submissions[i].committed->set_value(committed[i]);
+      }
+    }
+  }
+
+  for (auto& waiter : waiters) {
+    waiter.set_value(success);
+  }
+  return success;
+}
+
+}  // namespace database
+}  // namespace banking
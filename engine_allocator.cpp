@@ -0,0 +1,31 @@
+#include "engine_allocator.hpp"
+
+#include <array>
+
+const char* engineStructureName(EngineStructure structure) {
+  switch (structure) {
+    case EngineStructure::ACCOUNT_IDS: return "account_ids";
+    case EngineStructure::ACCOUNT_COLUMNS: return "account_columns";
+    case EngineStructure::BALANCE_HISTORY: return "balance_history";
+    case EngineStructure::PAYMENTS: return "payments";
+    case EngineStructure::SPENDER_INDEX: return "spender_index";
+  }
+  return "unknown";
+}
+
+const AllocationMeters& allocationMeters(EngineStructure structure) {
+  // Registered on first use, so even allocations during static initialization are counted
+  static const std::array<AllocationMeters, kEngineStructureCount> meters = [] {
+    auto& metrics = banking::observability::getGlobalMetrics();
+    std::array<AllocationMeters, kEngineStructureCount> registered{};
+    for (size_t i = 0; i < kEngineStructureCount; ++i) {
+      const banking::observability::Labels labels = {
+          {"structure", engineStructureName(static_cast<EngineStructure>(i))}};
+      registered[i] = {&metrics.gauge("engine_allocated_bytes", labels),
+                       &metrics.counter("engine_allocations_total", labels),
+                       &metrics.rate("engine_allocation_rate", labels)};
+    }
+    return registered;
+  }();
+  return meters[static_cast<size_t>(structure)];
+}
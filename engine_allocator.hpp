@@ -0,0 +1,89 @@
+#ifndef ENGINE_ALLOCATOR_HPP_
+#define ENGINE_ALLOCATOR_HPP_
+
+#include "observability/metrics.hpp"
+#include "observability/latency_histogram.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * The engine structures whose heap use the allocation profile breaks out.
+ */
+enum class EngineStructure : uint8_t {
+  ACCOUNT_IDS,      // AccountInterner
+  ACCOUNT_COLUMNS,  // Per-account parallel arrays
+  BALANCE_HISTORY,  // BalanceLog chunks and directories
+  PAYMENTS,         // PaymentScheduler
+  SPENDER_INDEX     // TopSpenders ordering
+};
+
+constexpr size_t kEngineStructureCount = static_cast<size_t>(EngineStructure::SPENDER_INDEX) + 1;
+
+// Lower-case name, e.g. "balance_history", as used in metric labels
+const char* engineStructureName(EngineStructure structure);
+
+/**
+ * Metric handles of one structure, shared by every engine instance:
+ * engine_allocated_bytes (gauge), engine_allocations_total (counter) and
+ * engine_allocation_rate (allocations per second), labelled by structure.
+ */
+struct AllocationMeters {
+  banking::observability::Gauge* bytes;
+  banking::observability::Counter* allocations;
+  banking::observability::RateMeter* rate;
+};
+
+const AllocationMeters& allocationMeters(EngineStructure structure);
+
+/**
+ * std::allocator that charges every allocation to `Structure`'s meters. The
+ * bytes are those the container asks for; allocator bookkeeping and the
+ * heap of strings it holds by value are not included.
+ */
+template <typename T, EngineStructure Structure>
+class CountingAllocator {
+ public:
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = CountingAllocator<U, Structure>;
+  };
+
+  CountingAllocator() noexcept = default;
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U, Structure>&) noexcept {}
+
+  T* allocate(size_t n) {
+    T* p = std::allocator<T>().allocate(n);
+    const AllocationMeters& meters = allocationMeters(Structure);
+    meters.bytes->increment(static_cast<double>(n * sizeof(T)));
+    meters.allocations->increment();
+    meters.rate->record();
+    return p;
+  }
+
+  void deallocate(T* p, size_t n) noexcept {
+    allocationMeters(Structure).bytes->decrement(static_cast<double>(n * sizeof(T)));
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U, Structure>&) const noexcept { return true; }
+  template <typename U>
+  bool operator!=(const CountingAllocator<U, Structure>&) const noexcept { return false; }
+};
+
+// Engine containers count their allocations only in profiling builds
+// (-DBANKING_ALLOCATION_PROFILING=ON); otherwise they use std::allocator.
+#ifdef BANKING_ALLOCATION_PROFILING
+template <typename T, EngineStructure Structure>
+using EngineAllocator = CountingAllocator<T, Structure>;
+#else
+template <typename T, EngineStructure Structure>
+using EngineAllocator = std::allocator<T>;
+#endif
+
+#endif  // ENGINE_ALLOCATOR_HPP_
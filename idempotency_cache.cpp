@@ -0,0 +1,190 @@
+#include "idempotency_cache.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace banking {
+
+struct IdempotencyCache::Attempt {
+  std::mutex mutex;
+  std::condition_variable finished;
+  bool done = false;
+  std::optional<network::protocol::Response> response;  // Empty if the attempt threw
+  std::exception_ptr error;
+  std::vector<Done> waiters;  // Duplicates answered when it finishes
+};
+
+struct IdempotencyCache::Shard {
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    uint64_t id;  // Tells a reservation's own entry from a later one for the same key
+    Clock::time_point expires;
+    std::shared_ptr<Attempt> attempt;
+    std::list<std::string>::iterator position;  // In order
+  };
+
+  void erase(std::unordered_map<std::string, Entry>::iterator it) {
+    order.erase(it->second.position);
+    entries.erase(it);
+  }
+
+  std::mutex mutex;
+  uint64_t next_id = 0;
+  std::list<std::string> order;  // Oldest first, which is also expiry order
+  std::unordered_map<std::string, Entry> entries;
+};
+
+IdempotencyCache::IdempotencyCache(const Config& config)
+    : ttl_(config.ttl),
+      hits_metric_(observability::getGlobalMetrics().counter("idempotency_hits_total")),
+      misses_metric_(observability::getGlobalMetrics().counter("idempotency_misses_total")),
+      evictions_metric_(observability::getGlobalMetrics().counter("idempotency_evictions_total")) {
+  const size_t shards = std::max<size_t>(1, config.shards);
+  capacity_per_shard_ = config.capacity == 0 ? 0 : std::max<size_t>(1, config.capacity / shards);
+  shards_.reserve(shards);
+  for (size_t i = 0; i < shards; ++i) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+IdempotencyCache::~IdempotencyCache() = default;
+
+IdempotencyCache::Reservation IdempotencyCache::reserve(const std::string& client_id,
+                                                         const std::string& key) {
+  Reservation reservation;
+  // Keys are only unique per client
+  reservation.key.reserve(client_id.size() + 1 + key.size());
+  reservation.key.append(client_id).push_back('\0');
+  reservation.key.append(key);
+  reservation.shard = shards_[std::hash<std::string>{}(reservation.key) % shards_.size()].get();
+  Shard& shard = *reservation.shard;
+
+  const auto now = Shard::Clock::now();
+  size_t expired = 0;
+  size_t evicted = 0;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    while (!shard.order.empty()) {
+      auto oldest = shard.entries.find(shard.order.front());
+      if (oldest->second.expires > now) break;
+      shard.erase(oldest);
+      ++expired;
+    }
+
+    auto it = shard.entries.find(reservation.key);
+    if (it != shard.entries.end()) {
+      reservation.attempt = it->second.attempt;
+    } else {
+      while (shard.entries.size() >= capacity_per_shard_) {
+        shard.erase(shard.entries.find(shard.order.front()));
+        ++evicted;
+      }
+      reservation.attempt = std::make_shared<Attempt>();
+      reservation.owner = true;
+      reservation.id = shard.next_id++;
+      shard.order.push_back(reservation.key);
+      shard.entries.emplace(reservation.key,
+                            Shard::Entry{reservation.id, now + ttl_, reservation.attempt,
+                                         std::prev(shard.order.end())});
+    }
+  }
+
+  expirations_ += expired;
+  if (evicted > 0) {
+    evictions_ += evicted;
+    evictions_metric_.increment(static_cast<double>(evicted));
+  }
+  if (reservation.owner) {
+    ++misses_;
+    misses_metric_.increment();
+  } else {
+    bool done;
+    {
+      std::lock_guard<std::mutex> lock(reservation.attempt->mutex);
+      done = reservation.attempt->done;
+    }
+    ++(done ? hits_ : waits_);
+    hits_metric_.increment();
+  }
+  return reservation;
+}
+
+network::protocol::Response IdempotencyCache::wait(const Reservation& reservation) {
+  Attempt& attempt = *reservation.attempt;
+  std::unique_lock<std::mutex> lock(attempt.mutex);
+  attempt.finished.wait(lock, [&] { return attempt.done; });
+  if (attempt.error) std::rethrow_exception(attempt.error);
+  return *attempt.response;
+}
+
+void IdempotencyCache::await(const Reservation& reservation, Done done) {
+  Attempt& attempt = *reservation.attempt;
+  {
+    std::lock_guard<std::mutex> lock(attempt.mutex);
+    if (!attempt.done) {
+      attempt.waiters.push_back(std::move(done));
+      return;
+    }
+  }
+  // A finished attempt no longer changes
+  done(attempt.response ? &*attempt.response : nullptr);
+}
+
+void IdempotencyCache::finish(Reservation& reservation, const network::protocol::Response& response,
+                              bool keep) {
+  complete(*reservation.attempt, &response, nullptr);
+  if (!keep) forget(reservation);
+}
+
+void IdempotencyCache::fail(Reservation& reservation, std::exception_ptr error) {
+  complete(*reservation.attempt, nullptr, error);
+  forget(reservation);
+}
+
+void IdempotencyCache::complete(Attempt& attempt, const network::protocol::Response* response,
+                                std::exception_ptr error) {
+  std::vector<Done> waiters;
+  {
+    std::lock_guard<std::mutex> lock(attempt.mutex);
+    if (attempt.done) return;  // An asynchronous run that finished before throwing
+    attempt.done = true;
+    if (response) attempt.response = *response;
+    attempt.error = error;
+    waiters.swap(attempt.waiters);
+  }
+  attempt.finished.notify_all();
+  for (const Done& waiter : waiters) {
+    waiter(response);
+  }
+}
+
+void IdempotencyCache::forget(Reservation& reservation) {
+  Shard& shard = *reservation.shard;
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.entries.find(reservation.key);
+  if (it != shard.entries.end() && it->second.id == reservation.id) {
+    shard.erase(it);
+  }
+}
+
+IdempotencyCache::Stats IdempotencyCache::getStats() const {
+  Stats stats;
+  stats.hits = hits_.load();
+  stats.waits = waits_.load();
+  stats.misses = misses_.load();
+  stats.evictions = evictions_.load();
+  stats.expirations = expirations_.load();
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    stats.entries += shard->entries.size();
+  }
+  return stats;
+}
+
+}  // namespace banking
@@ -3,14 +3,22 @@
 
 #include "../network/protocol.hpp"
 #include "../concurrent/lockfree_queue.hpp"
+#include "../concurrent/bounded_queue.hpp"
+#include "../concurrent/thread_placement.hpp"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
-#include <deque>
-#include <chrono>
 #include <functional>
 
 namespace banking {
@@ -50,13 +58,39 @@ struct FraudResult {
 /**
  * AI-powered fraud detection agent.
  * Analyzes transaction patterns in real-time to detect fraudulent activity.
+ *
+ * Accounts are partitioned across analysis workers by hash. Each worker has
+ * its own queue and owns the state of its accounts, so the asynchronous path
+ * never shares an account between threads; only synchronous
+ * analyzeTransaction() calls contend for a worker's shard. Per-account state
+ * is a handful of O(1) streaming aggregates: a running mean and variance of
+ * amounts, an exponentially decayed spend rate and a sliding one-hour
+ * transaction count.
  */
 class FraudDetectionAgent {
  public:
+  /**
+   * Called from the analysis workers, possibly several at once.
+   */
   using AlertCallback = std::function<void(const TransactionData&, const FraudResult&)>;
 
+  static constexpr size_t kDefaultSnapshotSlots = 1 << 14;
+
+  /**
+   * A non-zero `analysis_queue_capacity` bounds the analysis backlog with ring
+   * buffers, split evenly across workers; transactions submitted to a full one
+   * are dropped and counted. `analysis_workers` of 0 uses one per core, or
+   * one per entry of `worker_cpus`, which pins worker i to worker_cpus[i].
+   * Amount statistics weigh roughly the last `max_transactions_per_account`
+   * transactions of an account. quickScore() reads from a table of
+   * `snapshot_slots` account snapshots; accounts sharing a slot evict each other.
+   */
   FraudDetectionAgent(size_t analysis_window_seconds = 3600,  // 1 hour
-                      size_t max_transactions_per_account = 1000);
+                      size_t max_transactions_per_account = 1000,
+                      size_t analysis_queue_capacity = 0,
+                      size_t analysis_workers = 0,
+                      std::vector<int> worker_cpus = {},
+                      size_t snapshot_slots = kDefaultSnapshotSlots);
   ~FraudDetectionAgent();
 
   // Non-copyable
@@ -74,14 +108,31 @@ class FraudDetectionAgent {
   void stop();
 
   /**
-   * Analyze a transaction for fraud.
+   * Analyze a transaction for fraud and add it to the account's history.
    */
   FraudResult analyzeTransaction(const TransactionData& transaction);
 
+  /**
+   * Analyze many transactions in order, as analyzeTransaction() would one by
+   * one. Each shard is locked once, and scoring runs over the whole batch.
+   */
+  std::vector<FraudResult> analyzeBatch(const std::vector<TransactionData>& transactions);
+
+  /**
+   * Lightweight score of a transaction for inline pre-authorization, in the
+   * same 0-1 range as FraudResult::risk_score but without the location
+   * factor. Reads the account snapshot the analysis last published, without
+   * locks and without recording anything; an account never analyzed scores
+   * 0. Empty if its slot holds another account's snapshot, or was being
+   * rewritten on every read attempt.
+   */
+  std::optional<double> quickScore(const std::string& account_id, int amount, int timestamp) const;
+
   /**
    * Submit transaction for asynchronous analysis.
+   * Returns false if a bounded analysis queue is full and the transaction was dropped.
    */
-  void submitTransaction(const TransactionData& transaction);
+  bool submitTransaction(const TransactionData& transaction);
 
   /**
    * Set callback for fraud alerts.
@@ -96,6 +147,7 @@ class FraudDetectionAgent {
     size_t fraud_alerts_generated;
     double average_risk_score;
     size_t analysis_queue_size;
+    size_t transactions_dropped;
   };
   Stats getStats() const;
 
@@ -105,34 +157,120 @@ class FraudDetectionAgent {
   void updateModels();
 
  private:
-  void analysisWorker();
-  FraudResult performAnalysis(const TransactionData& transaction);
-  double calculateAmountAnomalyScore(const TransactionData& transaction);
-  double calculateFrequencyAnomalyScore(const TransactionData& transaction);
-  double calculateVelocityAnomalyScore(const TransactionData& transaction);
-  double calculateLocationAnomalyScore(const TransactionData& transaction);
-
-  // Transaction history per account
-  struct AccountHistory {
-    std::deque<TransactionData> recent_transactions;
-    std::chrono::steady_clock::time_point last_update;
-    double average_transaction_amount = 0.0;
-    double transaction_frequency_per_hour = 0.0;
-    std::unordered_map<std::string, int> location_counts;
-    std::unordered_map<std::string, int> ip_counts;
-
-    void addTransaction(const TransactionData& tx);
-    void cleanupOldTransactions(int current_timestamp);
+  static constexpr int kWindowBucketSeconds = 300;
+  static constexpr size_t kWindowBuckets = 12;  // One hour
+
+  // Streaming aggregates of one account's transactions so far
+  struct AccountState {
+    // Welford's running mean and sum of squared deviations of amounts
+    uint32_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    double velocity = 0.0;  // Spend, decayed with a one-hour time constant from last_timestamp
+    int last_timestamp = 0;
+
+    std::array<uint32_t, kWindowBuckets> window{};  // Transactions per 5-minute bucket
+    int64_t window_bucket = 0;                      // Bucket index of the newest count
+
+    std::vector<std::pair<uint32_t, uint32_t>> location_counts;  // (location, transactions)
+
+    double stddev() const { return count > 1 ? std::sqrt(m2 / (count - 1)) : 0.0; }
+    // Half the mean is the floor, so steady accounts are not flagged for small changes
+    double spread() const { return std::max(stddev(), std::abs(mean) * 0.5); }
+    double decayedVelocity(int timestamp) const;
+    uint32_t transactionsInWindow(int timestamp) const;
+    void record(int timestamp, int amount, uint32_t location, size_t max_count);
+
+    // Ring position of a bucket; buckets before 0 (the first hour) wrap like any other
+    static size_t windowSlot(int64_t bucket);
+  };
+
+  // Per-transaction features as parallel columns, so scoring is plain loops
+  struct FeatureColumns {
+    std::vector<double> amount_z;        // Deviation from the account mean, in standard deviations
+    std::vector<double> frequency;       // Transactions in the past hour
+    std::vector<double> velocity;        // Decayed hourly spend including this transaction
+    std::vector<double> location_share;  // Share of history at this location (1 = not scored)
+    std::vector<double> amount_score;
+    std::vector<double> frequency_score;
+    std::vector<double> velocity_score;
+    std::vector<double> location_score;
+    std::vector<double> risk_score;
+
+    void resize(size_t n);
   };
 
+  /**
+   * An account's aggregates as of its last analysis, for quickScore(). Slots
+   * are picked by account hash and guarded by a sequence lock: writers make
+   * `sequence` odd while they update, and readers retry if it changed. A
+   * writer finding the slot already odd, because another shard's account
+   * shares it, skips its update.
+   */
+  struct alignas(64) Snapshot {
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<int> last_timestamp{0};
+    std::atomic<uint64_t> account_hash{0};  // 0 = empty
+    std::atomic<double> mean{0.0};
+    std::atomic<double> spread{0.0};         // Floored as in extractFeatures()
+    std::atomic<double> velocity{0.0};       // As of last_timestamp
+    std::atomic<uint32_t> window_count{0};   // Transactions in the hour up to last_timestamp
+  };
+
+  // The accounts one worker owns
+  struct Shard {
+    std::mutex mutex;  // Uncontended unless analyzeTransaction() is called directly
+    std::unordered_map<std::string, AccountState> accounts;
+    std::unordered_map<std::string, uint32_t> locations;  // Interned location names, from 1
+  };
+
+  /**
+   * A worker's queue, the means for it to block on the queue, and its shard.
+   * Uses the bounded ring when one was configured, the linked queue otherwise.
+   */
+  struct Worker {
+    explicit Worker(size_t capacity)
+        : bounded(capacity > 0 ? std::make_unique<concurrent::BoundedQueue<TransactionData>>(capacity)
+                               : nullptr) {}
+
+    bool push(const TransactionData& transaction);
+    std::optional<TransactionData> pop() { return bounded ? bounded->tryDequeue() : queue.dequeue(); }
+    bool empty() const { return bounded ? bounded->empty() : queue.empty(); }
+    size_t size() const { return bounded ? bounded->size() : queue.size(); }
+
+    concurrent::LockFreeQueue<TransactionData> queue;
+    std::unique_ptr<concurrent::BoundedQueue<TransactionData>> bounded;
+    std::mutex wait_mutex;
+    std::condition_variable not_empty;
+    std::atomic<size_t> sleepers{0};
+
+    Shard shard;
+    std::atomic<double> risk_score_sum{0.0};  // Written by this worker's thread only
+    std::thread thread;
+  };
+
+  Worker& workerFor(const std::string& account_id);
+  void analysisWorker(Worker& worker);
+  bool waitForWork(Worker& worker);
+
+  // Score against the account's history, then record the transaction in it
+  FraudResult performAnalysis(Shard& shard, const TransactionData& transaction);
+
+  // Fill row `row` of `features` and record the transaction; shard.mutex must be held
+  void extractFeatures(Shard& shard, const TransactionData& transaction, FeatureColumns& features,
+                       size_t row) const;
+  void scoreFeatures(FeatureColumns& features) const;
+  static FraudResult makeResult(const FeatureColumns& features, size_t row);
+
+  void publishSnapshot(uint64_t account_hash, const AccountState& state) const;
+
   size_t analysis_window_seconds_;
   size_t max_transactions_per_account_;
 
-  std::unordered_map<std::string, AccountHistory> account_histories_;
-  mutable std::mutex histories_mutex_;
-
-  concurrent::LockFreeQueue<TransactionData> analysis_queue_;
-  std::unique_ptr<std::thread> analysis_thread_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  size_t snapshot_slots_;
+  std::unique_ptr<Snapshot[]> snapshots_;
   std::atomic<bool> running_;
 
   AlertCallback alert_callback_;
@@ -140,8 +278,9 @@ class FraudDetectionAgent {
   // Statistics
   std::atomic<size_t> transactions_analyzed_;
   std::atomic<size_t> fraud_alerts_generated_;
-  double total_risk_score_;
-  mutable std::mutex stats_mutex_;
+  std::atomic<size_t> transactions_dropped_;
+
+  std::vector<int> worker_cpus_;  // Empty leaves the workers unpinned
 
   // Fraud detection thresholds (configurable)
   double amount_anomaly_threshold_ = 3.0;  // Standard deviations
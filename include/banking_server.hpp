@@ -4,11 +4,21 @@
 #include "network/tcp_server.hpp"
 #include "banking_system_thread_safe.hpp"
 #include "concurrent/transaction_processor.hpp"
+#include "concurrent/thread_placement.hpp"
 #include "ai/fraud_detection_agent.hpp"
+#include "idempotency_cache.hpp"
+#include "observability/metrics.hpp"
 
+#include <chrono>
+#include <functional>
+#include <map>
 #include <memory>
+#include <optional>
+#include <shared_mutex>
 #include <unordered_map>
+#include <vector>
 #include <string>
+#include <string_view>
 
 namespace banking {
 
@@ -18,6 +28,30 @@ namespace banking {
  */
 class BankingServer {
  public:
+  struct Config {
+    int port = 8080;
+    size_t num_worker_threads = 4;
+    size_t analysis_window_seconds = 3600;
+
+    /**
+     * Pinning for the server's threads. Non-empty worker_cpus sets the worker
+     * count, and the default engine gets one shard per worker with its memory
+     * on that worker's node; non-empty reactor_cpus serves connections from
+     * that many event-loop reactors; non-empty fraud_cpus sets the analysis
+     * worker count. Empty leaves the threads unpinned, as before.
+     */
+    concurrent::ThreadPlacement placement;
+
+    // Replies to requests that carry an idempotency key, kept for retries
+    IdempotencyCache::Config idempotency;
+
+    // Account snapshots kept for pre-authorization scoring; a colliding account falls back
+    size_t fraud_snapshot_slots = ai::FraudDetectionAgent::kDefaultSnapshotSlots;
+  };
+
+  explicit BankingServer(const Config& config);
+  BankingServer(const Config& config, std::unique_ptr<BankingSystem> banking_system);
+
   BankingServer(int port,
                 size_t num_worker_threads = 4,
                 size_t analysis_window_seconds = 3600);
@@ -42,27 +76,94 @@ class BankingServer {
    */
   void stop();
 
+  /**
+   * Score financial operations inline before they are applied. A request
+   * scoring at least `reject_threshold` is answered with REJECTED_FRAUD; one
+   * whose decision takes longer than `budget` is applied and left to the
+   * asynchronous analysis. Call before start().
+   */
+  void enablePreAuthorization(std::chrono::microseconds budget, double reject_threshold = 0.8);
+
+  /**
+   * Serve reads only, as a replication follower does: GET_BALANCE and
+   * TOP_SPENDERS are answered while `is_fresh` holds and with ERROR otherwise,
+   * so clients can fall back to the primary; any other operation is answered
+   * with INVALID_REQUEST. Call before start().
+   */
+  void setReadOnly(std::function<bool()> is_fresh);
+
   /**
    * Get server statistics.
    */
+  struct RequestLatency {
+    network::protocol::MessageType type;
+    observability::LatencySummary parse;  // Frame handed over until decoded
+    observability::LatencySummary total;  // Frame handed over until its response was encoded
+  };
   struct Stats {
     bool is_running;
     size_t active_connections;
     concurrent::TransactionProcessor::Stats transaction_stats;
     ai::FraudDetectionAgent::Stats fraud_stats;
+    std::vector<RequestLatency> request_latency;  // Message types received so far
+    IdempotencyCache::Stats idempotency_stats;
+    concurrent::CpuTopology topology;             // CPUs and NUMA nodes available to the process
+    concurrent::ThreadPlacement placement;        // As configured; empty lists are unpinned
   };
   Stats getStats() const;
 
+  /**
+   * Reclaim memory the engine no longer needs and publish its engine_* gauges
+   * (see BankingSystem::ReclaimMemory).
+   */
+  void reclaimEngineMemory();
+
   /**
    * Get server port.
    */
   int getPort() const { return port_; }
 
  private:
+  /**
+   * Create the processor, fraud agent and TCP server around banking_system_.
+   */
+  void initializeComponents(const Config& config);
+
+  using ResponseCallback = concurrent::TransactionProcessor::ResponseCallback;
+
   /**
    * Handle incoming client requests.
+   * Decodes the frame once and answers through `respond` in the encoding the
+   * client used, once a worker has applied the request; the calling reactor
+   * does not wait for it. Binary requests are admitted as views into the
+   * frame and copied only if they go on, since they then outlive it.
+   */
+  void handleRequest(std::string_view request_bytes, network::TCPServer::Responder respond);
+
+  /**
+   * Count and authenticate a request and answer what needs no processing
+   * (authentication, heartbeats, bad sessions, writes sent to a replica).
+   * Returns that answer, or empty to go on to processRequest(). Takes a
+   * Request or a RequestView.
+   */
+  template <typename RequestT>
+  std::optional<network::protocol::Response> admitRequest(const RequestT& request);
+
+  /**
+   * Execute an admitted request, replaying a retry from the idempotency
+   * cache, and hand the response to `done`.
+   */
+  void processRequest(network::protocol::Request request, ResponseCallback done);
+
+  /**
+   * Screen an authenticated request and queue it on the processor.
+   */
+  void applyRequest(network::protocol::Request request, ResponseCallback done);
+
+  /**
+   * The pre-authorization decision: a rejection, or empty to apply the request.
    */
-  std::string handleRequest(const std::string& request_json);
+  std::optional<network::protocol::Response> preAuthorize(const network::protocol::Request& request);
 
   /**
    * Handle fraud detection alerts.
@@ -76,15 +177,37 @@ class BankingServer {
   ai::TransactionData extractTransactionData(const network::protocol::Request& request);
 
   int port_;
+  concurrent::CpuTopology topology_;
+  concurrent::ThreadPlacement placement_;
 
   // Core components
-  std::unique_ptr<BankingSystemThreadSafe> banking_system_;
+  std::unique_ptr<BankingSystem> banking_system_;
   std::unique_ptr<concurrent::TransactionProcessor> transaction_processor_;
   std::unique_ptr<ai::FraudDetectionAgent> fraud_agent_;
   std::unique_ptr<network::TCPServer> tcp_server_;
+  std::unique_ptr<IdempotencyCache> idempotency_cache_;
+
+  // Inline pre-authorization, off unless enabled
+  bool preauth_enabled_ = false;
+  std::chrono::microseconds preauth_budget_{0};
+  double preauth_reject_threshold_ = 0.8;
+
+  // Read-only follower mode, off unless set
+  bool read_only_ = false;
+  std::function<bool()> replica_fresh_;
+
+  // Metric handles, registered up front so requests never look them up by name
+  std::vector<observability::Counter*> request_counters_;  // By MessageType
+  std::vector<observability::LatencyRecorder*> parse_latency_;
+  std::vector<observability::LatencyRecorder*> total_latency_;
+  observability::Histogram* preauth_decision_seconds_ = nullptr;
+  observability::Histogram* preauth_overrun_seconds_ = nullptr;
+  observability::Counter* preauth_fallbacks_ = nullptr;
+  observability::Counter* preauth_rejections_ = nullptr;
 
   // Session management (simplified - in production, use proper JWT/session management)
-  std::unordered_map<std::string, std::string> active_sessions_;  // client_id -> session_token
+  // client_id -> session_token; transparent, so a client id still in the frame looks it up uncopied
+  std::map<std::string, std::string, std::less<>> active_sessions_;
   mutable std::shared_mutex sessions_mutex_;
 };
 
@@ -5,6 +5,29 @@
 #include <string>
 #include <vector>
 
+/**
+ * One mutation inside a batch. Only the fields used by `type` are read.
+ */
+struct BatchOperation {
+  enum class Type { CREATE_ACCOUNT, DEPOSIT, TRANSFER, SCHEDULE_PAYMENT, CANCEL_PAYMENT };
+
+  Type type = Type::DEPOSIT;
+  std::string account_id;         // CREATE_ACCOUNT, DEPOSIT, *_PAYMENT; TRANSFER source
+  std::string target_account_id;  // TRANSFER
+  std::string payment_id;         // CANCEL_PAYMENT
+  int amount = 0;
+  int delay = 0;                  // SCHEDULE_PAYMENT
+};
+
+/**
+ * Outcome of one BatchOperation, in the same position as the operation.
+ */
+struct BatchResult {
+  bool success = false;
+  std::optional<int> balance;            // New balance (DEPOSIT) or source balance (TRANSFER)
+  std::optional<std::string> payment_id; // SCHEDULE_PAYMENT
+};
+
 /**
  * Abstract base class for banking system operations.
  * This provides the interface that implementations must follow.
@@ -45,6 +68,50 @@ class BankingSystem {
                            const std::string& account_id_2) = 0;
   virtual std::optional<int> GetBalance(int timestamp, const std::string& account_id,
                                       int time_at) = 0;
+
+  /**
+   * Releases memory the engine no longer needs, such as spare capacity left by
+   * an earlier peak, and refreshes its engine_* gauges. Answers are unchanged.
+   * Meant to be called periodically; engines with nothing to release keep this no-op.
+   */
+  virtual void ReclaimMemory() {}
+
+  /**
+   * Applies `operations` in order, all at `timestamp`, and returns one result per
+   * operation. Operations are independent: a failed one does not undo the others.
+   * Implementations override this to pay per-call costs (due-payment processing,
+   * locking) once per batch; the default simply loops over the single operations.
+   */
+  virtual std::vector<BatchResult> ApplyBatch(int timestamp,
+                                              const std::vector<BatchOperation>& operations) {
+    std::vector<BatchResult> results;
+    results.reserve(operations.size());
+    for (const auto& op : operations) {
+      BatchResult result;
+      switch (op.type) {
+        case BatchOperation::Type::CREATE_ACCOUNT:
+          result.success = CreateAccount(timestamp, op.account_id);
+          break;
+        case BatchOperation::Type::DEPOSIT:
+          result.balance = Deposit(timestamp, op.account_id, op.amount);
+          result.success = result.balance.has_value();
+          break;
+        case BatchOperation::Type::TRANSFER:
+          result.balance = Transfer(timestamp, op.account_id, op.target_account_id, op.amount);
+          result.success = result.balance.has_value();
+          break;
+        case BatchOperation::Type::SCHEDULE_PAYMENT:
+          result.payment_id = SchedulePayment(timestamp, op.account_id, op.amount, op.delay);
+          result.success = result.payment_id.has_value();
+          break;
+        case BatchOperation::Type::CANCEL_PAYMENT:
+          result.success = CancelPayment(timestamp, op.account_id, op.payment_id);
+          break;
+      }
+      results.push_back(std::move(result));
+    }
+    return results;
+  }
 };
 
 #endif  // BANKING_SYSTEM_HPP_
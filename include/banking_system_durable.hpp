@@ -0,0 +1,96 @@
+#ifndef BANKING_SYSTEM_DURABLE_HPP_
+#define BANKING_SYSTEM_DURABLE_HPP_
+
+#include "banking_system_logged.hpp"
+#include "storage/write_ahead_log.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace banking {
+
+/**
+ * In-memory banking system made durable by local files instead of a database.
+ *
+ * Operation records (see BankingSystemLogged) are appended to a write-ahead
+ * log; the caller then waits outside the mutex for the group fsync that
+ * covers its record. Every `snapshot_every_operations` logged operations a
+ * background thread writes a memory-mappable snapshot of the engine and drops
+ * the WAL segments it covers. open() maps the newest snapshot and replays the
+ * WAL tail after it.
+ */
+class BankingSystemDurable : public BankingSystemLogged {
+ public:
+  struct Config {
+    // Holds the WAL segments and snapshots
+    std::string data_directory = "banking_data";
+    std::chrono::microseconds sync_interval{1000};
+    // Return from a mutation only once its WAL record is on disk
+    bool wait_for_sync = true;
+    // Logged operations between automatic snapshots (0 = only Checkpoint())
+    size_t snapshot_every_operations = 100000;
+  };
+
+  struct RecoveryStats {
+    uint64_t snapshot_sequence = 0;  // WAL sequence the snapshot covers (0 = no snapshot)
+    size_t snapshot_accounts = 0;
+    uint64_t replayed_operations = 0;
+    std::chrono::milliseconds duration{0};
+  };
+
+  explicit BankingSystemDurable(const Config& config);
+  ~BankingSystemDurable() override;
+
+  // Non-copyable
+  BankingSystemDurable(const BankingSystemDurable&) = delete;
+  BankingSystemDurable& operator=(const BankingSystemDurable&) = delete;
+
+  /**
+   * Recover from the data directory and start logging. Must be called before
+   * any operation; false if the snapshot or WAL cannot be read back.
+   */
+  bool open();
+
+  /**
+   * Write a snapshot now and delete the WAL segments and snapshots it supersedes.
+   */
+  bool Checkpoint();
+
+  RecoveryStats getRecoveryStats() const;
+  storage::WriteAheadLog::Stats getWalStats() const { return wal_.getStats(); }
+
+ protected:
+  // Append one encoded operation to the WAL; requires mutex_. Returns its sequence (0 on failure).
+  uint64_t appendRecord(std::string record) override;
+
+  // Wait, outside mutex_, until the record is as durable as the config asks.
+  bool awaitRecord(uint64_t sequence) override;
+
+ private:
+
+  void snapshotterLoop();
+
+  Config config_;
+  storage::WriteAheadLog wal_;
+
+  bool opened_ = false;
+  size_t operations_since_snapshot_ = 0;
+  RecoveryStats recovery_;
+
+  std::mutex checkpoint_mutex_;  // One snapshot at a time
+  // Snapshotter wake-ups; the flags below are guarded by mutex_
+  std::condition_variable checkpoint_cv_;
+  bool checkpoint_requested_ = false;
+  bool stopping_ = false;
+  std::thread snapshotter_;
+};
+
+}  // namespace banking
+
+#endif  // BANKING_SYSTEM_DURABLE_HPP_
@@ -0,0 +1,108 @@
+#ifndef BANKING_SYSTEM_LOGGED_HPP_
+#define BANKING_SYSTEM_LOGGED_HPP_
+
+#include "banking_system.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class BankingSystemImpl;
+
+namespace banking {
+
+namespace oplog {
+class RecordWriter;
+}  // namespace oplog
+
+/**
+ * In-memory banking system that records every successful mutation as an
+ * operation-log record (see operation_log.hpp), for a subclass to send
+ * somewhere: BankingSystemDurable appends them to its WAL,
+ * BankingSystemPrimary publishes them to followers.
+ *
+ * Every mutation is applied to a BankingSystemImpl and handed to
+ * appendRecord() under one mutex, so record order is the order operations
+ * took effect. awaitRecord() then runs with the mutex released. Failed
+ * operations change nothing and are not recorded; a batch is recorded whole
+ * if any of its operations succeeded, as replaying the failed ones fails them
+ * again.
+ *
+ * Queries are not recorded. They may still advance the engine's clock (which
+ * decides when scheduled payments fire), so the next record carries the
+ * highest query timestamp seen since the previous one, and replay advances
+ * the clock to it first.
+ */
+class BankingSystemLogged : public BankingSystem {
+ public:
+  ~BankingSystemLogged() override;
+
+  // Non-copyable
+  BankingSystemLogged(const BankingSystemLogged&) = delete;
+  BankingSystemLogged& operator=(const BankingSystemLogged&) = delete;
+
+  bool CreateAccount(int timestamp, const std::string& account_id) override;
+  std::optional<int> Deposit(int timestamp, const std::string& account_id, int amount) override;
+  std::optional<int> Transfer(int timestamp, const std::string& source_account_id,
+                             const std::string& target_account_id, int amount) override;
+  std::vector<std::string> TopSpenders(int timestamp, int n) override;
+  std::optional<std::string> SchedulePayment(int timestamp, const std::string& account_id,
+                                           int amount, int delay) override;
+  bool CancelPayment(int timestamp, const std::string& account_id,
+                    const std::string& payment_id) override;
+  bool MergeAccounts(int timestamp, const std::string& account_id_1,
+                    const std::string& account_id_2) override;
+  std::optional<int> GetBalance(int timestamp, const std::string& account_id,
+                               int time_at) override;
+
+  /**
+   * Applies the whole batch under one lock and records it as one record.
+   */
+  std::vector<BatchResult> ApplyBatch(int timestamp,
+                                      const std::vector<BatchOperation>& operations) override;
+
+  void ReclaimMemory() override;
+
+  /**
+   * Drops balance history before `before_timestamp` (see BankingSystemImpl::CompactHistory).
+   */
+  void CompactHistory(int before_timestamp);
+
+ protected:
+  BankingSystemLogged();
+
+  /**
+   * Send one record on; called with mutex_ held, in record order. Returns a
+   * ticket for awaitRecord() (0 if the record could not be taken).
+   */
+  virtual uint64_t appendRecord(std::string record) = 0;
+
+  /**
+   * Whether the record with `ticket` got as far as the sink promises (for
+   * example, onto disk); called with mutex_ released. A false result fails
+   * the operation, though its change stays in memory.
+   */
+  virtual bool awaitRecord(uint64_t /*ticket*/) { return true; }
+
+  mutable std::mutex mutex_;  // impl_, and the order records are appended in
+  std::unique_ptr<BankingSystemImpl> impl_;
+
+ private:
+  // Append an applied operation's record under `lock`, then release it and await the record.
+  bool record(std::unique_lock<std::mutex>& lock, const oplog::RecordWriter& writer);
+
+  // Note a timestamp seen by an operation that was not recorded; requires mutex_.
+  void observe(int timestamp);
+
+  // Highest unrecorded timestamp if it is ahead of `timestamp`, else kNoWatermark; resets it.
+  int takeReadWatermark(int timestamp);
+
+  int read_watermark_ = std::numeric_limits<int>::min();
+};
+
+}  // namespace banking
+
+#endif  // BANKING_SYSTEM_LOGGED_HPP_
@@ -3,15 +3,30 @@
 
 #include "banking_system.hpp"
 #include "database/banking_persistence.hpp"
+#include "database/read_cache.hpp"
+#include "database/write_behind_pipeline.hpp"
 
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class BankingSystemImpl;
 
 namespace banking {
 
 /**
  * Persistent banking system that combines in-memory operations with database persistence.
- * Uses write-through caching strategy: operations are performed in memory first,
- * then persisted to database for durability.
+ * Operations are performed in memory first; their records then go through a
+ * write-behind pipeline that group-commits them to the database. With
+ * DurabilityMode::ASYNC the database trails memory, so reads are answered from
+ * memory instead. Database-backed reads go through a ReadCache that the write
+ * path invalidates once its records are committed.
  */
 class BankingSystemPersistent : public BankingSystem {
  public:
@@ -24,11 +39,21 @@ class BankingSystemPersistent : public BankingSystem {
     std::string db_name = "banking_system";
     std::string db_username = "banking_user";
     std::string db_password = "";
+    int db_pool_size = 10;
     bool enable_fraud_detection = true;
     bool enable_audit_logging = true;
+    database::WriteBehindPipeline::Config persistence{};
+    database::ReadCache::Config read_cache{};
   };
 
   BankingSystemPersistent(const Config& config);
+
+  /**
+   * Persist through `persistence`, which is already set up, starting from an
+   * empty engine; initialize() is not needed and connects nothing.
+   */
+  BankingSystemPersistent(const Config& config, std::unique_ptr<database::BankingPersistence> persistence);
+
   ~BankingSystemPersistent() override;
 
   // Non-copyable
@@ -36,7 +61,8 @@ class BankingSystemPersistent : public BankingSystem {
   BankingSystemPersistent& operator=(const BankingSystemPersistent&) = delete;
 
   /**
-   * Initialize the database schema and load existing data.
+   * Initialize the database schema and load existing data. Startup streams the
+   * tables with binary COPY and restores the in-memory engine in bulk.
    */
   bool initialize();
 
@@ -73,26 +99,97 @@ class BankingSystemPersistent : public BankingSystem {
   std::optional<int> GetBalance(int timestamp, const std::string& account_id,
                                int time_at) override;
 
+  /**
+   * Runs the operations one by one but hands their records to the pipeline as
+   * one write batch. If it cannot be persisted every result reports failure.
+   */
+  std::vector<BatchResult> ApplyBatch(int timestamp,
+                                      const std::vector<BatchOperation>& operations) override;
+
+  /**
+   * Reclaims memory of the in-memory engine; the database keeps the full history.
+   */
+  void ReclaimMemory() override;
+
+  /**
+   * Records queued by one thread's operations, to wait for outside any lock.
+   */
+  struct PendingCommit {
+    std::vector<std::future<bool>> commits;
+    std::vector<std::pair<std::string, int>> stale_balances;  // Read-cache entries to drop once committed
+    bool stale_spenders = false;
+  };
+
+  /**
+   * From now on, in GROUP_COMMIT mode, operations return as soon as their
+   * records are queued and report success; whoever called them must take the
+   * pending commit with takeCommit() and pass it to awaitCommit(). Used by
+   * BankingSystemThreadSafe to wait with its mutex released.
+   */
+  void deferCommits();
+
+  /**
+   * Remove and return what the calling thread's operations have queued since
+   * its last call.
+   */
+  PendingCommit takeCommit();
+
+  /**
+   * Wait for `commit` and drop the cached reads it made stale. False if any
+   * of its records could not be written. Safe to call without any lock.
+   */
+  bool awaitCommit(PendingCommit commit);
+
+  /**
+   * Write-behind queue depth, flush counts and flush lag.
+   */
+  database::WriteBehindPipeline::Stats getPersistenceStats() const;
+
+  /**
+   * Hits, misses and size of the cache in front of database reads.
+   */
+  database::ReadCache::Stats getReadCacheStats() const;
+
  private:
   /**
    * Helper methods for persistence operations.
    */
-  bool persistTransaction(const std::string& transaction_type,
-                         const std::string& account_id,
-                         int amount, int balance_before, int balance_after,
-                         int timestamp, const std::string& reference_id = "",
-                         const std::string& description = "");
+  static void addTransaction(database::WriteBatch& batch,
+                             const std::string& transaction_type,
+                             const std::string& account_id,
+                             int amount, int balance_before, int balance_after,
+                             int timestamp, const std::string& reference_id = "",
+                             const std::string& description = "");
+
+  // Hand one operation's records to the pipeline, or to the batch being collected
+  bool persist(database::WriteBatch batch);
+
+  // Drop cached reads that committed records made stale
+  void invalidateReads(const std::vector<std::pair<std::string, int>>& balances, bool top_spenders);
+
+  // The (account, from time) balances `batch` changes; true if top spenders may change too
+  static bool staleReads(const database::WriteBatch& batch,
+                         std::vector<std::pair<std::string, int>>& balances);
+
+  // Whether the database has every committed operation, so reads may use it
+  bool databaseIsCurrent() const;
 
   bool loadFromDatabase();
   bool syncInMemoryWithDatabase();
 
   Config config_;
-  std::unique_ptr<BankingSystem> memory_system_;
-  std::shared_ptr<database::PostgresConnection> db_connection_;
+  std::unique_ptr<BankingSystemImpl> memory_system_;
+  std::shared_ptr<database::ConnectionPool> db_pool_;
   std::unique_ptr<database::BankingPersistence> persistence_;
+  std::unique_ptr<database::WriteBehindPipeline> pipeline_;  // Declared after persistence_: drains first
+  database::WriteBatch* collecting_ = nullptr;  // Set while ApplyBatch runs
+  bool defer_commits_ = false;  // Set by deferCommits()
+  std::mutex deferred_mutex_;
+  std::unordered_map<std::thread::id, PendingCommit> deferred_;  // Not yet taken, by thread
+  database::ReadCache read_cache_;
 
   // Cache for frequently accessed data
-  std::unordered_map<std::string, int> account_creation_cache_;
+  std::map<std::string, int> account_creation_cache_;
   mutable std::shared_mutex cache_mutex_;
 };
 
@@ -0,0 +1,58 @@
+#ifndef BANKING_SYSTEM_PRIMARY_HPP_
+#define BANKING_SYSTEM_PRIMARY_HPP_
+
+#include "banking_system_logged.hpp"
+#include "replication/replication_publisher.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace banking {
+
+/**
+ * In-memory banking system that streams its operation log to read-only
+ * followers (see BankingSystemReplica).
+ *
+ * Operation records (see BankingSystemLogged) are published in the order
+ * operations took effect, whichever processor worker ran them; they are the
+ * same records BankingSystemDurable writes to its WAL. CompactHistory() is
+ * recorded too, so it also compacts every follower.
+ *
+ * The single mutex gives up ShardedBankingSystem's parallelism on the primary
+ * in exchange for one total order that followers can replay.
+ */
+class BankingSystemPrimary : public BankingSystemLogged {
+ public:
+  explicit BankingSystemPrimary(const replication::ReplicationPublisher::Config& config);
+  ~BankingSystemPrimary() override;
+
+  // Non-copyable
+  BankingSystemPrimary(const BankingSystemPrimary&) = delete;
+  BankingSystemPrimary& operator=(const BankingSystemPrimary&) = delete;
+
+  /**
+   * Start accepting followers.
+   */
+  bool start();
+
+  /**
+   * Disconnect every follower.
+   */
+  void stop();
+
+  replication::ReplicationPublisher::Stats getReplicationStats() const { return publisher_.getStats(); }
+
+ protected:
+  // Publish one encoded operation; requires mutex_. Returns its sequence.
+  uint64_t appendRecord(std::string record) override;
+
+ private:
+  // Snapshot for a follower that cannot resume from the retained records
+  std::string snapshot(uint64_t& sequence);
+
+  replication::ReplicationPublisher publisher_;
+};
+
+}  // namespace banking
+
+#endif  // BANKING_SYSTEM_PRIMARY_HPP_
@@ -0,0 +1,122 @@
+#ifndef BANKING_SYSTEM_REPLICA_HPP_
+#define BANKING_SYSTEM_REPLICA_HPP_
+
+#include "banking_system.hpp"
+#include "replication/replication_subscriber.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class BankingSystemImpl;
+
+namespace banking {
+
+/**
+ * Read-only follower of a BankingSystemPrimary.
+ *
+ * A receive thread replays the primary's operation log into a local
+ * BankingSystemImpl, starting from a snapshot when it has nothing or has
+ * fallen out of the primary's retained window. GetBalance and TopSpenders
+ * answer from that copy; every mutation fails, since only the primary may
+ * change state.
+ *
+ * Reads never move the replica's clock: they are answered as of the last
+ * replayed record, so payments fire here exactly when the primary's log says
+ * they did. Staleness is the time since the primary last reported that the
+ * replica had everything; once it exceeds `max_staleness`, reads fail
+ * rather than serve old data (see isFresh()).
+ */
+class BankingSystemReplica : public BankingSystem {
+ public:
+  struct Config {
+    replication::ReplicationSubscriber::Config primary;
+    std::chrono::milliseconds max_staleness{1000};
+  };
+
+  struct Stats {
+    bool connected = false;
+    uint64_t applied_sequence = 0;
+    uint64_t snapshots_loaded = 0;
+    std::chrono::milliseconds staleness{0};  // Since the replica was last caught up
+  };
+
+  explicit BankingSystemReplica(const Config& config);
+  ~BankingSystemReplica() override;
+
+  // Non-copyable
+  BankingSystemReplica(const BankingSystemReplica&) = delete;
+  BankingSystemReplica& operator=(const BankingSystemReplica&) = delete;
+
+  /**
+   * Start following the primary; reads fail until the first catch-up.
+   */
+  void start();
+
+  /**
+   * Stop following. The replica keeps answering from what it has, until stale.
+   */
+  void stop();
+
+  /**
+   * True if the replica caught up with the primary within `max_staleness`.
+   */
+  bool isFresh() const;
+
+  /** Mutations are rejected on a replica. */
+  bool CreateAccount(int timestamp, const std::string& account_id) override;
+  std::optional<int> Deposit(int timestamp, const std::string& account_id, int amount) override;
+  std::optional<int> Transfer(int timestamp, const std::string& source_account_id,
+                             const std::string& target_account_id, int amount) override;
+  std::optional<std::string> SchedulePayment(int timestamp, const std::string& account_id,
+                                           int amount, int delay) override;
+  bool CancelPayment(int timestamp, const std::string& account_id,
+                    const std::string& payment_id) override;
+  bool MergeAccounts(int timestamp, const std::string& account_id_1,
+                    const std::string& account_id_2) override;
+  std::vector<BatchResult> ApplyBatch(int timestamp,
+                                      const std::vector<BatchOperation>& operations) override;
+
+  void ReclaimMemory() override;
+
+  /**
+   * Returns formatted identifiers of top n accounts by total outgoing amount,
+   * as of the last replayed record; empty while stale.
+   */
+  std::vector<std::string> TopSpenders(int timestamp, int n) override;
+
+  /**
+   * Balance at `time_at` as of the last replayed record; nullopt while stale.
+   */
+  std::optional<int> GetBalance(int timestamp, const std::string& account_id,
+                               int time_at) override;
+
+  Stats getStats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // Subscriber callbacks, on its receive thread
+  bool loadSnapshot(uint64_t sequence, const std::string& body);
+  bool applyRecord(uint64_t sequence, std::string_view record);
+  void caughtUp();
+
+  Config config_;
+
+  mutable std::mutex mutex_;  // impl_; reads settle lazily, so they mutate it too
+  std::unique_ptr<BankingSystemImpl> impl_;
+
+  std::atomic<Clock::rep> caught_up_at_{0};  // Clock ticks; 0 = never
+  std::atomic<uint64_t> snapshots_loaded_{0};
+
+  replication::ReplicationSubscriber subscriber_;
+};
+
+}  // namespace banking
+
+#endif  // BANKING_SYSTEM_REPLICA_HPP_
@@ -0,0 +1,107 @@
+#ifndef BANKING_SYSTEM_SHARDED_HPP_
+#define BANKING_SYSTEM_SHARDED_HPP_
+
+#include "banking_system.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace banking {
+
+/**
+ * Concurrent banking engine that hash-partitions accounts across independent
+ * in-memory shards, each guarded by its own mutex.
+ *
+ * Single-account operations lock one shard, so operations on accounts in
+ * different shards run in parallel. Transfers and merges that span two shards
+ * lock both in shard-index order; TopSpenders and mixed-shard batches lock
+ * every shard they need the same way, so no two callers can deadlock.
+ * Payment ids come from one counter shared by all shards and stay unique.
+ *
+ * Shards hash accounts exactly as TransactionProcessor's ACCOUNT_AFFINITY
+ * lanes do, so with one shard per worker each worker only touches its own
+ * shard's accounts, except for a request spanning lanes, which runs while
+ * the other lanes' workers wait for it.
+ */
+class ShardedBankingSystem : public BankingSystem {
+ public:
+  struct Config {
+    size_t num_shards = 16;
+    // CPU whose NUMA node shard i's memory is first touched on (cycled); empty = the caller's
+    std::vector<int> shard_cpus;
+  };
+
+  ShardedBankingSystem();
+  explicit ShardedBankingSystem(const Config& config);
+  ~ShardedBankingSystem() override;
+
+  // Non-copyable
+  ShardedBankingSystem(const ShardedBankingSystem&) = delete;
+  ShardedBankingSystem& operator=(const ShardedBankingSystem&) = delete;
+
+  bool CreateAccount(int timestamp, const std::string& account_id) override;
+  std::optional<int> Deposit(int timestamp, const std::string& account_id, int amount) override;
+  std::optional<int> Transfer(int timestamp, const std::string& source_account_id,
+                             const std::string& target_account_id, int amount) override;
+
+  /**
+   * Merges each shard's top n; ties break on account id as in a single shard.
+   */
+  std::vector<std::string> TopSpenders(int timestamp, int n) override;
+
+  std::optional<std::string> SchedulePayment(int timestamp, const std::string& account_id,
+                                           int amount, int delay) override;
+  bool CancelPayment(int timestamp, const std::string& account_id,
+                    const std::string& payment_id) override;
+
+  /**
+   * Across shards, pending payments of `account_id_2` move to the shard of
+   * `account_id_1`; its own history stays where it was for GetBalance.
+   */
+  bool MergeAccounts(int timestamp, const std::string& account_id_1,
+                    const std::string& account_id_2) override;
+  std::optional<int> GetBalance(int timestamp, const std::string& account_id,
+                               int time_at) override;
+
+  /**
+   * A batch confined to one shard runs as that shard's own batch; otherwise
+   * every involved shard is locked once for the whole batch.
+   */
+  std::vector<BatchResult> ApplyBatch(int timestamp,
+                                      const std::vector<BatchOperation>& operations) override;
+
+  /**
+   * Releases each shard's spare capacity in turn, holding only that shard's
+   * lock, then publishes the engine_* gauges summed over shards.
+   */
+  void ReclaimMemory() override;
+
+  size_t getShardCount() const { return shards_.size(); }
+
+ private:
+  struct Shard;
+
+  size_t shardIndex(const std::string& account_id) const;
+  Shard& shardFor(const std::string& account_id);
+
+  /**
+   * Lock the shards at `indices` (sorted, unique) in order.
+   */
+  std::vector<std::unique_lock<std::mutex>> lockShards(const std::vector<size_t>& indices);
+
+  // Bodies for operations spanning two shards; both must already be locked
+  std::optional<int> transferLocked(int timestamp, const std::string& source_account_id,
+                                    const std::string& target_account_id, int amount);
+  bool mergeLocked(int timestamp, const std::string& account_id_1,
+                   const std::string& account_id_2);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<int> next_payment_ordinal_;
+};
+
+}  // namespace banking
+
+#endif  // BANKING_SYSTEM_SHARDED_HPP_
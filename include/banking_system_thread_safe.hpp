@@ -4,19 +4,35 @@
 #include "banking_system.hpp"
 
 #include <memory>
-#include <shared_mutex>
-#include <unordered_map>
 #include <mutex>
+#include <vector>
 
 namespace banking {
 
+class BankingSystemPersistent;
+
 /**
- * Thread-safe wrapper for BankingSystem with fine-grained locking.
- * Uses account-level locking to allow concurrent operations on different accounts.
+ * Thread-safe wrapper that serializes every call into an arbitrary BankingSystem.
+ * The wrapped implementation mutates shared state on every call (even queries
+ * process due payments), so one mutex guards it; use ShardedBankingSystem when
+ * operations on different accounts should run in parallel.
+ *
+ * Around a BankingSystemPersistent in GROUP_COMMIT mode, mutations wait for
+ * their records to commit only after the mutex is released, so writes of
+ * concurrent callers share a group commit instead of each holding every other
+ * caller off until its own lands. Other callers can therefore see, and build
+ * on, a mutation before it has committed. If the commit then fails the
+ * mutation still reports failure (every result, for a batch), but it stays
+ * applied in memory, as it always has when persisting failed.
  */
 class BankingSystemThreadSafe : public BankingSystem {
  public:
   explicit BankingSystemThreadSafe(std::unique_ptr<BankingSystem> impl);
+
+  /**
+   * Wraps a persistent engine, deferring its commits as described above.
+   */
+  explicit BankingSystemThreadSafe(std::unique_ptr<BankingSystemPersistent> impl);
   ~BankingSystemThreadSafe() override = default;
 
   // Non-copyable
@@ -56,22 +72,22 @@ class BankingSystemThreadSafe : public BankingSystem {
   std::optional<int> GetBalance(int timestamp, const std::string& account_id,
                                int time_at) override;
 
- private:
   /**
-   * Get or create a mutex for the given account.
+   * Applies a batch under a single acquisition of the lock.
    */
-  std::shared_mutex& getAccountMutex(const std::string& account_id);
+  std::vector<BatchResult> ApplyBatch(int timestamp,
+                                      const std::vector<BatchOperation>& operations) override;
 
-  /**
-   * Acquire locks for multiple accounts in consistent order to prevent deadlocks.
-   */
-  void acquireAccountLocks(const std::string& account1, const std::string& account2,
-                          std::unique_lock<std::shared_mutex>& lock1,
-                          std::unique_lock<std::shared_mutex>& lock2);
+  void ReclaimMemory() override;
+
+ private:
+  // Run `call` under the mutex, then wait for its writes with the mutex released
+  template <typename Result, typename Call>
+  Result commitAfterUnlock(Call call, Result failed);
 
   std::unique_ptr<BankingSystem> impl_;
-  std::unordered_map<std::string, std::unique_ptr<std::shared_mutex>> account_mutexes_;
-  mutable std::shared_mutex global_mutex_;  // For global operations like TopSpenders
+  BankingSystemPersistent* persistent_ = nullptr;  // impl_, when its commits are deferred
+  std::mutex mutex_;
 };
 
 }  // namespace banking
@@ -0,0 +1,225 @@
+#ifndef BOUNDED_QUEUE_HPP_
+#define BOUNDED_QUEUE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace banking {
+namespace concurrent {
+
+/**
+ * Bounded Multiple Producer Multiple Consumer (MPMC) ring-buffer queue.
+ *
+ * Based on Dmitry Vyukov's bounded MPMC queue: every cell carries a sequence
+ * number that says whether it is free for the producer at a given position
+ * or ready for the consumer, so producers and consumers only contend on their
+ * own position counter. Storage is allocated once; enqueue and dequeue never
+ * touch the heap. When the ring is full, tryEnqueue fails instead of growing,
+ * which is the caller's backpressure signal.
+ */
+template<typename T>
+class BoundedQueue {
+ public:
+  /**
+   * Capacity is rounded up to a power of two (at least 2).
+   */
+  explicit BoundedQueue(size_t capacity);
+  ~BoundedQueue();
+
+  // Non-copyable
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  /**
+   * Enqueue an item. Returns false, leaving `item` untouched, if the queue is full.
+   */
+  bool tryEnqueue(T&& item);
+  bool tryEnqueue(const T& item);
+
+  /**
+   * Dequeue an item. Returns empty optional if the queue is empty.
+   */
+  std::optional<T> tryDequeue();
+
+  /**
+   * Move items from [first, last) into the queue with one position claim.
+   * Returns how many were enqueued; the rest did not fit and are untouched.
+   */
+  template<typename Iterator>
+  size_t enqueueBulk(Iterator first, Iterator last);
+
+  /**
+   * Dequeue up to `max_items` items into `out` with one position claim.
+   * Returns how many were written.
+   */
+  template<typename OutputIterator>
+  size_t dequeueBulk(OutputIterator out, size_t max_items);
+
+  /**
+   * Approximate while producers or consumers are active.
+   */
+  size_t size() const;
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() >= capacity_; }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T* item() { return std::launder(reinterpret_cast<T*>(storage)); }
+  };
+
+  static size_t roundUpToPowerOfTwo(size_t n);
+
+  // Claim up to `max_items` positions whose cells are in the expected state
+  size_t claim(std::atomic<size_t>& position, size_t offset, size_t max_items, size_t& start);
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+  // Each counter on its own cache line so producers and consumers don't false-share
+  alignas(kCacheLineSize) std::atomic<size_t> enqueue_pos_;
+  alignas(kCacheLineSize) std::atomic<size_t> dequeue_pos_;
+};
+
+template<typename T>
+size_t BoundedQueue<T>::roundUpToPowerOfTwo(size_t n) {
+  size_t power = 2;
+  while (power < n) power <<= 1;
+  return power;
+}
+
+template<typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity)
+    : capacity_(roundUpToPowerOfTwo(capacity)),
+      mask_(capacity_ - 1),
+      cells_(new Cell[capacity_]),
+      enqueue_pos_(0),
+      dequeue_pos_(0) {
+  for (size_t i = 0; i < capacity_; ++i) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+template<typename T>
+BoundedQueue<T>::~BoundedQueue() {
+  while (tryDequeue()) {
+  }
+}
+
+template<typename T>
+size_t BoundedQueue<T>::claim(std::atomic<size_t>& position, size_t offset,
+                              size_t max_items, size_t& start) {
+  size_t pos = position.load(std::memory_order_relaxed);
+  while (true) {
+    // A cell is free for producer position p when sequence == p, and ready
+    // for consumer position p when sequence == p + 1
+    size_t available = 0;
+    while (available < max_items) {
+      size_t p = pos + available;
+      size_t seq = cells_[p & mask_].sequence.load(std::memory_order_acquire);
+      if (seq != p + offset) break;
+      ++available;
+    }
+
+    if (available == 0) {
+      size_t seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+      // Behind: another thread claimed `pos` already, so reload and retry
+      if (static_cast<std::ptrdiff_t>(seq - (pos + offset)) > 0) {
+        pos = position.load(std::memory_order_relaxed);
+        continue;
+      }
+      return 0;  // Full (producers) or empty (consumers)
+    }
+
+    if (position.compare_exchange_weak(pos, pos + available, std::memory_order_relaxed)) {
+      start = pos;
+      return available;
+    }
+    // `pos` was reloaded by the failed CAS
+  }
+}
+
+template<typename T>
+bool BoundedQueue<T>::tryEnqueue(T&& item) {
+  size_t pos;
+  if (claim(enqueue_pos_, 0, 1, pos) == 0) return false;
+
+  Cell& cell = cells_[pos & mask_];
+  new (cell.storage) T(std::move(item));
+  cell.sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+bool BoundedQueue<T>::tryEnqueue(const T& item) {
+  T copy(item);
+  return tryEnqueue(std::move(copy));
+}
+
+template<typename T>
+std::optional<T> BoundedQueue<T>::tryDequeue() {
+  size_t pos;
+  if (claim(dequeue_pos_, 1, 1, pos) == 0) return std::nullopt;
+
+  Cell& cell = cells_[pos & mask_];
+  std::optional<T> result(std::move(*cell.item()));
+  cell.item()->~T();
+  cell.sequence.store(pos + capacity_, std::memory_order_release);
+  return result;
+}
+
+template<typename T>
+template<typename Iterator>
+size_t BoundedQueue<T>::enqueueBulk(Iterator first, Iterator last) {
+  size_t wanted = static_cast<size_t>(std::distance(first, last));
+  if (wanted == 0) return 0;
+
+  size_t pos;
+  size_t count = claim(enqueue_pos_, 0, std::min(wanted, capacity_), pos);
+  for (size_t i = 0; i < count; ++i, ++first) {
+    Cell& cell = cells_[(pos + i) & mask_];
+    new (cell.storage) T(std::move(*first));
+    cell.sequence.store(pos + i + 1, std::memory_order_release);
+  }
+  return count;
+}
+
+template<typename T>
+template<typename OutputIterator>
+size_t BoundedQueue<T>::dequeueBulk(OutputIterator out, size_t max_items) {
+  if (max_items == 0) return 0;
+
+  size_t pos;
+  size_t count = claim(dequeue_pos_, 1, std::min(max_items, capacity_), pos);
+  for (size_t i = 0; i < count; ++i) {
+    Cell& cell = cells_[(pos + i) & mask_];
+    *out++ = std::move(*cell.item());
+    cell.item()->~T();
+    cell.sequence.store(pos + i + capacity_, std::memory_order_release);
+  }
+  return count;
+}
+
+template<typename T>
+size_t BoundedQueue<T>::size() const {
+  size_t enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+  size_t dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+  return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+}  // namespace concurrent
+}  // namespace banking
+
+#endif  // BOUNDED_QUEUE_HPP_
@@ -2,6 +2,7 @@
 #define LOCKFREE_QUEUE_HPP_
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <vector>
@@ -13,14 +14,19 @@ namespace concurrent {
  * Lock-free Multiple Producer Single Consumer (MPSC) queue.
  * Uses atomic operations for thread-safe enqueue/dequeue without locks.
  * Optimized for high-throughput transaction processing.
+ *
+ * Consumers are serialized by a try-lock flag, so sharing one queue between
+ * several consumers is safe (if contended); a consumer that loses the race
+ * sees an empty result, exactly as with a momentarily empty queue.
  */
 template<typename T>
 class LockFreeQueue {
  private:
   struct Node {
-    T data;
+    std::optional<T> data;  // Empty for the dummy node, so T needs no default ctor
     std::atomic<Node*> next;
 
+    Node() : next(nullptr) {}
     Node(T value) : data(std::move(value)), next(nullptr) {}
   };
 
@@ -38,13 +44,13 @@ class LockFreeQueue {
   void enqueue(T item);
 
   /**
-   * Dequeue an item (single consumer only).
-   * Returns empty optional if queue is empty.
+   * Dequeue an item.
+   * Returns empty optional if queue is empty or another consumer is mid-dequeue.
    */
   std::optional<T> dequeue();
 
   /**
-   * Check if queue is empty (not thread-safe).
+   * Check if queue is empty (approximate while producers are active).
    */
   bool empty() const;
 
@@ -62,6 +68,7 @@ class LockFreeQueue {
   std::atomic<Node*> head_;
   std::atomic<Node*> tail_;
   std::atomic<size_t> size_;
+  std::atomic_flag consumer_lock_ = ATOMIC_FLAG_INIT;
 };
 
 /**
@@ -76,6 +83,76 @@ struct TransactionBatch {
   TransactionBatch(size_t id) : batch_id(id), enqueue_time(std::chrono::steady_clock::now()) {}
 };
 
+template<typename T>
+LockFreeQueue<T>::LockFreeQueue() : size_(0) {
+  // Create dummy node
+  Node* dummy = new Node();
+  head_.store(dummy);
+  tail_.store(dummy);
+}
+
+template<typename T>
+LockFreeQueue<T>::~LockFreeQueue() {
+  clear();
+  Node* dummy = head_.load();
+  if (dummy) {
+    delete dummy;
+  }
+}
+
+template<typename T>
+void LockFreeQueue<T>::enqueue(T item) {
+  Node* new_node = new Node(std::move(item));
+  // Count first so size_ never dips below the number of linked nodes
+  size_.fetch_add(1);
+  Node* old_tail = tail_.exchange(new_node);
+
+  // Link the old tail to the new node
+  old_tail->next.store(new_node, std::memory_order_release);
+}
+
+template<typename T>
+std::optional<T> LockFreeQueue<T>::dequeue() {
+  // Only the consumer holding the flag may free the old head
+  if (consumer_lock_.test_and_set(std::memory_order_acquire)) {
+    return std::nullopt;
+  }
+
+  Node* head = head_.load(std::memory_order_relaxed);
+  Node* next = head->next.load(std::memory_order_acquire);
+  if (next == nullptr) {
+    consumer_lock_.clear(std::memory_order_release);
+    return std::nullopt;  // Queue is empty
+  }
+
+  std::optional<T> result = std::move(next->data);
+  next->data.reset();  // `next` is the new dummy
+  head_.store(next, std::memory_order_relaxed);
+  size_.fetch_sub(1);
+  consumer_lock_.clear(std::memory_order_release);
+
+  delete head;
+  return result;
+}
+
+template<typename T>
+bool LockFreeQueue<T>::empty() const {
+  // The head node may be freed by a concurrent consumer, so don't touch it
+  return size_.load() == 0;
+}
+
+template<typename T>
+size_t LockFreeQueue<T>::size() const {
+  return size_.load();
+}
+
+template<typename T>
+void LockFreeQueue<T>::clear() {
+  while (!empty()) {
+    dequeue();
+  }
+}
+
 }  // namespace concurrent
 }  // namespace banking
 
@@ -0,0 +1,353 @@
+#ifndef OPERATION_TABLE_HPP_
+#define OPERATION_TABLE_HPP_
+
+#include "banking_system.hpp"
+#include "protocol.hpp"
+
+#include <array>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace banking {
+namespace concurrent {
+
+/**
+ * How one engine operation runs, specialized per MessageType.
+ *
+ * Args borrows the operation's arguments from the decoded request, call()
+ * goes straight to BankingSystem and encode() builds the typed response from
+ * its Result. Financial operations name the account, and the transaction
+ * type, that fraud analysis screens. Batchable operations also map Args onto
+ * a BatchOperation and a BatchResult back onto Result. Types left
+ * unspecialized (AUTHENTICATE, HEARTBEAT, ERROR, BATCH) are not engine
+ * operations.
+ */
+template <network::protocol::MessageType Type>
+struct Operation {
+  static constexpr bool kEngine = false;
+};
+
+template <>
+struct Operation<network::protocol::MessageType::CREATE_ACCOUNT> {
+  static constexpr bool kEngine = true;
+  static constexpr bool kMutates = true;
+  static constexpr bool kBatchable = true;
+  static constexpr std::string network::protocol::Request::*kScreenedAccount = nullptr;
+  static constexpr const char* kScreenedAs = nullptr;
+
+  struct Args {
+    const std::string& account_id;
+  };
+  using Result = bool;
+
+  static Args decode(const network::protocol::Request& request) { return {request.account_id}; }
+  static Result call(BankingSystem& system, int timestamp, const Args& args) {
+    return system.CreateAccount(timestamp, args.account_id);
+  }
+  static network::protocol::Response encode(Result created, const Args& args, int timestamp) {
+    if (created) return network::protocol::Response::accountCreated(args.account_id, timestamp);
+    return network::protocol::Response::error(
+        network::protocol::Status::ERROR, "Account creation failed", timestamp);
+  }
+  static void toBatch(const Args& args, BatchOperation& op) {
+    op.type = BatchOperation::Type::CREATE_ACCOUNT;
+    op.account_id = args.account_id;
+  }
+  static Result fromBatch(const BatchResult& result) { return result.success; }
+};
+
+template <>
+struct Operation<network::protocol::MessageType::DEPOSIT> {
+  static constexpr bool kEngine = true;
+  static constexpr bool kMutates = true;
+  static constexpr bool kBatchable = true;
+  static constexpr std::string network::protocol::Request::*kScreenedAccount =
+      &network::protocol::Request::account_id;
+  static constexpr const char* kScreenedAs = "DEPOSIT";
+
+  struct Args {
+    const std::string& account_id;
+    int amount;
+  };
+  using Result = std::optional<int>;
+
+  static Args decode(const network::protocol::Request& request) {
+    return {request.account_id, request.amount};
+  }
+  static Result call(BankingSystem& system, int timestamp, const Args& args) {
+    return system.Deposit(timestamp, args.account_id, args.amount);
+  }
+  static network::protocol::Response encode(const Result& balance, const Args&, int timestamp) {
+    if (balance) return network::protocol::Response::depositResult(*balance, timestamp);
+    return network::protocol::Response::error(
+        network::protocol::Status::ACCOUNT_NOT_FOUND, "Account not found", timestamp);
+  }
+  static void toBatch(const Args& args, BatchOperation& op) {
+    op.type = BatchOperation::Type::DEPOSIT;
+    op.account_id = args.account_id;
+    op.amount = args.amount;
+  }
+  static Result fromBatch(const BatchResult& result) { return result.balance; }
+};
+
+template <>
+struct Operation<network::protocol::MessageType::TRANSFER> {
+  static constexpr bool kEngine = true;
+  static constexpr bool kMutates = true;
+  static constexpr bool kBatchable = true;
+  static constexpr std::string network::protocol::Request::*kScreenedAccount =
+      &network::protocol::Request::source_account;
+  static constexpr const char* kScreenedAs = "TRANSFER";
+
+  struct Args {
+    const std::string& source_account;
+    const std::string& target_account;
+    int amount;
+  };
+  using Result = std::optional<int>;
+
+  static Args decode(const network::protocol::Request& request) {
+    return {request.source_account, request.target_account, request.amount};
+  }
+  static Result call(BankingSystem& system, int timestamp, const Args& args) {
+    return system.Transfer(timestamp, args.source_account, args.target_account, args.amount);
+  }
+  static network::protocol::Response encode(const Result& source_balance, const Args&, int timestamp) {
+    if (source_balance) return network::protocol::Response::transferResult(*source_balance, timestamp);
+    return network::protocol::Response::error(
+        network::protocol::Status::INSUFFICIENT_FUNDS, "Transfer failed", timestamp);
+  }
+  static void toBatch(const Args& args, BatchOperation& op) {
+    op.type = BatchOperation::Type::TRANSFER;
+    op.account_id = args.source_account;
+    op.target_account_id = args.target_account;
+    op.amount = args.amount;
+  }
+  static Result fromBatch(const BatchResult& result) { return result.balance; }
+};
+
+template <>
+struct Operation<network::protocol::MessageType::GET_BALANCE> {
+  static constexpr bool kEngine = true;
+  static constexpr bool kMutates = false;
+  static constexpr bool kBatchable = false;
+  static constexpr std::string network::protocol::Request::*kScreenedAccount = nullptr;
+  static constexpr const char* kScreenedAs = nullptr;
+
+  struct Args {
+    const std::string& account_id;
+    int time_at;
+  };
+  using Result = std::optional<int>;
+
+  static Args decode(const network::protocol::Request& request) {
+    return {request.account_id, request.time_at};
+  }
+  static Result call(BankingSystem& system, int timestamp, const Args& args) {
+    return system.GetBalance(timestamp, args.account_id, args.time_at);
+  }
+  static network::protocol::Response encode(const Result& balance, const Args&, int timestamp) {
+    if (balance) return network::protocol::Response::balanceResult(*balance, timestamp);
+    return network::protocol::Response::error(
+        network::protocol::Status::ACCOUNT_NOT_FOUND, "Account not found", timestamp);
+  }
+};
+
+template <>
+struct Operation<network::protocol::MessageType::TOP_SPENDERS> {
+  static constexpr bool kEngine = true;
+  static constexpr bool kMutates = false;
+  static constexpr bool kBatchable = false;
+  static constexpr std::string network::protocol::Request::*kScreenedAccount = nullptr;
+  static constexpr const char* kScreenedAs = nullptr;
+
+  struct Args {
+    int n;
+  };
+  using Result = std::vector<std::string>;
+
+  static Args decode(const network::protocol::Request& request) { return {request.n}; }
+  static Result call(BankingSystem& system, int timestamp, const Args& args) {
+    return system.TopSpenders(timestamp, args.n);
+  }
+  static network::protocol::Response encode(const Result& spenders, const Args&, int timestamp) {
+    return network::protocol::Response::topSpendersResult(spenders, timestamp);
+  }
+};
+
+template <>
+struct Operation<network::protocol::MessageType::SCHEDULE_PAYMENT> {
+  static constexpr bool kEngine = true;
+  static constexpr bool kMutates = true;
+  static constexpr bool kBatchable = true;
+  static constexpr std::string network::protocol::Request::*kScreenedAccount =
+      &network::protocol::Request::account_id;
+  static constexpr const char* kScreenedAs = "PAYMENT";
+
+  struct Args {
+    const std::string& account_id;
+    int amount;
+    int delay;
+  };
+  using Result = std::optional<std::string>;
+
+  static Args decode(const network::protocol::Request& request) {
+    return {request.account_id, request.amount, request.delay};
+  }
+  static Result call(BankingSystem& system, int timestamp, const Args& args) {
+    return system.SchedulePayment(timestamp, args.account_id, args.amount, args.delay);
+  }
+  static network::protocol::Response encode(const Result& payment_id, const Args&, int timestamp) {
+    if (payment_id) return network::protocol::Response::paymentScheduled(*payment_id, timestamp);
+    return network::protocol::Response::error(
+        network::protocol::Status::ACCOUNT_NOT_FOUND, "Payment scheduling failed", timestamp);
+  }
+  static void toBatch(const Args& args, BatchOperation& op) {
+    op.type = BatchOperation::Type::SCHEDULE_PAYMENT;
+    op.account_id = args.account_id;
+    op.amount = args.amount;
+    op.delay = args.delay;
+  }
+  static Result fromBatch(const BatchResult& result) { return result.payment_id; }
+};
+
+template <>
+struct Operation<network::protocol::MessageType::CANCEL_PAYMENT> {
+  static constexpr bool kEngine = true;
+  static constexpr bool kMutates = true;
+  static constexpr bool kBatchable = true;
+  static constexpr std::string network::protocol::Request::*kScreenedAccount = nullptr;
+  static constexpr const char* kScreenedAs = nullptr;
+
+  struct Args {
+    const std::string& account_id;
+    const std::string& payment_id;
+  };
+  using Result = bool;
+
+  static Args decode(const network::protocol::Request& request) {
+    return {request.account_id, request.payment_id};
+  }
+  static Result call(BankingSystem& system, int timestamp, const Args& args) {
+    return system.CancelPayment(timestamp, args.account_id, args.payment_id);
+  }
+  static network::protocol::Response encode(Result cancelled, const Args&, int timestamp) {
+    if (cancelled) return network::protocol::Response::paymentCancelled(timestamp);
+    return network::protocol::Response::error(
+        network::protocol::Status::ERROR, "Payment cancellation failed", timestamp);
+  }
+  static void toBatch(const Args& args, BatchOperation& op) {
+    op.type = BatchOperation::Type::CANCEL_PAYMENT;
+    op.account_id = args.account_id;
+    op.payment_id = args.payment_id;
+  }
+  static Result fromBatch(const BatchResult& result) { return result.success; }
+};
+
+template <>
+struct Operation<network::protocol::MessageType::MERGE_ACCOUNTS> {
+  static constexpr bool kEngine = true;
+  static constexpr bool kMutates = true;
+  static constexpr bool kBatchable = false;
+  static constexpr std::string network::protocol::Request::*kScreenedAccount = nullptr;
+  static constexpr const char* kScreenedAs = nullptr;
+
+  struct Args {
+    const std::string& account_id_1;
+    const std::string& account_id_2;
+  };
+  using Result = bool;
+
+  static Args decode(const network::protocol::Request& request) {
+    return {request.account_id_1, request.account_id_2};
+  }
+  static Result call(BankingSystem& system, int timestamp, const Args& args) {
+    return system.MergeAccounts(timestamp, args.account_id_1, args.account_id_2);
+  }
+  static network::protocol::Response encode(Result merged, const Args&, int timestamp) {
+    if (merged) return network::protocol::Response::accountsMerged(timestamp);
+    return network::protocol::Response::error(
+        network::protocol::Status::ERROR, "Account merge failed", timestamp);
+  }
+};
+
+/**
+ * One row of the dispatch table. Null entry points mean the type cannot be
+ * executed (or batched) by the engine.
+ */
+struct OperationDescriptor {
+  bool read_only = false;  // Answered by read-only replicas
+  // The account fraud analysis screens, if any, and the transaction type it is screened as
+  std::string network::protocol::Request::*screened_account = nullptr;
+  const char* screened_as = nullptr;
+
+  network::protocol::Response (*execute)(BankingSystem&, const network::protocol::Request&) = nullptr;
+
+  // Batchable operations: the request as a batch entry, and the entry's result as a response
+  void (*to_batch)(const network::protocol::Request&, BatchOperation&) = nullptr;
+  network::protocol::Response (*from_batch)(const BatchResult&, const network::protocol::Request&,
+                                            int timestamp) = nullptr;
+};
+
+namespace detail {
+
+template <network::protocol::MessageType Type>
+network::protocol::Response execute(BankingSystem& system, const network::protocol::Request& request) {
+  using Op = Operation<Type>;
+  const typename Op::Args args = Op::decode(request);
+  return Op::encode(Op::call(system, request.timestamp, args), args, request.timestamp);
+}
+
+template <network::protocol::MessageType Type>
+void toBatch(const network::protocol::Request& request, BatchOperation& op) {
+  Operation<Type>::toBatch(Operation<Type>::decode(request), op);
+}
+
+template <network::protocol::MessageType Type>
+network::protocol::Response fromBatch(const BatchResult& result, const network::protocol::Request& request,
+                                      int timestamp) {
+  using Op = Operation<Type>;
+  return Op::encode(Op::fromBatch(result), Op::decode(request), timestamp);
+}
+
+template <network::protocol::MessageType Type>
+constexpr OperationDescriptor describe() {
+  using Op = Operation<Type>;
+  OperationDescriptor descriptor{};
+  if constexpr (Op::kEngine) {
+    descriptor.read_only = !Op::kMutates;
+    descriptor.screened_account = Op::kScreenedAccount;
+    descriptor.screened_as = Op::kScreenedAs;
+    descriptor.execute = &execute<Type>;
+    if constexpr (Op::kBatchable) {
+      descriptor.to_batch = &toBatch<Type>;
+      descriptor.from_batch = &fromBatch<Type>;
+    }
+  }
+  return descriptor;
+}
+
+template <size_t... Index>
+constexpr std::array<OperationDescriptor, network::protocol::kMessageTypeCount> makeTable(
+    std::index_sequence<Index...>) {
+  return {{describe<static_cast<network::protocol::MessageType>(Index)>()...}};
+}
+
+}  // namespace detail
+
+// Indexed by MessageType; built at compile time from the Operation specializations
+inline constexpr std::array<OperationDescriptor, network::protocol::kMessageTypeCount> kOperationTable =
+    detail::makeTable(std::make_index_sequence<network::protocol::kMessageTypeCount>{});
+
+inline const OperationDescriptor& operationFor(network::protocol::MessageType type) {
+  static constexpr OperationDescriptor kUnknown{};
+  const size_t index = static_cast<size_t>(type);
+  return index < kOperationTable.size() ? kOperationTable[index] : kUnknown;
+}
+
+}  // namespace concurrent
+}  // namespace banking
+
+#endif  // OPERATION_TABLE_HPP_
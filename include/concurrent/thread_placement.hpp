@@ -0,0 +1,83 @@
+#ifndef THREAD_PLACEMENT_HPP_
+#define THREAD_PLACEMENT_HPP_
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace banking {
+namespace concurrent {
+
+/**
+ * The CPUs this process may run on, grouped by NUMA node.
+ * Read from /sys/devices/system/node; a machine (or container) without NUMA
+ * information is reported as one node holding every allowed CPU.
+ */
+struct CpuTopology {
+  struct Node {
+    int id = 0;
+    std::vector<int> cpus;  // Ascending, limited to the process's affinity mask
+  };
+  std::vector<Node> nodes;
+
+  static CpuTopology detect();
+
+  size_t cpuCount() const;
+
+  // NUMA node of `cpu`, or -1 if it is not in this topology
+  int nodeOf(int cpu) const;
+
+  // "node0: 0-15; node1: 16-31"
+  std::string describe() const;
+};
+
+/**
+ * Which CPU each long-lived server thread is pinned to. An empty list leaves
+ * that kind of thread unpinned, with its count decided as before.
+ */
+struct ThreadPlacement {
+  std::vector<int> reactor_cpus;  // One event-loop reactor per entry
+  std::vector<int> worker_cpus;   // One processor worker, and its engine shard, per entry
+  std::vector<int> fraud_cpus;    // One fraud analysis worker per entry
+
+  bool empty() const { return reactor_cpus.empty() && worker_cpus.empty() && fraud_cpus.empty(); }
+
+  /**
+   * One thread per core: `reactors` and `fraud_workers` CPUs are set aside and
+   * every other CPU runs a processor worker. Each kind is dealt round-robin
+   * across nodes so every node carries its share of each.
+   */
+  static ThreadPlacement shardPerCore(const CpuTopology& topology, size_t reactors, size_t fraud_workers);
+};
+
+/**
+ * Restrict `thread` to `cpu`. A negative cpu leaves it alone. False (and the
+ * thread unpinned) if the CPU is outside the process's affinity mask.
+ */
+inline bool pinThread(pthread_t thread, int cpu) {
+  if (cpu < 0) return true;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+inline bool pinThread(std::thread& thread, int cpu) {
+  return pinThread(thread.native_handle(), cpu);
+}
+
+/**
+ * The entry of `cpus` for the `index`-th thread of a kind, or -1 if unpinned.
+ */
+inline int cpuFor(const std::vector<int>& cpus, size_t index) {
+  return cpus.empty() ? -1 : cpus[index % cpus.size()];
+}
+
+}  // namespace concurrent
+}  // namespace banking
+
+#endif  // THREAD_PLACEMENT_HPP_
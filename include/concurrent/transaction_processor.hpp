@@ -2,11 +2,21 @@
 #define TRANSACTION_PROCESSOR_HPP_
 
 #include "lockfree_queue.hpp"
+#include "bounded_queue.hpp"
 #include "banking_system.hpp"
+#include "protocol.hpp"
+#include "observability/latency_histogram.hpp"
+
+#include <array>
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <thread>
 #include <vector>
 
@@ -20,10 +30,30 @@ namespace concurrent {
 class TransactionProcessor {
  public:
   using TransactionCallback = std::function<void(const std::string&)>;
+  // Receives the result of one submitted request
+  using ResponseCallback = std::function<void(network::protocol::Response)>;
+
+  /**
+   * How submitted requests are assigned to workers.
+   */
+  enum class DispatchMode {
+    SHARED_QUEUE,     // Every worker takes from one queue; no ordering between workers
+    ACCOUNT_AFFINITY  // Each worker owns a queue; requests route by the hash of every account they touch
+  };
+
+  struct Config {
+    size_t num_workers = 4;
+    size_t batch_size = 100;
+    DispatchMode dispatch_mode = DispatchMode::SHARED_QUEUE;
+    size_t spin_iterations = 2000;  // Empty polls before an idle worker blocks
+    size_t queue_capacity = 0;      // Per-queue bound; 0 keeps the unbounded linked queue
+    std::vector<int> worker_cpus;   // CPU for worker i (cycled); empty leaves workers unpinned
+  };
 
   TransactionProcessor(BankingSystem* banking_system,
                       size_t num_worker_threads = 4,
                       size_t batch_size = 100);
+  TransactionProcessor(BankingSystem* banking_system, const Config& config);
   ~TransactionProcessor();
 
   // Non-copyable
@@ -41,7 +71,34 @@ class TransactionProcessor {
   void stop();
 
   /**
-   * Submit a transaction for processing.
+   * Submit a decoded request for processing.
+   * The future resolves with the operation's result once a worker applies it.
+   * In ACCOUNT_AFFINITY mode, requests touching the same account run in
+   * submission order. A request touching accounts on several lanes (a transfer,
+   * a merge, a batch) is queued on each of them and runs once every one of
+   * those lanes has reached it, so it is ordered against all its accounts.
+   * With a bounded queue that is full, the future resolves immediately with
+   * an error and the rejection is counted in Stats.
+   */
+  std::future<network::protocol::Response> submitRequest(network::protocol::Request request);
+
+  /**
+   * Like submitRequest(), but hands the result to `done` instead of a future:
+   * on the worker that applied the request, or on the caller's thread before
+   * returning if the request is turned away. Lets callers that must not block,
+   * such as an event-loop reactor, carry on while the request runs.
+   */
+  void submitRequest(network::protocol::Request request, ResponseCallback done);
+
+  /**
+   * True if `response` is the processor turning a request away (queue full,
+   * or stopped) rather than the result of applying it.
+   */
+  static bool isRejection(const network::protocol::Response& response);
+
+  /**
+   * Submit a JSON-encoded transaction for processing.
+   * The result is only reported through the transaction callback.
    */
   void submitTransaction(const std::string& transaction_json);
 
@@ -55,34 +112,118 @@ class TransactionProcessor {
    */
   size_t getQueueSize() const;
 
+  /**
+   * Latency of one message type, split at the worker's dequeue.
+   */
+  struct OperationLatency {
+    network::protocol::MessageType type;
+    observability::LatencySummary queue;    // Submitted until a worker dequeued it
+    observability::LatencySummary execute;  // Applied to the BankingSystem and answered
+  };
+
   /**
    * Get processing statistics.
+   * Latencies and throughput come from the process-wide metrics, so they
+   * cover every processor in the process.
    */
   struct Stats {
     size_t transactions_processed;
     size_t transactions_queued;
+    size_t transactions_rejected;  // Turned away by a full bounded queue
     double avg_processing_time_ms;
-    double throughput_tps;
+    double throughput_tps;  // Completed per second over the last 10 seconds
+    std::vector<OperationLatency> latency;  // Message types processed so far
   };
   Stats getStats() const;
 
  private:
-  void workerThread();
-  void processTransaction(const std::string& transaction_json);
+  struct Rendezvous;
+
+  struct Task {
+    network::protocol::Request request;
+    ResponseCallback done;
+    std::chrono::steady_clock::time_point enqueued;
+    bool primary = true;  // False for the placeholders on a multi-lane request's other lanes
+    std::shared_ptr<Rendezvous> rendezvous;  // Set for requests spanning several lanes
+  };
+
+  /**
+   * Where the lanes of a multi-lane request meet. Each lane's worker arrives
+   * when it dequeues its part; all but the last wait, the last runs the request.
+   */
+  struct Rendezvous {
+    explicit Rendezvous(size_t lanes) : remaining(lanes) {}
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t remaining;          // Lanes yet to reach the request
+    std::optional<Task> task;  // The primary part, parked until the last lane arrives
+    bool done = false;         // Run, or abandoned because not every part was queued
+  };
+
+  /**
+   * A queue plus the means for idle workers to block on it.
+   * Uses the bounded ring when one was configured, the linked queue otherwise.
+   */
+  struct Lane {
+    explicit Lane(size_t capacity)
+        : bounded(capacity > 0 ? std::make_unique<BoundedQueue<Task>>(capacity) : nullptr) {}
+
+    bool push(Task&& task);
+    std::optional<Task> pop() { return bounded ? bounded->tryDequeue() : queue.dequeue(); }
+    bool empty() const { return bounded ? bounded->empty() : queue.empty(); }
+    size_t size() const { return bounded ? bounded->size() : queue.size(); }
+
+    LockFreeQueue<Task> queue;
+    std::unique_ptr<BoundedQueue<Task>> bounded;
+    std::mutex wait_mutex;
+    std::condition_variable not_empty;
+    std::atomic<size_t> sleepers{0};
+  };
+
+  void workerThread(Lane& lane);
+  bool waitForWork(Lane& lane);
+  // The lanes of every account `request` touches, deduplicated, the first account's first
+  std::vector<Lane*> lanesFor(const network::protocol::Request& request);
+  void wake(Lane& lane);
+  // Arrive at the task's rendezvous; true if this worker is the last and should run it
+  bool meet(Task& task);
+  void finish(Rendezvous& rendezvous);
+  void runTask(Task& task);
+  // Apply a request, turning a failure into an error response
+  network::protocol::Response execute(const network::protocol::Request& request);
+  void recordCompletion(size_t type, std::chrono::steady_clock::time_point enqueued,
+                        std::chrono::steady_clock::time_point start_time,
+                        std::chrono::steady_clock::time_point end_time);
+  network::protocol::Response processTransaction(const network::protocol::Request& request);
+  network::protocol::Response processBatch(const network::protocol::Request& request);
 
   BankingSystem* banking_system_;
   size_t num_workers_;
   size_t batch_size_;
-
-  LockFreeQueue<std::string> transaction_queue_;
+  DispatchMode dispatch_mode_;
+  size_t spin_iterations_;
+  std::vector<int> worker_cpus_;
+
+  std::vector<std::unique_ptr<Lane>> lanes_;
+  // Multi-lane requests are queued on all their lanes under this lock, so any two
+  // of them appear in the same order on every lane they share and cannot deadlock
+  std::mutex submit_mutex_;
   std::vector<std::unique_ptr<std::thread>> worker_threads_;
   std::atomic<bool> running_;
+  std::atomic<size_t> next_batch_id_;
 
   TransactionCallback callback_;
 
   // Statistics
   std::atomic<size_t> transactions_processed_;
+  std::atomic<size_t> transactions_rejected_;
   std::atomic<size_t> total_processing_time_us_;
+
+  // Metric handles, by MessageType
+  std::array<observability::LatencyRecorder*, network::protocol::kMessageTypeCount> queue_latency_{};
+  std::array<observability::LatencyRecorder*, network::protocol::kMessageTypeCount> execute_latency_{};
+  observability::RateMeter* throughput_ = nullptr;
   mutable std::mutex stats_mutex_;
 };
 
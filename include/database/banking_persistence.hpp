@@ -1,12 +1,19 @@
 #ifndef BANKING_PERSISTENCE_HPP_
 #define BANKING_PERSISTENCE_HPP_
 
-#include "postgres_connection.hpp"
+#include "connection_pool.hpp"
 #include "../network/protocol.hpp"
 
+#include <chrono>
+#include <climits>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <set>
+#include <string>
 #include <vector>
-#include <memory>
 
 namespace banking {
 namespace database {
@@ -69,13 +76,76 @@ struct BalanceEvent {
       : timestamp(ts), balance_delta(delta), event_type(type) {}
 };
 
+/**
+ * Records produced by one or more banking operations, written in one database
+ * transaction by BankingPersistence::saveBatch.
+ */
+struct WriteBatch {
+  struct AccountMerge {
+    std::string child_account_id;
+    std::string parent_account_id;
+    int merge_timestamp;
+    int balance_transferred;
+  };
+
+  struct SystemEvent {
+    std::string event_type;
+    std::string severity;
+    std::string message;
+    std::string component;
+  };
+
+  struct CreatedAccount {
+    std::string account_id;
+    int timestamp;
+  };
+
+  std::vector<CreatedAccount> created_accounts;
+  std::vector<TransactionRecord> transactions;
+  std::vector<std::pair<std::string, BalanceEvent>> balance_events;
+  std::vector<ScheduledPaymentRecord> scheduled_payments;
+  std::vector<std::string> canceled_payments;
+  std::vector<AccountMerge> merges;
+  std::vector<SystemEvent> system_events;
+
+  size_t size() const {
+    return created_accounts.size() + transactions.size() + balance_events.size() +
+           scheduled_payments.size() + canceled_payments.size() + merges.size() +
+           system_events.size();
+  }
+  bool empty() const { return size() == 0; }
+
+  /**
+   * Move every record of `other` to the end of this batch.
+   */
+  void append(WriteBatch&& other);
+};
+
+/**
+ * Everything needed to rebuild in-memory state, as read by BankingPersistence::bulkLoad.
+ */
+struct BulkLoadData {
+  struct Account {
+    std::string account_id;
+    int created_at = 0;
+    bool is_active = false;
+  };
+
+  std::vector<Account> accounts;
+  std::vector<std::pair<std::string, BalanceEvent>> balance_events;
+  std::vector<ScheduledPaymentRecord> scheduled_payments;
+  std::vector<WriteBatch::AccountMerge> merges;
+};
+
 /**
  * Banking persistence interface.
- * Provides database operations for the banking system.
+ * Provides database operations for the banking system. Each call checks a
+ * connection out of the pool and runs its statement as a prepared statement,
+ * so it is parsed and planned once per connection.
  */
 class BankingPersistence {
  public:
-  BankingPersistence(std::shared_ptr<PostgresConnection> conn);
+  BankingPersistence(std::shared_ptr<ConnectionPool> pool);
   virtual ~BankingPersistence() = default;
 
   // Non-copyable
@@ -92,9 +162,13 @@ class BankingPersistence {
   virtual bool accountExists(const std::string& account_id);
   virtual std::optional<int> getAccountBalance(const std::string& account_id);
   virtual bool updateAccountBalance(const std::string& account_id, int new_balance);
+  // One transaction and multi-row UPDATE; the last balance given for an account wins
+  virtual bool updateAccountBalances(const std::vector<std::pair<std::string, int>>& balances);
 
   // Transaction operations
   virtual bool saveTransaction(const TransactionRecord& transaction);
+  // One transaction and multi-row INSERT for all of `transactions`
+  virtual bool saveTransactions(const std::vector<TransactionRecord>& transactions);
   virtual std::vector<TransactionRecord> getAccountTransactions(const std::string& account_id,
                                                               int limit = 100,
                                                               int offset = 0);
@@ -110,6 +184,8 @@ class BankingPersistence {
 
   // Historical balance operations
   virtual bool saveBalanceEvent(const std::string& account_id, const BalanceEvent& event);
+  // Like saveBatch, sums events sharing account, timestamp and type into one row
+  virtual bool saveBalanceEvents(const std::vector<std::pair<std::string, BalanceEvent>>& events);
   virtual std::vector<BalanceEvent> getBalanceEvents(const std::string& account_id,
                                                    int start_time = 0, int end_time = INT_MAX);
   virtual std::optional<int> getBalanceAtTime(const std::string& account_id, int time_at);
@@ -130,19 +206,49 @@ class BankingPersistence {
                              double risk_score, const std::vector<std::string>& risk_factors,
                              const std::string& recommendation, int confidence_level);
 
+  /**
+   * Write every record in `batch` in one transaction, using one multi-row
+   * statement per table. Balance events for the same account, timestamp and
+   * type are summed. Returns false (and writes nothing) on any failure.
+   */
+  virtual bool saveBatch(const WriteBatch& batch);
+
+  /**
+   * Called from the loading thread as each table finishes.
+   */
+  using BulkLoadProgress = std::function<void(const std::string& table, size_t rows, size_t bytes,
+                                              std::chrono::milliseconds elapsed)>;
+
+  /**
+   * Read the accounts, balance_events, scheduled_payments and account_merges
+   * tables in full with binary COPY. Tables stream concurrently on separate
+   * pooled connections and each one's rows are decoded on several threads.
+   */
+  virtual bool bulkLoad(BulkLoadData& data, const BulkLoadProgress& progress = nullptr);
+
   // System operations
   virtual bool logSystemEvent(const std::string& event_type, const std::string& severity,
                              const std::string& message, const std::string& component = "",
                              const std::string& correlation_id = "");
 
  protected:
-  std::shared_ptr<PostgresConnection> conn_;
+  std::shared_ptr<ConnectionPool> pool_;
 
  private:
   /**
    * Helper to execute schema creation from file.
    */
   bool executeSchemaFile(const std::string& schema_path);
+
+  /**
+   * Create the monthly transactions/balance_events partitions covering
+   * [from_ts, to_ts], skipping months this process already created. Call it
+   * outside a transaction: attaching a partition locks its parent.
+   */
+  bool ensurePartitions(PostgresConnection& conn, int from_ts, int to_ts);
+
+  std::mutex partitions_mutex_;
+  std::set<int> partition_months_;  // Months since year 0 known to have partitions
 };
 
 }  // namespace database
@@ -0,0 +1,127 @@
+#ifndef BINARY_COPY_HPP_
+#define BINARY_COPY_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace banking {
+namespace database {
+
+/**
+ * The output of one `COPY ... TO STDOUT (FORMAT binary)`, indexed by tuple.
+ *
+ * Data is appended as it streams in. index() then walks the stream once,
+ * reading only field lengths, so the rows can afterwards be decoded in any
+ * order and from several threads. All integers in the format are big-endian.
+ */
+class BinaryCopyBuffer {
+ public:
+  static constexpr size_t kMaxFields = 8;
+
+  /**
+   * One tuple's fields. Column types must match the casts in the COPY query:
+   * int4, bool and text are supported.
+   */
+  class Row {
+   public:
+    bool isNull(size_t field) const { return fields_[field].length < 0; }
+
+    int32_t int32(size_t field) const { return decodeInt32(fields_[field].data); }
+
+    bool boolean(size_t field) const { return fields_[field].data[0] != 0; }
+
+    std::string text(size_t field) const {
+      return isNull(field) ? std::string() : std::string(fields_[field].data, fields_[field].length);
+    }
+
+   private:
+    friend class BinaryCopyBuffer;
+    struct Field {
+      const char* data = nullptr;
+      int32_t length = -1;
+    };
+    std::array<Field, kMaxFields> fields_{};
+  };
+
+  void append(const char* data, size_t length) { data_.append(data, length); }
+
+  /**
+   * Check the header and find every tuple holding exactly `fields` columns
+   * (at most kMaxFields). False if the stream is malformed or truncated.
+   */
+  bool index(size_t fields) {
+    static const char kSignature[] = "PGCOPY\n\377\r\n";
+    constexpr size_t kSignatureLength = 11;  // Includes the trailing NUL
+    tuples_.clear();
+    fields_ = fields;
+    if (fields > kMaxFields || data_.size() < kSignatureLength + 8 ||
+        std::memcmp(data_.data(), kSignature, kSignatureLength) != 0) {
+      return false;
+    }
+
+    size_t pos = kSignatureLength + 4;  // Skip the flags word
+    const int32_t extension = readInt32(pos);
+    pos += 4 + static_cast<size_t>(extension < 0 ? 0 : extension);
+
+    while (pos + 2 <= data_.size()) {
+      const int16_t count = readInt16(pos);
+      if (count == -1) {
+        return true;  // Trailer
+      }
+      if (static_cast<size_t>(count) != fields) {
+        return false;
+      }
+      tuples_.push_back(pos);
+      pos += 2;
+      for (size_t i = 0; i < fields; ++i) {
+        if (pos + 4 > data_.size()) return false;
+        const int32_t length = readInt32(pos);
+        pos += 4 + static_cast<size_t>(length < 0 ? 0 : length);
+      }
+      if (pos > data_.size()) return false;
+    }
+    return false;
+  }
+
+  size_t rowCount() const { return tuples_.size(); }
+  size_t byteCount() const { return data_.size(); }
+
+  Row row(size_t index) const {
+    Row row;
+    size_t pos = tuples_[index] + 2;
+    for (size_t i = 0; i < fields_; ++i) {
+      const int32_t length = readInt32(pos);
+      pos += 4;
+      row.fields_[i] = {data_.data() + pos, length};
+      pos += static_cast<size_t>(length < 0 ? 0 : length);
+    }
+    return row;
+  }
+
+ private:
+  int16_t readInt16(size_t pos) const {
+    const auto* p = reinterpret_cast<const unsigned char*>(data_.data() + pos);
+    return static_cast<int16_t>((p[0] << 8) | p[1]);
+  }
+
+  int32_t readInt32(size_t pos) const { return decodeInt32(data_.data() + pos); }
+
+  static int32_t decodeInt32(const char* data) {
+    const auto* p = reinterpret_cast<const unsigned char*>(data);
+    return static_cast<int32_t>((uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) |
+                                (uint32_t{p[2]} << 8) | uint32_t{p[3]});
+  }
+
+  std::string data_;
+  std::vector<size_t> tuples_;  // Offset of each tuple's field count
+  size_t fields_ = 0;
+};
+
+}  // namespace database
+}  // namespace banking
+
+#endif  // BINARY_COPY_HPP_
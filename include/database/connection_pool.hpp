@@ -0,0 +1,104 @@
+#ifndef CONNECTION_POOL_HPP_
+#define CONNECTION_POOL_HPP_
+
+#include "postgres_connection.hpp"
+#include "observability/metrics.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace banking {
+namespace database {
+
+class ConnectionPool;
+
+/**
+ * A connection checked out of a ConnectionPool; returns it on destruction.
+ */
+class PooledConnection {
+ public:
+  PooledConnection() = default;
+  PooledConnection(ConnectionPool* pool, std::unique_ptr<PostgresConnection> conn);
+  ~PooledConnection();
+
+  // Movable, non-copyable
+  PooledConnection(PooledConnection&& other) noexcept;
+  PooledConnection& operator=(PooledConnection&& other) noexcept;
+  PooledConnection(const PooledConnection&) = delete;
+  PooledConnection& operator=(const PooledConnection&) = delete;
+
+  PostgresConnection* operator->() const { return conn_.get(); }
+  PostgresConnection& operator*() const { return *conn_; }
+  explicit operator bool() const { return conn_ != nullptr; }
+
+  /**
+   * Return the connection to the pool before the handle goes out of scope.
+   */
+  void release();
+
+ private:
+  ConnectionPool* pool_ = nullptr;
+  std::unique_ptr<PostgresConnection> conn_;
+};
+
+/**
+ * Fixed set of `max_connections` PostgreSQL connections shared by callers.
+ *
+ * acquire() hands out an idle connection, waiting up to `connection_timeout`
+ * seconds for one to come back. A connection found broken at checkout is
+ * reconnected. Checkout wait time and the share of connections in use are
+ * reported through the global metrics.
+ */
+class ConnectionPool {
+ public:
+  explicit ConnectionPool(const PostgresConnection::Config& config);
+  ~ConnectionPool() = default;
+
+  // Non-copyable
+  ConnectionPool(const ConnectionPool&) = delete;
+  ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+  /**
+   * Open every connection; false if any fails.
+   */
+  bool connect();
+
+  /**
+   * Check out a connection. Throws std::runtime_error if none frees up in time.
+   */
+  PooledConnection acquire();
+
+  size_t size() const { return connections_; }
+  size_t idleCount() const;
+
+  /**
+   * Get connection info for logging.
+   */
+  std::string getConnectionInfo() const;
+
+ private:
+  friend class PooledConnection;
+  void checkin(std::unique_ptr<PostgresConnection> conn);
+  void reportUsage(size_t in_use) const;
+
+  PostgresConnection::Config config_;
+  size_t connections_ = 0;
+
+  mutable std::mutex mutex_;
+  std::condition_variable available_;
+  std::vector<std::unique_ptr<PostgresConnection>> idle_;
+
+  observability::Histogram& wait_seconds_metric_;
+  observability::Counter& timeouts_metric_;
+  observability::Gauge& in_use_metric_;
+  observability::Gauge& utilization_metric_;
+};
+
+}  // namespace database
+}  // namespace banking
+
+#endif  // CONNECTION_POOL_HPP_
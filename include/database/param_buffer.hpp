@@ -0,0 +1,76 @@
+#ifndef PARAM_BUFFER_HPP_
+#define PARAM_BUFFER_HPP_
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace banking {
+namespace database {
+
+/**
+ * Text-format bind parameters for one statement, packed into a single arena.
+ *
+ * Integers are formatted with std::to_chars straight into the arena, so once
+ * the buffer has grown, binding a row allocates nothing. clear() keeps the
+ * capacity for the next statement. Pointers from values() stay valid until
+ * the next add or clear.
+ */
+class ParamBuffer {
+ public:
+  template <typename Integer, std::enable_if_t<std::is_integral_v<Integer>, int> = 0>
+  ParamBuffer& add(Integer value) {
+    char digits[24];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    offsets_.push_back(arena_.size());
+    arena_.append(digits, result.ptr);
+    arena_.push_back('\0');
+    return *this;
+  }
+
+  ParamBuffer& add(std::string_view value) {
+    offsets_.push_back(arena_.size());
+    arena_.append(value);
+    arena_.push_back('\0');
+    return *this;
+  }
+
+  ParamBuffer& addNull() {
+    offsets_.push_back(kNull);
+    return *this;
+  }
+
+  // Empty strings bind as SQL NULL
+  ParamBuffer& addOrNull(std::string_view value) { return value.empty() ? addNull() : add(value); }
+
+  size_t size() const { return offsets_.size(); }
+  int count() const { return static_cast<int>(offsets_.size()); }
+
+  const char* const* values() {
+    pointers_.resize(offsets_.size());
+    for (size_t i = 0; i < offsets_.size(); ++i) {
+      pointers_[i] = offsets_[i] == kNull ? nullptr : arena_.data() + offsets_[i];
+    }
+    return pointers_.data();
+  }
+
+  void clear() {
+    arena_.clear();
+    offsets_.clear();
+  }
+
+ private:
+  static constexpr size_t kNull = static_cast<size_t>(-1);
+
+  std::string arena_;            // Every value, NUL-terminated
+  std::vector<size_t> offsets_;  // Start of each value in arena_, or kNull
+  std::vector<const char*> pointers_;
+};
+
+}  // namespace database
+}  // namespace banking
+
+#endif  // PARAM_BUFFER_HPP_
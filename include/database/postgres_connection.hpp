@@ -1,9 +1,11 @@
 #ifndef POSTGRES_CONNECTION_HPP_
 #define POSTGRES_CONNECTION_HPP_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <mutex>
+#include <unordered_set>
 #include <postgresql/libpq-fe.h>
 
 namespace banking {
@@ -11,7 +13,8 @@ namespace database {
 
 /**
  * PostgreSQL database connection wrapper.
- * Handles connection management, connection pooling, and basic query execution.
+ * Handles connection management and query execution on one session; see
+ * ConnectionPool for sharing several of them.
  */
 class PostgresConnection {
  public:
@@ -25,7 +28,7 @@ class PostgresConnection {
     std::string username = "banking_user";
     std::string password = "";
     int connection_timeout = 30;  // seconds
-    int max_connections = 10;
+    int max_connections = 10;  // Pool size when used through ConnectionPool
   };
 
   PostgresConnection(const Config& config);
@@ -69,6 +72,22 @@ class PostgresConnection {
                                      const int* paramLengths = nullptr,
                                      const int* paramFormats = nullptr);
 
+  /**
+   * Execute `query` as the prepared statement `name`, preparing it on this
+   * session the first time the name is used.
+   */
+  PGresult* executePrepared(const std::string& name,
+                           const std::string& query,
+                           int nParams,
+                           const char* const* paramValues);
+
+  /**
+   * Run a `COPY ... TO STDOUT` statement, passing each chunk of output to
+   * `on_data` as it arrives.
+   */
+  bool copyOut(const std::string& query,
+               const std::function<void(const char* data, int length)>& on_data);
+
   /**
    * Begin a transaction.
    */
@@ -95,10 +114,15 @@ class PostgresConnection {
   std::string getConnectionInfo() const;
 
  private:
+  // Callers must hold mutex_
+  bool executeQueryLocked(const std::string& query);
+  void disconnectLocked();
+
   Config config_;
   PGconn* connection_;
   mutable std::mutex mutex_;
   bool in_transaction_;
+  std::unordered_set<std::string> prepared_;  // Statement names prepared on this session
 };
 
 /**
@@ -114,9 +138,10 @@ class TransactionGuard {
   TransactionGuard& operator=(const TransactionGuard&) = delete;
 
   /**
-   * Commit the transaction (called automatically in destructor).
+   * Commit the transaction; returns whether it committed. Without a commit
+   * the destructor rolls back.
    */
-  void commit();
+  bool commit();
 
   /**
    * Rollback the transaction.
@@ -0,0 +1,138 @@
+#ifndef READ_CACHE_HPP_
+#define READ_CACHE_HPP_
+
+#include "observability/metrics.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace banking {
+namespace database {
+
+/**
+ * Read-through cache for database-backed queries.
+ *
+ * Historical balances are keyed by (account, time_at) and kept in LRU order
+ * in shards picked by account, `capacity` entries in total. Top-spenders
+ * results are kept per `n` for the current epoch.
+ *
+ * Writers invalidate after their records have committed: an account's
+ * balances from a timestamp on, or the whole top-spenders epoch. A load that
+ * was in flight across such an invalidation is returned to its caller but not
+ * cached, so an answer read before the commit is never served afterwards.
+ * Hits and misses are exported to the global metrics.
+ */
+class ReadCache {
+ public:
+  struct Config {
+    size_t capacity = 64 * 1024;  // Balance entries across all shards (0 = disabled)
+    size_t shards = 16;
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0;
+    size_t entries = 0;
+  };
+
+  explicit ReadCache(const Config& config);
+  ~ReadCache();
+
+  // Non-copyable
+  ReadCache(const ReadCache&) = delete;
+  ReadCache& operator=(const ReadCache&) = delete;
+
+  /**
+   * The cached balance of `account` at `time_at`, or `load()` (returning
+   * std::optional<int>) on a miss. Empty results are not cached.
+   */
+  template <typename Load>
+  std::optional<int> balance(const std::string& account, int time_at, Load load) {
+    if (!enabled()) return load();
+
+    uint64_t generation = 0;
+    if (auto cached = findBalance(account, time_at, generation)) {
+      return cached;
+    }
+    std::optional<int> loaded = load();
+    if (loaded) {
+      storeBalance(account, time_at, *loaded, generation);
+    }
+    return loaded;
+  }
+
+  /**
+   * The cached top `n` spenders of the current epoch, or `load()` on a miss.
+   */
+  template <typename Load>
+  std::vector<std::string> topSpenders(int n, Load load) {
+    if (!enabled()) return load();
+
+    uint64_t epoch = 0;
+    if (auto cached = findTopSpenders(n, epoch)) {
+      return std::move(*cached);
+    }
+    std::vector<std::string> loaded = load();
+    storeTopSpenders(n, loaded, epoch);
+    return loaded;
+  }
+
+  /**
+   * Drop `account`'s balances at or after `from_time`.
+   */
+  void invalidateBalances(const std::string& account, int from_time);
+
+  /**
+   * Start a new top-spenders epoch.
+   */
+  void invalidateTopSpenders();
+
+  Stats getStats() const;
+  bool enabled() const { return capacity_per_shard_ > 0; }
+
+ private:
+  struct Shard;
+
+  Shard& shardFor(const std::string& account) const;
+
+  // `generation` is set on a miss and passed back to storeBalance()
+  std::optional<int> findBalance(const std::string& account, int time_at, uint64_t& generation);
+  void storeBalance(const std::string& account, int time_at, int balance, uint64_t generation);
+
+  std::optional<std::vector<std::string>> findTopSpenders(int n, uint64_t& epoch);
+  void storeTopSpenders(int n, const std::vector<std::string>& result, uint64_t epoch);
+
+  void recordLookup(bool hit);
+
+  size_t capacity_per_shard_ = 0;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  std::mutex spenders_mutex_;
+  uint64_t spenders_epoch_ = 0;
+  std::map<int, std::vector<std::string>> spenders_;  // Results of spenders_epoch_, by n
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> invalidations_{0};
+
+  observability::Counter& hits_metric_;
+  observability::Counter& misses_metric_;
+  observability::Counter& evictions_metric_;
+  observability::Gauge& hit_ratio_metric_;
+};
+
+}  // namespace database
+}  // namespace banking
+
+#endif  // READ_CACHE_HPP_
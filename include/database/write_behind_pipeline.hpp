@@ -0,0 +1,144 @@
+#ifndef WRITE_BEHIND_PIPELINE_HPP_
+#define WRITE_BEHIND_PIPELINE_HPP_
+
+#include "banking_persistence.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace banking {
+namespace database {
+
+/**
+ * When a submitted write counts as done.
+ */
+enum class DurabilityMode {
+  SYNC,          // Written in its own transaction before submit() returns
+  GROUP_COMMIT,  // Queued; submit() waits until the batch containing it commits
+  ASYNC          // Queued; submit() returns immediately
+};
+
+/**
+ * Write-behind queue in front of BankingPersistence.
+ *
+ * Operations hand their records to submit() after the in-memory change is
+ * made. A flusher thread drains the queue every `flush_interval`, or as soon as
+ * `max_batch_records` are waiting, and writes everything queued with a single
+ * saveBatch() call: one transaction and one multi-row statement per table,
+ * instead of a round trip and a commit per record. If that batch fails, each
+ * submission in it is written again on its own, so one bad record only fails
+ * the operation it belongs to.
+ */
+class WriteBehindPipeline {
+ public:
+  struct Config {
+    DurabilityMode mode = DurabilityMode::GROUP_COMMIT;
+    std::chrono::milliseconds flush_interval{5};
+    size_t max_batch_records = 512;
+    // Submitters block while this many records are waiting (0 = unbounded)
+    size_t max_queued_records = 64 * 1024;
+  };
+
+  struct Stats {
+    uint64_t records_submitted = 0;
+    uint64_t records_flushed = 0;
+    uint64_t flushes = 0;
+    uint64_t failed_flushes = 0;   // Flushes that left some records unwritten
+    uint64_t retried_flushes = 0;  // Flushes whose batch failed and was split up
+    size_t queued_records = 0;
+    std::chrono::microseconds last_flush_duration{0};
+    // Age of the oldest record not yet written (zero when the queue is empty)
+    std::chrono::microseconds flush_lag{0};
+  };
+
+  WriteBehindPipeline(BankingPersistence& persistence, const Config& config);
+  ~WriteBehindPipeline();
+
+  // Non-copyable
+  WriteBehindPipeline(const WriteBehindPipeline&) = delete;
+  WriteBehindPipeline& operator=(const WriteBehindPipeline&) = delete;
+
+  /**
+   * Start the flusher thread (a no-op in SYNC mode).
+   */
+  void start();
+
+  /**
+   * Flush everything still queued and stop the flusher thread.
+   */
+  void stop();
+
+  /**
+   * Hand over one operation's records. Returns false if they could not be
+   * written; in ASYNC mode failures are only reported through stats.
+   */
+  bool submit(WriteBatch batch);
+
+  /**
+   * Like submit(), but hands back the wait instead of blocking: the future
+   * becomes ready once the records are written (GROUP_COMMIT) and is ready
+   * immediately otherwise. Lets a caller holding a lock queue its records,
+   * release the lock and only then wait, so other callers can join the batch.
+   */
+  std::future<bool> enqueue(WriteBatch batch);
+
+  /**
+   * Block until everything submitted so far has been written. Returns false
+   * if the last batch failed.
+   */
+  bool flush();
+
+  Stats getStats() const;
+  DurabilityMode mode() const { return config_.mode; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // Where one submit()'s records sit in a merged batch, and who waits for them
+  struct Submission {
+    std::array<size_t, 7> records{};  // Per WriteBatch table, in declaration order
+    std::optional<std::promise<bool>> committed;  // Empty in ASYNC mode
+  };
+
+  void flusherLoop();
+
+  // Take everything queued and write it with mutex_ released; returns with it held again
+  void writePending(std::unique_lock<std::mutex>& lock);
+
+  // Write one drained batch and resolve its waiters; called without mutex_ held
+  bool writeBatch(WriteBatch batch, std::vector<Submission> submissions,
+                  std::vector<std::promise<bool>> waiters, Clock::time_point oldest);
+
+  BankingPersistence& persistence_;
+  Config config_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;   // Flusher: records waiting or stopping
+  std::condition_variable space_cv_;  // Submitters: queue below max_queued_records
+  WriteBatch pending_;
+  std::vector<Submission> submissions_;      // What pending_ is made of
+  std::vector<std::promise<bool>> waiters_;  // flush() callers
+  Clock::time_point oldest_pending_;
+  Clock::time_point oldest_in_flight_;
+  size_t in_flight_records_ = 0;
+  bool flush_requested_ = false;
+  bool running_ = false;
+  bool stopping_ = false;
+  Stats stats_;
+
+  std::mutex write_mutex_;  // One saveBatch() at a time, so batches commit in order
+  std::thread flusher_;
+};
+
+}  // namespace database
+}  // namespace banking
+
+#endif  // WRITE_BEHIND_PIPELINE_HPP_
@@ -0,0 +1,153 @@
+#ifndef IDEMPOTENCY_CACHE_HPP_
+#define IDEMPOTENCY_CACHE_HPP_
+
+#include "network/protocol.hpp"
+#include "observability/metrics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace banking {
+
+/**
+ * Responses of recent requests by (client_id, idempotency key), so a retried
+ * request is answered without being applied twice.
+ *
+ * Keys live in shards picked by hash, `capacity` in total, and expire `ttl`
+ * after they were first seen; when a shard is full its oldest key goes first.
+ * A duplicate that arrives while the first attempt is still running waits for
+ * that attempt's response rather than running alongside it. Responses the
+ * caller marks as not cacheable (the request never reached the engine) are
+ * handed to any waiters and then forgotten, so the next retry runs again.
+ */
+class IdempotencyCache {
+ public:
+  struct Config {
+    size_t capacity = 256 * 1024;  // Keys across all shards (0 = disabled)
+    size_t shards = 16;
+    std::chrono::milliseconds ttl{std::chrono::minutes(10)};
+  };
+
+  struct Stats {
+    uint64_t hits = 0;         // Answered from a completed first attempt
+    uint64_t waits = 0;        // Answered by waiting for a first attempt in flight
+    uint64_t misses = 0;       // First attempts
+    uint64_t evictions = 0;    // Dropped before expiry to stay within capacity
+    uint64_t expirations = 0;
+    size_t entries = 0;
+  };
+
+  explicit IdempotencyCache(const Config& config);
+  ~IdempotencyCache();
+
+  // Non-copyable
+  IdempotencyCache(const IdempotencyCache&) = delete;
+  IdempotencyCache& operator=(const IdempotencyCache&) = delete;
+
+  // Receives a response, or nullptr if the first attempt it waited for threw
+  using Done = std::function<void(const network::protocol::Response*)>;
+  using Finish = std::function<void(network::protocol::Response)>;
+
+  /**
+   * The response of the first request from `client_id` with `key`, or `run()`
+   * if there is none. An empty key always runs. `cacheable(response)` decides
+   * whether a fresh response is kept for later duplicates.
+   */
+  template <typename Run, typename Cacheable>
+  network::protocol::Response execute(const std::string& client_id, const std::string& key, Run run,
+                                      Cacheable cacheable) {
+    if (!enabled() || key.empty()) return run();
+
+    Reservation reservation = reserve(client_id, key);
+    if (!reservation.owner) return wait(reservation);
+    try {
+      network::protocol::Response response = run();
+      finish(reservation, response, cacheable(response));
+      return response;
+    } catch (...) {
+      fail(reservation, std::current_exception());
+      throw;
+    }
+  }
+
+  /**
+   * Like execute(), but never waits: `run(finish)` starts the request and
+   * calls `finish` once with its response, from any thread, and `done` gets
+   * the answer on that thread. A duplicate of an attempt still in flight is
+   * answered on the thread that finishes the attempt.
+   */
+  template <typename Run, typename Cacheable>
+  void executeAsync(const std::string& client_id, const std::string& key, Run run,
+                    Cacheable cacheable, Done done) {
+    if (!enabled() || key.empty()) {
+      run(Finish([done = std::move(done)](network::protocol::Response response) { done(&response); }));
+      return;
+    }
+
+    Reservation reservation = reserve(client_id, key);
+    if (!reservation.owner) return await(reservation, std::move(done));
+    try {
+      run(Finish([this, reservation, cacheable, done](network::protocol::Response response) mutable {
+        finish(reservation, response, cacheable(response));
+        done(&response);
+      }));
+    } catch (...) {
+      fail(reservation, std::current_exception());
+      throw;
+    }
+  }
+
+  Stats getStats() const;
+  bool enabled() const { return capacity_per_shard_ > 0; }
+
+ private:
+  struct Shard;
+  struct Attempt;
+
+  /**
+   * A claim on a key: the first attempt, possibly still running, and with
+   * `owner` set the duty to run the request and finish() it.
+   */
+  struct Reservation {
+    Shard* shard = nullptr;
+    std::string key;
+    uint64_t id = 0;
+    std::shared_ptr<Attempt> attempt;
+    bool owner = false;
+  };
+
+  Reservation reserve(const std::string& client_id, const std::string& key);
+  // Block until the first attempt finishes; rethrows what it threw
+  network::protocol::Response wait(const Reservation& reservation);
+  // Call `done` once the first attempt finishes, now if it already has
+  void await(const Reservation& reservation, Done done);
+  void finish(Reservation& reservation, const network::protocol::Response& response, bool keep);
+  void fail(Reservation& reservation, std::exception_ptr error);
+  void complete(Attempt& attempt, const network::protocol::Response* response, std::exception_ptr error);
+  void forget(Reservation& reservation);
+
+  size_t capacity_per_shard_ = 0;
+  std::chrono::milliseconds ttl_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> waits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> expirations_{0};
+
+  observability::Counter& hits_metric_;
+  observability::Counter& misses_metric_;
+  observability::Counter& evictions_metric_;
+};
+
+}  // namespace banking
+
+#endif  // IDEMPOTENCY_CACHE_HPP_
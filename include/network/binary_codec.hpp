@@ -0,0 +1,136 @@
+#ifndef BINARY_CODEC_HPP_
+#define BINARY_CODEC_HPP_
+
+#include "protocol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace banking {
+namespace network {
+namespace protocol {
+
+// Operation fields of a Request, in the order they are declared there.
+enum class RequestField : uint8_t {
+  ACCOUNT_ID,
+  SOURCE_ACCOUNT,
+  TARGET_ACCOUNT,
+  ACCOUNT_ID_1,
+  ACCOUNT_ID_2,
+  PAYMENT_ID,
+  USERNAME,
+  PASSWORD,
+  AMOUNT,
+  TIME_AT,
+  N,
+  DELAY,
+  OPERATIONS   // BATCH sub-requests
+};
+
+/**
+ * Ordered list of the fields a message type carries.
+ */
+struct RequestSchema {
+  const RequestField* fields;
+  size_t count;
+
+  const RequestField* begin() const { return fields; }
+  const RequestField* end() const { return fields + count; }
+};
+
+/**
+ * Schema for `type`; shared by the binary and JSON encodings.
+ */
+const RequestSchema& requestSchema(MessageType type);
+
+/**
+ * Wire name of a field (the JSON payload key).
+ */
+const char* requestFieldName(RequestField field);
+
+/**
+ * Request decoded in place. String fields point into the buffer the request
+ * was decoded from and are only valid while that buffer is untouched;
+ * call materialize() to keep the request beyond that.
+ */
+struct RequestView {
+  MessageType type = MessageType::HEARTBEAT;
+  int timestamp = 0;
+  std::string_view client_id;
+  std::string_view session_token;
+  std::string_view idempotency_key;
+
+  std::string_view account_id;
+  std::string_view source_account;
+  std::string_view target_account;
+  std::string_view account_id_1;
+  std::string_view account_id_2;
+  std::string_view payment_id;
+  std::string_view username;
+  std::string_view password;
+  int amount = 0;
+  int time_at = 0;
+  int n = 0;
+  int delay = 0;
+  std::vector<RequestView> operations;
+
+  Request materialize() const;
+};
+
+/**
+ * Schema-driven binary encoding of Request and Response.
+ *
+ * Request:  magic | type u8 | timestamp | client_id | session_token | schema fields
+ *           [| idempotency_key]
+ * Response: magic | status u8 | timestamp | message | presence u8 | present fields
+ *
+ * Integers are 4-byte little-endian; strings are a varint length followed by
+ * the bytes. BATCH operations are a varint count followed by each sub-request
+ * as type u8 | timestamp | schema fields; batch results are a varint count of
+ * nested responses without the magic byte. The idempotency key trails the
+ * request only when set, so decoders that predate it still accept the rest.
+ *
+ * The schema for each message type fixes which fields follow and in what
+ * order, so no field names or tags are sent. The magic byte can never start
+ * a JSON document, which is how the two encodings are told apart.
+ */
+class BinaryCodec {
+ public:
+  static constexpr char kRequestMagic = static_cast<char>(0xB1);
+  static constexpr char kResponseMagic = static_cast<char>(0xB2);
+
+  /**
+   * True if `bytes` starts with a binary request or response.
+   */
+  static bool isBinary(std::string_view bytes);
+
+  /**
+   * Append the encoding of `request` to `out`.
+   */
+  static void encodeRequest(const Request& request, std::string& out);
+
+  /**
+   * Decode a request without copying its strings.
+   * Throws std::runtime_error on truncated or malformed input.
+   */
+  static RequestView decodeRequest(std::string_view bytes);
+
+  /**
+   * Append the encoding of `response` to `out`.
+   */
+  static void encodeResponse(const Response& response, std::string& out);
+
+  /**
+   * Decode a response. Throws std::runtime_error on malformed input.
+   */
+  static Response decodeResponse(std::string_view bytes);
+};
+
+}  // namespace protocol
+}  // namespace network
+}  // namespace banking
+
+#endif  // BINARY_CODEC_HPP_
@@ -1,13 +1,11 @@
 #ifndef PROTOCOL_HPP_
 #define PROTOCOL_HPP_
 
-#include <map>
-#include <sstream>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
-#include <string>
-#include <vector>
 
 namespace banking {
 namespace network {
@@ -25,9 +23,15 @@ enum class MessageType {
   MERGE_ACCOUNTS,
   AUTHENTICATE,
   HEARTBEAT,
-  ERROR
+  ERROR,
+  BATCH   // Appended so existing wire values stay stable
 };
 
+constexpr size_t kMessageTypeCount = static_cast<size_t>(MessageType::BATCH) + 1;
+
+// Upper-case name of a message type, e.g. "TRANSFER", as used in metric labels
+const char* messageTypeName(MessageType type);
+
 // Response status
 enum class Status {
   SUCCESS,
@@ -35,16 +39,46 @@ enum class Status {
   INVALID_REQUEST,
   UNAUTHORIZED,
   ACCOUNT_NOT_FOUND,
-  INSUFFICIENT_FUNDS
+  INSUFFICIENT_FUNDS,
+  REJECTED_FRAUD  // Declined by pre-authorization; appended so existing wire values stay stable
+};
+
+// Payload encodings; a server answers in the encoding the request used.
+enum class Encoding {
+  JSON,    // Human-readable, kept for debugging and old clients
+  BINARY   // Schema-driven compact encoding (see binary_codec.hpp)
 };
 
 // Request base structure
 struct Request {
-  MessageType type;
-  int timestamp;
+  MessageType type = MessageType::HEARTBEAT;
+  int timestamp = 0;
   std::string client_id;
   std::string session_token;
-  std::map<std::string, std::string> payload;
+
+  // Optional, chosen by the client and unique per logical operation: a retry
+  // carrying the same key within the server's dedup window is answered with
+  // the first attempt's response instead of being applied again
+  std::string idempotency_key;
+
+  // Operation fields. Which ones are set depends on `type`; the JSON
+  // encoding nests them under "payload" using the same names.
+  std::string account_id;
+  std::string source_account;
+  std::string target_account;
+  std::string account_id_1;
+  std::string account_id_2;
+  std::string payment_id;
+  std::string username;
+  std::string password;
+  int amount = 0;
+  int time_at = 0;
+  int n = 0;
+  int delay = 0;
+
+  // BATCH only: sub-operations, applied in order at this request's timestamp
+  // under its client_id/session_token. Their own timestamps are ignored.
+  std::vector<Request> operations;
 
   // Helper methods for specific request types
   static Request createAccount(int timestamp, const std::string& client_id,
@@ -84,18 +118,37 @@ struct Request {
                              const std::string& password);
 
   static Request heartbeat(int timestamp, const std::string& client_id);
+
+  static Request batch(int timestamp, const std::string& client_id,
+                       const std::string& session_token,
+                       std::vector<Request> operations);
 };
 
 // Response base structure
 struct Response {
-  Status status;
+  Status status = Status::SUCCESS;
   std::string message;
-  int timestamp;
-  std::map<std::string, std::string> payload;
+  int timestamp = 0;
+
+  // Result fields, present only for the operations that produce them.
+  std::optional<std::string> account_id;
+  std::optional<int> balance;
+  std::optional<int> source_balance;
+  std::optional<std::string> payment_id;
+  std::optional<std::string> session_token;
+  std::optional<std::vector<std::string>> spenders;
+  std::optional<std::vector<Response>> results;  // BATCH: one per sub-operation
+
+  /**
+   * True if any result field is set.
+   */
+  bool hasPayload() const {
+    return account_id || balance || source_balance || payment_id ||
+           session_token || spenders || results;
+  }
 
   // Helper methods for specific response types
-  static Response success(const std::string& message, int timestamp,
-                         const nlohmann::json& payload = nlohmann::json{});
+  static Response success(const std::string& message, int timestamp);
 
   static Response error(Status status, const std::string& message, int timestamp);
 
@@ -108,21 +161,145 @@ struct Response {
   static Response paymentCancelled(int timestamp);
   static Response accountsMerged(int timestamp);
   static Response authenticated(const std::string& session_token, int timestamp);
+  static Response batchResult(std::vector<Response> results, int timestamp);
 };
 
-// Serialization functions
+// JSON serialization functions
 std::string serializeRequest(const Request& request);
-Request deserializeRequest(const std::string& json_str);
+Request deserializeRequest(std::string_view json_str);
 
 std::string serializeResponse(const Response& response);
-Response deserializeResponse(const std::string& json_str);
+Response deserializeResponse(std::string_view json_str);
+
+// Encoding-aware helpers; decoding detects the encoding from the first byte.
+Encoding detectEncoding(std::string_view bytes);
+std::string encodeRequest(const Request& request, Encoding encoding);
+Request decodeRequest(std::string_view bytes);  // Copies every string; see BinaryCodec::decodeRequest
+std::string encodeResponse(const Response& response, Encoding encoding);
+void encodeResponse(const Response& response, Encoding encoding, std::string& out);  // Appends to `out`
+Response decodeResponse(std::string_view bytes);
+
+// Wire framing versions, negotiated per connection (see MessageFramer).
+enum class FramingVersion : uint8_t {
+  V1_HEX = 1,     // Legacy: 8 hex chars of length, applied twice per message
+  V2_BINARY = 2,  // 4-byte little-endian length, applied once
+  V3_MULTIPLEXED = 3  // v2 header plus a 4-byte request id echoed in the response
+};
+
+constexpr FramingVersion kMaxFramingVersion = FramingVersion::V3_MULTIPLEXED;
+
+/**
+ * True if frames of this version carry a request id, so responses may be
+ * matched out of order. Older versions answer strictly in request order.
+ */
+constexpr bool carriesRequestId(FramingVersion version) {
+  return version >= FramingVersion::V3_MULTIPLEXED;
+}
+
+/**
+ * Receive buffer for framed messages.
+ * Bytes are read straight into the tail and consumed from the head by
+ * advancing an offset; unread bytes are only moved when the tail runs out
+ * of room, so frames stay contiguous and can be handed out as string_views.
+ * Views returned by readable() are invalidated by the next prepareWrite().
+ */
+class FrameBuffer {
+ public:
+  explicit FrameBuffer(size_t initial_capacity = 64 * 1024);
+
+  /**
+   * Reserve at least `min_bytes` of writable space and return a pointer to it.
+   */
+  char* prepareWrite(size_t min_bytes);
+
+  /**
+   * Mark `n` bytes written after prepareWrite() as readable.
+   */
+  void commitWrite(size_t n);
+
+  void append(const char* data, size_t n);
+
+  std::string_view readable() const {
+    return std::string_view(data_.data() + read_pos_, write_pos_ - read_pos_);
+  }
+
+  void consume(size_t n);
+
+  size_t size() const { return write_pos_ - read_pos_; }
+  bool empty() const { return read_pos_ == write_pos_; }
+
+ private:
+  std::vector<char> data_;
+  size_t read_pos_;
+  size_t write_pos_;
+};
 
 // Message framing for TCP transport
 class MessageFramer {
  public:
+  static constexpr size_t kV1HeaderSize = 8;
+  static constexpr size_t kV2HeaderSize = 4;
+  static constexpr size_t kV3HeaderSize = 8;      // length + request id
+  static constexpr size_t kHandshakeSize = 4;      // "BKP" + version byte
+  static constexpr size_t kMaxFrameSize = 16 * 1024 * 1024;
+
+  enum class HandshakeState {
+    NEED_MORE,   // Not enough bytes to decide yet
+    LEGACY,      // Peer skipped the handshake and speaks v1
+    NEGOTIATED   // Handshake consumed; version chosen
+  };
+
+  // Legacy v1 helpers (single hex frame)
   static std::string frameMessage(const std::string& message);
   static std::string unframeMessage(const std::string& framed_message);
   static bool isCompleteMessage(const std::string& buffer);
+
+  /**
+   * Append `payload` to `out` framed for the given version.
+   * v1 keeps the historical double hex frame so old peers still parse it.
+   * `request_id` is only written by versions that carry one.
+   */
+  static void appendFrame(std::string& out, std::string_view payload,
+                          FramingVersion version, uint32_t request_id = 0);
+
+  /**
+   * Build a frame in place: beginFrame() reserves the header at the end of
+   * `out` and returns its offset, the caller appends the payload, and
+   * finishFrame() writes the header for everything appended since.
+   */
+  static size_t beginFrame(std::string& out, FramingVersion version);
+  static void finishFrame(std::string& out, size_t frame_start,
+                          FramingVersion version, uint32_t request_id = 0);
+  static size_t headerSize(FramingVersion version);
+
+  /**
+   * Extract the next complete frame from `buffer` without copying.
+   * Returns false if more bytes are needed. The frame is consumed from the
+   * buffer but `payload` stays valid until the buffer is next written to.
+   * `request_id` is set to 0 for versions that do not carry one.
+   * Throws std::runtime_error on a malformed or oversized header.
+   */
+  static bool nextFrame(FrameBuffer& buffer, FramingVersion version,
+                        std::string_view& payload, uint32_t& request_id);
+  static bool nextFrame(FrameBuffer& buffer, FramingVersion version,
+                        std::string_view& payload);
+
+  /**
+   * Client hello: magic followed by the highest version the client speaks.
+   */
+  static std::string encodeHandshake(FramingVersion max_version);
+
+  /**
+   * Server side: detect and consume a client hello at the start of a stream.
+   * On NEGOTIATED, `version` holds the version to use and `reply` the ack to send.
+   */
+  static HandshakeState acceptHandshake(FrameBuffer& buffer, FramingVersion& version,
+                                        std::string& reply);
+
+  /**
+   * Client side: consume the server's ack and report the chosen version.
+   */
+  static HandshakeState readHandshakeAck(FrameBuffer& buffer, FramingVersion& version);
 };
 
 }  // namespace protocol
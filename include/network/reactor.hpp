@@ -0,0 +1,169 @@
+#ifndef REACTOR_HPP_
+#define REACTOR_HPP_
+
+#include "protocol.hpp"
+#include "tcp_server.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace banking {
+namespace network {
+
+namespace detail {
+
+/**
+ * Per-connection receive state shared by both I/O models.
+ */
+struct StreamState {
+  protocol::FrameBuffer input;
+  protocol::FramingVersion framing = protocol::FramingVersion::V1_HEX;
+  bool negotiated = false;
+};
+
+/**
+ * Negotiate framing on the first bytes of a stream, appending the reply to
+ * `output`, then take the next complete request. Returns false until one is
+ * buffered; throws if the peer sent something unparseable.
+ */
+bool nextRequest(StreamState& stream, std::string& output,
+                 std::string_view& request, uint32_t& request_id);
+
+/**
+ * Run every complete request in `stream` through `writer`, which encodes
+ * each response straight into `output` behind a reserved frame header.
+ * Returns false if the peer sent something unparseable and should be dropped.
+ */
+bool dispatchBufferedRequests(const TCPServer::ResponseWriter& writer,
+                              StreamState& stream, std::string& output,
+                              const std::string& client_addr);
+
+/**
+ * Write all of `data` to a blocking socket, resuming after short writes and
+ * signals. Returns false if the connection failed.
+ */
+bool sendAll(int fd, std::string_view data);
+
+}  // namespace detail
+
+/**
+ * Single-threaded epoll event loop used by TCPServer in EVENT_LOOP mode.
+ * Each reactor owns its own SO_REUSEPORT listening socket, so the kernel
+ * load-balances new connections across reactors without a shared accept lock.
+ * All sockets are non-blocking; per-connection read and write buffers hold
+ * partial frames and unsent responses between readiness events.
+ *
+ * With an AsyncHandler, requests are handed off and the loop moves on;
+ * answers are posted back through an eventfd and framed in request order.
+ *
+ * A connection reads a bounded amount per readiness event, so one busy peer
+ * cannot starve the others, and stops reading while its unsent responses or
+ * unanswered requests are above a high-water mark, so a peer that does not
+ * read cannot grow them without bound. A peer that half-closes still gets
+ * every response before the connection is closed.
+ */
+class Reactor {
+ public:
+  /**
+   * A non-negative `cpu` pins the event loop thread to that CPU.
+   */
+  Reactor(size_t id, int port, int listen_backlog,
+          const TCPServer::ResponseWriter& writer,
+          const TCPServer::AsyncHandler& async_handler,
+          std::atomic<size_t>& connection_count,
+          int cpu = -1);
+  ~Reactor();
+
+  // Non-copyable
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+
+  /**
+   * Bind the listening socket and start the event loop thread.
+   */
+  bool start();
+
+  /**
+   * Stop the event loop and close every connection owned by this reactor.
+   */
+  void stop();
+
+ private:
+  struct Mailbox;
+
+  // A request handed to the AsyncHandler, answered or not yet
+  struct PendingResponse {
+    uint32_t request_id = 0;
+    bool done = false;
+    std::string response;
+  };
+
+  // An answer posted to the loop
+  struct Completion {
+    int fd;
+    uint64_t connection;  // Connection::id, since fds are reused
+    uint64_t sequence;    // Which of the connection's requests
+    std::string response;
+  };
+
+  struct Connection {
+    uint64_t id = 0;
+    std::string addr;
+    detail::StreamState stream;
+    std::deque<PendingResponse> in_flight;  // Requests not yet framed, in arrival order
+    uint64_t first_sequence = 0;            // Sequence of in_flight.front()
+    std::string write_buffer;
+    size_t write_offset = 0;
+    uint32_t interest = 0;        // Events currently registered with epoll
+    bool throttled = false;       // Reading paused until unsent output drains
+    bool read_closed = false;     // Peer finished sending; close once output drains
+  };
+
+  void run();
+  void acceptConnections();
+  // Read and answer what the peer sent; false if the connection failed
+  bool handleReadable(int fd, Connection& conn);
+  // Hand every buffered request to the AsyncHandler; false on a protocol error
+  bool dispatchAsync(int fd, Connection& conn);
+  // Apply the answers posted since the last call and send what they complete
+  void processCompletions();
+  // Frame the answered requests at the front of in_flight into the write buffer
+  void emitResponses(Connection& conn);
+  bool flushWrites(int fd, Connection& conn);
+  /**
+   * Register the events `conn` needs now. Returns false if it has nothing
+   * left to read or write and should be closed.
+   */
+  bool updateInterest(int fd, Connection& conn);
+  void closeConnection(int fd);
+
+  size_t id_;
+  int port_;
+  int listen_backlog_;
+  int cpu_;
+  const TCPServer::ResponseWriter& response_writer_;
+  const TCPServer::AsyncHandler& async_handler_;
+  std::atomic<size_t>& connection_count_;
+
+  int listen_fd_;
+  int epoll_fd_;
+  int wake_fd_;
+  std::atomic<bool> running_;
+  std::unique_ptr<std::thread> thread_;
+  std::unordered_map<int, Connection> connections_;
+  uint64_t next_connection_id_ = 0;
+  std::shared_ptr<Mailbox> mailbox_;
+  std::vector<Completion> completions_;  // Swapped with the mailbox's, to keep both allocated
+};
+
+}  // namespace network
+}  // namespace banking
+
+#endif  // REACTOR_HPP_
@@ -1,13 +1,18 @@
 #ifndef TCP_CLIENT_HPP_
 #define TCP_CLIENT_HPP_
 
+#include "protocol.hpp"
+
 #include <atomic>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <mutex>
-#include <condition_variable>
+#include <unordered_map>
 
 namespace banking {
 namespace network {
@@ -18,7 +23,19 @@ namespace network {
  */
 class TCPClient {
  public:
+  /**
+   * Client configuration.
+   */
+  struct Config {
+    // Highest framing version to offer; V1_HEX skips the handshake entirely.
+    protocol::FramingVersion max_framing = protocol::kMaxFramingVersion;
+    // How long to wait for the server's handshake ack before assuming a
+    // legacy server and reconnecting with v1 framing.
+    int handshake_timeout_ms = 500;
+  };
+
   TCPClient(const std::string& host, int port);
+  TCPClient(const std::string& host, int port, const Config& config);
   ~TCPClient();
 
   // Non-copyable
@@ -46,9 +63,17 @@ class TCPClient {
   std::string sendRequest(const std::string& request);
 
   /**
-   * Send a request asynchronously (fire and forget).
+   * Send a request without waiting for the response.
+   * Any number of requests may be in flight on one connection; the future
+   * completes when the matching response arrives, in whatever order the
+   * server answers. It fails with std::runtime_error if the connection drops.
    */
-  bool sendRequestAsync(const std::string& request);
+  std::future<std::string> sendRequestAsync(const std::string& request);
+
+  /**
+   * Number of requests sent but not yet answered.
+   */
+  size_t getPendingCount() const;
 
   /**
    * Get server host.
@@ -60,21 +85,36 @@ class TCPClient {
    */
   int getPort() const { return port_; }
 
+  /**
+   * Framing version in use on the current connection.
+   */
+  protocol::FramingVersion getFramingVersion() const { return framing_; }
+
  private:
+  bool openSocket();
+  void closeSocket();
+  bool negotiateFraming();
   void receiveLoop();
-  bool sendMessage(const std::string& message);
-  std::string receiveMessage();
+  bool writeAll(const std::string& data);
+  void completeRequest(uint32_t request_id, std::string_view response);
+  void failPendingRequests(const std::string& reason);
 
   std::string host_;
   int port_;
+  Config config_;
   int socket_;
+  protocol::FramingVersion framing_;
+  protocol::FrameBuffer receive_buffer_;
   std::atomic<bool> connected_;
   std::unique_ptr<std::thread> receive_thread_;
   mutable std::mutex socket_mutex_;
-  std::mutex response_mutex_;
-  std::condition_variable response_cv_;
-  std::string pending_response_;
-  bool response_ready_;
+
+  // Outstanding requests. With v3 framing responses are matched by id;
+  // older servers answer in order, so `pending_order_` tracks send order.
+  mutable std::mutex pending_mutex_;
+  std::unordered_map<uint32_t, std::promise<std::string>> pending_requests_;
+  std::deque<uint32_t> pending_order_;
+  uint32_t next_request_id_;
 };
 
 }  // namespace network
@@ -4,22 +4,64 @@
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace banking {
 namespace network {
 
+class Reactor;
+
 /**
  * TCP Server for banking system operations.
  * Handles client connections and dispatches requests to the banking system.
  */
 class TCPServer {
  public:
-  using RequestHandler = std::function<std::string(const std::string&)>;
+  // Receives one unframed request; the view is only valid for the call.
+  using RequestHandler = std::function<std::string(std::string_view)>;
+
+  // Like RequestHandler, but appends the encoded response to `out`, which is
+  // the connection's output buffer with the frame header already reserved.
+  using ResponseWriter = std::function<void(std::string_view request, std::string& out)>;
+
+  // Answers one request with its encoded response; call exactly once, from any thread.
+  using Responder = std::function<void(std::string response)>;
+
+  // Like RequestHandler, but may answer after returning, through `respond`.
+  // EVENT_LOOP reactors keep serving their connections meanwhile, and each
+  // connection's responses still go out in the order its requests came in;
+  // a THREAD_PER_CONNECTION thread waits for each answer in turn.
+  using AsyncHandler = std::function<void(std::string_view request, Responder respond)>;
+
+  /**
+   * How client sockets are mapped onto threads.
+   */
+  enum class IoModel {
+    THREAD_PER_CONNECTION,  // One blocking thread per accepted socket
+    EVENT_LOOP              // Fixed set of epoll reactors multiplexing all sockets
+  };
+
+  /**
+   * Server configuration.
+   */
+  struct Config {
+    IoModel io_model = IoModel::THREAD_PER_CONNECTION;
+    size_t num_reactors = 0;     // EVENT_LOOP only; 0 = one per reactor CPU, else per hardware thread
+    int listen_backlog = 1024;   // Clamped by the kernel to net.core.somaxconn
+    std::vector<int> reactor_cpus;  // EVENT_LOOP only; CPU for reactor i (cycled), empty = unpinned
+  };
 
   TCPServer(int port, RequestHandler handler);
+  TCPServer(int port, RequestHandler handler, const Config& config);
+  TCPServer(int port, ResponseWriter writer);
+  TCPServer(int port, ResponseWriter writer, const Config& config);
+  TCPServer(int port, AsyncHandler handler);
+  TCPServer(int port, AsyncHandler handler, const Config& config);
   ~TCPServer();
 
   // Non-copyable
@@ -52,16 +94,26 @@ class TCPServer {
   size_t getConnectionCount() const;
 
  private:
+  bool startThreadPerConnection();
+  bool startEventLoop();
   void acceptLoop();
   void handleClient(int client_socket, std::string client_addr);
 
   int port_;
   int server_socket_;
-  RequestHandler request_handler_;
+  ResponseWriter response_writer_;
+  AsyncHandler async_handler_;  // Empty unless constructed with one
+  Config config_;
   std::atomic<bool> running_;
+
+  // THREAD_PER_CONNECTION state
   std::unique_ptr<std::thread> accept_thread_;
   std::unordered_map<int, std::unique_ptr<std::thread>> client_threads_;
   mutable std::mutex connections_mutex_;
+
+  // EVENT_LOOP state
+  std::vector<std::unique_ptr<Reactor>> reactors_;
+  std::atomic<size_t> reactor_connections_;
 };
 
 }  // namespace network
@@ -0,0 +1,147 @@
+#ifndef LATENCY_HISTOGRAM_HPP_
+#define LATENCY_HISTOGRAM_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace banking {
+namespace observability {
+
+/**
+ * Quantiles of one latency distribution, in microseconds.
+ */
+struct LatencySummary {
+  uint64_t count = 0;
+  double mean_us = 0.0;
+  double p50_us = 0.0;
+  double p99_us = 0.0;
+  double p999_us = 0.0;
+  double max_us = 0.0;
+};
+
+/**
+ * Log-linear (HDR-style) histogram of nanosecond values.
+ *
+ * Values below 2^kSubBucketBits are counted exactly. Above that, every power
+ * of two is split into 2^(kSubBucketBits - 1) equal buckets, so a value is
+ * reported within 1 / 2^(kSubBucketBits - 1) of itself (about 3%) across the
+ * whole range, up to kMaxValue (about 68 seconds; larger values are clamped).
+ * Histograms merge by adding counts, so per-thread ones combine exactly.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 6;
+  static constexpr int kMaxValueBits = 36;
+  static constexpr uint64_t kMaxValue = (uint64_t{1} << kMaxValueBits) - 1;
+  static constexpr size_t kBucketCount =
+      (size_t{1} << kSubBucketBits) + (kMaxValueBits - kSubBucketBits) * (size_t{1} << (kSubBucketBits - 1));
+
+  LatencyHistogram() : counts_(kBucketCount, 0) {}
+
+  void record(uint64_t value_ns, uint64_t times = 1);
+  void merge(const LatencyHistogram& other);
+  void reset();
+
+  uint64_t count() const { return count_; }
+  uint64_t max() const { return max_; }
+  double mean() const { return count_ > 0 ? static_cast<double>(sum_) / count_ : 0.0; }
+
+  /**
+   * The value at or below which `percentile` (0-100) of recorded values fall,
+   * as the highest value its bucket holds, never above max().
+   */
+  uint64_t valueAtPercentile(double percentile) const;
+
+  LatencySummary summary() const;
+
+  static size_t bucketIndex(uint64_t value_ns);
+  static uint64_t bucketUpperBound(size_t index);
+
+ private:
+  friend class LatencyRecorder;
+
+  std::vector<uint64_t> counts_;
+  uint64_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t max_ = 0;
+};
+
+/**
+ * Concurrent recorder feeding a LatencyHistogram.
+ *
+ * Each thread records into its own cell (see MetricsCollector), so record()
+ * is a few uncontended relaxed atomics. A cell's counts are allocated the
+ * first time a thread records into it, so unused series stay small.
+ * snapshot() merges the cells.
+ */
+class LatencyRecorder {
+ public:
+  LatencyRecorder();
+  ~LatencyRecorder();
+
+  // Non-copyable
+  LatencyRecorder(const LatencyRecorder&) = delete;
+  LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+  void record(std::chrono::nanoseconds latency);
+  LatencyHistogram snapshot() const;
+  void reset();
+
+ private:
+  struct Counts {
+    std::array<std::atomic<uint64_t>, LatencyHistogram::kBucketCount> buckets{};
+  };
+
+  struct alignas(64) Cell {
+    std::atomic<Counts*> counts{nullptr};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+  };
+
+  std::vector<Cell> cells_;
+};
+
+/**
+ * Events per second over a sliding window of whole seconds.
+ *
+ * One slot per second of a 64-second ring, each packing its second and its
+ * count into one atomic word, so recording is lock-free and a slot left over
+ * from a previous lap is never counted.
+ */
+class RateMeter {
+ public:
+  static constexpr int kMaxWindowSeconds = 60;
+
+  RateMeter();
+
+  void record(uint64_t events = 1);
+
+  /**
+   * Average rate over the last `window_seconds` complete seconds, or over the
+   * seconds since construction if that is shorter.
+   */
+  double perSecond(int window_seconds = 10) const;
+
+  void reset();
+
+ private:
+  static constexpr size_t kSlots = 64;
+
+  static uint32_t currentSecond();
+
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> word{0};  // (second << 32) | count
+  };
+
+  std::array<Slot, kSlots> slots_;
+  std::atomic<uint32_t> started_;
+};
+
+}  // namespace observability
+}  // namespace banking
+
+#endif  // LATENCY_HISTOGRAM_HPP_
@@ -1,13 +1,24 @@
 #ifndef LOGGER_HPP_
 #define LOGGER_HPP_
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <mutex>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <type_traits>
+#include <vector>
+
+// Statements below this level (0 = DEBUG ... 4 = FATAL) are compiled out
+#ifndef BANKING_LOG_COMPILE_LEVEL
+#define BANKING_LOG_COMPILE_LEVEL 0
+#endif
 
 namespace banking {
 namespace observability {
@@ -23,21 +34,202 @@ enum class LogLevel {
   FATAL
 };
 
+/**
+ * The constant part of a log statement. Records carry its address as their
+ * format ID, so only the arguments are copied per call. A null `format`
+ * marks the message-based API (message, component, correlation id, fields).
+ */
+struct LogSite {
+  LogLevel level;
+  const char* format;     // "{}" stands for each argument in turn
+  const char* component;
+};
+
+namespace detail {
+
+enum class LogArg : uint8_t { INT, UINT, DOUBLE, BOOL, STRING };
+
+// Arguments already encoded by LogBuilder, copied as they are
+struct RawLogArgs {
+  std::string_view bytes;
+  uint16_t count;
+};
+
+/**
+ * Single-producer, single-consumer byte ring holding one thread's records.
+ * A record never wraps: one that does not fit before the end is preceded by
+ * a zero-size marker telling the consumer to skip to the start.
+ */
+class LogRing {
+ public:
+  LogRing(size_t capacity, uint32_t thread_index);
+
+  // Producer: room for `bytes` (a multiple of 8), or nullptr if full or larger than the ring
+  char* reserve(size_t bytes);
+  void commit();
+
+  // Consumer: hand every committed record to `handle(const char*)`; returns how many
+  template <typename Handle>
+  size_t drain(Handle handle);
+
+  uint32_t threadIndex() const { return thread_index_; }
+  size_t capacity() const { return capacity_; }
+
+  std::atomic<bool> abandoned{false};  // Set when the owning thread exits
+
+ private:
+  std::unique_ptr<char[]> buffer_;
+  size_t capacity_;
+  uint32_t thread_index_;
+  uint64_t reserved_end_ = 0;  // Producer only
+  alignas(64) std::atomic<uint64_t> head_{0};
+  alignas(64) std::atomic<uint64_t> tail_{0};
+};
+
+template <typename Handle>
+size_t LogRing::drain(Handle handle) {
+  // Head first: an empty ring's producer may move both cursors to the next lap
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  const uint64_t start = tail_.load(std::memory_order_relaxed);
+  uint64_t tail = start;
+  size_t records = 0;
+  while (tail < head) {
+    const size_t offset = static_cast<size_t>(tail % capacity_);
+    uint32_t size;
+    std::memcpy(&size, buffer_.get() + offset, sizeof(size));
+    if (size == 0) {
+      tail += capacity_ - offset;  // Wrap marker
+      continue;
+    }
+    handle(buffer_.get() + offset);
+    tail += size;
+    ++records;
+  }
+  if (tail != start) {
+    tail_.store(tail, std::memory_order_release);
+  }
+  return records;
+}
+
+struct RecordHeader {
+  uint32_t size;  // Including this header and padding; 0 marks a wrap
+  uint16_t arg_count;
+  uint16_t reserved;
+  const LogSite* site;
+  int64_t timestamp_ns;  // System clock
+};
+
+template <typename T>
+constexpr bool isLogString() {
+  using U = std::decay_t<T>;
+  return std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view> ||
+         std::is_same_v<U, const char*> || std::is_same_v<U, char*>;
+}
+
+template <typename T>
+size_t encodedSize(const T& value) {
+  if constexpr (std::is_same_v<std::decay_t<T>, RawLogArgs>) {
+    return value.bytes.size();
+  } else if constexpr (isLogString<T>()) {
+    return 1 + sizeof(uint32_t) + std::string_view(value).size();
+  } else {
+    static_assert(std::is_arithmetic_v<T>, "log arguments must be numbers, bools or strings");
+    return 1 + 8;
+  }
+}
+
+template <typename T>
+char* encode(char* out, const T& value) {
+  if constexpr (std::is_same_v<std::decay_t<T>, RawLogArgs>) {
+    std::memcpy(out, value.bytes.data(), value.bytes.size());
+    return out + value.bytes.size();
+  } else if constexpr (isLogString<T>()) {
+    const std::string_view text(value);
+    const uint32_t length = static_cast<uint32_t>(text.size());
+    *out++ = static_cast<char>(LogArg::STRING);
+    std::memcpy(out, &length, sizeof(length));
+    std::memcpy(out + sizeof(length), text.data(), length);
+    return out + sizeof(length) + length;
+  } else {
+    uint64_t bits;
+    LogArg tag;
+    if constexpr (std::is_same_v<T, bool>) {
+      tag = LogArg::BOOL;
+      bits = value ? 1 : 0;
+    } else if constexpr (std::is_floating_point_v<T>) {
+      tag = LogArg::DOUBLE;
+      const double widened = static_cast<double>(value);
+      std::memcpy(&bits, &widened, sizeof(bits));
+    } else if constexpr (std::is_signed_v<T>) {
+      tag = LogArg::INT;
+      bits = static_cast<uint64_t>(static_cast<int64_t>(value));
+    } else {
+      tag = LogArg::UINT;
+      bits = static_cast<uint64_t>(value);
+    }
+    *out++ = static_cast<char>(tag);
+    std::memcpy(out, &bits, sizeof(bits));
+    return out + sizeof(bits);
+  }
+}
+
+template <typename T>
+uint16_t argCount(const T& value) {
+  if constexpr (std::is_same_v<std::decay_t<T>, RawLogArgs>) {
+    return value.count;
+  } else {
+    return 1;
+  }
+}
+
+}  // namespace detail
+
 /**
  * Structured logger with JSON output and configurable log levels.
  * Thread-safe and supports correlation IDs for request tracing.
+ *
+ * Logging is asynchronous. A call copies the statement's LogSite address, a
+ * timestamp and its raw arguments into the calling thread's ring and returns;
+ * nothing is formatted and no lock is taken. A background thread drains the
+ * rings every `flush_interval`, formats the records and writes each batch to
+ * the output stream with one flush. ERROR and FATAL records wake it at once,
+ * and FATAL waits until its record is written.
  */
 class Logger {
  public:
+  /**
+   * What a call does when its thread's ring is full.
+   */
+  enum class OverflowPolicy {
+    DROP,  // Discard the record and count it
+    BLOCK  // Wait for the background thread to make room
+  };
+
+  struct Config {
+    size_t ring_bytes = 64 * 1024;  // Per thread; applies to threads that log for the first time afterwards
+    OverflowPolicy overflow = OverflowPolicy::DROP;
+    std::chrono::milliseconds flush_interval{10};
+  };
+
+  struct Stats {
+    uint64_t records_written = 0;
+    uint64_t records_dropped = 0;
+    uint64_t batches_written = 0;
+    size_t rings = 0;
+  };
+
   static Logger& getInstance();
 
   // Non-copyable
   Logger(const Logger&) = delete;
   Logger& operator=(const Logger&) = delete;
 
+  void configure(const Config& config);
+
   // Set minimum log level
   void setLogLevel(LogLevel level);
   LogLevel getLogLevel() const;
+  bool enabled(LogLevel level) const { return level >= min_level_.load(std::memory_order_relaxed); }
 
   // Set output stream (default: std::cout)
   void setOutputStream(std::ostream& stream);
@@ -63,6 +255,19 @@ class Logger {
              const std::string& component = "",
              const std::string& correlation_id = "");
 
+  /**
+   * Log `site` with `args` (numbers, bools and strings) as one binary record.
+   */
+  template <typename... Args>
+  void write(const LogSite& site, const Args&... args);
+
+  /**
+   * Write everything logged so far before returning.
+   */
+  void flush();
+
+  Stats getStats() const;
+
   // Structured logging with key-value pairs
   class LogBuilder {
    public:
@@ -78,37 +283,123 @@ class Logger {
     LogBuilder& field(const std::string& key, bool value);
 
    private:
+    template <typename T>
+    LogBuilder& append(const std::string& key, const T& value);
+
     LogLevel level_;
     std::string message_;
     std::string component_;
     std::string correlation_id_;
-    std::unordered_map<std::string, std::string> fields_;
+    std::string fields_;  // Encoded key/value arguments, appended in order
+    uint16_t field_args_ = 0;
   };
 
  private:
   Logger();
-  ~Logger() = default;
+  ~Logger();
+
+  // The calling thread's ring, created on its first record
+  detail::LogRing& threadRing();
+
+  // Room for `bytes` in `ring` under the overflow policy; nullptr if dropped
+  char* reserve(detail::LogRing& ring, size_t bytes);
+
+  void wake();
+  void backgroundLoop();
 
-  void log(LogLevel level, const std::string& message,
-           const std::string& component,
-           const std::string& correlation_id,
-           const std::unordered_map<std::string, std::string>& fields = {});
+  // Drain every ring into one batch and write it; caller holds consume_mutex_
+  void drainRings();
+  void formatRecord(const char* record, uint32_t thread_index, std::string& out) const;
 
-  std::string levelToString(LogLevel level) const;
-  std::string getCurrentTimestamp() const;
-  std::string getThreadId() const;
+  static const LogSite& messageSite(LogLevel level);
+  static const char* levelToString(LogLevel level);
 
-  LogLevel min_level_;
+  std::atomic<LogLevel> min_level_;
+  std::atomic<size_t> ring_bytes_;
+  std::atomic<OverflowPolicy> overflow_;
+  std::atomic<int64_t> flush_interval_ms_;
+
+  mutable std::mutex rings_mutex_;  // Registration and the consumer's walk only
+  std::vector<std::shared_ptr<detail::LogRing>> rings_;
+  uint32_t next_thread_index_ = 0;
+
+  std::mutex consume_mutex_;  // One drainer at a time; guards output_stream_ and batch_
   std::ostream* output_stream_;
-  mutable std::mutex mutex_;
+  std::string batch_;
+
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
+  bool wake_requested_ = false;
+  bool stopping_ = false;
+  std::thread background_;
+
+  std::atomic<uint64_t> records_written_{0};
+  std::atomic<uint64_t> records_dropped_{0};
+  std::atomic<uint64_t> batches_written_{0};
 };
 
-// Convenience macros for logging
-#define LOG_DEBUG(msg) banking::observability::Logger::getInstance().debug(msg, __func__)
-#define LOG_INFO(msg) banking::observability::Logger::getInstance().info(msg, __func__)
-#define LOG_WARN(msg) banking::observability::Logger::getInstance().warn(msg, __func__)
-#define LOG_ERROR(msg) banking::observability::Logger::getInstance().error(msg, __func__)
-#define LOG_FATAL(msg) banking::observability::Logger::getInstance().fatal(msg, __func__)
+template <typename... Args>
+void Logger::write(const LogSite& site, const Args&... args) {
+  if (!enabled(site.level)) return;
+
+  const size_t payload = sizeof(detail::RecordHeader) + (size_t{0} + ... + detail::encodedSize(args));
+  const size_t size = (payload + 7) & ~size_t{7};
+  detail::LogRing& ring = threadRing();
+  char* out = reserve(ring, size);
+  if (!out) return;
+
+  detail::RecordHeader header;
+  header.size = static_cast<uint32_t>(size);
+  header.arg_count = static_cast<uint16_t>((0 + ... + detail::argCount(args)));
+  header.reserved = 0;
+  header.site = &site;
+  header.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+  std::memcpy(out, &header, sizeof(header));
+
+  char* cursor = out + sizeof(header);
+  ((cursor = detail::encode(cursor, args)), ...);
+  ring.commit();
+
+  if (site.level >= LogLevel::ERROR) {
+    wake();
+  }
+  if (site.level == LogLevel::FATAL) {
+    flush();
+  }
+}
+
+#define BANKING_LOG_ENABLED(level_value) ((level_value) >= BANKING_LOG_COMPILE_LEVEL)
+
+#define BANKING_LOG_MESSAGE(level_value, method, ...)                      \
+  do {                                                                    \
+    if constexpr (BANKING_LOG_ENABLED(level_value)) {                     \
+      banking::observability::Logger::getInstance().method(__VA_ARGS__);  \
+    }                                                                     \
+  } while (0)
+
+#define BANKING_LOG_FORMAT(level, level_value, component, format, ...)                              \
+  do {                                                                                            \
+    if constexpr (BANKING_LOG_ENABLED(level_value)) {                                             \
+      static constexpr banking::observability::LogSite banking_log_site{                          \
+          banking::observability::LogLevel::level, format, component};                            \
+      banking::observability::Logger::getInstance().write(banking_log_site, ##__VA_ARGS__);       \
+    }                                                                                             \
+  } while (0)
+
+// Convenience macros for logging: (message[, component[, correlation_id]])
+#define LOG_DEBUG(...) BANKING_LOG_MESSAGE(0, debug, __VA_ARGS__)
+#define LOG_INFO(...) BANKING_LOG_MESSAGE(1, info, __VA_ARGS__)
+#define LOG_WARN(...) BANKING_LOG_MESSAGE(2, warn, __VA_ARGS__)
+#define LOG_ERROR(...) BANKING_LOG_MESSAGE(3, error, __VA_ARGS__)
+#define LOG_FATAL(...) BANKING_LOG_MESSAGE(4, fatal, __VA_ARGS__)
+
+// Formatted logging with a literal format: (component, "Loaded {} rows", rows)
+#define LOG_DEBUG_FMT(component, format, ...) BANKING_LOG_FORMAT(DEBUG, 0, component, format, ##__VA_ARGS__)
+#define LOG_INFO_FMT(component, format, ...) BANKING_LOG_FORMAT(INFO, 1, component, format, ##__VA_ARGS__)
+#define LOG_WARN_FMT(component, format, ...) BANKING_LOG_FORMAT(WARN, 2, component, format, ##__VA_ARGS__)
+#define LOG_ERROR_FMT(component, format, ...) BANKING_LOG_FORMAT(ERROR, 3, component, format, ##__VA_ARGS__)
+#define LOG_FATAL_FMT(component, format, ...) BANKING_LOG_FORMAT(FATAL, 4, component, format, ##__VA_ARGS__)
 
 // Structured logging helper
 #define LOG_BUILDER(level, msg) \
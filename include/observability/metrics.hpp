@@ -1,24 +1,137 @@
 #ifndef METRICS_HPP_
 #define METRICS_HPP_
 
+#include "latency_histogram.hpp"
+
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
 #include <string>
-#include <unordered_map>
+#include <utility>
 #include <vector>
-#include <mutex>
 
 namespace banking {
 namespace observability {
 
+// Label name/value pairs of one series, e.g. {{"operation", "TRANSFER"}}
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+namespace detail {
+
+constexpr size_t kMetricCells = 16;
+
+/**
+ * The cell the calling thread updates. Threads are assigned cells round-robin
+ * on first use, so with up to kMetricCells threads none share a cache line.
+ */
+size_t threadCell();
+
+struct alignas(64) PaddedDouble {
+  std::atomic<double> value{0.0};
+};
+
+// fetch_add for atomic<double> is C++20; cells are rarely contended, so the loop rarely repeats
+inline void atomicAdd(std::atomic<double>& target, double value) {
+  double current = target.load(std::memory_order_relaxed);
+  while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace detail
+
+/**
+ * Monotonically increasing value. Updates go to the calling thread's cell;
+ * value() sums them.
+ */
+class Counter {
+ public:
+  void increment(double value = 1.0) { detail::atomicAdd(cells_[detail::threadCell()].value, value); }
+  double value() const;
+  void reset();
+
+ private:
+  std::array<detail::PaddedDouble, detail::kMetricCells> cells_;
+};
+
+/**
+ * Value that can go up and down. The last set() wins, so a gauge is a single
+ * atomic rather than per-thread cells.
+ */
+class Gauge {
+ public:
+  void set(double value) { value_.value.store(value, std::memory_order_relaxed); }
+  void increment(double value = 1.0) { detail::atomicAdd(value_.value, value); }
+  void decrement(double value = 1.0) { increment(-value); }
+  double value() const { return value_.value.load(std::memory_order_relaxed); }
+
+ private:
+  detail::PaddedDouble value_;
+};
+
+/**
+ * Distribution of values over fixed buckets. Each thread's cell holds its own
+ * per-bucket counts, found by binary search over the upper bounds, and they
+ * are only added up on export.
+ */
+class Histogram {
+ public:
+  explicit Histogram(std::vector<double> upper_bounds);
+
+  void observe(double value);
+
+  struct Snapshot {
+    std::vector<double> upper_bounds;  // Without the implicit +Inf bucket
+    std::vector<uint64_t> counts;      // Per bucket, not cumulative; the last one is +Inf
+    uint64_t count = 0;
+    double sum = 0.0;
+  };
+  Snapshot snapshot() const;
+  void reset();
+
+ private:
+  // Bucket counts are laid out cell by cell, each cell starting on its own cache line
+  struct alignas(64) CountLine {
+    std::array<std::atomic<uint64_t>, 8> counts{};
+  };
+  std::atomic<uint64_t>& count(size_t cell, size_t bucket) const {
+    return lines_[cell * lines_per_cell_ + bucket / 8].counts[bucket % 8];
+  }
+
+  std::vector<double> upper_bounds_;  // Each bucket's counts, then the +Inf bucket's
+  size_t lines_per_cell_;
+  std::unique_ptr<CountLine[]> lines_;
+  std::array<detail::PaddedDouble, detail::kMetricCells> sums_;
+};
+
 /**
- * Simple metrics collection system for monitoring system performance.
- * Supports counters, gauges, and histograms with Prometheus-compatible output.
+ * Metrics registry with Prometheus-compatible output.
+ *
+ * counter(), gauge() and histogram() register a series on first use and
+ * return a handle that stays valid for the collector's lifetime; hot paths
+ * keep the handle, so an update is one uncontended atomic operation with no
+ * lock and no name lookup. The name-based methods look the handle up on
+ * every call and suit code that reports rarely.
  */
 class MetricsCollector {
  public:
   MetricsCollector();
-  ~MetricsCollector() = default;
+  ~MetricsCollector();
+
+  // Handles; `labels` distinguish series of the same metric
+  Counter& counter(const std::string& name, const Labels& labels = {});
+  Gauge& gauge(const std::string& name, const Labels& labels = {});
+  // `upper_bounds` (ascending) apply when the series is first registered; empty uses the defaults
+  Histogram& histogram(const std::string& name, const Labels& labels = {},
+                       const std::vector<double>& upper_bounds = {});
+  // Exported as a summary in seconds: p50, p99, p99.9 and max (quantile 1)
+  LatencyRecorder& latency(const std::string& name, const Labels& labels = {});
+  // Exported as a gauge: events per second over the last 10 seconds
+  RateMeter& rate(const std::string& name, const Labels& labels = {});
 
   // Counter: monotonically increasing value
   void incrementCounter(const std::string& name, double value = 1.0);
@@ -35,47 +148,32 @@ class MetricsCollector {
   class Timer {
    public:
     Timer(MetricsCollector& collector, const std::string& name);
+    explicit Timer(Histogram& histogram);
     ~Timer();
 
    private:
-    MetricsCollector& collector_;
-    std::string name_;
+    Histogram& histogram_;
     std::chrono::steady_clock::time_point start_;
   };
 
   // Export metrics in Prometheus format
   std::string exportMetrics() const;
 
-  // Reset all metrics
+  // Zero all metrics; handles stay valid
   void reset();
 
  private:
-  struct Counter {
-    double value{0.0};
-    std::string help;
-  };
+  // Series are keyed by (name, rendered labels), so each metric's series export together
+  using SeriesKey = std::pair<std::string, std::string>;
 
-  struct Gauge {
-    double value{0.0};
-    std::string help;
-  };
-
-  struct HistogramBucket {
-    double upper_bound;
-    size_t count{0};
-  };
-
-  struct Histogram {
-    std::vector<HistogramBucket> buckets;
-    size_t count{0};
-    double sum{0.0};
-    std::string help;
-  };
+  static std::string renderLabels(const Labels& labels);
 
-  mutable std::mutex mutex_;
-  std::unordered_map<std::string, Counter> counters_;
-  std::unordered_map<std::string, Gauge> gauges_;
-  std::unordered_map<std::string, Histogram> histograms_;
+  mutable std::shared_mutex mutex_;  // Guards the maps, not the values
+  std::map<SeriesKey, std::unique_ptr<Counter>> counters_;
+  std::map<SeriesKey, std::unique_ptr<Gauge>> gauges_;
+  std::map<SeriesKey, std::unique_ptr<Histogram>> histograms_;
+  std::map<SeriesKey, std::unique_ptr<LatencyRecorder>> latencies_;
+  std::map<SeriesKey, std::unique_ptr<RateMeter>> rates_;
 
   // Default histogram buckets (in seconds)
   static std::vector<double> defaultBuckets();
@@ -0,0 +1,127 @@
+#ifndef REPLICATION_PUBLISHER_HPP_
+#define REPLICATION_PUBLISHER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace banking {
+namespace replication {
+
+/**
+ * Primary side of replication: numbers operation records in the order they
+ * are published and streams them to every connected follower. Each publisher
+ * is a new log with its own random id, so a follower that applied another
+ * log's records, such as a previous run of this primary, starts over from a
+ * snapshot instead of resuming by sequence alone.
+ *
+ * publish() only appends to an in-memory window of recent records, so the
+ * writer never waits on a follower. Each follower gets its own sender thread
+ * that copies whatever it has not yet sent out of the window. A follower that
+ * falls behind the window (or connects with nothing) is sent a snapshot from
+ * `SnapshotSource` and continues from the sequence it covers.
+ */
+class ReplicationPublisher {
+ public:
+  struct Config {
+    int port = 9100;
+    // Records kept for followers to catch up from; older ones cost a snapshot
+    size_t retained_records = 1024 * 1024;
+    // Idle followers still hear from the primary this often
+    std::chrono::milliseconds heartbeat_interval{100};
+    // Records copied out of the window per send
+    size_t max_send_bytes = 256 * 1024;
+  };
+
+  struct Stats {
+    uint64_t log_id = 0;
+    size_t followers = 0;
+    uint64_t last_sequence = 0;
+    uint64_t first_retained = 0;  // Oldest sequence a follower can resume after without a snapshot
+    uint64_t records_sent = 0;
+    uint64_t snapshots_sent = 0;
+  };
+
+  /**
+   * Produces a snapshot body and sets `sequence` to the last record it covers.
+   * Must be consistent: the state after exactly the records through `sequence`.
+   */
+  using SnapshotSource = std::function<std::string(uint64_t& sequence)>;
+
+  ReplicationPublisher(const Config& config, SnapshotSource snapshot_source);
+  ~ReplicationPublisher();
+
+  // Non-copyable
+  ReplicationPublisher(const ReplicationPublisher&) = delete;
+  ReplicationPublisher& operator=(const ReplicationPublisher&) = delete;
+
+  /**
+   * Listen for followers.
+   */
+  bool start();
+
+  /**
+   * Disconnect every follower and stop listening.
+   */
+  void stop();
+
+  /**
+   * Append the next record and return its sequence. Callers publish in the
+   * order the operations took effect, typically under the engine's lock.
+   */
+  uint64_t publish(std::string record);
+
+  uint64_t lastSequence() const;
+  uint64_t logId() const { return log_id_; }
+  Stats getStats() const;
+
+ private:
+  void acceptLoop();
+  void serveFollower(int socket, std::string addr);
+
+  // Stream a fresh snapshot; `next` becomes the first sequence after it.
+  bool sendSnapshot(int socket, uint64_t& next);
+
+  enum class Batch {
+    READY,            // `out` holds records, a heartbeat, or both
+    SNAPSHOT_NEEDED,  // `next` is no longer (or not yet) in the window
+    STOPPING
+  };
+
+  // Wait for records from `next` on and frame them, or a heartbeat, into `out`.
+  Batch collect(uint64_t& next, std::string& out);
+
+  Config config_;
+  SnapshotSource snapshot_source_;
+  const uint64_t log_id_;  // Never 0, which a follower with no log sends
+
+  mutable std::mutex mutex_;
+  std::condition_variable published_;
+  std::deque<std::string> records_;  // Sequences [first_retained_, next_sequence_)
+  uint64_t first_retained_ = 1;
+  uint64_t next_sequence_ = 1;
+  bool stopping_ = false;
+
+  int server_socket_ = -1;
+  std::atomic<bool> running_{false};
+  std::unique_ptr<std::thread> accept_thread_;
+  mutable std::mutex followers_mutex_;
+  std::unordered_map<int, std::unique_ptr<std::thread>> follower_threads_;
+
+  std::atomic<uint64_t> records_sent_{0};
+  std::atomic<uint64_t> snapshots_sent_{0};
+};
+
+}  // namespace replication
+}  // namespace banking
+
+#endif  // REPLICATION_PUBLISHER_HPP_
@@ -0,0 +1,65 @@
+#ifndef REPLICATION_STREAM_HPP_
+#define REPLICATION_STREAM_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace banking {
+namespace replication {
+
+/**
+ * Messages on a replication connection. Each one travels in a v2 frame
+ * (MessageFramer, 4-byte length).
+ *
+ * Sequences only mean something within one log, and a primary starts a new
+ * log, with a random id, every time it starts. The follower opens with a
+ * hello carrying the last sequence it applied and the id of the log it came
+ * from, both 0 if it has nothing. The primary first sends its own log id,
+ * then the records after that sequence, or a snapshot first when it no
+ * longer retains them or the follower's log is not its own (always, for 0).
+ * From then on the primary pushes records as they are applied, and a
+ * heartbeat with its latest sequence whenever the follower has been sent
+ * everything.
+ */
+enum class FrameKind : uint8_t {
+  RECORD = 1,      // One operation record; `sequence` is its position in the log
+  SNAPSHOT_CHUNK,  // Part of a snapshot body, in order
+  SNAPSHOT_END,    // Snapshot complete; it covers every record through `sequence`
+  HEARTBEAT,       // The primary's latest sequence; no payload
+  LOG_ID           // First on every connection; the primary's log id in `sequence`
+};
+
+// The follower's hello: [last applied sequence][log id]
+constexpr size_t kHelloSize = 2 * sizeof(uint64_t);
+
+// [kind][sequence], native-endian like the records themselves
+constexpr size_t kFrameHeaderSize = 1 + sizeof(uint64_t);
+
+// Snapshots go out in pieces so no frame nears MessageFramer::kMaxFrameSize
+constexpr size_t kSnapshotChunkSize = 1024 * 1024;
+
+inline void appendMessage(std::string& out, FrameKind kind, uint64_t sequence,
+                          std::string_view payload = {}) {
+  out.push_back(static_cast<char>(kind));
+  out.append(reinterpret_cast<const char*>(&sequence), sizeof(sequence));
+  out.append(payload.data(), payload.size());
+}
+
+/**
+ * Split a frame payload into its parts; false if it is too short to hold a header.
+ */
+inline bool parseMessage(std::string_view frame, FrameKind& kind, uint64_t& sequence,
+                         std::string_view& payload) {
+  if (frame.size() < kFrameHeaderSize) return false;
+  kind = static_cast<FrameKind>(frame[0]);
+  std::memcpy(&sequence, frame.data() + 1, sizeof(sequence));
+  payload = frame.substr(kFrameHeaderSize);
+  return true;
+}
+
+}  // namespace replication
+}  // namespace banking
+
+#endif  // REPLICATION_STREAM_HPP_
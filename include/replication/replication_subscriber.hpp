@@ -0,0 +1,103 @@
+#ifndef REPLICATION_SUBSCRIBER_HPP_
+#define REPLICATION_SUBSCRIBER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace banking {
+namespace replication {
+
+/**
+ * Follower side of replication: keeps a connection to a ReplicationPublisher
+ * open, reconnecting after failures, and hands what arrives to a Handler on
+ * its own receive thread.
+ *
+ * Each (re)connection resumes after the last sequence the handler accepted,
+ * in the log it came from; a primary streaming a different log (it was
+ * restarted, or another primary took over) sends a snapshot first, and
+ * records of a log the follower has not loaded are never applied. If the
+ * handler rejects a record or snapshot, the follower's state can no longer
+ * be trusted, so the subscriber reconnects asking for a snapshot.
+ */
+class ReplicationSubscriber {
+ public:
+  struct Config {
+    std::string primary_host = "127.0.0.1";
+    int primary_port = 9100;
+    std::chrono::milliseconds reconnect_interval{500};
+  };
+
+  struct Handler {
+    // Replace all state with a snapshot body covering records through `sequence`
+    std::function<bool(uint64_t sequence, const std::string& body)> snapshot;
+    // Apply the record at `sequence`; records arrive gaplessly in order
+    std::function<bool(uint64_t sequence, std::string_view record)> record;
+    // Everything through `sequence` has now been delivered
+    std::function<void(uint64_t sequence)> caught_up;
+  };
+
+  ReplicationSubscriber(const Config& config, Handler handler);
+  ~ReplicationSubscriber();
+
+  // Non-copyable
+  ReplicationSubscriber(const ReplicationSubscriber&) = delete;
+  ReplicationSubscriber& operator=(const ReplicationSubscriber&) = delete;
+
+  /**
+   * Start following; the first connection resumes after `applied_sequence`
+   * of the log `log_id` (0 asks for a snapshot).
+   */
+  void start(uint64_t applied_sequence = 0, uint64_t log_id = 0);
+
+  /**
+   * Disconnect and stop the receive thread.
+   */
+  void stop();
+
+  bool isConnected() const { return connected_.load(); }
+
+  /**
+   * Last sequence the handler accepted.
+   */
+  uint64_t appliedSequence() const { return applied_sequence_.load(); }
+
+  /**
+   * The log appliedSequence() belongs to; 0 before the first snapshot.
+   */
+  uint64_t logId() const { return log_id_.load(); }
+
+ private:
+  void receiveLoop();
+
+  // Connect and send the hello; -1 on failure.
+  int connectToPrimary();
+
+  // Consume frames until the connection drops or the handler rejects one.
+  void follow(int socket);
+
+  Config config_;
+  Handler handler_;
+
+  std::atomic<bool> running_{false};
+  std::atomic<bool> connected_{false};
+  std::atomic<uint64_t> applied_sequence_{0};
+  std::atomic<uint64_t> log_id_{0};
+  std::unique_ptr<std::thread> receive_thread_;
+
+  std::mutex socket_mutex_;  // Lets stop() shut the socket down under the receive thread
+  std::condition_variable stopped_;  // Cuts the reconnect wait short
+  int socket_ = -1;
+};
+
+}  // namespace replication
+}  // namespace banking
+
+#endif  // REPLICATION_SUBSCRIBER_HPP_
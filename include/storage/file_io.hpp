@@ -0,0 +1,49 @@
+#ifndef STORAGE_FILE_IO_HPP_
+#define STORAGE_FILE_IO_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace banking {
+namespace storage {
+
+/**
+ * CRC-32 (IEEE) of `length` bytes, continuing from `crc` to checksum data in pieces.
+ */
+uint32_t crc32(const void* data, size_t length, uint32_t crc = 0);
+
+/**
+ * `<prefix><number, zero-padded to 20 digits><suffix>`, so names sort numerically.
+ */
+std::string numberedFileName(const std::string& prefix, uint64_t number, const std::string& suffix);
+
+/**
+ * Files in `directory` named by numberedFileName() with `prefix` and `suffix`,
+ * as (number, path) in ascending number order.
+ */
+std::vector<std::pair<uint64_t, std::string>> listNumberedFiles(const std::string& directory,
+                                                               const std::string& prefix,
+                                                               const std::string& suffix);
+
+/**
+ * Create `directory` (and its parents) if it does not exist.
+ */
+bool ensureDirectory(const std::string& directory);
+
+/**
+ * fsync the directory itself, so file creations, renames and removals in it survive a crash.
+ */
+bool syncDirectory(const std::string& directory);
+
+/**
+ * write() all of `data`, retrying short writes and EINTR.
+ */
+bool writeAll(int fd, const char* data, size_t length);
+
+}  // namespace storage
+}  // namespace banking
+
+#endif  // STORAGE_FILE_IO_HPP_
@@ -0,0 +1,67 @@
+#ifndef SNAPSHOT_FILE_HPP_
+#define SNAPSHOT_FILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace banking {
+namespace storage {
+
+/**
+ * A read-only, memory-mapped snapshot `snapshot-<wal sequence>.snap`.
+ *
+ * The file is a 64-byte header (magic, version, WAL sequence, body size and
+ * body crc32) followed by the body, which starts 64-byte aligned so callers
+ * can lay fixed-size records out in it and read them in place. Snapshots are
+ * written to a temporary file, fsynced and renamed, so a crash leaves either
+ * the old snapshot or the complete new one.
+ */
+class SnapshotFile {
+ public:
+  ~SnapshotFile();
+
+  // Movable, non-copyable
+  SnapshotFile(SnapshotFile&& other) noexcept;
+  SnapshotFile& operator=(SnapshotFile&& other) noexcept;
+  SnapshotFile(const SnapshotFile&) = delete;
+  SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+  /**
+   * Durably write a snapshot covering the WAL up to `wal_sequence`.
+   */
+  static bool write(const std::string& directory, uint64_t wal_sequence, const std::string& body);
+
+  /**
+   * Map the newest snapshot in `directory` whose header and checksum are
+   * valid, or nullopt if there is none.
+   */
+  static std::optional<SnapshotFile> latest(const std::string& directory);
+
+  /**
+   * Delete snapshots older than `wal_sequence` and leftover temporary files.
+   */
+  static void removeOlderThan(const std::string& directory, uint64_t wal_sequence);
+
+  uint64_t walSequence() const { return wal_sequence_; }
+  const char* data() const;
+  size_t size() const { return body_size_; }
+  const std::string& path() const { return path_; }
+
+ private:
+  SnapshotFile() = default;
+
+  static std::optional<SnapshotFile> map(const std::string& path);
+
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  size_t body_size_ = 0;
+  uint64_t wal_sequence_ = 0;
+  std::string path_;
+};
+
+}  // namespace storage
+}  // namespace banking
+
+#endif  // SNAPSHOT_FILE_HPP_
@@ -0,0 +1,133 @@
+#ifndef WRITE_AHEAD_LOG_HPP_
+#define WRITE_AHEAD_LOG_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace banking {
+namespace storage {
+
+/**
+ * Append-only log of opaque records with group fsync.
+ *
+ * Every record gets the next sequence number and is framed as
+ * [length][crc32][sequence][payload], so a torn or corrupt tail is detected on
+ * replay and cut off. append() only copies the frame into a buffer; a syncer
+ * thread writes whatever accumulated within `sync_interval` (or as soon as
+ * `max_buffered_bytes` are waiting) and makes it durable with one fdatasync.
+ *
+ * The log is a series of segment files `wal-<first sequence>.log` in one
+ * directory. rotate() starts a new segment, so segments whose records are all
+ * covered by a snapshot can be deleted whole.
+ */
+class WriteAheadLog {
+ public:
+  struct Config {
+    std::string directory = "wal";
+    std::chrono::microseconds sync_interval{1000};
+    size_t max_buffered_bytes = 1024 * 1024;
+  };
+
+  struct Stats {
+    uint64_t records_appended = 0;
+    uint64_t bytes_appended = 0;
+    uint64_t syncs = 0;
+    uint64_t durable_sequence = 0;
+    bool failed = false;
+    std::chrono::microseconds last_sync_duration{0};
+  };
+
+  using RecordCallback = std::function<void(uint64_t sequence, const std::string& payload)>;
+
+  explicit WriteAheadLog(const Config& config);
+  ~WriteAheadLog();
+
+  // Non-copyable
+  WriteAheadLog(const WriteAheadLog&) = delete;
+  WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+  /**
+   * Hand every record after `after_sequence` to `apply`, oldest first, before
+   * open(). A torn tail on the last segment is truncated away. Returns the last
+   * sequence in the log (at least `after_sequence`), or nullopt if records are
+   * missing or corrupt anywhere else.
+   */
+  std::optional<uint64_t> replay(uint64_t after_sequence, const RecordCallback& apply);
+
+  /**
+   * Start a segment whose first record gets `next_sequence`, and the syncer thread.
+   */
+  bool open(uint64_t next_sequence);
+
+  /**
+   * Make everything appended durable and stop the syncer thread.
+   */
+  void close();
+
+  /**
+   * Buffer one record and return its sequence; 0 if the log is closed or has failed.
+   */
+  uint64_t append(const std::string& payload);
+
+  /**
+   * Block until the record with `sequence` is on disk; false if it never will be.
+   */
+  bool waitDurable(uint64_t sequence);
+
+  /**
+   * Write and fdatasync everything appended so far.
+   */
+  bool sync();
+
+  /**
+   * Sync, then continue in a new segment starting at the next sequence.
+   */
+  bool rotate();
+
+  /**
+   * Delete the segments that hold nothing after `sequence`. The current segment is kept.
+   */
+  void removeSegmentsThrough(uint64_t sequence);
+
+  uint64_t lastSequence() const;
+  Stats getStats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void syncerLoop();
+
+  // Write out the buffer and sync the current segment; requires io_mutex_.
+  // `next_sequence`, if given, receives the first sequence not in what was written.
+  bool writeBuffered(uint64_t* next_sequence = nullptr);
+
+  int openSegment(uint64_t first_sequence);
+
+  Config config_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;     // Syncer: records buffered or closing
+  std::condition_variable durable_cv_;  // Waiters: durable sequence advanced or failed
+  std::string buffer_;
+  Clock::time_point oldest_buffered_;
+  uint64_t next_sequence_ = 1;
+  bool running_ = false;
+  bool stopping_ = false;
+  Stats stats_;
+
+  std::mutex io_mutex_;  // The segment file: one write+sync or rotation at a time
+  int fd_ = -1;
+  std::thread syncer_;
+};
+
+}  // namespace storage
+}  // namespace banking
+
+#endif  // WRITE_AHEAD_LOG_HPP_
@@ -1,9 +1,12 @@
 #include "include/banking_server.hpp"
 #include "include/banking_system_persistent.hpp"
+#include "include/banking_system_primary.hpp"
+#include "include/banking_system_replica.hpp"
 
 #include <iostream>
 #include <csignal>
 #include <atomic>
+#include <vector>
 
 std::atomic<bool> running{true};
 
@@ -24,6 +27,31 @@ int main(int argc, char* argv[]) {
   std::string db_username = "banking_user";
   std::string db_password = "";
 
+  // Replication role flags may appear anywhere and are removed before the positional arguments:
+  //   --replicate=PORT       stream the operation log to followers connecting on PORT
+  //   --follow=IP:PORT       serve GET_BALANCE/TOP_SPENDERS replicated from a primary
+  // and so may the placement flag:
+  //   --shard-per-core       pin one reactor and one fraud worker per NUMA node and a
+  //                          processor worker with its own engine shard to every other CPU
+  int replicate_port = 0;
+  std::string follow;
+  bool shard_per_core = false;
+  std::vector<char*> positional = {argv[0]};
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--replicate=", 0) == 0) {
+      replicate_port = std::stoi(arg.substr(12));
+    } else if (arg.rfind("--follow=", 0) == 0) {
+      follow = arg.substr(9);
+    } else if (arg == "--shard-per-core") {
+      shard_per_core = true;
+    } else {
+      positional.push_back(argv[i]);
+    }
+  }
+  argc = static_cast<int>(positional.size());
+  argv = positional.data();
+
   // Parse command line arguments
   if (argc >= 2) port = std::stoi(argv[1]);
   if (argc >= 3) num_workers = std::stoul(argv[2]);
@@ -49,9 +77,44 @@ int main(int argc, char* argv[]) {
     // Determine if we should use persistent storage
     bool use_database = !db_host.empty() && !db_username.empty();
 
+    banking::BankingServer::Config server_config{port, num_workers, analysis_window, {}, {}};
+    if (shard_per_core) {
+      const auto topology = banking::concurrent::CpuTopology::detect();
+      server_config.placement = banking::concurrent::ThreadPlacement::shardPerCore(
+          topology, topology.nodes.size(), topology.nodes.size());
+      std::cout << "Shard-per-core on " << topology.describe() << std::endl;
+    }
+
     std::unique_ptr<banking::BankingServer> server;
 
-    if (use_database) {
+    if (!follow.empty()) {
+      const size_t colon = follow.rfind(':');
+      if (colon == std::string::npos) {
+        std::cerr << "--follow expects IP:PORT" << std::endl;
+        return 1;
+      }
+      banking::BankingSystemReplica::Config replica_config;
+      replica_config.primary.primary_host = follow.substr(0, colon);
+      replica_config.primary.primary_port = std::stoi(follow.substr(colon + 1));
+
+      std::cout << "Following primary at " << follow << " (read-only)..." << std::endl;
+      auto replica = std::make_unique<banking::BankingSystemReplica>(replica_config);
+      replica->start();
+      banking::BankingSystemReplica* replica_state = replica.get();
+      server = std::make_unique<banking::BankingServer>(server_config, std::move(replica));
+      server->setReadOnly([replica_state] { return replica_state->isFresh(); });
+    } else if (replicate_port > 0) {
+      banking::replication::ReplicationPublisher::Config publisher_config;
+      publisher_config.port = replicate_port;
+
+      std::cout << "Initializing in-memory primary replicating on port " << replicate_port << "..." << std::endl;
+      auto primary = std::make_unique<banking::BankingSystemPrimary>(publisher_config);
+      if (!primary->start()) {
+        std::cerr << "Failed to start replication publisher" << std::endl;
+        return 1;
+      }
+      server = std::make_unique<banking::BankingServer>(server_config, std::move(primary));
+    } else if (use_database) {
       // Use persistent banking system with PostgreSQL
       banking::BankingSystemPersistent::Config db_config{
         db_host, db_port, db_name, db_username, db_password
@@ -67,12 +130,11 @@ int main(int argc, char* argv[]) {
 
       // Wrap persistent system in thread-safe wrapper
       auto thread_safe_system = std::make_unique<banking::BankingSystemThreadSafe>(std::move(persistent_system));
-      server = std::make_unique<banking::BankingServer>(port, num_workers, analysis_window,
-                                                       std::move(thread_safe_system));
+      server = std::make_unique<banking::BankingServer>(server_config, std::move(thread_safe_system));
     } else {
       // Use in-memory system only
       std::cout << "Initializing with in-memory storage only..." << std::endl;
-      server = std::make_unique<banking::BankingServer>(port, num_workers, analysis_window);
+      server = std::make_unique<banking::BankingServer>(server_config);
     }
 
     if (!server->start()) {
@@ -86,20 +148,27 @@ int main(int argc, char* argv[]) {
     // Main server loop
     while (running) {
       std::this_thread::sleep_for(std::chrono::seconds(5));
+      server->reclaimEngineMemory();
 
       // Print statistics every 5 seconds
-      auto stats = server.getStats();
+      auto stats = server->getStats();
       std::cout << "\n--- Server Statistics ---" << std::endl;
       std::cout << "Active connections: " << stats.active_connections << std::endl;
       std::cout << "Transactions processed: " << stats.transaction_stats.transactions_processed << std::endl;
       std::cout << "Transactions in queue: " << stats.transaction_stats.transactions_queued << std::endl;
       std::cout << "Avg processing time: " << stats.transaction_stats.avg_processing_time_ms << " ms" << std::endl;
+      std::cout << "Throughput: " << stats.transaction_stats.throughput_tps << " TPS" << std::endl;
+      for (const auto& latency : stats.request_latency) {
+        std::cout << banking::network::protocol::messageTypeName(latency.type) << " latency (us): p50 "
+                  << latency.total.p50_us << ", p99 " << latency.total.p99_us << ", p99.9 "
+                  << latency.total.p999_us << ", max " << latency.total.max_us << std::endl;
+      }
       std::cout << "Fraud alerts generated: " << stats.fraud_stats.fraud_alerts_generated << std::endl;
       std::cout << "Avg fraud risk score: " << stats.fraud_stats.average_risk_score << std::endl;
       std::cout << "-----------------------" << std::endl;
     }
 
-    server.stop();
+    server->stop();
 
   } catch (const std::exception& e) {
     std::cerr << "Server error: " << e.what() << std::endl;
@@ -0,0 +1,382 @@
+#include "binary_codec.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace banking {
+namespace network {
+namespace protocol {
+
+namespace {
+
+using F = RequestField;
+
+constexpr RequestField kCreateAccountFields[] = {F::ACCOUNT_ID};
+constexpr RequestField kDepositFields[] = {F::ACCOUNT_ID, F::AMOUNT};
+constexpr RequestField kTransferFields[] = {F::SOURCE_ACCOUNT, F::TARGET_ACCOUNT, F::AMOUNT};
+constexpr RequestField kGetBalanceFields[] = {F::ACCOUNT_ID, F::TIME_AT};
+constexpr RequestField kTopSpendersFields[] = {F::N};
+constexpr RequestField kSchedulePaymentFields[] = {F::ACCOUNT_ID, F::AMOUNT, F::DELAY};
+constexpr RequestField kCancelPaymentFields[] = {F::ACCOUNT_ID, F::PAYMENT_ID};
+constexpr RequestField kMergeAccountsFields[] = {F::ACCOUNT_ID_1, F::ACCOUNT_ID_2};
+constexpr RequestField kAuthenticateFields[] = {F::USERNAME, F::PASSWORD};
+constexpr RequestField kBatchFields[] = {F::OPERATIONS};
+
+template <size_t N>
+constexpr RequestSchema schemaOf(const RequestField (&fields)[N]) {
+  return RequestSchema{fields, N};
+}
+
+// Indexed by MessageType.
+const RequestSchema kSchemas[] = {
+    schemaOf(kCreateAccountFields),     // CREATE_ACCOUNT
+    schemaOf(kDepositFields),           // DEPOSIT
+    schemaOf(kTransferFields),          // TRANSFER
+    schemaOf(kGetBalanceFields),        // GET_BALANCE
+    schemaOf(kTopSpendersFields),       // TOP_SPENDERS
+    schemaOf(kSchedulePaymentFields),   // SCHEDULE_PAYMENT
+    schemaOf(kCancelPaymentFields),     // CANCEL_PAYMENT
+    schemaOf(kMergeAccountsFields),     // MERGE_ACCOUNTS
+    schemaOf(kAuthenticateFields),      // AUTHENTICATE
+    RequestSchema{nullptr, 0},          // HEARTBEAT
+    RequestSchema{nullptr, 0},          // ERROR
+    schemaOf(kBatchFields),             // BATCH
+};
+
+constexpr size_t kNumMessageTypes = sizeof(kSchemas) / sizeof(kSchemas[0]);
+
+// Response presence bits
+constexpr uint8_t kHasAccountId = 1 << 0;
+constexpr uint8_t kHasBalance = 1 << 1;
+constexpr uint8_t kHasSourceBalance = 1 << 2;
+constexpr uint8_t kHasPaymentId = 1 << 3;
+constexpr uint8_t kHasSessionToken = 1 << 4;
+constexpr uint8_t kHasSpenders = 1 << 5;
+constexpr uint8_t kHasResults = 1 << 6;
+
+/**
+ * Apply `fn` to the member of `request` named by `field`. Works for both
+ * Request and RequestView, which share member names.
+ */
+template <typename R, typename Fn>
+void visitField(R& request, RequestField field, Fn&& fn) {
+  switch (field) {
+    case F::ACCOUNT_ID: fn(request.account_id); break;
+    case F::SOURCE_ACCOUNT: fn(request.source_account); break;
+    case F::TARGET_ACCOUNT: fn(request.target_account); break;
+    case F::ACCOUNT_ID_1: fn(request.account_id_1); break;
+    case F::ACCOUNT_ID_2: fn(request.account_id_2); break;
+    case F::PAYMENT_ID: fn(request.payment_id); break;
+    case F::USERNAME: fn(request.username); break;
+    case F::PASSWORD: fn(request.password); break;
+    case F::AMOUNT: fn(request.amount); break;
+    case F::TIME_AT: fn(request.time_at); break;
+    case F::N: fn(request.n); break;
+    case F::DELAY: fn(request.delay); break;
+    case F::OPERATIONS: fn(request.operations); break;
+  }
+}
+
+void writeInt(std::string& out, int value) {
+  uint32_t v = static_cast<uint32_t>(value);
+  char bytes[4] = {
+      static_cast<char>(v & 0xFF),
+      static_cast<char>((v >> 8) & 0xFF),
+      static_cast<char>((v >> 16) & 0xFF),
+      static_cast<char>((v >> 24) & 0xFF)};
+  out.append(bytes, sizeof(bytes));
+}
+
+void writeVarint(std::string& out, size_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void writeString(std::string& out, std::string_view value) {
+  writeVarint(out, value.size());
+  out.append(value.data(), value.size());
+}
+
+/**
+ * Bounds-checked cursor over an encoded message.
+ */
+class Reader {
+ public:
+  explicit Reader(std::string_view bytes) : bytes_(bytes), pos_(0) {}
+
+  uint8_t readByte() {
+    require(1);
+    return static_cast<uint8_t>(bytes_[pos_++]);
+  }
+
+  int readInt() {
+    require(4);
+    const auto* b = reinterpret_cast<const unsigned char*>(bytes_.data() + pos_);
+    pos_ += 4;
+    return static_cast<int>(static_cast<uint32_t>(b[0]) |
+                            (static_cast<uint32_t>(b[1]) << 8) |
+                            (static_cast<uint32_t>(b[2]) << 16) |
+                            (static_cast<uint32_t>(b[3]) << 24));
+  }
+
+  size_t readVarint() {
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+      if (shift > 28) throw std::runtime_error("Malformed binary message: bad length");
+      uint8_t byte = readByte();
+      value |= static_cast<size_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) return value;
+    }
+  }
+
+  std::string_view readString() {
+    size_t length = readVarint();
+    require(length);
+    std::string_view value = bytes_.substr(pos_, length);
+    pos_ += length;
+    return value;
+  }
+
+  size_t remaining() const { return bytes_.size() - pos_; }
+
+  void read(std::string_view& value) { value = readString(); }
+  void read(int& value) { value = readInt(); }
+
+ private:
+  void require(size_t n) const {
+    if (bytes_.size() - pos_ < n) {
+      throw std::runtime_error("Malformed binary message: truncated");
+    }
+  }
+
+  std::string_view bytes_;
+  size_t pos_;
+};
+
+void encodeRequestFields(const Request& request, std::string& out);
+
+void encodeOperations(const std::vector<Request>& operations, std::string& out) {
+  writeVarint(out, operations.size());
+  for (const auto& op : operations) {
+    if (op.type == MessageType::BATCH) {
+      throw std::runtime_error("Nested batches are not supported");
+    }
+    out.push_back(static_cast<char>(op.type));
+    writeInt(out, op.timestamp);
+    encodeRequestFields(op, out);
+  }
+}
+
+void encodeRequestFields(const Request& request, std::string& out) {
+  auto write_field = [&out](const auto& value) {
+    using T = std::decay_t<decltype(value)>;
+    if constexpr (std::is_same_v<T, int>) {
+      writeInt(out, value);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      writeString(out, value);
+    } else {
+      encodeOperations(value, out);
+    }
+  };
+  for (RequestField field : requestSchema(request.type)) {
+    visitField(request, field, write_field);
+  }
+}
+
+void decodeRequestFields(Reader& reader, RequestView& view, bool nested) {
+  auto read_field = [&reader, nested](auto& value) {
+    using T = std::decay_t<decltype(value)>;
+    if constexpr (std::is_same_v<T, std::vector<RequestView>>) {
+      if (nested) throw std::runtime_error("Nested batches are not supported");
+      size_t count = reader.readVarint();
+      // Each operation takes at least 5 bytes, which bounds the reservation
+      value.reserve(std::min(count, reader.remaining() / 5));
+      for (size_t i = 0; i < count; ++i) {
+        RequestView op;
+        op.type = static_cast<MessageType>(reader.readByte());
+        op.timestamp = reader.readInt();
+        decodeRequestFields(reader, op, true);
+        value.push_back(std::move(op));
+      }
+    } else {
+      reader.read(value);
+    }
+  };
+  for (RequestField field : requestSchema(view.type)) {
+    visitField(view, field, read_field);
+  }
+}
+
+void encodeResponseBody(const Response& response, std::string& out) {
+  out.push_back(static_cast<char>(response.status));
+  writeInt(out, response.timestamp);
+  writeString(out, response.message);
+
+  uint8_t presence = 0;
+  if (response.account_id) presence |= kHasAccountId;
+  if (response.balance) presence |= kHasBalance;
+  if (response.source_balance) presence |= kHasSourceBalance;
+  if (response.payment_id) presence |= kHasPaymentId;
+  if (response.session_token) presence |= kHasSessionToken;
+  if (response.spenders) presence |= kHasSpenders;
+  if (response.results) presence |= kHasResults;
+  out.push_back(static_cast<char>(presence));
+
+  if (response.account_id) writeString(out, *response.account_id);
+  if (response.balance) writeInt(out, *response.balance);
+  if (response.source_balance) writeInt(out, *response.source_balance);
+  if (response.payment_id) writeString(out, *response.payment_id);
+  if (response.session_token) writeString(out, *response.session_token);
+  if (response.spenders) {
+    writeVarint(out, response.spenders->size());
+    for (const auto& spender : *response.spenders) {
+      writeString(out, spender);
+    }
+  }
+  if (response.results) {
+    writeVarint(out, response.results->size());
+    for (const auto& result : *response.results) {
+      encodeResponseBody(result, out);
+    }
+  }
+}
+
+Response decodeResponseBody(Reader& reader, size_t max_items) {
+  Response response;
+  response.status = static_cast<Status>(reader.readByte());
+  response.timestamp = reader.readInt();
+  response.message = std::string(reader.readString());
+
+  uint8_t presence = reader.readByte();
+  if (presence & kHasAccountId) response.account_id = std::string(reader.readString());
+  if (presence & kHasBalance) response.balance = reader.readInt();
+  if (presence & kHasSourceBalance) response.source_balance = reader.readInt();
+  if (presence & kHasPaymentId) response.payment_id = std::string(reader.readString());
+  if (presence & kHasSessionToken) response.session_token = std::string(reader.readString());
+  if (presence & kHasSpenders) {
+    std::vector<std::string> spenders;
+    size_t count = reader.readVarint();
+    spenders.reserve(std::min(count, max_items));
+    for (size_t i = 0; i < count; ++i) {
+      spenders.emplace_back(reader.readString());
+    }
+    response.spenders = std::move(spenders);
+  }
+  if (presence & kHasResults) {
+    std::vector<Response> results;
+    size_t count = reader.readVarint();
+    results.reserve(std::min(count, max_items));
+    for (size_t i = 0; i < count; ++i) {
+      results.push_back(decodeResponseBody(reader, max_items));
+    }
+    response.results = std::move(results);
+  }
+  return response;
+}
+
+}  // namespace
+
+const RequestSchema& requestSchema(MessageType type) {
+  size_t index = static_cast<size_t>(type);
+  if (index >= kNumMessageTypes) {
+    throw std::runtime_error("Unknown message type");
+  }
+  return kSchemas[index];
+}
+
+const char* requestFieldName(RequestField field) {
+  switch (field) {
+    case F::ACCOUNT_ID: return "account_id";
+    case F::SOURCE_ACCOUNT: return "source_account";
+    case F::TARGET_ACCOUNT: return "target_account";
+    case F::ACCOUNT_ID_1: return "account_id_1";
+    case F::ACCOUNT_ID_2: return "account_id_2";
+    case F::PAYMENT_ID: return "payment_id";
+    case F::USERNAME: return "username";
+    case F::PASSWORD: return "password";
+    case F::AMOUNT: return "amount";
+    case F::TIME_AT: return "time_at";
+    case F::N: return "n";
+    case F::DELAY: return "delay";
+    case F::OPERATIONS: return "operations";
+  }
+  return "";
+}
+
+Request RequestView::materialize() const {
+  Request request;
+  request.type = type;
+  request.timestamp = timestamp;
+  request.client_id = std::string(client_id);
+  request.session_token = std::string(session_token);
+  request.idempotency_key = std::string(idempotency_key);
+  request.account_id = std::string(account_id);
+  request.source_account = std::string(source_account);
+  request.target_account = std::string(target_account);
+  request.account_id_1 = std::string(account_id_1);
+  request.account_id_2 = std::string(account_id_2);
+  request.payment_id = std::string(payment_id);
+  request.username = std::string(username);
+  request.password = std::string(password);
+  request.amount = amount;
+  request.time_at = time_at;
+  request.n = n;
+  request.delay = delay;
+  request.operations.reserve(operations.size());
+  for (const auto& op : operations) {
+    request.operations.push_back(op.materialize());
+  }
+  return request;
+}
+
+bool BinaryCodec::isBinary(std::string_view bytes) {
+  return !bytes.empty() && (bytes[0] == kRequestMagic || bytes[0] == kResponseMagic);
+}
+
+void BinaryCodec::encodeRequest(const Request& request, std::string& out) {
+  out.push_back(kRequestMagic);
+  out.push_back(static_cast<char>(request.type));
+  writeInt(out, request.timestamp);
+  writeString(out, request.client_id);
+  writeString(out, request.session_token);
+  encodeRequestFields(request, out);
+  if (!request.idempotency_key.empty()) writeString(out, request.idempotency_key);
+}
+
+RequestView BinaryCodec::decodeRequest(std::string_view bytes) {
+  Reader reader(bytes);
+  if (static_cast<char>(reader.readByte()) != kRequestMagic) {
+    throw std::runtime_error("Not a binary request");
+  }
+
+  RequestView view;
+  view.type = static_cast<MessageType>(reader.readByte());
+  view.timestamp = reader.readInt();
+  view.client_id = reader.readString();
+  view.session_token = reader.readString();
+  decodeRequestFields(reader, view, false);
+  if (reader.remaining() > 0) view.idempotency_key = reader.readString();
+  return view;
+}
+
+void BinaryCodec::encodeResponse(const Response& response, std::string& out) {
+  out.push_back(kResponseMagic);
+  encodeResponseBody(response, out);
+}
+
+Response BinaryCodec::decodeResponse(std::string_view bytes) {
+  Reader reader(bytes);
+  if (static_cast<char>(reader.readByte()) != kResponseMagic) {
+    throw std::runtime_error("Not a binary response");
+  }
+  return decodeResponseBody(reader, bytes.size());
+}
+
+}  // namespace protocol
+}  // namespace network
+}  // namespace banking
@@ -1,12 +1,25 @@
 #include "protocol.hpp"
+#include "binary_codec.hpp"
 
-#include <iomanip>
-#include <sstream>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 
 namespace banking {
 namespace network {
 namespace protocol {
 
+const char* messageTypeName(MessageType type) {
+  static const char* const kNames[kMessageTypeCount] = {
+      "CREATE_ACCOUNT", "DEPOSIT",        "TRANSFER",       "GET_BALANCE",
+      "TOP_SPENDERS",   "SCHEDULE_PAYMENT", "CANCEL_PAYMENT", "MERGE_ACCOUNTS",
+      "AUTHENTICATE",   "HEARTBEAT",      "ERROR",          "BATCH"};
+  const size_t index = static_cast<size_t>(type);
+  return index < kMessageTypeCount ? kNames[index] : "UNKNOWN";
+}
+
 // Request helper methods
 Request Request::createAccount(int timestamp, const std::string& client_id,
                               const std::string& session_token,
@@ -16,7 +29,7 @@ Request Request::createAccount(int timestamp, const std::string& client_id,
   req.timestamp = timestamp;
   req.client_id = client_id;
   req.session_token = session_token;
-  req.payload["account_id"] = account_id;
+  req.account_id = account_id;
   return req;
 }
 
@@ -28,8 +41,8 @@ Request Request::deposit(int timestamp, const std::string& client_id,
   req.timestamp = timestamp;
   req.client_id = client_id;
   req.session_token = session_token;
-  req.payload["account_id"] = account_id;
-  req.payload["amount"] = amount;
+  req.account_id = account_id;
+  req.amount = amount;
   return req;
 }
 
@@ -42,9 +55,9 @@ Request Request::transfer(int timestamp, const std::string& client_id,
   req.timestamp = timestamp;
   req.client_id = client_id;
   req.session_token = session_token;
-  req.payload["source_account"] = source_account;
-  req.payload["target_account"] = target_account;
-  req.payload["amount"] = amount;
+  req.source_account = source_account;
+  req.target_account = target_account;
+  req.amount = amount;
   return req;
 }
 
@@ -56,8 +69,8 @@ Request Request::getBalance(int timestamp, const std::string& client_id,
   req.timestamp = timestamp;
   req.client_id = client_id;
   req.session_token = session_token;
-  req.payload["account_id"] = account_id;
-  req.payload["time_at"] = time_at;
+  req.account_id = account_id;
+  req.time_at = time_at;
   return req;
 }
 
@@ -68,7 +81,7 @@ Request Request::topSpenders(int timestamp, const std::string& client_id,
   req.timestamp = timestamp;
   req.client_id = client_id;
   req.session_token = session_token;
-  req.payload["n"] = n;
+  req.n = n;
   return req;
 }
 
@@ -80,9 +93,9 @@ Request Request::schedulePayment(int timestamp, const std::string& client_id,
   req.timestamp = timestamp;
   req.client_id = client_id;
   req.session_token = session_token;
-  req.payload["account_id"] = account_id;
-  req.payload["amount"] = amount;
-  req.payload["delay"] = delay;
+  req.account_id = account_id;
+  req.amount = amount;
+  req.delay = delay;
   return req;
 }
 
@@ -94,8 +107,8 @@ Request Request::cancelPayment(int timestamp, const std::string& client_id,
   req.timestamp = timestamp;
   req.client_id = client_id;
   req.session_token = session_token;
-  req.payload["account_id"] = account_id;
-  req.payload["payment_id"] = payment_id;
+  req.account_id = account_id;
+  req.payment_id = payment_id;
   return req;
 }
 
@@ -108,8 +121,8 @@ Request Request::mergeAccounts(int timestamp, const std::string& client_id,
   req.timestamp = timestamp;
   req.client_id = client_id;
   req.session_token = session_token;
-  req.payload["account_id_1"] = account_id_1;
-  req.payload["account_id_2"] = account_id_2;
+  req.account_id_1 = account_id_1;
+  req.account_id_2 = account_id_2;
   return req;
 }
 
@@ -120,8 +133,8 @@ Request Request::authenticate(int timestamp, const std::string& username,
   req.timestamp = timestamp;
   req.client_id = "";
   req.session_token = "";
-  req.payload["username"] = username;
-  req.payload["password"] = password;
+  req.username = username;
+  req.password = password;
   return req;
 }
 
@@ -131,18 +144,27 @@ Request Request::heartbeat(int timestamp, const std::string& client_id) {
   req.timestamp = timestamp;
   req.client_id = client_id;
   req.session_token = "";
-  req.payload = nlohmann::json::object();
+  return req;
+}
+
+Request Request::batch(int timestamp, const std::string& client_id,
+                       const std::string& session_token,
+                       std::vector<Request> operations) {
+  Request req;
+  req.type = MessageType::BATCH;
+  req.timestamp = timestamp;
+  req.client_id = client_id;
+  req.session_token = session_token;
+  req.operations = std::move(operations);
   return req;
 }
 
 // Response helper methods
-Response Response::success(const std::string& message, int timestamp,
-                          const nlohmann::json& payload) {
+Response Response::success(const std::string& message, int timestamp) {
   Response resp;
   resp.status = Status::SUCCESS;
   resp.message = message;
   resp.timestamp = timestamp;
-  resp.payload = payload;
   return resp;
 }
 
@@ -151,44 +173,43 @@ Response Response::error(Status status, const std::string& message, int timestam
   resp.status = status;
   resp.message = message;
   resp.timestamp = timestamp;
-  resp.payload = nlohmann::json::object();
   return resp;
 }
 
 Response Response::accountCreated(const std::string& account_id, int timestamp) {
-  nlohmann::json payload;
-  payload["account_id"] = account_id;
-  return success("Account created successfully", timestamp, payload);
+  Response resp = success("Account created successfully", timestamp);
+  resp.account_id = account_id;
+  return resp;
 }
 
 Response Response::depositResult(int new_balance, int timestamp) {
-  nlohmann::json payload;
-  payload["balance"] = new_balance;
-  return success("Deposit successful", timestamp, payload);
+  Response resp = success("Deposit successful", timestamp);
+  resp.balance = new_balance;
+  return resp;
 }
 
 Response Response::transferResult(int new_source_balance, int timestamp) {
-  nlohmann::json payload;
-  payload["source_balance"] = new_source_balance;
-  return success("Transfer successful", timestamp, payload);
+  Response resp = success("Transfer successful", timestamp);
+  resp.source_balance = new_source_balance;
+  return resp;
 }
 
 Response Response::balanceResult(int balance, int timestamp) {
-  nlohmann::json payload;
-  payload["balance"] = balance;
-  return success("Balance retrieved", timestamp, payload);
+  Response resp = success("Balance retrieved", timestamp);
+  resp.balance = balance;
+  return resp;
 }
 
 Response Response::topSpendersResult(const std::vector<std::string>& spenders, int timestamp) {
-  nlohmann::json payload;
-  payload["spenders"] = spenders;
-  return success("Top spenders retrieved", timestamp, payload);
+  Response resp = success("Top spenders retrieved", timestamp);
+  resp.spenders = spenders;
+  return resp;
 }
 
 Response Response::paymentScheduled(const std::string& payment_id, int timestamp) {
-  nlohmann::json payload;
-  payload["payment_id"] = payment_id;
-  return success("Payment scheduled", timestamp, payload);
+  Response resp = success("Payment scheduled", timestamp);
+  resp.payment_id = payment_id;
+  return resp;
 }
 
 Response Response::paymentCancelled(int timestamp) {
@@ -200,84 +221,472 @@ Response Response::accountsMerged(int timestamp) {
 }
 
 Response Response::authenticated(const std::string& session_token, int timestamp) {
-  nlohmann::json payload;
-  payload["session_token"] = session_token;
-  return success("Authentication successful", timestamp, payload);
+  Response resp = success("Authentication successful", timestamp);
+  resp.session_token = session_token;
+  return resp;
+}
+
+Response Response::batchResult(std::vector<Response> results, int timestamp) {
+  Response resp = success("Batch processed", timestamp);
+  resp.results = std::move(results);
+  return resp;
 }
 
 // Serialization functions
-std::string serializeRequest(const Request& request) {
+namespace {
+
+int jsonInt(const nlohmann::json& value) {
+  // Accept numbers encoded as strings from older clients.
+  return value.is_string() ? std::stoi(value.get<std::string>()) : value.get<int>();
+}
+
+nlohmann::json requestToJson(const Request& request) {
+  nlohmann::json payload = nlohmann::json::object();
+  for (RequestField field : requestSchema(request.type)) {
+    const char* name = requestFieldName(field);
+    switch (field) {
+      case RequestField::ACCOUNT_ID: payload[name] = request.account_id; break;
+      case RequestField::SOURCE_ACCOUNT: payload[name] = request.source_account; break;
+      case RequestField::TARGET_ACCOUNT: payload[name] = request.target_account; break;
+      case RequestField::ACCOUNT_ID_1: payload[name] = request.account_id_1; break;
+      case RequestField::ACCOUNT_ID_2: payload[name] = request.account_id_2; break;
+      case RequestField::PAYMENT_ID: payload[name] = request.payment_id; break;
+      case RequestField::USERNAME: payload[name] = request.username; break;
+      case RequestField::PASSWORD: payload[name] = request.password; break;
+      case RequestField::AMOUNT: payload[name] = request.amount; break;
+      case RequestField::TIME_AT: payload[name] = request.time_at; break;
+      case RequestField::N: payload[name] = request.n; break;
+      case RequestField::DELAY: payload[name] = request.delay; break;
+      case RequestField::OPERATIONS: {
+        nlohmann::json operations = nlohmann::json::array();
+        for (const auto& op : request.operations) {
+          operations.push_back(requestToJson(op));
+        }
+        payload[name] = std::move(operations);
+        break;
+      }
+    }
+  }
+
   nlohmann::json j;
   j["type"] = static_cast<int>(request.type);
   j["timestamp"] = request.timestamp;
   j["client_id"] = request.client_id;
   j["session_token"] = request.session_token;
-  j["payload"] = request.payload;
-  return j.dump();
+  if (!request.idempotency_key.empty()) j["idempotency_key"] = request.idempotency_key;
+  j["payload"] = std::move(payload);
+  return j;
 }
 
-Request deserializeRequest(const std::string& json_str) {
-  nlohmann::json j = nlohmann::json::parse(json_str);
+Request requestFromJson(const nlohmann::json& j, bool nested) {
   Request req;
-  req.type = static_cast<MessageType>(j["type"].get<int>());
-  req.timestamp = j["timestamp"];
-  req.client_id = j["client_id"];
-  req.session_token = j["session_token"];
-  req.payload = j["payload"];
+  req.type = static_cast<MessageType>(j.at("type").get<int>());
+  req.timestamp = j.value("timestamp", 0);
+  req.client_id = j.value("client_id", "");
+  req.session_token = j.value("session_token", "");
+  req.idempotency_key = j.value("idempotency_key", "");
+
+  auto payload_it = j.find("payload");
+  if (payload_it == j.end() || !payload_it->is_object()) return req;
+  const nlohmann::json& payload = *payload_it;
+
+  for (RequestField field : requestSchema(req.type)) {
+    auto it = payload.find(requestFieldName(field));
+    if (it == payload.end()) continue;
+    switch (field) {
+      case RequestField::ACCOUNT_ID: req.account_id = it->get<std::string>(); break;
+      case RequestField::SOURCE_ACCOUNT: req.source_account = it->get<std::string>(); break;
+      case RequestField::TARGET_ACCOUNT: req.target_account = it->get<std::string>(); break;
+      case RequestField::ACCOUNT_ID_1: req.account_id_1 = it->get<std::string>(); break;
+      case RequestField::ACCOUNT_ID_2: req.account_id_2 = it->get<std::string>(); break;
+      case RequestField::PAYMENT_ID: req.payment_id = it->get<std::string>(); break;
+      case RequestField::USERNAME: req.username = it->get<std::string>(); break;
+      case RequestField::PASSWORD: req.password = it->get<std::string>(); break;
+      case RequestField::AMOUNT: req.amount = jsonInt(*it); break;
+      case RequestField::TIME_AT: req.time_at = jsonInt(*it); break;
+      case RequestField::N: req.n = jsonInt(*it); break;
+      case RequestField::DELAY: req.delay = jsonInt(*it); break;
+      case RequestField::OPERATIONS:
+        if (nested) throw std::runtime_error("Nested batches are not supported");
+        for (const auto& op : *it) {
+          req.operations.push_back(requestFromJson(op, true));
+        }
+        break;
+    }
+  }
   return req;
 }
 
-std::string serializeResponse(const Response& response) {
+nlohmann::json responseToJson(const Response& response) {
+  nlohmann::json payload = nlohmann::json::object();
+  if (response.account_id) payload["account_id"] = *response.account_id;
+  if (response.balance) payload["balance"] = *response.balance;
+  if (response.source_balance) payload["source_balance"] = *response.source_balance;
+  if (response.payment_id) payload["payment_id"] = *response.payment_id;
+  if (response.session_token) payload["session_token"] = *response.session_token;
+  if (response.spenders) payload["spenders"] = *response.spenders;
+  if (response.results) {
+    nlohmann::json results = nlohmann::json::array();
+    for (const auto& result : *response.results) {
+      results.push_back(responseToJson(result));
+    }
+    payload["results"] = std::move(results);
+  }
+
   nlohmann::json j;
   j["status"] = static_cast<int>(response.status);
   j["message"] = response.message;
   j["timestamp"] = response.timestamp;
-  j["payload"] = response.payload;
-  return j.dump();
+  j["payload"] = std::move(payload);
+  return j;
 }
 
-Response deserializeResponse(const std::string& json_str) {
-  nlohmann::json j = nlohmann::json::parse(json_str);
+Response responseFromJson(const nlohmann::json& j) {
   Response resp;
-  resp.status = static_cast<Status>(j["status"].get<int>());
-  resp.message = j["message"];
-  resp.timestamp = j["timestamp"];
-  resp.payload = j["payload"];
+  resp.status = static_cast<Status>(j.at("status").get<int>());
+  resp.message = j.value("message", "");
+  resp.timestamp = j.value("timestamp", 0);
+
+  auto payload_it = j.find("payload");
+  if (payload_it == j.end() || !payload_it->is_object()) return resp;
+  const nlohmann::json& payload = *payload_it;
+
+  if (payload.contains("account_id")) resp.account_id = payload["account_id"].get<std::string>();
+  if (payload.contains("balance")) resp.balance = jsonInt(payload["balance"]);
+  if (payload.contains("source_balance")) resp.source_balance = jsonInt(payload["source_balance"]);
+  if (payload.contains("payment_id")) resp.payment_id = payload["payment_id"].get<std::string>();
+  if (payload.contains("session_token")) {
+    resp.session_token = payload["session_token"].get<std::string>();
+  }
+  if (payload.contains("spenders")) {
+    resp.spenders = payload["spenders"].get<std::vector<std::string>>();
+  }
+  if (payload.contains("results")) {
+    std::vector<Response> results;
+    for (const auto& result : payload["results"]) {
+      results.push_back(responseFromJson(result));
+    }
+    resp.results = std::move(results);
+  }
   return resp;
 }
 
+}  // namespace
+
+std::string serializeRequest(const Request& request) {
+  return requestToJson(request).dump();
+}
+
+Request deserializeRequest(std::string_view json_str) {
+  return requestFromJson(nlohmann::json::parse(json_str.begin(), json_str.end()), false);
+}
+
+std::string serializeResponse(const Response& response) {
+  return responseToJson(response).dump();
+}
+
+Response deserializeResponse(std::string_view json_str) {
+  return responseFromJson(nlohmann::json::parse(json_str.begin(), json_str.end()));
+}
+
+Encoding detectEncoding(std::string_view bytes) {
+  return BinaryCodec::isBinary(bytes) ? Encoding::BINARY : Encoding::JSON;
+}
+
+std::string encodeRequest(const Request& request, Encoding encoding) {
+  if (encoding == Encoding::JSON) return serializeRequest(request);
+  std::string out;
+  BinaryCodec::encodeRequest(request, out);
+  return out;
+}
+
+Request decodeRequest(std::string_view bytes) {
+  if (BinaryCodec::isBinary(bytes)) {
+    return BinaryCodec::decodeRequest(bytes).materialize();
+  }
+  return deserializeRequest(bytes);
+}
+
+std::string encodeResponse(const Response& response, Encoding encoding) {
+  if (encoding == Encoding::JSON) return serializeResponse(response);
+  std::string out;
+  BinaryCodec::encodeResponse(response, out);
+  return out;
+}
+
+void encodeResponse(const Response& response, Encoding encoding, std::string& out) {
+  if (encoding == Encoding::JSON) {
+    out += serializeResponse(response);
+  } else {
+    BinaryCodec::encodeResponse(response, out);
+  }
+}
+
+Response decodeResponse(std::string_view bytes) {
+  if (BinaryCodec::isBinary(bytes)) {
+    return BinaryCodec::decodeResponse(bytes);
+  }
+  return deserializeResponse(bytes);
+}
+
 // Message framing implementation
+namespace {
+
+constexpr char kHandshakeMagic[] = {'B', 'K', 'P'};
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+bool parseHexLength(std::string_view header, size_t& length) {
+  if (header.size() < MessageFramer::kV1HeaderSize) return false;
+
+  length = 0;
+  for (size_t i = 0; i < MessageFramer::kV1HeaderSize; ++i) {
+    char c = header[i];
+    size_t digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      return false;
+    }
+    length = (length << 4) | digit;
+  }
+  return true;
+}
+
+void writeHexHeader(char* header, size_t length) {
+  for (size_t i = MessageFramer::kV1HeaderSize; i-- > 0;) {
+    header[i] = kHexDigits[length & 0xF];
+    length >>= 4;
+  }
+}
+
+void appendHexHeader(std::string& out, size_t length) {
+  char header[MessageFramer::kV1HeaderSize];
+  writeHexHeader(header, length);
+  out.append(header, sizeof(header));
+}
+
+uint32_t readLittleEndian32(const char* p) {
+  const auto* b = reinterpret_cast<const unsigned char*>(p);
+  return static_cast<uint32_t>(b[0]) |
+         (static_cast<uint32_t>(b[1]) << 8) |
+         (static_cast<uint32_t>(b[2]) << 16) |
+         (static_cast<uint32_t>(b[3]) << 24);
+}
+
+void writeLittleEndian32(char* header, uint32_t value) {
+  header[0] = static_cast<char>(value & 0xFF);
+  header[1] = static_cast<char>((value >> 8) & 0xFF);
+  header[2] = static_cast<char>((value >> 16) & 0xFF);
+  header[3] = static_cast<char>((value >> 24) & 0xFF);
+}
+
+bool isHandshake(std::string_view bytes) {
+  return bytes.size() >= MessageFramer::kHandshakeSize &&
+         bytes.compare(0, sizeof(kHandshakeMagic),
+                       std::string_view(kHandshakeMagic, sizeof(kHandshakeMagic))) == 0;
+}
+
+}  // namespace
+
+FrameBuffer::FrameBuffer(size_t initial_capacity)
+    : data_(initial_capacity), read_pos_(0), write_pos_(0) {
+}
+
+char* FrameBuffer::prepareWrite(size_t min_bytes) {
+  if (data_.size() - write_pos_ < min_bytes) {
+    // Reclaim consumed space first; only grow if that is not enough.
+    if (read_pos_ > 0) {
+      std::memmove(data_.data(), data_.data() + read_pos_, write_pos_ - read_pos_);
+      write_pos_ -= read_pos_;
+      read_pos_ = 0;
+    }
+    if (data_.size() - write_pos_ < min_bytes) {
+      data_.resize(std::max(data_.size() * 2, write_pos_ + min_bytes));
+    }
+  }
+  return data_.data() + write_pos_;
+}
+
+void FrameBuffer::commitWrite(size_t n) {
+  write_pos_ += n;
+}
+
+void FrameBuffer::append(const char* data, size_t n) {
+  std::memcpy(prepareWrite(n), data, n);
+  commitWrite(n);
+}
+
+void FrameBuffer::consume(size_t n) {
+  read_pos_ += std::min(n, size());
+  if (read_pos_ == write_pos_) {
+    read_pos_ = 0;
+    write_pos_ = 0;
+  }
+}
+
 std::string MessageFramer::frameMessage(const std::string& message) {
-  std::stringstream ss;
-  ss << std::setw(8) << std::setfill('0') << std::hex << message.size();
-  ss << message;
-  return ss.str();
+  std::string framed;
+  framed.reserve(kV1HeaderSize + message.size());
+  appendHexHeader(framed, message.size());
+  framed += message;
+  return framed;
 }
 
 std::string MessageFramer::unframeMessage(const std::string& framed_message) {
-  if (framed_message.size() < 8) {
+  size_t message_size;
+  if (!parseHexLength(framed_message, message_size)) {
     throw std::runtime_error("Invalid framed message: too short");
   }
 
-  std::stringstream ss(framed_message.substr(0, 8));
-  size_t message_size;
-  ss >> std::hex >> message_size;
-
-  if (framed_message.size() < 8 + message_size) {
+  if (framed_message.size() < kV1HeaderSize + message_size) {
     throw std::runtime_error("Invalid framed message: incomplete");
   }
 
-  return framed_message.substr(8, message_size);
+  return framed_message.substr(kV1HeaderSize, message_size);
 }
 
 bool MessageFramer::isCompleteMessage(const std::string& buffer) {
-  if (buffer.size() < 8) return false;
-
-  std::stringstream ss(buffer.substr(0, 8));
   size_t message_size;
-  ss >> std::hex >> message_size;
+  if (!parseHexLength(buffer, message_size)) return false;
+  return buffer.size() >= kV1HeaderSize + message_size;
+}
+
+void MessageFramer::appendFrame(std::string& out, std::string_view payload,
+                                FramingVersion version, uint32_t request_id) {
+  const size_t frame_start = beginFrame(out, version);
+  out.append(payload.data(), payload.size());
+  finishFrame(out, frame_start, version, request_id);
+}
 
-  return buffer.size() >= 8 + message_size;
+size_t MessageFramer::headerSize(FramingVersion version) {
+  if (version == FramingVersion::V1_HEX) return 2 * kV1HeaderSize;
+  return carriesRequestId(version) ? kV3HeaderSize : kV2HeaderSize;
+}
+
+size_t MessageFramer::beginFrame(std::string& out, FramingVersion version) {
+  const size_t frame_start = out.size();
+  out.resize(frame_start + headerSize(version));
+  return frame_start;
+}
+
+void MessageFramer::finishFrame(std::string& out, size_t frame_start,
+                                FramingVersion version, uint32_t request_id) {
+  char* header = &out[frame_start];
+  const size_t payload_size = out.size() - frame_start - headerSize(version);
+  if (version == FramingVersion::V1_HEX) {
+    writeHexHeader(header, kV1HeaderSize + payload_size);
+    writeHexHeader(header + kV1HeaderSize, payload_size);
+  } else {
+    writeLittleEndian32(header, static_cast<uint32_t>(payload_size));
+    if (carriesRequestId(version)) {
+      writeLittleEndian32(header + kV2HeaderSize, request_id);
+    }
+  }
+}
+
+bool MessageFramer::nextFrame(FrameBuffer& buffer, FramingVersion version,
+                              std::string_view& payload) {
+  uint32_t request_id;
+  return nextFrame(buffer, version, payload, request_id);
+}
+
+bool MessageFramer::nextFrame(FrameBuffer& buffer, FramingVersion version,
+                              std::string_view& payload, uint32_t& request_id) {
+  std::string_view bytes = buffer.readable();
+  request_id = 0;
+
+  if (version == FramingVersion::V1_HEX) {
+    if (bytes.size() < kV1HeaderSize) return false;
+
+    size_t outer_size;
+    if (!parseHexLength(bytes, outer_size) || outer_size > kMaxFrameSize) {
+      throw std::runtime_error("Invalid frame header");
+    }
+    if (bytes.size() < kV1HeaderSize + outer_size) return false;
+
+    std::string_view outer = bytes.substr(kV1HeaderSize, outer_size);
+    size_t inner_size;
+    if (!parseHexLength(outer, inner_size) || kV1HeaderSize + inner_size > outer.size()) {
+      throw std::runtime_error("Invalid inner frame header");
+    }
+
+    payload = outer.substr(kV1HeaderSize, inner_size);
+    buffer.consume(kV1HeaderSize + outer_size);
+    return true;
+  }
+
+  size_t header_size = carriesRequestId(version) ? kV3HeaderSize : kV2HeaderSize;
+  if (bytes.size() < header_size) return false;
+
+  size_t frame_size = readLittleEndian32(bytes.data());
+  if (frame_size > kMaxFrameSize) {
+    throw std::runtime_error("Frame exceeds maximum size");
+  }
+  if (bytes.size() < header_size + frame_size) return false;
+
+  if (carriesRequestId(version)) {
+    request_id = readLittleEndian32(bytes.data() + kV2HeaderSize);
+  }
+  payload = bytes.substr(header_size, frame_size);
+  buffer.consume(header_size + frame_size);
+  return true;
+}
+
+std::string MessageFramer::encodeHandshake(FramingVersion max_version) {
+  std::string hello(kHandshakeMagic, sizeof(kHandshakeMagic));
+  hello.push_back(static_cast<char>(max_version));
+  return hello;
+}
+
+MessageFramer::HandshakeState MessageFramer::acceptHandshake(FrameBuffer& buffer,
+                                                             FramingVersion& version,
+                                                             std::string& reply) {
+  std::string_view bytes = buffer.readable();
+  if (bytes.empty()) return HandshakeState::NEED_MORE;
+
+  // v1 frames always start with a hex digit, which can never be the magic.
+  if (bytes[0] != kHandshakeMagic[0]) {
+    version = FramingVersion::V1_HEX;
+    return HandshakeState::LEGACY;
+  }
+  if (bytes.size() < kHandshakeSize) return HandshakeState::NEED_MORE;
+  if (!isHandshake(bytes)) {
+    throw std::runtime_error("Invalid protocol handshake");
+  }
+
+  uint8_t requested = static_cast<uint8_t>(bytes[3]);
+  if (requested < static_cast<uint8_t>(FramingVersion::V1_HEX)) {
+    throw std::runtime_error("Unsupported protocol version");
+  }
+  version = static_cast<FramingVersion>(
+      std::min(requested, static_cast<uint8_t>(kMaxFramingVersion)));
+  buffer.consume(kHandshakeSize);
+
+  reply.assign(kHandshakeMagic, sizeof(kHandshakeMagic));
+  reply.push_back(static_cast<char>(version));
+  return HandshakeState::NEGOTIATED;
+}
+
+MessageFramer::HandshakeState MessageFramer::readHandshakeAck(FrameBuffer& buffer,
+                                                              FramingVersion& version) {
+  std::string_view bytes = buffer.readable();
+  if (bytes.size() < kHandshakeSize) return HandshakeState::NEED_MORE;
+  if (!isHandshake(bytes)) {
+    throw std::runtime_error("Invalid protocol handshake ack");
+  }
+
+  uint8_t chosen = static_cast<uint8_t>(bytes[3]);
+  if (chosen < static_cast<uint8_t>(FramingVersion::V1_HEX) ||
+      chosen > static_cast<uint8_t>(kMaxFramingVersion)) {
+    throw std::runtime_error("Server chose an unsupported protocol version");
+  }
+  version = static_cast<FramingVersion>(chosen);
+  buffer.consume(kHandshakeSize);
+  return HandshakeState::NEGOTIATED;
 }
 
 }  // namespace protocol
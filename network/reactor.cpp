@@ -0,0 +1,493 @@
+#include "reactor.hpp"
+#include "protocol.hpp"
+#include "concurrent/thread_placement.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace banking {
+namespace network {
+
+namespace {
+
+constexpr int kMaxEventsPerWait = 256;
+constexpr size_t kReadChunkSize = 64 * 1024;
+// Read at most this much per readiness event; the rest is reported again next wait
+constexpr size_t kMaxReadPerEvent = 4 * kReadChunkSize;
+// Stop reading from a peer with more unsent output than this, until it drains below the low mark
+constexpr size_t kWriteHighWater = 1024 * 1024;
+constexpr size_t kWriteLowWater = 256 * 1024;
+// Likewise for requests handed to an AsyncHandler and not yet answered
+constexpr size_t kMaxInFlight = 1024;
+
+}  // namespace
+
+/**
+ * Where an AsyncHandler's answers wait for the loop. Responders hold it by
+ * shared_ptr, so one answering after the reactor stopped finds it closed.
+ */
+struct Reactor::Mailbox {
+  void post(Completion completion) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!open) return;  // The connection went with the reactor
+    const bool first = completions.empty();
+    completions.push_back(std::move(completion));
+    // The loop collects answers given on its own thread after each batch of events
+    if (first && std::this_thread::get_id() != loop) {
+      uint64_t one = 1;
+      ssize_t ignored = write(wake_fd, &one, sizeof(one));
+      (void)ignored;
+    }
+  }
+
+  std::mutex mutex;
+  std::vector<Completion> completions;
+  bool open = true;
+  int wake_fd = -1;
+  std::thread::id loop;
+};
+
+Reactor::Reactor(size_t id, int port, int listen_backlog,
+                 const TCPServer::ResponseWriter& writer,
+                 const TCPServer::AsyncHandler& async_handler,
+                 std::atomic<size_t>& connection_count,
+                 int cpu)
+    : id_(id),
+      port_(port),
+      listen_backlog_(listen_backlog),
+      cpu_(cpu),
+      response_writer_(writer),
+      async_handler_(async_handler),
+      connection_count_(connection_count),
+      listen_fd_(-1),
+      epoll_fd_(-1),
+      wake_fd_(-1),
+      running_(false) {
+}
+
+Reactor::~Reactor() {
+  stop();
+}
+
+bool Reactor::start() {
+  listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    std::cerr << "Reactor " << id_ << ": failed to create socket" << std::endl;
+    return false;
+  }
+
+  // Every reactor binds the same port; the kernel spreads accepts across them.
+  int opt = 1;
+  if (setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+      setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+    std::cerr << "Reactor " << id_ << ": failed to set socket options" << std::endl;
+    stop();
+    return false;
+  }
+
+  struct sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = INADDR_ANY;
+  address.sin_port = htons(port_);
+
+  if (bind(listen_fd_, (struct sockaddr*)&address, sizeof(address)) < 0) {
+    std::cerr << "Reactor " << id_ << ": failed to bind port " << port_ << std::endl;
+    stop();
+    return false;
+  }
+
+  if (listen(listen_fd_, listen_backlog_) < 0) {
+    std::cerr << "Reactor " << id_ << ": failed to listen" << std::endl;
+    stop();
+    return false;
+  }
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd_ < 0 || wake_fd_ < 0) {
+    std::cerr << "Reactor " << id_ << ": failed to create epoll/eventfd" << std::endl;
+    stop();
+    return false;
+  }
+
+  struct epoll_event ev;
+  std::memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = listen_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+  ev.data.fd = wake_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+  mailbox_ = std::make_shared<Mailbox>();
+  mailbox_->wake_fd = wake_fd_;
+
+  running_ = true;
+  thread_ = std::make_unique<std::thread>(&Reactor::run, this);
+  if (!concurrent::pinThread(*thread_, cpu_)) {
+    std::cerr << "Could not pin reactor " << id_ << " to CPU " << cpu_ << std::endl;
+  }
+  return true;
+}
+
+void Reactor::stop() {
+  if (running_.exchange(false)) {
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+  }
+
+  if (thread_ && thread_->joinable()) {
+    thread_->join();
+  }
+  thread_.reset();
+
+  // Answers still to come are dropped, and never touch the closed eventfd
+  if (mailbox_) {
+    std::lock_guard<std::mutex> lock(mailbox_->mutex);
+    mailbox_->open = false;
+  }
+
+  for (auto& pair : connections_) {
+    close(pair.first);
+    connection_count_.fetch_sub(1);
+  }
+  connections_.clear();
+
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    listen_fd_ = -1;
+  }
+  if (wake_fd_ >= 0) {
+    close(wake_fd_);
+    wake_fd_ = -1;
+  }
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+}
+
+void Reactor::run() {
+  struct epoll_event events[kMaxEventsPerWait];
+  {
+    std::lock_guard<std::mutex> lock(mailbox_->mutex);
+    mailbox_->loop = std::this_thread::get_id();
+  }
+
+  while (running_) {
+    int n = epoll_wait(epoll_fd_, events, kMaxEventsPerWait, -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      std::cerr << "Reactor " << id_ << ": epoll_wait failed: " << std::strerror(errno) << std::endl;
+      break;
+    }
+
+    for (int i = 0; i < n; ++i) {
+      int fd = events[i].data.fd;
+
+      if (fd == wake_fd_) {
+        // Posted answers are collected below; running_ is re-checked by the outer loop
+        uint64_t count;
+        ssize_t ignored = read(wake_fd_, &count, sizeof(count));
+        (void)ignored;
+        continue;
+      }
+      if (fd == listen_fd_) {
+        acceptConnections();
+        continue;
+      }
+
+      auto it = connections_.find(fd);
+      if (it == connections_.end()) continue;
+
+      uint32_t mask = events[i].events;
+      Connection& conn = it->second;
+      bool keep = (mask & (EPOLLERR | EPOLLHUP)) == 0;
+      if (keep && (mask & (EPOLLIN | EPOLLRDHUP))) {
+        keep = handleReadable(fd, conn);
+      }
+      if (keep && (mask & EPOLLOUT)) {
+        keep = flushWrites(fd, conn);
+      }
+      if (!keep || !updateInterest(fd, conn)) {
+        closeConnection(fd);
+      }
+    }
+
+    processCompletions();
+  }
+}
+
+void Reactor::acceptConnections() {
+  while (true) {
+    struct sockaddr_in client_address;
+    socklen_t client_addr_len = sizeof(client_address);
+    int fd = accept4(listen_fd_, (struct sockaddr*)&client_address, &client_addr_len,
+                     SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        std::cerr << "Reactor " << id_ << ": failed to accept connection" << std::endl;
+      }
+      return;
+    }
+
+    char client_ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &client_address.sin_addr, client_ip, INET_ADDRSTRLEN);
+
+    Connection conn;
+    conn.id = next_connection_id_++;
+    conn.addr = std::string(client_ip) + ":" + std::to_string(ntohs(client_address.sin_port));
+    conn.interest = EPOLLIN | EPOLLRDHUP;
+
+    struct epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = conn.interest;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      close(fd);
+      continue;
+    }
+
+    connections_.emplace(fd, std::move(conn));
+    connection_count_.fetch_add(1);
+  }
+}
+
+bool Reactor::handleReadable(int fd, Connection& conn) {
+  // A stale event from before reading was paused or the peer finished sending
+  if (conn.throttled || conn.read_closed) return true;
+
+  size_t budget = kMaxReadPerEvent;
+  while (budget > 0) {
+    const size_t chunk = std::min(kReadChunkSize, budget);
+    char* buffer = conn.stream.input.prepareWrite(chunk);
+    ssize_t bytes_read = read(fd, buffer, chunk);
+    if (bytes_read > 0) {
+      conn.stream.input.commitWrite(static_cast<size_t>(bytes_read));
+      budget -= static_cast<size_t>(bytes_read);
+      continue;
+    }
+    if (bytes_read == 0) {
+      conn.read_closed = true;  // Half-close: answer what was sent, then close
+    } else if (errno == EINTR) {
+      continue;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      std::cerr << "Error reading from client " << conn.addr << std::endl;
+      return false;
+    }
+    break;
+  }
+
+  if (async_handler_) {
+    if (!dispatchAsync(fd, conn)) return false;
+    emitResponses(conn);
+  } else if (!detail::dispatchBufferedRequests(response_writer_, conn.stream,
+                                               conn.write_buffer, conn.addr)) {
+    return false;
+  }
+  return flushWrites(fd, conn);
+}
+
+bool Reactor::dispatchAsync(int fd, Connection& conn) {
+  try {
+    std::string_view request;
+    uint32_t request_id;
+    while (detail::nextRequest(conn.stream, conn.write_buffer, request, request_id)) {
+      const uint64_t sequence = conn.first_sequence + conn.in_flight.size();
+      conn.in_flight.push_back(PendingResponse{request_id, false, {}});
+      TCPServer::Responder respond =
+          [mailbox = mailbox_, fd, connection = conn.id, sequence](std::string response) {
+            mailbox->post(Completion{fd, connection, sequence, std::move(response)});
+          };
+      try {
+        async_handler_(request, std::move(respond));
+      } catch (const std::exception& e) {
+        std::cerr << "Error processing request from " << conn.addr << ": " << e.what() << std::endl;
+        PendingResponse& pending = conn.in_flight.back();
+        auto error_response = protocol::Response::error(
+            protocol::Status::ERROR, "Invalid request format", 0);
+        protocol::encodeResponse(error_response, protocol::detectEncoding(request), pending.response);
+        pending.done = true;
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Protocol error from " << conn.addr << ": " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void Reactor::processCompletions() {
+  {
+    std::lock_guard<std::mutex> lock(mailbox_->mutex);
+    if (mailbox_->completions.empty()) return;
+    completions_.swap(mailbox_->completions);
+  }
+
+  std::vector<int> ready;
+  for (Completion& completion : completions_) {
+    auto it = connections_.find(completion.fd);
+    if (it == connections_.end() || it->second.id != completion.connection) continue;  // Closed since
+    Connection& conn = it->second;
+    // Already answered with an error if the handler threw after taking the responder
+    const uint64_t index = completion.sequence - conn.first_sequence;
+    if (index >= conn.in_flight.size() || conn.in_flight[index].done) continue;
+    conn.in_flight[index].response = std::move(completion.response);
+    conn.in_flight[index].done = true;
+    if (index == 0) ready.push_back(completion.fd);
+  }
+  completions_.clear();
+
+  for (int fd : ready) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) continue;
+    emitResponses(it->second);
+    if (!flushWrites(fd, it->second) || !updateInterest(fd, it->second)) {
+      closeConnection(fd);
+    }
+  }
+}
+
+void Reactor::emitResponses(Connection& conn) {
+  while (!conn.in_flight.empty() && conn.in_flight.front().done) {
+    const PendingResponse& pending = conn.in_flight.front();
+    const size_t frame_start = protocol::MessageFramer::beginFrame(conn.write_buffer, conn.stream.framing);
+    conn.write_buffer += pending.response;
+    protocol::MessageFramer::finishFrame(conn.write_buffer, frame_start, conn.stream.framing,
+                                         pending.request_id);
+    conn.in_flight.pop_front();
+    ++conn.first_sequence;
+  }
+}
+
+bool Reactor::flushWrites(int fd, Connection& conn) {
+  while (conn.write_offset < conn.write_buffer.size()) {
+    ssize_t written = send(fd, conn.write_buffer.data() + conn.write_offset,
+                           conn.write_buffer.size() - conn.write_offset, MSG_NOSIGNAL);
+    if (written > 0) {
+      conn.write_offset += static_cast<size_t>(written);
+      continue;
+    }
+    if (written < 0 && errno == EINTR) continue;
+    if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // Socket buffer full; wait for EPOLLOUT. Drop the sent prefix once it
+      // outweighs what is left, so a slow reader does not grow the buffer
+      if (conn.write_offset >= conn.write_buffer.size() - conn.write_offset) {
+        conn.write_buffer.erase(0, conn.write_offset);
+        conn.write_offset = 0;
+      }
+      return true;
+    }
+    std::cerr << "Error writing to client " << conn.addr << std::endl;
+    return false;
+  }
+
+  conn.write_buffer.clear();
+  conn.write_offset = 0;
+  return true;
+}
+
+bool Reactor::updateInterest(int fd, Connection& conn) {
+  const size_t unsent = conn.write_buffer.size() - conn.write_offset;
+  const size_t in_flight = conn.in_flight.size();
+  if (conn.read_closed && unsent == 0 && in_flight == 0) return false;
+
+  if (unsent > kWriteHighWater || in_flight > kMaxInFlight) {
+    conn.throttled = true;
+  } else if (unsent <= kWriteLowWater && in_flight <= kMaxInFlight / 2) {
+    conn.throttled = false;
+  }
+
+  uint32_t interest = 0;
+  if (!conn.read_closed && !conn.throttled) interest |= EPOLLIN | EPOLLRDHUP;
+  if (unsent > 0) interest |= EPOLLOUT;
+  if (interest == conn.interest) return true;
+
+  struct epoll_event ev;
+  std::memset(&ev, 0, sizeof(ev));
+  ev.events = interest;
+  ev.data.fd = fd;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+  conn.interest = interest;
+  return true;
+}
+
+void Reactor::closeConnection(int fd) {
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  if (connections_.erase(fd) > 0) {
+    connection_count_.fetch_sub(1);
+  }
+}
+
+namespace detail {
+
+bool nextRequest(StreamState& stream, std::string& output,
+                 std::string_view& request, uint32_t& request_id) {
+  if (!stream.negotiated) {
+    std::string reply;
+    auto state = protocol::MessageFramer::acceptHandshake(stream.input, stream.framing, reply);
+    if (state == protocol::MessageFramer::HandshakeState::NEED_MORE) return false;
+    stream.negotiated = true;
+    output += reply;
+  }
+  return protocol::MessageFramer::nextFrame(stream.input, stream.framing, request, request_id);
+}
+
+bool dispatchBufferedRequests(const TCPServer::ResponseWriter& writer,
+                              StreamState& stream, std::string& output,
+                              const std::string& client_addr) {
+  try {
+    std::string_view request_view;
+    uint32_t request_id;
+    while (nextRequest(stream, output, request_view, request_id)) {
+      // The writer owns decoding, so each request is parsed exactly once, and
+      // encodes its response in place, so it is never copied into the frame
+      const size_t frame_start = protocol::MessageFramer::beginFrame(output, stream.framing);
+      try {
+        writer(request_view, output);
+      } catch (const std::exception& e) {
+        std::cerr << "Error processing request from " << client_addr << ": " << e.what() << std::endl;
+        output.resize(frame_start + protocol::MessageFramer::headerSize(stream.framing));
+        auto error_response = protocol::Response::error(
+            protocol::Status::ERROR, "Invalid request format", 0);
+        protocol::encodeResponse(error_response, protocol::detectEncoding(request_view), output);
+      }
+      protocol::MessageFramer::finishFrame(output, frame_start, stream.framing, request_id);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Protocol error from " << client_addr << ": " << e.what() << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool sendAll(int fd, std::string_view data) {
+  while (!data.empty()) {
+    ssize_t written = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (written > 0) {
+      data.remove_prefix(static_cast<size_t>(written));
+      continue;
+    }
+    if (written < 0 && errno == EINTR) continue;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace detail
+
+}  // namespace network
+}  // namespace banking
@@ -2,9 +2,12 @@
 #include "protocol.hpp"
 
 #include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <iostream>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #include <sstream>
@@ -13,11 +16,17 @@ namespace banking {
 namespace network {
 
 TCPClient::TCPClient(const std::string& host, int port)
+    : TCPClient(host, port, Config{}) {
+}
+
+TCPClient::TCPClient(const std::string& host, int port, const Config& config)
     : host_(host),
       port_(port),
+      config_(config),
       socket_(-1),
+      framing_(protocol::FramingVersion::V1_HEX),
       connected_(false),
-      response_ready_(false) {
+      next_request_id_(1) {
 }
 
 TCPClient::~TCPClient() {
@@ -27,6 +36,28 @@ TCPClient::~TCPClient() {
 bool TCPClient::connect() {
   if (connected_) return true;
 
+  // Reap a previous connection the server closed underneath us
+  disconnect();
+
+  if (!openSocket()) return false;
+
+  if (!negotiateFraming()) {
+    // Legacy servers never answer the handshake and have our hello sitting
+    // in their buffer, so start over on a fresh connection speaking v1.
+    closeSocket();
+    framing_ = protocol::FramingVersion::V1_HEX;
+    if (!openSocket()) return false;
+  }
+
+  connected_ = true;
+  receive_thread_ = std::make_unique<std::thread>(&TCPClient::receiveLoop, this);
+
+  std::cout << "Connected to server at " << host_ << ":" << port_
+            << " (framing v" << static_cast<int>(framing_) << ")" << std::endl;
+  return true;
+}
+
+bool TCPClient::openSocket() {
   // Create socket
   socket_ = socket(AF_INET, SOCK_STREAM, 0);
   if (socket_ < 0) {
@@ -36,84 +67,154 @@ bool TCPClient::connect() {
 
   // Set up server address
   struct sockaddr_in server_address;
+  std::memset(&server_address, 0, sizeof(server_address));
   server_address.sin_family = AF_INET;
   server_address.sin_port = htons(port_);
 
   if (inet_pton(AF_INET, host_.c_str(), &server_address.sin_addr) <= 0) {
     std::cerr << "Invalid address: " << host_ << std::endl;
-    close(socket_);
-    socket_ = -1;
+    closeSocket();
     return false;
   }
 
   // Connect to server
   if (::connect(socket_, (struct sockaddr*)&server_address, sizeof(server_address)) < 0) {
     std::cerr << "Failed to connect to " << host_ << ":" << port_ << std::endl;
-    close(socket_);
-    socket_ = -1;
+    closeSocket();
     return false;
   }
 
-  connected_ = true;
-  receive_thread_ = std::make_unique<std::thread>(&TCPClient::receiveLoop, this);
-
-  std::cout << "Connected to server at " << host_ << ":" << port_ << std::endl;
+  receive_buffer_.consume(receive_buffer_.size());
   return true;
 }
 
-void TCPClient::disconnect() {
-  if (!connected_) return;
-
-  connected_ = false;
-
-  // Close socket to break receive loop
+void TCPClient::closeSocket() {
   if (socket_ >= 0) {
     shutdown(socket_, SHUT_RDWR);
     close(socket_);
     socket_ = -1;
   }
+}
+
+bool TCPClient::negotiateFraming() {
+  if (config_.max_framing == protocol::FramingVersion::V1_HEX) {
+    framing_ = protocol::FramingVersion::V1_HEX;
+    return true;
+  }
+
+  std::string hello = protocol::MessageFramer::encodeHandshake(config_.max_framing);
+  if (write(socket_, hello.data(), hello.size()) != static_cast<ssize_t>(hello.size())) {
+    return false;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(config_.handshake_timeout_ms);
+  while (true) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) return false;
+
+    struct pollfd pfd;
+    pfd.fd = socket_;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, static_cast<int>(remaining.count())) <= 0) return false;
+
+    char* buffer = receive_buffer_.prepareWrite(protocol::MessageFramer::kHandshakeSize);
+    ssize_t bytes_read = read(socket_, buffer, protocol::MessageFramer::kHandshakeSize);
+    if (bytes_read <= 0) return false;
+    receive_buffer_.commitWrite(static_cast<size_t>(bytes_read));
+
+    try {
+      auto state = protocol::MessageFramer::readHandshakeAck(receive_buffer_, framing_);
+      if (state == protocol::MessageFramer::HandshakeState::NEGOTIATED) return true;
+    } catch (const std::exception& e) {
+      std::cerr << "Handshake failed: " << e.what() << std::endl;
+      return false;
+    }
+  }
+}
+
+void TCPClient::disconnect() {
+  bool was_connected = connected_.exchange(false);
+
+  // Shut the socket down to break the receive loop, but only close it once
+  // that thread can no longer be using the descriptor
+  {
+    std::lock_guard<std::mutex> lock(socket_mutex_);
+    if (socket_ >= 0) shutdown(socket_, SHUT_RDWR);
+  }
 
   // Wait for receive thread
   if (receive_thread_ && receive_thread_->joinable()) {
     receive_thread_->join();
   }
+  receive_thread_.reset();
+
+  {
+    std::lock_guard<std::mutex> lock(socket_mutex_);
+    closeSocket();
+  }
+  failPendingRequests("Disconnected from server");
 
-  std::cout << "Disconnected from server" << std::endl;
+  if (was_connected) {
+    std::cout << "Disconnected from server" << std::endl;
+  }
 }
 
 std::string TCPClient::sendRequest(const std::string& request) {
-  if (!connected_) {
-    throw std::runtime_error("Not connected to server");
+  return sendRequestAsync(request).get();
+}
+
+std::future<std::string> TCPClient::sendRequestAsync(const std::string& request) {
+  std::promise<std::string> promise;
+  auto future = promise.get_future();
+
+  // Ids are assigned and frames written under one lock, so send order
+  // matches id order for servers that answer in sequence
+  std::lock_guard<std::mutex> lock(socket_mutex_);
+
+  if (!connected_ || socket_ < 0) {
+    promise.set_exception(std::make_exception_ptr(
+        std::runtime_error("Not connected to server")));
+    return future;
   }
 
+  uint32_t request_id;
   {
-    std::lock_guard<std::mutex> lock(response_mutex_);
-    response_ready_ = false;
+    std::lock_guard<std::mutex> pending_lock(pending_mutex_);
+    request_id = next_request_id_++;
+    pending_requests_.emplace(request_id, std::move(promise));
+    if (!protocol::carriesRequestId(framing_)) {
+      pending_order_.push_back(request_id);
+    }
   }
 
-  if (!sendMessage(request)) {
-    throw std::runtime_error("Failed to send request");
-  }
+  // Frame the message
+  std::string final_message;
+  final_message.reserve(protocol::MessageFramer::kV3HeaderSize + request.size());
+  protocol::MessageFramer::appendFrame(final_message, request, framing_, request_id);
 
-  // Wait for response
-  {
-    std::unique_lock<std::mutex> lock(response_mutex_);
-    response_cv_.wait(lock, [this]() { return response_ready_; });
-    return pending_response_;
+  if (!writeAll(final_message)) {
+    std::cerr << "Failed to send message" << std::endl;
+    // The stream is now unusable; the receive loop fails every pending request
+    connected_ = false;
+    shutdown(socket_, SHUT_RDWR);
   }
+
+  return future;
 }
 
-bool TCPClient::sendRequestAsync(const std::string& request) {
-  if (!connected_) return false;
-  return sendMessage(request);
+size_t TCPClient::getPendingCount() const {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  return pending_requests_.size();
 }
 
 void TCPClient::receiveLoop() {
-  char buffer[4096];
-  std::string message_buffer;
+  constexpr size_t kReadChunkSize = 64 * 1024;
 
   while (connected_) {
-    ssize_t bytes_read = read(socket_, buffer, sizeof(buffer));
+    char* buffer = receive_buffer_.prepareWrite(kReadChunkSize);
+    ssize_t bytes_read = read(socket_, buffer, kReadChunkSize);
 
     if (bytes_read <= 0) {
       if (bytes_read < 0 && connected_) {
@@ -122,43 +223,75 @@ void TCPClient::receiveLoop() {
       break;
     }
 
-    message_buffer.append(buffer, bytes_read);
+    receive_buffer_.commitWrite(static_cast<size_t>(bytes_read));
 
     // Process complete messages
-    while (protocol::MessageFramer::isCompleteMessage(message_buffer)) {
-      std::string framed_message = protocol::MessageFramer::unframeMessage(message_buffer);
-      std::string response_json = protocol::MessageFramer::unframeMessage(framed_message);
-
-      // Notify waiting thread
-      {
-        std::lock_guard<std::mutex> lock(response_mutex_);
-        pending_response_ = response_json;
-        response_ready_ = true;
+    try {
+      std::string_view response_view;
+      uint32_t request_id;
+      while (protocol::MessageFramer::nextFrame(receive_buffer_, framing_,
+                                                response_view, request_id)) {
+        completeRequest(request_id, response_view);
       }
-      response_cv_.notify_one();
+    } catch (const std::exception& e) {
+      std::cerr << "Malformed response from server: " << e.what() << std::endl;
+      break;
     }
   }
 
   connected_ = false;
+  failPendingRequests("Connection to server lost");
 }
 
-bool TCPClient::sendMessage(const std::string& message) {
-  std::lock_guard<std::mutex> lock(socket_mutex_);
+void TCPClient::completeRequest(uint32_t request_id, std::string_view response) {
+  std::promise<std::string> promise;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    if (!protocol::carriesRequestId(framing_)) {
+      if (pending_order_.empty()) {
+        std::cerr << "Unexpected response from server" << std::endl;
+        return;
+      }
+      request_id = pending_order_.front();
+      pending_order_.pop_front();
+    }
 
-  if (!connected_ || socket_ < 0) return false;
+    auto it = pending_requests_.find(request_id);
+    if (it == pending_requests_.end()) {
+      std::cerr << "Response for unknown request id " << request_id << std::endl;
+      return;
+    }
+    promise = std::move(it->second);
+    pending_requests_.erase(it);
+  }
 
-  // Frame the message
-  std::string framed_message = protocol::MessageFramer::frameMessage(message);
-  std::string final_message = protocol::MessageFramer::frameMessage(framed_message);
+  promise.set_value(std::string(response));
+}
 
-  ssize_t bytes_written = write(socket_, final_message.c_str(), final_message.size());
+void TCPClient::failPendingRequests(const std::string& reason) {
+  std::unordered_map<uint32_t, std::promise<std::string>> pending;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    pending.swap(pending_requests_);
+    pending_order_.clear();
+  }
 
-  if (bytes_written < 0) {
-    std::cerr << "Failed to send message" << std::endl;
-    connected_ = false;
-    return false;
+  for (auto& entry : pending) {
+    entry.second.set_exception(std::make_exception_ptr(std::runtime_error(reason)));
   }
+}
 
+bool TCPClient::writeAll(const std::string& data) {
+  size_t total_written = 0;
+  while (total_written < data.size()) {
+    ssize_t bytes_written = send(socket_, data.data() + total_written,
+                                 data.size() - total_written, MSG_NOSIGNAL);
+    if (bytes_written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    total_written += static_cast<size_t>(bytes_written);
+  }
   return true;
 }
 
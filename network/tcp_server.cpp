@@ -1,8 +1,12 @@
 #include "tcp_server.hpp"
 #include "protocol.hpp"
+#include "reactor.hpp"
+#include "concurrent/thread_placement.hpp"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cstring>
+#include <future>
 #include <iostream>
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -13,11 +17,52 @@
 namespace banking {
 namespace network {
 
+namespace {
+
+// A connection thread may block, so it waits for each deferred answer in turn
+TCPServer::ResponseWriter awaitingWriter(TCPServer::AsyncHandler handler) {
+  return [handler = std::move(handler)](std::string_view request, std::string& out) {
+    auto response = std::make_shared<std::promise<std::string>>();
+    auto answer = response->get_future();
+    handler(request, [response](std::string payload) { response->set_value(std::move(payload)); });
+    out += answer.get();
+  };
+}
+
+}  // namespace
+
 TCPServer::TCPServer(int port, RequestHandler handler)
+    : TCPServer(port, std::move(handler), Config{}) {
+}
+
+TCPServer::TCPServer(int port, RequestHandler handler, const Config& config)
+    : TCPServer(port,
+                ResponseWriter([handler = std::move(handler)](std::string_view request, std::string& out) {
+                  out += handler(request);
+                }),
+                config) {
+}
+
+TCPServer::TCPServer(int port, ResponseWriter writer)
+    : TCPServer(port, std::move(writer), Config{}) {
+}
+
+TCPServer::TCPServer(int port, ResponseWriter writer, const Config& config)
     : port_(port),
       server_socket_(-1),
-      request_handler_(std::move(handler)),
-      running_(false) {
+      response_writer_(std::move(writer)),
+      config_(config),
+      running_(false),
+      reactor_connections_(0) {
+}
+
+TCPServer::TCPServer(int port, AsyncHandler handler)
+    : TCPServer(port, std::move(handler), Config{}) {
+}
+
+TCPServer::TCPServer(int port, AsyncHandler handler, const Config& config)
+    : TCPServer(port, awaitingWriter(handler), config) {
+  async_handler_ = std::move(handler);
 }
 
 TCPServer::~TCPServer() {
@@ -25,6 +70,40 @@ TCPServer::~TCPServer() {
 }
 
 bool TCPServer::start() {
+  if (running_) return true;
+
+  if (config_.io_model == IoModel::EVENT_LOOP) {
+    return startEventLoop();
+  }
+  return startThreadPerConnection();
+}
+
+bool TCPServer::startEventLoop() {
+  size_t num_reactors = config_.num_reactors;
+  if (num_reactors == 0) {
+    num_reactors = !config_.reactor_cpus.empty() ? config_.reactor_cpus.size()
+                                                 : std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (size_t i = 0; i < num_reactors; ++i) {
+    auto reactor = std::make_unique<Reactor>(i, port_, config_.listen_backlog, response_writer_,
+                                             async_handler_, reactor_connections_,
+                                             concurrent::cpuFor(config_.reactor_cpus, i));
+    if (!reactor->start()) {
+      std::cerr << "Failed to start reactor " << i << " on port " << port_ << std::endl;
+      reactors_.clear();
+      return false;
+    }
+    reactors_.push_back(std::move(reactor));
+  }
+
+  running_ = true;
+  std::cout << "TCP Server started on port " << port_ << " with "
+            << num_reactors << " event-loop reactors" << std::endl;
+  return true;
+}
+
+bool TCPServer::startThreadPerConnection() {
   // Create socket
   server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
   if (server_socket_ < 0) {
@@ -34,8 +113,8 @@ bool TCPServer::start() {
 
   // Set socket options
   int opt = 1;
-  if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT,
-                 &opt, sizeof(opt)) < 0) {
+  if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+      setsockopt(server_socket_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
     std::cerr << "Failed to set socket options" << std::endl;
     close(server_socket_);
     return false;
@@ -54,7 +133,7 @@ bool TCPServer::start() {
   }
 
   // Listen for connections
-  if (listen(server_socket_, 10) < 0) {
+  if (listen(server_socket_, config_.listen_backlog) < 0) {
     std::cerr << "Failed to listen on socket" << std::endl;
     close(server_socket_);
     return false;
@@ -72,6 +151,15 @@ void TCPServer::stop() {
 
   running_ = false;
 
+  if (!reactors_.empty()) {
+    for (auto& reactor : reactors_) {
+      reactor->stop();
+    }
+    reactors_.clear();
+    std::cout << "TCP Server stopped" << std::endl;
+    return;
+  }
+
   // Close server socket to break accept loop
   if (server_socket_ >= 0) {
     shutdown(server_socket_, SHUT_RDWR);
@@ -84,15 +172,20 @@ void TCPServer::stop() {
     accept_thread_->join();
   }
 
-  // Close all client connections
+  // Close all client connections. Threads are joined outside the lock because
+  // each handler takes connections_mutex_ on its way out.
+  std::unordered_map<int, std::unique_ptr<std::thread>> threads;
   {
     std::lock_guard<std::mutex> lock(connections_mutex_);
     for (auto& pair : client_threads_) {
-      if (pair.second && pair.second->joinable()) {
-        pair.second->join();
-      }
+      shutdown(pair.first, SHUT_RDWR);
+    }
+    threads.swap(client_threads_);
+  }
+  for (auto& pair : threads) {
+    if (pair.second && pair.second->joinable()) {
+      pair.second->join();
     }
-    client_threads_.clear();
   }
 
   std::cout << "TCP Server stopped" << std::endl;
@@ -133,11 +226,13 @@ void TCPServer::acceptLoop() {
 }
 
 void TCPServer::handleClient(int client_socket, std::string client_addr) {
-  char buffer[4096];
-  std::string message_buffer;
+  constexpr size_t kReadChunkSize = 4096;
+  detail::StreamState stream;
+  std::string response_buffer;
 
   while (running_) {
-    ssize_t bytes_read = read(client_socket, buffer, sizeof(buffer));
+    char* buffer = stream.input.prepareWrite(kReadChunkSize);
+    ssize_t bytes_read = read(client_socket, buffer, kReadChunkSize);
 
     if (bytes_read <= 0) {
       if (bytes_read < 0) {
@@ -146,52 +241,42 @@ void TCPServer::handleClient(int client_socket, std::string client_addr) {
       break;
     }
 
-    message_buffer.append(buffer, bytes_read);
+    stream.input.commitWrite(static_cast<size_t>(bytes_read));
 
     // Process complete messages
-    while (protocol::MessageFramer::isCompleteMessage(message_buffer)) {
-      std::string framed_message = protocol::MessageFramer::unframeMessage(message_buffer);
-      std::string request_json = protocol::MessageFramer::unframeMessage(framed_message);
-
-      try {
-        auto request = protocol::deserializeRequest(request_json);
-        std::string response_json = request_handler_(request_json);
-
-        // Frame and send response
-        std::string framed_response = protocol::MessageFramer::frameMessage(response_json);
-        std::string final_message = protocol::MessageFramer::frameMessage(framed_response);
-
-        ssize_t bytes_written = write(client_socket, final_message.c_str(), final_message.size());
-        if (bytes_written < 0) {
-          std::cerr << "Error writing to client " << client_addr << std::endl;
-          break;
-        }
-      } catch (const std::exception& e) {
-        std::cerr << "Error processing request from " << client_addr << ": " << e.what() << std::endl;
-
-        // Send error response
-        auto error_response = protocol::Response::error(
-            protocol::Status::ERROR, "Invalid request format", 0);
-        std::string error_json = protocol::serializeResponse(error_response);
-        std::string framed_error = protocol::MessageFramer::frameMessage(error_json);
-        std::string final_error = protocol::MessageFramer::frameMessage(framed_error);
-
-        write(client_socket, final_error.c_str(), final_error.size());
+    // Every response to this read goes out in one send, however many were pipelined
+    bool stream_ok = detail::dispatchBufferedRequests(response_writer_, stream,
+                                                      response_buffer, client_addr);
+    if (!response_buffer.empty()) {
+      bool written = detail::sendAll(client_socket, response_buffer);
+      response_buffer.clear();  // Keeps its capacity for the next batch
+      if (!written) {
+        std::cerr << "Error writing to client " << client_addr << std::endl;
+        break;
       }
     }
+    if (!stream_ok) break;
   }
 
-  close(client_socket);
-  std::cout << "Closed connection from " << client_addr << std::endl;
-
-  // Remove from active connections
+  // Remove from active connections. If stop() already claimed the thread it
+  // will join it; otherwise nobody will, so detach before erasing.
   {
     std::lock_guard<std::mutex> lock(connections_mutex_);
-    client_threads_.erase(client_socket);
+    auto it = client_threads_.find(client_socket);
+    if (it != client_threads_.end()) {
+      it->second->detach();
+      client_threads_.erase(it);
+    }
   }
+
+  close(client_socket);
+  std::cout << "Closed connection from " << client_addr << std::endl;
 }
 
 size_t TCPServer::getConnectionCount() const {
+  if (config_.io_model == IoModel::EVENT_LOOP) {
+    return reactor_connections_.load();
+  }
   std::lock_guard<std::mutex> lock(connections_mutex_);
   return client_threads_.size();
 }
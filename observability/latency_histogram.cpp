@@ -0,0 +1,199 @@
+#include "latency_histogram.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace banking {
+namespace observability {
+
+namespace {
+
+constexpr size_t kExactValues = size_t{1} << LatencyHistogram::kSubBucketBits;
+constexpr size_t kHalfBucket = kExactValues / 2;
+
+double toMicros(uint64_t nanos) { return static_cast<double>(nanos) / 1000.0; }
+
+void updateMax(std::atomic<uint64_t>& target, uint64_t value) {
+  uint64_t current = target.load(std::memory_order_relaxed);
+  while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+size_t LatencyHistogram::bucketIndex(uint64_t value_ns) {
+  const uint64_t value = std::min(value_ns, kMaxValue);
+  if (value < kExactValues) return static_cast<size_t>(value);
+
+  // Keep the top kSubBucketBits bits: the leading one selects the power of two, the rest the bucket
+  const int msb = 63 - __builtin_clzll(value);
+  const int shift = msb - (kSubBucketBits - 1);
+  return kExactValues + static_cast<size_t>(shift - 1) * kHalfBucket +
+         static_cast<size_t>((value >> shift) - kHalfBucket);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+  if (index < kExactValues) return index;
+  const size_t offset = index - kExactValues;
+  const int shift = static_cast<int>(offset / kHalfBucket) + 1;
+  const uint64_t sub_bucket = offset % kHalfBucket + kHalfBucket;
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value_ns, uint64_t times) {
+  counts_[bucketIndex(value_ns)] += times;
+  count_ += times;
+  sum_ += value_ns * times;
+  max_ = std::max(max_, value_ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  count_ = 0;
+  sum_ = 0;
+  max_ = 0;
+}
+
+uint64_t LatencyHistogram::valueAtPercentile(double percentile) const {
+  if (count_ == 0) return 0;
+  const double clamped = std::max(0.0, std::min(100.0, percentile));
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * count_)));
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return std::min(bucketUpperBound(i), max_);
+    }
+  }
+  return max_;
+}
+
+LatencySummary LatencyHistogram::summary() const {
+  LatencySummary summary;
+  summary.count = count_;
+  summary.mean_us = mean() / 1000.0;
+  summary.p50_us = toMicros(valueAtPercentile(50.0));
+  summary.p99_us = toMicros(valueAtPercentile(99.0));
+  summary.p999_us = toMicros(valueAtPercentile(99.9));
+  summary.max_us = toMicros(max_);
+  return summary;
+}
+
+LatencyRecorder::LatencyRecorder() : cells_(detail::kMetricCells) {
+}
+
+LatencyRecorder::~LatencyRecorder() {
+  for (auto& cell : cells_) {
+    delete cell.counts.load(std::memory_order_acquire);
+  }
+}
+
+void LatencyRecorder::record(std::chrono::nanoseconds latency) {
+  const uint64_t value = static_cast<uint64_t>(std::max<int64_t>(0, latency.count()));
+  Cell& cell = cells_[detail::threadCell()];
+
+  Counts* counts = cell.counts.load(std::memory_order_acquire);
+  if (!counts) {
+    // Another thread sharing this cell may install its counts first
+    auto fresh = std::make_unique<Counts>();
+    if (cell.counts.compare_exchange_strong(counts, fresh.get(), std::memory_order_acq_rel)) {
+      counts = fresh.release();
+    }
+  }
+  counts->buckets[LatencyHistogram::bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  cell.sum.fetch_add(value, std::memory_order_relaxed);
+  updateMax(cell.max, value);
+}
+
+LatencyHistogram LatencyRecorder::snapshot() const {
+  LatencyHistogram merged;
+  for (const auto& cell : cells_) {
+    const Counts* counts = cell.counts.load(std::memory_order_acquire);
+    if (!counts) continue;
+    for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+      const uint64_t count = counts->buckets[i].load(std::memory_order_relaxed);
+      merged.counts_[i] += count;
+      merged.count_ += count;
+    }
+    merged.sum_ += cell.sum.load(std::memory_order_relaxed);
+    merged.max_ = std::max(merged.max_, cell.max.load(std::memory_order_relaxed));
+  }
+  return merged;
+}
+
+void LatencyRecorder::reset() {
+  for (auto& cell : cells_) {
+    if (Counts* counts = cell.counts.load(std::memory_order_acquire)) {
+      for (auto& bucket : counts->buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+    }
+    cell.sum.store(0, std::memory_order_relaxed);
+    cell.max.store(0, std::memory_order_relaxed);
+  }
+}
+
+RateMeter::RateMeter() : started_(currentSecond()) {
+}
+
+uint32_t RateMeter::currentSecond() {
+  return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+
+void RateMeter::record(uint64_t events) {
+  const uint32_t second = currentSecond();
+  Slot& slot = slots_[second % kSlots];
+
+  uint64_t word = slot.word.load(std::memory_order_relaxed);
+  while (true) {
+    if (static_cast<uint32_t>(word >> 32) == second) {
+      slot.word.fetch_add(events, std::memory_order_relaxed);
+      return;
+    }
+    // The slot still holds a second from the previous lap; start it over
+    if (slot.word.compare_exchange_weak(word, (uint64_t{second} << 32) | events, std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+double RateMeter::perSecond(int window_seconds) const {
+  const uint32_t now = currentSecond();
+  const uint32_t window = static_cast<uint32_t>(std::max(1, std::min(kMaxWindowSeconds, window_seconds)));
+  const uint32_t span = std::min(window, now - started_.load(std::memory_order_relaxed));
+  if (span == 0) return 0.0;
+
+  // Complete seconds only: the current one is still filling
+  uint64_t events = 0;
+  for (const auto& slot : slots_) {
+    const uint64_t word = slot.word.load(std::memory_order_relaxed);
+    const uint32_t age = now - static_cast<uint32_t>(word >> 32);
+    if (age >= 1 && age <= span) {
+      events += word & 0xffffffffu;
+    }
+  }
+  return static_cast<double>(events) / span;
+}
+
+void RateMeter::reset() {
+  for (auto& slot : slots_) {
+    slot.word.store(0, std::memory_order_relaxed);
+  }
+  started_.store(currentSecond(), std::memory_order_relaxed);
+}
+
+}  // namespace observability
+}  // namespace banking
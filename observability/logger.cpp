@@ -1,54 +1,242 @@
 #include "logger.hpp"
+#include "metrics.hpp"
 
-#include <iomanip>
-#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
 
 namespace banking {
 namespace observability {
 
+namespace detail {
+
+LogRing::LogRing(size_t capacity, uint32_t thread_index)
+    : buffer_(new char[capacity]), capacity_(capacity), thread_index_(thread_index) {}
+
+char* LogRing::reserve(size_t bytes) {
+  if (bytes > capacity_) return nullptr;
+
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  const uint64_t tail = tail_.load(std::memory_order_acquire);
+
+  // An empty ring starts over at the front, so any record up to the capacity fits;
+  // the consumer reads head first, so seeing the new head means seeing the new tail
+  if (head == tail && head % capacity_ != 0) {
+    head += capacity_ - head % capacity_;
+    tail_.store(head, std::memory_order_relaxed);
+    head_.store(head, std::memory_order_release);
+  }
+  const size_t offset = static_cast<size_t>(head % capacity_);
+  const size_t contiguous = capacity_ - offset;
+
+  // A record that would straddle the end starts over at the front
+  const size_t skip = bytes > contiguous ? contiguous : 0;
+  if (bytes + skip > capacity_ - (head - tail)) return nullptr;
+
+  if (skip > 0) {
+    const uint32_t marker = 0;
+    std::memcpy(buffer_.get() + offset, &marker, sizeof(marker));
+  }
+  reserved_end_ = head + skip + bytes;
+  return buffer_.get() + (skip > 0 ? 0 : offset);
+}
+
+void LogRing::commit() {
+  head_.store(reserved_end_, std::memory_order_release);
+}
+
+}  // namespace detail
+
+namespace {
+
+// Holds the calling thread's ring and hands it back when the thread exits
+struct ThreadRing {
+  std::shared_ptr<detail::LogRing> ring;
+
+  ~ThreadRing() {
+    if (ring) ring->abandoned.store(true, std::memory_order_release);
+  }
+};
+
+thread_local ThreadRing thread_ring;
+
+struct DecodedArg {
+  detail::LogArg tag;
+  uint64_t bits;
+  std::string_view text;
+};
+
+const char* decodeArg(const char* in, DecodedArg& arg) {
+  arg.tag = static_cast<detail::LogArg>(*in++);
+  if (arg.tag == detail::LogArg::STRING) {
+    uint32_t length;
+    std::memcpy(&length, in, sizeof(length));
+    arg.text = std::string_view(in + sizeof(length), length);
+    return in + sizeof(length) + length;
+  }
+  std::memcpy(&arg.bits, in, sizeof(arg.bits));
+  return in + sizeof(arg.bits);
+}
+
+void appendEscaped(std::string& out, std::string_view text) {
+  for (char c : text) {
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          out += escaped;
+        } else {
+          out += c;
+        }
+    }
+  }
+}
+
+// The argument as it reads inside a message; strings are escaped, not quoted
+void appendText(std::string& out, const DecodedArg& arg) {
+  char number[32];
+  switch (arg.tag) {
+    case detail::LogArg::STRING:
+      appendEscaped(out, arg.text);
+      return;
+    case detail::LogArg::BOOL:
+      out += arg.bits ? "true" : "false";
+      return;
+    case detail::LogArg::INT:
+      std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(arg.bits));
+      break;
+    case detail::LogArg::UINT:
+      std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(arg.bits));
+      break;
+    case detail::LogArg::DOUBLE: {
+      double value;
+      std::memcpy(&value, &arg.bits, sizeof(value));
+      std::snprintf(number, sizeof(number), "%.6f", value);
+      break;
+    }
+    default:
+      return;
+  }
+  out += number;
+}
+
+// The argument as a JSON value
+void appendValue(std::string& out, const DecodedArg& arg) {
+  if (arg.tag == detail::LogArg::STRING) {
+    out += '"';
+    appendEscaped(out, arg.text);
+    out += '"';
+  } else {
+    appendText(out, arg);
+  }
+}
+
+void appendTimestamp(std::string& out, int64_t timestamp_ns) {
+  const std::time_t seconds = static_cast<std::time_t>(timestamp_ns / 1000000000);
+  const long microseconds = static_cast<long>(timestamp_ns % 1000000000 / 1000);
+  std::tm utc;
+  gmtime_r(&seconds, &utc);
+  char text[64];
+  std::snprintf(text, sizeof(text), "%04d-%02d-%02dT%02d:%02d:%02d.%06ldZ", utc.tm_year + 1900,
+                utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, microseconds);
+  out += text;
+}
+
+}  // namespace
+
 Logger& Logger::getInstance() {
   static Logger instance;
   return instance;
 }
 
-Logger::Logger() : min_level_(LogLevel::INFO), output_stream_(&std::cout) {}
+Logger::Logger()
+    : min_level_(LogLevel::INFO),
+      ring_bytes_(Config{}.ring_bytes),
+      overflow_(Config{}.overflow),
+      flush_interval_ms_(Config{}.flush_interval.count()),
+      output_stream_(&std::cout) {
+  // Touch the registry first so it outlives the logger's final drain
+  getGlobalMetrics();
+  background_ = std::thread([this] { backgroundLoop(); });
+}
+
+Logger::~Logger() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stopping_ = true;
+  }
+  wake_cv_.notify_one();
+  background_.join();
+  flush();
+}
+
+void Logger::configure(const Config& config) {
+  // Rings hold whole records, and the wrap marker needs the 8-byte alignment
+  ring_bytes_.store(std::max<size_t>(256, (config.ring_bytes + 7) & ~size_t{7}), std::memory_order_relaxed);
+  overflow_.store(config.overflow, std::memory_order_relaxed);
+  flush_interval_ms_.store(std::max<int64_t>(1, config.flush_interval.count()), std::memory_order_relaxed);
+  wake();
+}
 
 void Logger::setLogLevel(LogLevel level) {
-  min_level_ = level;
+  min_level_.store(level, std::memory_order_relaxed);
 }
 
 LogLevel Logger::getLogLevel() const {
-  return min_level_;
+  return min_level_.load(std::memory_order_relaxed);
 }
 
 void Logger::setOutputStream(std::ostream& stream) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<std::mutex> lock(consume_mutex_);
   output_stream_ = &stream;
 }
 
 void Logger::debug(const std::string& message, const std::string& component,
                    const std::string& correlation_id) {
-  log(LogLevel::DEBUG, message, component, correlation_id);
+  write(messageSite(LogLevel::DEBUG), message, component, correlation_id);
 }
 
 void Logger::info(const std::string& message, const std::string& component,
                   const std::string& correlation_id) {
-  log(LogLevel::INFO, message, component, correlation_id);
+  write(messageSite(LogLevel::INFO), message, component, correlation_id);
 }
 
 void Logger::warn(const std::string& message, const std::string& component,
                   const std::string& correlation_id) {
-  log(LogLevel::WARN, message, component, correlation_id);
+  write(messageSite(LogLevel::WARN), message, component, correlation_id);
 }
 
 void Logger::error(const std::string& message, const std::string& component,
                    const std::string& correlation_id) {
-  log(LogLevel::ERROR, message, component, correlation_id);
+  write(messageSite(LogLevel::ERROR), message, component, correlation_id);
 }
 
 void Logger::fatal(const std::string& message, const std::string& component,
                    const std::string& correlation_id) {
-  log(LogLevel::FATAL, message, component, correlation_id);
+  write(messageSite(LogLevel::FATAL), message, component, correlation_id);
+}
+
+void Logger::flush() {
+  std::lock_guard<std::mutex> lock(consume_mutex_);
+  drainRings();
+}
+
+Logger::Stats Logger::getStats() const {
+  Stats stats;
+  stats.records_written = records_written_.load(std::memory_order_relaxed);
+  stats.records_dropped = records_dropped_.load(std::memory_order_relaxed);
+  stats.batches_written = batches_written_.load(std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    stats.rings = rings_.size();
+  }
+  return stats;
 }
 
 Logger::LogBuilder::LogBuilder(LogLevel level, const std::string& message,
@@ -58,65 +246,180 @@ Logger::LogBuilder::LogBuilder(LogLevel level, const std::string& message,
       correlation_id_(correlation_id) {}
 
 Logger::LogBuilder::~LogBuilder() {
-  Logger::getInstance().log(level_, message_, component_, correlation_id_, fields_);
+  Logger::getInstance().write(messageSite(level_), message_, component_, correlation_id_,
+                              detail::RawLogArgs{fields_, field_args_});
 }
 
-Logger::LogBuilder& Logger::LogBuilder::field(const std::string& key, const std::string& value) {
-  fields_[key] = "\"" + value + "\"";
+template <typename T>
+Logger::LogBuilder& Logger::LogBuilder::append(const std::string& key, const T& value) {
+  const size_t start = fields_.size();
+  fields_.resize(start + detail::encodedSize(key) + detail::encodedSize(value));
+  char* out = detail::encode(&fields_[start], key);
+  detail::encode(out, value);
+  field_args_ += 2;
   return *this;
 }
 
+Logger::LogBuilder& Logger::LogBuilder::field(const std::string& key, const std::string& value) {
+  return append(key, value);
+}
+
 Logger::LogBuilder& Logger::LogBuilder::field(const std::string& key, int value) {
-  fields_[key] = std::to_string(value);
-  return *this;
+  return append(key, value);
 }
 
 Logger::LogBuilder& Logger::LogBuilder::field(const std::string& key, double value) {
-  std::stringstream ss;
-  ss << std::fixed << std::setprecision(6) << value;
-  fields_[key] = ss.str();
-  return *this;
+  return append(key, value);
 }
 
 Logger::LogBuilder& Logger::LogBuilder::field(const std::string& key, bool value) {
-  fields_[key] = value ? "true" : "false";
-  return *this;
+  return append(key, value);
 }
 
-void Logger::log(LogLevel level, const std::string& message,
-                 const std::string& component, const std::string& correlation_id,
-                 const std::unordered_map<std::string, std::string>& fields) {
-  if (level < min_level_) return;
+detail::LogRing& Logger::threadRing() {
+  if (!thread_ring.ring) {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    thread_ring.ring = std::make_shared<detail::LogRing>(ring_bytes_.load(std::memory_order_relaxed),
+                                                         next_thread_index_++);
+    rings_.push_back(thread_ring.ring);
+  }
+  return *thread_ring.ring;
+}
 
-  std::lock_guard<std::mutex> lock(mutex_);
+char* Logger::reserve(detail::LogRing& ring, size_t bytes) {
+  while (true) {
+    if (char* out = ring.reserve(bytes)) return out;
 
-  // Build JSON log entry
-  std::stringstream ss;
-  ss << "{";
-  ss << "\"timestamp\":\"" << getCurrentTimestamp() << "\",";
-  ss << "\"level\":\"" << levelToString(level) << "\",";
-  ss << "\"thread\":\"" << getThreadId() << "\",";
-  ss << "\"message\":\"" << message << "\"";
+    // Larger than this ring (sized when its thread first logged) can never fit
+    if (overflow_.load(std::memory_order_relaxed) == OverflowPolicy::DROP || bytes > ring.capacity()) {
+      records_dropped_.fetch_add(1, std::memory_order_relaxed);
+      static Counter& dropped = getGlobalMetrics().counter("log_records_dropped_total");
+      dropped.increment();
+      return nullptr;
+    }
+    wake();
+    std::this_thread::yield();
+  }
+}
 
-  if (!component.empty()) {
-    ss << ",\"component\":\"" << component << "\"";
+void Logger::wake() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_requested_ = true;
   }
+  wake_cv_.notify_one();
+}
 
-  if (!correlation_id.empty()) {
-    ss << ",\"correlation_id\":\"" << correlation_id << "\"";
+void Logger::backgroundLoop() {
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  while (!stopping_) {
+    wake_cv_.wait_for(lock, std::chrono::milliseconds(flush_interval_ms_.load(std::memory_order_relaxed)),
+                      [this] { return wake_requested_ || stopping_; });
+    wake_requested_ = false;
+    lock.unlock();
+    flush();
+    lock.lock();
   }
+}
 
-  for (const auto& [key, value] : fields) {
-    ss << ",\"" << key << "\":" << value;
+void Logger::drainRings() {
+  std::vector<std::shared_ptr<detail::LogRing>> rings;
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    rings = rings_;
   }
 
-  ss << "}\n";
+  batch_.clear();
+  uint64_t records = 0;
+  for (const auto& ring : rings) {
+    // Read abandonment first: a ring abandoned before its drain is empty after it
+    const bool abandoned = ring->abandoned.load(std::memory_order_acquire);
+    const uint32_t thread_index = ring->threadIndex();
+    records += ring->drain([&](const char* record) { formatRecord(record, thread_index, batch_); });
 
-  *output_stream_ << ss.str();
+    if (abandoned) {
+      std::lock_guard<std::mutex> lock(rings_mutex_);
+      rings_.erase(std::remove(rings_.begin(), rings_.end(), ring), rings_.end());
+    }
+  }
+
+  if (records == 0) return;
+  output_stream_->write(batch_.data(), static_cast<std::streamsize>(batch_.size()));
   output_stream_->flush();
+  records_written_.fetch_add(records, std::memory_order_relaxed);
+  batches_written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Logger::formatRecord(const char* record, uint32_t thread_index, std::string& out) const {
+  detail::RecordHeader header;
+  std::memcpy(&header, record, sizeof(header));
+  const LogSite& site = *header.site;
+
+  std::vector<DecodedArg> args(header.arg_count);
+  const char* in = record + sizeof(header);
+  for (auto& arg : args) {
+    in = decodeArg(in, arg);
+  }
+
+  out += "{\"timestamp\":\"";
+  appendTimestamp(out, header.timestamp_ns);
+  out += "\",\"level\":\"";
+  out += levelToString(site.level);
+  out += "\",\"thread\":\"";
+  out += std::to_string(thread_index);
+  out += "\",\"message\":\"";
+
+  if (site.format) {
+    // Substitute the arguments for the format's placeholders in turn
+    size_t next = 0;
+    for (const char* c = site.format; *c; ++c) {
+      if (c[0] == '{' && c[1] == '}' && next < args.size()) {
+        appendText(out, args[next++]);
+        ++c;
+      } else {
+        appendEscaped(out, std::string_view(c, 1));
+      }
+    }
+    out += "\"";
+    if (site.component && *site.component) {
+      out += ",\"component\":\"";
+      appendEscaped(out, site.component);
+      out += "\"";
+    }
+  } else {
+    // Message, component, correlation id, then key/value field pairs
+    appendEscaped(out, args[0].text);
+    out += "\"";
+    if (!args[1].text.empty()) {
+      out += ",\"component\":\"";
+      appendEscaped(out, args[1].text);
+      out += "\"";
+    }
+    if (!args[2].text.empty()) {
+      out += ",\"correlation_id\":\"";
+      appendEscaped(out, args[2].text);
+      out += "\"";
+    }
+    for (size_t i = 3; i + 1 < args.size(); i += 2) {
+      out += ",\"";
+      appendEscaped(out, args[i].text);
+      out += "\":";
+      appendValue(out, args[i + 1]);
+    }
+  }
+  out += "}\n";
 }
 
-std::string Logger::levelToString(LogLevel level) const {
+const LogSite& Logger::messageSite(LogLevel level) {
+  static constexpr LogSite sites[] = {
+      {LogLevel::DEBUG, nullptr, nullptr}, {LogLevel::INFO, nullptr, nullptr},
+      {LogLevel::WARN, nullptr, nullptr},  {LogLevel::ERROR, nullptr, nullptr},
+      {LogLevel::FATAL, nullptr, nullptr},
+  };
+  return sites[static_cast<int>(level)];
+}
+
+const char* Logger::levelToString(LogLevel level) {
   switch (level) {
     case LogLevel::DEBUG: return "DEBUG";
     case LogLevel::INFO: return "INFO";
@@ -127,23 +430,5 @@ std::string Logger::levelToString(LogLevel level) const {
   }
 }
 
-std::string Logger::getCurrentTimestamp() const {
-  auto now = std::chrono::system_clock::now();
-  auto time_t = std::chrono::system_clock::to_time_t(now);
-  auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
-      now.time_since_epoch()) % 1000000;
-
-  std::stringstream ss;
-  ss << std::put_time(std::gmtime(&time_t), "%Y-%m-%dT%H:%M:%S")
-     << "." << std::setfill('0') << std::setw(6) << microseconds.count() << "Z";
-  return ss.str();
-}
-
-std::string Logger::getThreadId() const {
-  std::stringstream ss;
-  ss << std::this_thread::get_id();
-  return ss.str();
-}
-
 }  // namespace observability
 }  // namespace banking
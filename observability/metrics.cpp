@@ -1,26 +1,144 @@
 #include "metrics.hpp"
 
 #include <algorithm>
+#include <limits>
+#include <mutex>
 #include <sstream>
 
 namespace banking {
 namespace observability {
 
+namespace {
+
+// The series for `key`, created by `make` if it is not registered yet
+template <typename Metric, typename Make>
+Metric& findOrCreate(std::shared_mutex& mutex, std::map<std::pair<std::string, std::string>,
+                     std::unique_ptr<Metric>>& series, std::pair<std::string, std::string> key, Make make) {
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = series.find(key);
+    if (it != series.end()) return *it->second;
+  }
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  auto& slot = series[std::move(key)];
+  if (!slot) slot = make();
+  return *slot;
+}
+
+// Series name with its labels, plus `extra` (e.g. le="0.5") appended
+std::string seriesName(const std::string& name, const std::string& labels, const std::string& extra = "") {
+  if (labels.empty() && extra.empty()) return name;
+  std::string out = name + "{" + labels;
+  if (!labels.empty() && !extra.empty()) out += ",";
+  return out + extra + "}";
+}
+
+}  // namespace
+
+namespace detail {
+
+size_t threadCell() {
+  static std::atomic<size_t> next_cell{0};
+  thread_local const size_t cell = next_cell.fetch_add(1, std::memory_order_relaxed) % kMetricCells;
+  return cell;
+}
+
+}  // namespace detail
+
+double Counter::value() const {
+  double total = 0.0;
+  for (const auto& cell : cells_) {
+    total += cell.value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+void Counter::reset() {
+  for (auto& cell : cells_) {
+    cell.value.store(0.0, std::memory_order_relaxed);
+  }
+}
+
+Histogram::Histogram(std::vector<double> upper_bounds) : upper_bounds_(std::move(upper_bounds)) {
+  std::sort(upper_bounds_.begin(), upper_bounds_.end());
+  lines_per_cell_ = (upper_bounds_.size() + 1 + 7) / 8;
+  lines_ = std::make_unique<CountLine[]>(lines_per_cell_ * detail::kMetricCells);
+}
+
+void Histogram::observe(double value) {
+  // The first bucket whose upper bound is at least the value; past the end is +Inf
+  const size_t bucket = static_cast<size_t>(
+      std::lower_bound(upper_bounds_.begin(), upper_bounds_.end(), value) - upper_bounds_.begin());
+  const size_t cell = detail::threadCell();
+  count(cell, bucket).fetch_add(1, std::memory_order_relaxed);
+  detail::atomicAdd(sums_[cell].value, value);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snapshot;
+  snapshot.upper_bounds = upper_bounds_;
+  snapshot.counts.assign(upper_bounds_.size() + 1, 0);
+  for (size_t cell = 0; cell < detail::kMetricCells; ++cell) {
+    for (size_t bucket = 0; bucket < snapshot.counts.size(); ++bucket) {
+      snapshot.counts[bucket] += count(cell, bucket).load(std::memory_order_relaxed);
+    }
+    snapshot.sum += sums_[cell].value.load(std::memory_order_relaxed);
+  }
+  for (uint64_t bucket_count : snapshot.counts) {
+    snapshot.count += bucket_count;
+  }
+  return snapshot;
+}
+
+void Histogram::reset() {
+  for (size_t cell = 0; cell < detail::kMetricCells; ++cell) {
+    for (size_t bucket = 0; bucket <= upper_bounds_.size(); ++bucket) {
+      count(cell, bucket).store(0, std::memory_order_relaxed);
+    }
+    sums_[cell].value.store(0.0, std::memory_order_relaxed);
+  }
+}
+
 MetricsCollector::MetricsCollector() = default;
+MetricsCollector::~MetricsCollector() = default;
+
+Counter& MetricsCollector::counter(const std::string& name, const Labels& labels) {
+  return findOrCreate(mutex_, counters_, {name, renderLabels(labels)},
+                      [] { return std::make_unique<Counter>(); });
+}
+
+Gauge& MetricsCollector::gauge(const std::string& name, const Labels& labels) {
+  return findOrCreate(mutex_, gauges_, {name, renderLabels(labels)},
+                      [] { return std::make_unique<Gauge>(); });
+}
+
+Histogram& MetricsCollector::histogram(const std::string& name, const Labels& labels,
+                                       const std::vector<double>& upper_bounds) {
+  return findOrCreate(mutex_, histograms_, {name, renderLabels(labels)}, [&] {
+    return std::make_unique<Histogram>(upper_bounds.empty() ? defaultBuckets() : upper_bounds);
+  });
+}
+
+LatencyRecorder& MetricsCollector::latency(const std::string& name, const Labels& labels) {
+  return findOrCreate(mutex_, latencies_, {name, renderLabels(labels)},
+                      [] { return std::make_unique<LatencyRecorder>(); });
+}
+
+RateMeter& MetricsCollector::rate(const std::string& name, const Labels& labels) {
+  return findOrCreate(mutex_, rates_, {name, renderLabels(labels)},
+                      [] { return std::make_unique<RateMeter>(); });
+}
 
 void MetricsCollector::incrementCounter(const std::string& name, double value) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  counters_[name].value += value;
+  counter(name).increment(value);
 }
 
 void MetricsCollector::setGauge(const std::string& name, double value) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  gauges_[name].value = value;
+  gauge(name).set(value);
 }
 
 void MetricsCollector::incrementGauge(const std::string& name, double value) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  gauges_[name].value += value;
+  gauge(name).increment(value);
 }
 
 void MetricsCollector::decrementGauge(const std::string& name, double value) {
@@ -28,90 +146,131 @@ void MetricsCollector::decrementGauge(const std::string& name, double value) {
 }
 
 void MetricsCollector::observeHistogram(const std::string& name, double value) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  auto& hist = histograms_[name];
-
-  // Initialize buckets if not done
-  if (hist.buckets.empty()) {
-    auto buckets = defaultBuckets();
-    for (double bound : buckets) {
-      hist.buckets.push_back({bound, 0});
-    }
-    // Add +Inf bucket
-    hist.buckets.push_back({std::numeric_limits<double>::infinity(), 0});
-  }
-
-  // Update histogram
-  hist.count += 1;
-  hist.sum += value;
-
-  // Find appropriate bucket
-  for (auto& bucket : hist.buckets) {
-    if (value <= bucket.upper_bound) {
-      bucket.count += 1;
-    }
-  }
+  histogram(name).observe(value);
 }
 
 MetricsCollector::Timer::Timer(MetricsCollector& collector, const std::string& name)
-    : collector_(collector), name_(name), start_(std::chrono::steady_clock::now()) {
+    : Timer(collector.histogram(name)) {
+}
+
+MetricsCollector::Timer::Timer(Histogram& histogram)
+    : histogram_(histogram), start_(std::chrono::steady_clock::now()) {
 }
 
 MetricsCollector::Timer::~Timer() {
   auto end = std::chrono::steady_clock::now();
-  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start_);
-  double seconds = duration.count() / 1000000.0;
-  collector_.observeHistogram(name_, seconds);
+  histogram_.observe(std::chrono::duration<double>(end - start_).count());
 }
 
 std::string MetricsCollector::exportMetrics() const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::shared_lock<std::shared_mutex> lock(mutex_);
   std::stringstream ss;
 
+  // One HELP/TYPE header per metric, then each of its series
+  auto header = [&](const std::string& name, const std::string& previous, const char* type) {
+    if (name == previous) return;
+    ss << "# HELP " << name << " " << type << " metric\n";
+    ss << "# TYPE " << name << " " << type << "\n";
+  };
+
   // Export counters
-  for (const auto& [name, counter] : counters_) {
-    ss << "# HELP " << name << " Counter metric\n";
-    ss << "# TYPE " << name << " counter\n";
-    ss << name << " " << counter.value << "\n";
+  std::string previous;
+  for (const auto& [key, counter] : counters_) {
+    header(key.first, previous, "counter");
+    previous = key.first;
+    ss << seriesName(key.first, key.second) << " " << counter->value() << "\n";
   }
 
   // Export gauges
-  for (const auto& [name, gauge] : gauges_) {
-    ss << "# HELP " << name << " Gauge metric\n";
-    ss << "# TYPE " << name << " gauge\n";
-    ss << name << " " << gauge.value << "\n";
+  previous.clear();
+  for (const auto& [key, gauge] : gauges_) {
+    header(key.first, previous, "gauge");
+    previous = key.first;
+    ss << seriesName(key.first, key.second) << " " << gauge->value() << "\n";
   }
 
-  // Export histograms
-  for (const auto& [name, hist] : histograms_) {
-    ss << "# HELP " << name << " Histogram metric\n";
-    ss << "# TYPE " << name << " histogram\n";
+  // Export rates, as gauges
+  previous.clear();
+  for (const auto& [key, rate] : rates_) {
+    header(key.first, previous, "gauge");
+    previous = key.first;
+    ss << seriesName(key.first, key.second) << " " << rate->perSecond() << "\n";
+  }
 
-    size_t cumulative_count = 0;
-    for (size_t i = 0; i < hist.buckets.size(); ++i) {
-      const auto& bucket = hist.buckets[i];
-      cumulative_count += bucket.count;
+  // Export histograms
+  previous.clear();
+  for (const auto& [key, histogram] : histograms_) {
+    header(key.first, previous, "histogram");
+    previous = key.first;
 
-      if (bucket.upper_bound == std::numeric_limits<double>::infinity()) {
-        ss << name << "_bucket{le=\"+Inf\"} " << cumulative_count << "\n";
+    const Histogram::Snapshot snapshot = histogram->snapshot();
+    const std::string bucket_name = key.first + "_bucket";
+    uint64_t cumulative_count = 0;
+    for (size_t i = 0; i < snapshot.counts.size(); ++i) {
+      cumulative_count += snapshot.counts[i];
+      std::ostringstream le;
+      le << "le=\"";
+      if (i < snapshot.upper_bounds.size()) {
+        le << snapshot.upper_bounds[i];
       } else {
-        ss << name << "_bucket{le=\"" << bucket.upper_bound << "\"} " << cumulative_count << "\n";
+        le << "+Inf";
       }
+      le << "\"";
+      ss << seriesName(bucket_name, key.second, le.str()) << " " << cumulative_count << "\n";
     }
 
-    ss << name << "_count " << hist.count << "\n";
-    ss << name << "_sum " << hist.sum << "\n";
+    ss << seriesName(key.first + "_count", key.second) << " " << snapshot.count << "\n";
+    ss << seriesName(key.first + "_sum", key.second) << " " << snapshot.sum << "\n";
+  }
+
+  // Export latencies, as summaries in seconds
+  previous.clear();
+  for (const auto& [key, recorder] : latencies_) {
+    header(key.first, previous, "summary");
+    previous = key.first;
+
+    const LatencyHistogram snapshot = recorder->snapshot();
+    for (const auto& [quantile, percentile] : {std::pair<const char*, double>{"0.5", 50.0},
+                                               {"0.99", 99.0}, {"0.999", 99.9}, {"1", 100.0}}) {
+      const std::string label = std::string("quantile=\"") + quantile + "\"";
+      ss << seriesName(key.first, key.second, label) << " " << snapshot.valueAtPercentile(percentile) / 1e9 << "\n";
+    }
+    ss << seriesName(key.first + "_count", key.second) << " " << snapshot.count() << "\n";
+    ss << seriesName(key.first + "_sum", key.second) << " " << snapshot.mean() * snapshot.count() / 1e9 << "\n";
   }
 
   return ss.str();
 }
 
 void MetricsCollector::reset() {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+
+  for (auto& [key, counter] : counters_) counter->reset();
+  for (auto& [key, gauge] : gauges_) gauge->set(0.0);
+  for (auto& [key, histogram] : histograms_) histogram->reset();
+  for (auto& [key, recorder] : latencies_) recorder->reset();
+  for (auto& [key, rate] : rates_) rate->reset();
+}
 
-  counters_.clear();
-  gauges_.clear();
-  histograms_.clear();
+std::string MetricsCollector::renderLabels(const Labels& labels) {
+  std::string out;
+  for (const auto& [name, value] : labels) {
+    if (!out.empty()) out += ",";
+    out += name + "=\"";
+    // Escape as the Prometheus text format requires
+    for (char c : value) {
+      if (c == '\\' || c == '"') {
+        out += '\\';
+        out += c;
+      } else if (c == '\n') {
+        out += "\\n";
+      } else {
+        out += c;
+      }
+    }
+    out += "\"";
+  }
+  return out;
 }
 
 std::vector<double> MetricsCollector::defaultBuckets() {
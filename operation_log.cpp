@@ -0,0 +1,260 @@
+#include "operation_log.hpp"
+
+#include <string_view>
+#include <unordered_map>
+
+namespace banking {
+namespace oplog {
+
+namespace {
+
+// Snapshot body: a header, then fixed-size account, payment and balance-change
+// records that name accounts by index, then the account names back to back.
+// Every record is 4-byte aligned, so a mapped snapshot can be read in place.
+struct SnapshotHeader {
+  uint32_t accounts;
+  uint32_t payments;
+  uint64_t history;
+  uint64_t names_bytes;
+  int32_t next_payment_ordinal;
+  int32_t latest_timestamp;
+  int32_t history_horizon;
+  uint32_t reserved;
+};
+
+struct SnapshotAccount {
+  uint32_t name_offset;
+  uint32_t name_length;
+  int32_t creation_time;
+  int32_t balance;
+  int32_t outgoing;
+  uint32_t merge_parent;  // Account index, or kNoParent
+  int32_t merge_time;
+  uint8_t live;
+  uint8_t reserved[3];
+};
+
+struct SnapshotPayment {
+  uint32_t account;
+  int32_t ordinal;
+  int32_t amount;
+  int32_t due_timestamp;
+};
+
+struct SnapshotChange {
+  uint32_t account;
+  int32_t timestamp;
+  int32_t delta;
+};
+
+constexpr uint32_t kNoParent = UINT32_MAX;
+
+template <typename Record>
+void appendRecord(std::string& body, const Record& record) {
+  body.append(reinterpret_cast<const char*>(&record), sizeof(record));
+}
+
+}  // namespace
+
+RecordWriter& RecordWriter::batch(const std::vector<BatchOperation>& operations) {
+  int32(static_cast<int32_t>(operations.size()));
+  for (const BatchOperation& op : operations) {
+    byte(static_cast<uint8_t>(op.type))
+        .text(op.account_id)
+        .text(op.target_account_id)
+        .text(op.payment_id)
+        .int32(op.amount)
+        .int32(op.delay);
+  }
+  return *this;
+}
+
+bool applyRecord(BankingSystemImpl& impl, std::string_view record) {
+  RecordReader in(record);
+  const auto operation = static_cast<Operation>(in.byte());
+  const int timestamp = in.int32();
+  const int watermark = in.int32();
+  if (watermark != kNoWatermark) {
+    impl.TopSpenderTotals(watermark, 0);  // Advances the clock and fires what was due by then
+  }
+
+  // Only successful operations are logged singly, so replaying one must succeed again
+  switch (operation) {
+    case Operation::CREATE_ACCOUNT: {
+      const std::string account_id = in.text();
+      return in.complete() && impl.CreateAccount(timestamp, account_id);
+    }
+    case Operation::DEPOSIT: {
+      const std::string account_id = in.text();
+      const int amount = in.int32();
+      return in.complete() && impl.Deposit(timestamp, account_id, amount).has_value();
+    }
+    case Operation::TRANSFER: {
+      const std::string source = in.text();
+      const std::string target = in.text();
+      const int amount = in.int32();
+      return in.complete() && impl.Transfer(timestamp, source, target, amount).has_value();
+    }
+    case Operation::SCHEDULE_PAYMENT: {
+      const std::string account_id = in.text();
+      const int amount = in.int32();
+      const int delay = in.int32();
+      return in.complete() && impl.SchedulePayment(timestamp, account_id, amount, delay).has_value();
+    }
+    case Operation::CANCEL_PAYMENT: {
+      const std::string account_id = in.text();
+      const std::string payment_id = in.text();
+      return in.complete() && impl.CancelPayment(timestamp, account_id, payment_id);
+    }
+    case Operation::MERGE_ACCOUNTS: {
+      const std::string account_id_1 = in.text();
+      const std::string account_id_2 = in.text();
+      return in.complete() && impl.MergeAccounts(timestamp, account_id_1, account_id_2);
+    }
+    case Operation::APPLY_BATCH: {
+      const int32_t count = in.int32();
+      if (count < 0 || static_cast<size_t>(count) > in.remaining()) return false;
+      std::vector<BatchOperation> operations(static_cast<size_t>(count));
+      for (BatchOperation& op : operations) {
+        const uint8_t type = in.byte();
+        if (type > static_cast<uint8_t>(BatchOperation::Type::CANCEL_PAYMENT)) return false;
+        op.type = static_cast<BatchOperation::Type>(type);
+        op.account_id = in.text();
+        op.target_account_id = in.text();
+        op.payment_id = in.text();
+        op.amount = in.int32();
+        op.delay = in.int32();
+      }
+      if (!in.complete()) return false;
+      impl.ApplyBatch(timestamp, operations);
+      return true;
+    }
+    case Operation::COMPACT_HISTORY:
+      if (!in.complete()) return false;
+      impl.CompactHistory(timestamp);
+      return true;
+  }
+  return false;
+}
+
+std::string encodeState(const BankingSystemImpl::SavedState& state) {
+  std::unordered_map<std::string_view, uint32_t> index;
+  index.reserve(state.accounts.size());
+  uint64_t names_bytes = 0;
+  for (uint32_t i = 0; i < state.accounts.size(); ++i) {
+    index.emplace(state.accounts[i].id, i);
+    names_bytes += state.accounts[i].id.size();
+  }
+
+  SnapshotHeader header{};
+  header.accounts = static_cast<uint32_t>(state.accounts.size());
+  header.payments = static_cast<uint32_t>(state.pendingPayments.size());
+  header.history = state.history.size();
+  header.names_bytes = names_bytes;
+  header.next_payment_ordinal = state.nextPaymentOrdinal;
+  header.latest_timestamp = state.latestTimestamp;
+  header.history_horizon = state.historyHorizon;
+
+  std::string body;
+  body.reserve(sizeof(header) + header.accounts * sizeof(SnapshotAccount) +
+               header.payments * sizeof(SnapshotPayment) + header.history * sizeof(SnapshotChange) + names_bytes);
+  appendRecord(body, header);
+
+  uint32_t name_offset = 0;
+  for (const BankingSystemImpl::SavedAccount& account : state.accounts) {
+    SnapshotAccount record{};
+    record.name_offset = name_offset;
+    record.name_length = static_cast<uint32_t>(account.id.size());
+    record.creation_time = account.creationTime;
+    record.balance = account.balance;
+    record.outgoing = account.outgoing;
+    record.merge_parent = account.mergedInto.empty() ? kNoParent : index.at(account.mergedInto);
+    record.merge_time = account.mergeTime;
+    record.live = account.live ? 1 : 0;
+    appendRecord(body, record);
+    name_offset += record.name_length;
+  }
+
+  for (const BankingSystemImpl::SavedPayment& payment : state.pendingPayments) {
+    appendRecord(body, SnapshotPayment{index.at(payment.account), payment.ordinal, payment.amount,
+                                       payment.dueTimestamp});
+  }
+
+  // Exported history is grouped by account, so the lookup rarely runs
+  const std::string* last_account = nullptr;
+  uint32_t account_index = 0;
+  for (const BankingSystemImpl::SavedBalanceChange& change : state.history) {
+    if (!last_account || *last_account != change.account) {
+      account_index = index.at(change.account);
+      last_account = &change.account;
+    }
+    appendRecord(body, SnapshotChange{account_index, change.timestamp, change.delta});
+  }
+
+  for (const BankingSystemImpl::SavedAccount& account : state.accounts) {
+    body.append(account.id);
+  }
+  return body;
+}
+
+bool decodeState(const char* data, size_t size, BankingSystemImpl::SavedState& state) {
+  if (size < sizeof(SnapshotHeader)) {
+    return false;
+  }
+  const auto* header = reinterpret_cast<const SnapshotHeader*>(data);
+  const uint64_t expected = sizeof(SnapshotHeader) + uint64_t{header->accounts} * sizeof(SnapshotAccount) +
+                            uint64_t{header->payments} * sizeof(SnapshotPayment) +
+                            header->history * sizeof(SnapshotChange) + header->names_bytes;
+  if (expected != size) {
+    return false;
+  }
+  const auto* accounts = reinterpret_cast<const SnapshotAccount*>(data + sizeof(SnapshotHeader));
+  const auto* payments = reinterpret_cast<const SnapshotPayment*>(accounts + header->accounts);
+  const auto* history = reinterpret_cast<const SnapshotChange*>(payments + header->payments);
+  const char* names = reinterpret_cast<const char*>(history + header->history);
+
+  state.accounts.resize(header->accounts);
+  for (uint32_t i = 0; i < header->accounts; ++i) {
+    const SnapshotAccount& record = accounts[i];
+    if (uint64_t{record.name_offset} + record.name_length > header->names_bytes) {
+      return false;
+    }
+    BankingSystemImpl::SavedAccount& account = state.accounts[i];
+    account.id.assign(names + record.name_offset, record.name_length);
+    account.creationTime = record.creation_time;
+    account.live = record.live != 0;
+    account.balance = record.balance;
+    account.outgoing = record.outgoing;
+    account.mergeTime = record.merge_time;
+  }
+  for (uint32_t i = 0; i < header->accounts; ++i) {
+    const uint32_t parent = accounts[i].merge_parent;
+    if (parent == kNoParent) continue;
+    if (parent >= header->accounts) return false;
+    state.accounts[i].mergedInto = state.accounts[parent].id;
+  }
+
+  state.pendingPayments.reserve(header->payments);
+  for (uint32_t i = 0; i < header->payments; ++i) {
+    const SnapshotPayment& record = payments[i];
+    if (record.account >= header->accounts) return false;
+    state.pendingPayments.push_back(BankingSystemImpl::SavedPayment{
+        state.accounts[record.account].id, record.ordinal, record.amount, record.due_timestamp});
+  }
+
+  state.history.reserve(header->history);
+  for (uint64_t i = 0; i < header->history; ++i) {
+    const SnapshotChange& record = history[i];
+    if (record.account >= header->accounts) return false;
+    state.history.push_back(
+        BankingSystemImpl::SavedBalanceChange{state.accounts[record.account].id, record.timestamp, record.delta});
+  }
+
+  state.nextPaymentOrdinal = header->next_payment_ordinal;
+  state.latestTimestamp = header->latest_timestamp;
+  state.historyHorizon = header->history_horizon;
+  return true;
+}
+
+}  // namespace oplog
+}  // namespace banking
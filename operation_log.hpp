@@ -0,0 +1,142 @@
+#ifndef OPERATION_LOG_HPP_
+#define OPERATION_LOG_HPP_
+
+#include "banking_core_impl.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace banking {
+namespace oplog {
+
+/**
+ * Encoding of applied mutations as self-contained records, and of a whole
+ * engine as a snapshot body. The WAL (BankingSystemDurable) and the
+ * replication stream (BankingSystemPrimary) carry the same records, so
+ * replaying them in order against a BankingSystemImpl restored from the same
+ * snapshot reproduces the engine that wrote them.
+ */
+
+// Watermark of a record that no unlogged query ran ahead of
+constexpr int kNoWatermark = std::numeric_limits<int>::min();
+
+enum class Operation : uint8_t {
+  CREATE_ACCOUNT = 1,
+  DEPOSIT,
+  TRANSFER,
+  SCHEDULE_PAYMENT,
+  CANCEL_PAYMENT,
+  MERGE_ACCOUNTS,
+  APPLY_BATCH,
+  COMPACT_HISTORY
+};
+
+// A record: [operation][timestamp][read watermark] and then the operation's
+// arguments. Integers are native-endian; strings are length-prefixed.
+class RecordWriter {
+ public:
+  RecordWriter(Operation operation, int timestamp, int watermark) {
+    byte(static_cast<uint8_t>(operation));
+    int32(timestamp);
+    int32(watermark);
+  }
+
+  RecordWriter& byte(uint8_t value) {
+    data_.push_back(static_cast<char>(value));
+    return *this;
+  }
+
+  RecordWriter& int32(int32_t value) {
+    data_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    return *this;
+  }
+
+  RecordWriter& text(const std::string& value) {
+    int32(static_cast<int32_t>(value.size()));
+    data_.append(value);
+    return *this;
+  }
+
+  // Count, then every field of each operation
+  RecordWriter& batch(const std::vector<BatchOperation>& operations);
+
+  const std::string& data() const { return data_; }
+
+ private:
+  std::string data_;
+};
+
+class RecordReader {
+ public:
+  explicit RecordReader(std::string_view data) : data_(data) {}
+
+  uint8_t byte() {
+    if (!need(1)) return 0;
+    return static_cast<uint8_t>(data_[pos_++]);
+  }
+
+  int32_t int32() {
+    int32_t value = 0;
+    if (need(sizeof(value))) {
+      std::memcpy(&value, data_.data() + pos_, sizeof(value));
+      pos_ += sizeof(value);
+    }
+    return value;
+  }
+
+  std::string text() {
+    const int32_t length = int32();
+    if (length < 0 || !need(static_cast<size_t>(length))) {
+      ok_ = false;
+      return {};
+    }
+    std::string value(data_.substr(pos_, static_cast<size_t>(length)));
+    pos_ += static_cast<size_t>(length);
+    return value;
+  }
+
+  size_t remaining() const { return data_.size() - pos_; }
+
+  // Every read stayed in bounds and nothing is left over
+  bool complete() const { return ok_ && pos_ == data_.size(); }
+
+ private:
+  bool need(size_t length) {
+    if (data_.size() - pos_ < length) {
+      ok_ = false;
+      return false;
+    }
+    return true;
+  }
+
+  std::string_view data_;
+  size_t pos_ = 0;
+  bool ok_ = true;
+};
+
+/**
+ * Re-run one record against `impl`. False if the record is malformed, or if
+ * an operation that was logged because it succeeded fails this time.
+ */
+bool applyRecord(BankingSystemImpl& impl, std::string_view record);
+
+/**
+ * Snapshot body: fixed-size, 4-byte aligned records that can be read in place
+ * from a mapped file, followed by the account names.
+ */
+std::string encodeState(const BankingSystemImpl::SavedState& state);
+
+/**
+ * Parse a body written by encodeState; false if it is truncated or inconsistent.
+ */
+bool decodeState(const char* data, size_t size, BankingSystemImpl::SavedState& state);
+
+}  // namespace oplog
+}  // namespace banking
+
+#endif  // OPERATION_LOG_HPP_
@@ -0,0 +1,314 @@
+#include "payment_scheduler.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr int64_t lowBits(int bits) {
+  return (int64_t{1} << bits) - 1;
+}
+
+// Reallocate only containers whose capacity is well past what they hold
+constexpr size_t kShrinkSlack = 64;
+
+template <typename Container>
+void shrinkIfSparse(Container& container) {
+  if (container.capacity() > 2 * container.size() + kShrinkSlack) {
+    container.shrink_to_fit();
+  }
+}
+
+}  // namespace
+
+void PaymentScheduler::schedule(Payment payment) {
+  const int ordinal = payment.ordinal;
+  const int64_t due = payment.dueTimestamp;
+  if (payment.account >= byAccount_.size()) {
+    byAccount_.resize(payment.account + 1);
+  }
+  byAccount_[payment.account].emplace(payment.dueTimestamp, ordinal);
+  Pending& pending = pending_[ordinal];
+  pending.payment = std::move(payment);
+  insertEntry(Entry{due, ordinal, &pending});
+}
+
+const PaymentScheduler::Payment* PaymentScheduler::findPending(int ordinal) const {
+  auto it = pending_.find(ordinal);
+  return it == pending_.end() ? nullptr : &it->second.payment;
+}
+
+bool PaymentScheduler::cancel(int ordinal) {
+  auto it = pending_.find(ordinal);
+  if (it == pending_.end()) {
+    return false;
+  }
+  const Payment& payment = it->second.payment;
+  byAccount_[payment.account].erase({payment.dueTimestamp, ordinal});
+  removeEntry(it->second);
+  pending_.erase(it);
+  return true;
+}
+
+void PaymentScheduler::advance(int now, const FireCallback& fire) {
+  // Late arrivals (scheduled behind the sweep) precede everything still on the wheel
+  if (!ready_.empty()) {
+    EntryList entries;
+    size_t kept = 0;
+    for (size_t i = 0; i < ready_.size(); ++i) {
+      const Entry entry = ready_[i];
+      if (entry.due > now) {
+        entry.owner->index = kept;
+        ready_[kept++] = entry;
+      } else {
+        entry.owner->level = kFiring;
+        entries.push_back(entry);
+      }
+    }
+    ready_.resize(kept);
+    fireEntries(entries, fire);
+  }
+
+  const int64_t limit = now;
+  while (true) {
+    int64_t next = nextEventTick();
+    if (next > limit) break;
+
+    current_ = next;
+    cascadeAt(current_);
+    const int slot = static_cast<int>(current_ & lowBits(kSlotBits));
+    if (occupied_[0] & (uint64_t{1} << slot)) {
+      EntryList entries = std::move(wheel_[0][slot]);
+      wheel_[0][slot].clear();
+      occupied_[0] &= ~(uint64_t{1} << slot);
+      for (const Entry& entry : entries) {
+        entry.owner->level = kFiring;
+      }
+      fireEntries(entries, fire);
+    }
+  }
+
+  // Nothing is due before the next event, so the sweep may jump straight past `now`;
+  // if that lands on a slot boundary, its slot must be cascaded like any other
+  if (current_ <= limit) {
+    current_ = limit + 1;
+    cascadeAt(current_);
+  }
+}
+
+void PaymentScheduler::advanceAccount(uint32_t account, int now, const FireCallback& fire) {
+  if (account >= byAccount_.size()) {
+    return;
+  }
+  const auto& due = byAccount_[account];
+  while (!due.empty() && due.begin()->first <= now) {
+    firePending(due.begin()->second, fire);
+  }
+
+  // With nothing pending the sweep can skip ahead at no cost, so payments scheduled
+  // next land on the wheel relative to now rather than in overflow
+  if (pending_.empty() && current_ <= now) {
+    current_ = int64_t{now} + 1;
+  }
+}
+
+void PaymentScheduler::reassign(uint32_t from, uint32_t to) {
+  if (from >= byAccount_.size() || byAccount_[from].empty() || from == to) {
+    return;
+  }
+  if (to >= byAccount_.size()) {
+    byAccount_.resize(to + 1);
+  }
+  DueSet moved = std::move(byAccount_[from]);
+  byAccount_[from].clear();
+  for (const auto& key : moved) {
+    pending_[key.second].payment.account = to;
+  }
+  byAccount_[to].merge(moved);
+}
+
+std::vector<PaymentScheduler::Payment> PaymentScheduler::takePending(uint32_t account) {
+  std::vector<Payment> payments;
+  if (account >= byAccount_.size()) {
+    return payments;
+  }
+  DueSet taken = std::move(byAccount_[account]);
+  byAccount_[account].clear();
+  payments.reserve(taken.size());
+  for (const auto& key : taken) {
+    auto itPending = pending_.find(key.second);
+    removeEntry(itPending->second);
+    payments.push_back(std::move(itPending->second.payment));
+    pending_.erase(itPending);
+  }
+  return payments;
+}
+
+std::vector<PaymentScheduler::Payment> PaymentScheduler::pendingPayments() const {
+  std::vector<Payment> payments;
+  payments.reserve(pending_.size());
+  for (const auto& entry : pending_) {
+    payments.push_back(entry.second.payment);
+  }
+  std::sort(payments.begin(), payments.end(),
+            [](const Payment& a, const Payment& b) { return a.ordinal < b.ordinal; });
+  return payments;
+}
+
+void PaymentScheduler::shrink() {
+  for (auto& level : wheel_) {
+    for (EntryList& entries : level) {
+      shrinkIfSparse(entries);
+    }
+  }
+  shrinkIfSparse(ready_);
+
+  // Accounts merged away keep an empty slot; only trailing ones can go
+  while (!byAccount_.empty() && byAccount_.back().empty()) {
+    byAccount_.pop_back();
+  }
+  shrinkIfSparse(byAccount_);
+  if (pending_.bucket_count() > 4 * pending_.size() + kShrinkSlack) {
+    pending_.rehash(0);
+  }
+}
+
+size_t PaymentScheduler::entryCount() const {
+  size_t entries = ready_.size() + overflow_.size();
+  for (const auto& level : wheel_) {
+    for (const EntryList& slot : level) {
+      entries += slot.size();
+    }
+  }
+  return entries;
+}
+
+void PaymentScheduler::insertEntry(const Entry& entry) {
+  Pending& owner = *entry.owner;
+  if (entry.due < current_) {
+    owner.level = kReady;
+    owner.index = ready_.size();
+    ready_.push_back(entry);
+    return;
+  }
+
+  // Level = highest 6-bit group in which the due time differs from the sweep position
+  const uint64_t diff = static_cast<uint64_t>(entry.due ^ current_);
+  if (diff >> kWheelBits) {
+    owner.level = kOverflow;
+    owner.overflow = overflow_.emplace(entry.due, entry);
+    return;
+  }
+  int level = 0;
+  while (level < kLevels - 1 && (diff >> (kSlotBits * (level + 1))) != 0) {
+    ++level;
+  }
+  const int slot = static_cast<int>((entry.due >> (kSlotBits * level)) & lowBits(kSlotBits));
+  owner.level = level;
+  owner.slot = slot;
+  owner.index = wheel_[level][slot].size();
+  wheel_[level][slot].push_back(entry);
+  occupied_[level] |= uint64_t{1} << slot;
+}
+
+void PaymentScheduler::removeEntry(Pending& pending) {
+  switch (pending.level) {
+    case kFiring:
+      return;
+    case kOverflow:
+      overflow_.erase(pending.overflow);
+      break;
+    case kReady:
+      removeAt(ready_, pending.index);
+      break;
+    default:
+      removeAt(wheel_[pending.level][pending.slot], pending.index);
+      if (wheel_[pending.level][pending.slot].empty()) {
+        occupied_[pending.level] &= ~(uint64_t{1} << pending.slot);
+      }
+      break;
+  }
+  pending.level = kFiring;
+}
+
+void PaymentScheduler::removeAt(EntryList& entries, size_t index) {
+  // Slots are unordered (a sweep sorts what it fires), so the last entry fills the gap
+  entries[index] = entries.back();
+  entries[index].owner->index = index;
+  entries.pop_back();
+}
+
+int64_t PaymentScheduler::nextEventTick() const {
+  int64_t best = INT64_MAX;
+
+  for (int level = 0; level < kLevels; ++level) {
+    const int shift = kSlotBits * level;
+    const int index = static_cast<int>((current_ >> shift) & lowBits(kSlotBits));
+    // Above level 0 the current slot has already been cascaded
+    const int from = level == 0 ? index : index + 1;
+    if (from >= kSlots) continue;
+
+    const uint64_t candidates = occupied_[level] & (~uint64_t{0} << from);
+    if (candidates == 0) continue;
+    const int slot = __builtin_ctzll(candidates);
+    const int64_t tick = (current_ & ~lowBits(shift + kSlotBits)) + (int64_t{slot} << shift);
+    best = std::min(best, tick);
+  }
+
+  if (!overflow_.empty()) {
+    best = std::min(best, overflow_.begin()->first & ~lowBits(kWheelBits));
+  }
+  return best;
+}
+
+void PaymentScheduler::cascadeAt(int64_t tick) {
+  // Entering a new top-level rotation: pull in overflow entries that now fit
+  if ((tick & lowBits(kWheelBits)) == 0 && !overflow_.empty()) {
+    auto end = overflow_.lower_bound(tick + (int64_t{1} << kWheelBits));
+    EntryList entries;
+    for (auto it = overflow_.begin(); it != end; ++it) {
+      entries.push_back(it->second);
+    }
+    overflow_.erase(overflow_.begin(), end);
+    for (const Entry& entry : entries) {
+      insertEntry(entry);
+    }
+  }
+
+  for (int level = kLevels - 1; level >= 1; --level) {
+    const int shift = kSlotBits * level;
+    if ((tick & lowBits(shift)) != 0) continue;
+
+    const int slot = static_cast<int>((tick >> shift) & lowBits(kSlotBits));
+    if ((occupied_[level] & (uint64_t{1} << slot)) == 0) continue;
+
+    EntryList entries = std::move(wheel_[level][slot]);
+    wheel_[level][slot].clear();
+    occupied_[level] &= ~(uint64_t{1} << slot);
+    for (const Entry& entry : entries) {
+      insertEntry(entry);
+    }
+  }
+}
+
+void PaymentScheduler::fireEntries(EntryList& entries, const FireCallback& fire) {
+  std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+    if (a.due != b.due) return a.due < b.due;
+    return a.ordinal < b.ordinal;
+  });
+  for (const Entry& entry : entries) {
+    firePending(entry.ordinal, fire);
+  }
+}
+
+void PaymentScheduler::firePending(int ordinal, const FireCallback& fire) {
+  auto it = pending_.find(ordinal);
+  if (it == pending_.end()) {
+    return;
+  }
+  removeEntry(it->second);
+  Payment payment = std::move(it->second.payment);
+  pending_.erase(it);
+
+  byAccount_[payment.account].erase({payment.dueTimestamp, ordinal});
+  fire(payment);
+}
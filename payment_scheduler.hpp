@@ -0,0 +1,153 @@
+#ifndef PAYMENT_SCHEDULER_HPP_
+#define PAYMENT_SCHEDULER_HPP_
+
+#include "engine_allocator.hpp"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Pending scheduled payments, keyed by their integer ordinal and owned by an
+ * account handle (see AccountInterner).
+ *
+ * Due times live in a hierarchical timing wheel (4 levels of 64 slots, with
+ * an ordered overflow list beyond 2^24 ticks), so a sweep only visits slots
+ * that hold payments instead of walking every due time. An account index
+ * keeps each account's pending payments in due order, so single-account
+ * operations settle just that account and merges move just its payments.
+ *
+ * Payments fire in (due time, ordinal) order. Each pending payment knows where
+ * its wheel entry is, so firing one through the account index or canceling it
+ * removes the entry right away; the wheel only ever holds pending payments.
+ */
+class PaymentScheduler {
+ public:
+  struct Payment {
+    uint32_t account = 0;
+    int amount = 0;
+    int dueTimestamp = 0;
+    int ordinal = 0;  // Global creation order; the numeric part of the payment id
+  };
+
+  using FireCallback = std::function<void(const Payment&)>;
+
+  PaymentScheduler() = default;
+
+  // Non-copyable
+  PaymentScheduler(const PaymentScheduler&) = delete;
+  PaymentScheduler& operator=(const PaymentScheduler&) = delete;
+
+  /**
+   * Add a pending payment. Its ordinal must not already be pending.
+   */
+  void schedule(Payment payment);
+
+  /**
+   * The pending payment with `ordinal`, or nullptr if it fired, was canceled or never existed.
+   */
+  const Payment* findPending(int ordinal) const;
+
+  /**
+   * Drop a pending payment without firing it.
+   */
+  bool cancel(int ordinal);
+
+  /**
+   * Fire every pending payment due at or before `now`, across all accounts.
+   */
+  void advance(int now, const FireCallback& fire);
+
+  /**
+   * Fire the pending payments of one account due at or before `now`.
+   */
+  void advanceAccount(uint32_t account, int now, const FireCallback& fire);
+
+  /**
+   * Make every pending payment of `from` belong to `to` (used by merges).
+   */
+  void reassign(uint32_t from, uint32_t to);
+
+  /**
+   * Remove and return the pending payments of `account`, in firing order.
+   */
+  std::vector<Payment> takePending(uint32_t account);
+
+  /**
+   * Copies of every pending payment, in ordinal order.
+   */
+  std::vector<Payment> pendingPayments() const;
+
+  /**
+   * Release capacity the containers kept from earlier peaks. Only containers
+   * holding far more than they use are reallocated, so repeated calls are cheap.
+   */
+  void shrink();
+
+  size_t pendingCount() const { return pending_.size(); }
+  // Wheel, overflow and late-arrival entries; one per pending payment
+  size_t entryCount() const;
+
+ private:
+  static constexpr int kLevels = 4;
+  static constexpr int kSlotBits = 6;
+  static constexpr int kSlots = 1 << kSlotBits;
+  static constexpr int kWheelBits = kLevels * kSlotBits;
+
+  struct Pending;
+
+  struct Entry {
+    int64_t due;
+    int ordinal;
+    Pending* owner;  // Only valid while the payment is pending
+  };
+
+  template <typename T>
+  using Allocator = EngineAllocator<T, EngineStructure::PAYMENTS>;
+  using EntryList = std::vector<Entry, Allocator<Entry>>;
+  using OverflowMap = std::multimap<int64_t, Entry, std::less<int64_t>, Allocator<std::pair<const int64_t, Entry>>>;
+  using DueSet = std::set<std::pair<int, int>, std::less<std::pair<int, int>>, Allocator<std::pair<int, int>>>;
+
+  // Pending::level values besides a wheel level
+  static constexpr int kReady = -1;
+  static constexpr int kOverflow = -2;
+  static constexpr int kFiring = -3;  // Taken off the wheel by a sweep that is firing it
+
+  // A pending payment and where its entry is
+  struct Pending {
+    Payment payment;
+    int level = kFiring;
+    int slot = 0;
+    size_t index = 0;  // In the wheel slot or ready_
+    OverflowMap::iterator overflow;
+  };
+
+  void insertEntry(const Entry& entry);
+  // Take a payment's entry off the wheel, if a sweep has not already
+  void removeEntry(Pending& pending);
+  void removeAt(EntryList& entries, size_t index);
+  int64_t nextEventTick() const;
+  void cascadeAt(int64_t tick);
+  void fireEntries(EntryList& entries, const FireCallback& fire);
+  void firePending(int ordinal, const FireCallback& fire);
+
+  // Node-based, so an Entry's owner pointer stays valid across rehashing
+  std::unordered_map<int, Pending, std::hash<int>, std::equal_to<int>, Allocator<std::pair<const int, Pending>>>
+      pending_;
+  // (due, ordinal) of each account's pending payments, indexed by handle
+  std::vector<DueSet, Allocator<DueSet>> byAccount_;
+
+  // Every tick before current_ has been swept
+  int64_t current_ = INT64_MIN;
+  std::array<std::array<EntryList, kSlots>, kLevels> wheel_;
+  std::array<uint64_t, kLevels> occupied_{};  // Bit per non-empty slot
+  OverflowMap overflow_;  // Too far ahead for the wheel
+  EntryList ready_;  // Scheduled already due (behind current_)
+};
+
+#endif  // PAYMENT_SCHEDULER_HPP_
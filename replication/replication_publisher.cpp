@@ -0,0 +1,309 @@
+#include "replication/replication_publisher.hpp"
+#include "replication/replication_stream.hpp"
+#include "network/protocol.hpp"
+#include "network/reactor.hpp"
+#include "observability/metrics.hpp"
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace banking {
+namespace replication {
+
+namespace {
+
+constexpr network::protocol::FramingVersion kFraming = network::protocol::FramingVersion::V2_BINARY;
+
+void appendFramed(std::string& out, FrameKind kind, uint64_t sequence, std::string_view payload = {}) {
+  const size_t frame_start = network::protocol::MessageFramer::beginFrame(out, kFraming);
+  appendMessage(out, kind, sequence, payload);
+  network::protocol::MessageFramer::finishFrame(out, frame_start, kFraming);
+}
+
+// A fresh log id for each publisher; random, so a restarted primary never repeats one
+uint64_t newLogId() {
+  std::random_device device;
+  std::mt19937_64 generator((uint64_t{device()} << 32 | device()) ^
+                            static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+  uint64_t id = 0;
+  while (id == 0) id = generator();
+  return id;
+}
+
+struct Hello {
+  uint64_t applied;  // Last sequence the follower applied
+  uint64_t log_id;   // The log it came from
+};
+
+// The follower's hello. nullopt if it hung up or sent garbage.
+std::optional<Hello> readHello(int socket) {
+  network::protocol::FrameBuffer input(64);
+  std::string_view hello;
+  try {
+    while (!network::protocol::MessageFramer::nextFrame(input, kFraming, hello)) {
+      char* buffer = input.prepareWrite(64);
+      const ssize_t bytes_read = read(socket, buffer, 64);
+      if (bytes_read <= 0) return std::nullopt;
+      input.commitWrite(static_cast<size_t>(bytes_read));
+    }
+  } catch (const std::exception&) {
+    return std::nullopt;
+  }
+  if (hello.size() != kHelloSize) return std::nullopt;
+  Hello parsed;
+  std::memcpy(&parsed.applied, hello.data(), sizeof(parsed.applied));
+  std::memcpy(&parsed.log_id, hello.data() + sizeof(parsed.applied), sizeof(parsed.log_id));
+  return parsed;
+}
+
+}  // namespace
+
+ReplicationPublisher::ReplicationPublisher(const Config& config, SnapshotSource snapshot_source)
+    : config_(config), snapshot_source_(std::move(snapshot_source)), log_id_(newLogId()) {
+}
+
+ReplicationPublisher::~ReplicationPublisher() {
+  stop();
+}
+
+bool ReplicationPublisher::start() {
+  if (running_) return true;
+
+  server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (server_socket_ < 0) {
+    std::cerr << "Failed to create replication socket" << std::endl;
+    return false;
+  }
+
+  int opt = 1;
+  if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+    std::cerr << "Failed to set replication socket options" << std::endl;
+    close(server_socket_);
+    server_socket_ = -1;
+    return false;
+  }
+
+  struct sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = INADDR_ANY;
+  address.sin_port = htons(config_.port);
+
+  if (bind(server_socket_, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+      listen(server_socket_, 16) < 0) {
+    std::cerr << "Failed to listen for followers on port " << config_.port << std::endl;
+    close(server_socket_);
+    server_socket_ = -1;
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = false;
+  }
+  running_ = true;
+  accept_thread_ = std::make_unique<std::thread>(&ReplicationPublisher::acceptLoop, this);
+
+  std::cout << "Replication publisher listening on port " << config_.port << std::endl;
+  return true;
+}
+
+void ReplicationPublisher::stop() {
+  if (!running_) return;
+  running_ = false;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  published_.notify_all();
+
+  if (server_socket_ >= 0) {
+    shutdown(server_socket_, SHUT_RDWR);
+    close(server_socket_);
+    server_socket_ = -1;
+  }
+  if (accept_thread_ && accept_thread_->joinable()) {
+    accept_thread_->join();
+  }
+
+  // Joined outside the lock because each sender takes followers_mutex_ on its way out
+  std::unordered_map<int, std::unique_ptr<std::thread>> threads;
+  {
+    std::lock_guard<std::mutex> lock(followers_mutex_);
+    for (auto& pair : follower_threads_) {
+      shutdown(pair.first, SHUT_RDWR);
+    }
+    threads.swap(follower_threads_);
+  }
+  for (auto& pair : threads) {
+    if (pair.second && pair.second->joinable()) {
+      pair.second->join();
+    }
+  }
+}
+
+uint64_t ReplicationPublisher::publish(std::string record) {
+  uint64_t sequence;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sequence = next_sequence_++;
+    records_.push_back(std::move(record));
+    if (records_.size() > config_.retained_records) {
+      records_.pop_front();
+      ++first_retained_;
+    }
+  }
+  published_.notify_all();
+  return sequence;
+}
+
+uint64_t ReplicationPublisher::lastSequence() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return next_sequence_ - 1;
+}
+
+ReplicationPublisher::Stats ReplicationPublisher::getStats() const {
+  Stats stats;
+  stats.log_id = log_id_;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.last_sequence = next_sequence_ - 1;
+    stats.first_retained = first_retained_;
+  }
+  {
+    std::lock_guard<std::mutex> lock(followers_mutex_);
+    stats.followers = follower_threads_.size();
+  }
+  stats.records_sent = records_sent_.load();
+  stats.snapshots_sent = snapshots_sent_.load();
+  return stats;
+}
+
+void ReplicationPublisher::acceptLoop() {
+  while (running_) {
+    struct sockaddr_in follower_address;
+    socklen_t address_length = sizeof(follower_address);
+    int follower_socket = accept(server_socket_, (struct sockaddr*)&follower_address, &address_length);
+    if (follower_socket < 0) {
+      if (running_) {
+        std::cerr << "Failed to accept follower connection" << std::endl;
+      }
+      continue;
+    }
+
+    char follower_ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &follower_address.sin_addr, follower_ip, INET_ADDRSTRLEN);
+    std::string addr = std::string(follower_ip) + ":" + std::to_string(ntohs(follower_address.sin_port));
+
+    std::lock_guard<std::mutex> lock(followers_mutex_);
+    follower_threads_[follower_socket] =
+        std::make_unique<std::thread>(&ReplicationPublisher::serveFollower, this, follower_socket, addr);
+  }
+}
+
+void ReplicationPublisher::serveFollower(int socket, std::string addr) {
+  auto& metrics = observability::getGlobalMetrics();
+  observability::Counter& records_sent = metrics.counter("replication_records_sent_total");
+  observability::Gauge& followers = metrics.gauge("replication_followers");
+
+  std::optional<Hello> hello = readHello(socket);
+  std::string out;
+  if (hello) {
+    appendFramed(out, FrameKind::LOG_ID, log_id_);
+    if (!network::detail::sendAll(socket, out)) hello.reset();
+  }
+  if (hello) {
+    // Another log's sequences say nothing about this one's
+    const bool same_log = hello->log_id == log_id_;
+    std::cout << "Replication follower " << addr << " connected after sequence " << hello->applied
+              << (same_log || hello->applied == 0 ? "" : " of another log") << std::endl;
+    followers.increment();
+
+    uint64_t next = hello->applied + 1;
+    bool need_snapshot = hello->applied == 0 || !same_log;
+    while (running_) {
+      if (need_snapshot) {
+        if (!sendSnapshot(socket, next)) break;
+        need_snapshot = false;
+      }
+
+      out.clear();
+      const uint64_t first = next;
+      const Batch batch = collect(next, out);
+      if (batch == Batch::STOPPING) break;
+      if (batch == Batch::SNAPSHOT_NEEDED) {
+        need_snapshot = true;
+        continue;
+      }
+      if (!network::detail::sendAll(socket, out)) break;
+      if (next > first) {
+        records_sent_ += next - first;
+        records_sent.increment(static_cast<double>(next - first));
+      }
+    }
+    followers.decrement();
+  }
+
+  // If stop() already claimed the thread it will join it; otherwise detach before erasing
+  {
+    std::lock_guard<std::mutex> lock(followers_mutex_);
+    auto it = follower_threads_.find(socket);
+    if (it != follower_threads_.end()) {
+      it->second->detach();
+      follower_threads_.erase(it);
+    }
+  }
+  close(socket);
+  std::cout << "Replication follower " << addr << " disconnected" << std::endl;
+}
+
+bool ReplicationPublisher::sendSnapshot(int socket, uint64_t& next) {
+  uint64_t sequence = 0;
+  const std::string body = snapshot_source_(sequence);
+
+  std::string out;
+  for (size_t offset = 0; offset < body.size(); offset += kSnapshotChunkSize) {
+    out.clear();
+    appendFramed(out, FrameKind::SNAPSHOT_CHUNK, sequence,
+                 std::string_view(body).substr(offset, kSnapshotChunkSize));
+    if (!network::detail::sendAll(socket, out)) return false;
+  }
+  out.clear();
+  appendFramed(out, FrameKind::SNAPSHOT_END, sequence);
+  if (!network::detail::sendAll(socket, out)) return false;
+
+  next = sequence + 1;
+  ++snapshots_sent_;
+  observability::getGlobalMetrics().incrementCounter("replication_snapshots_sent_total");
+  return true;
+}
+
+ReplicationPublisher::Batch ReplicationPublisher::collect(uint64_t& next, std::string& out) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  published_.wait_for(lock, config_.heartbeat_interval, [&] { return stopping_ || next < next_sequence_; });
+  if (stopping_) return Batch::STOPPING;
+
+  // Evicted from the window, or ahead of a log that restarted
+  if (next < first_retained_ || next > next_sequence_) return Batch::SNAPSHOT_NEEDED;
+
+  while (next < next_sequence_ && out.size() < config_.max_send_bytes) {
+    appendFramed(out, FrameKind::RECORD, next, records_[next - first_retained_]);
+    ++next;
+  }
+  // Tells the follower it has seen everything up to now, which bounds its staleness
+  if (next == next_sequence_) {
+    appendFramed(out, FrameKind::HEARTBEAT, next - 1);
+  }
+  return Batch::READY;
+}
+
+}  // namespace replication
+}  // namespace banking
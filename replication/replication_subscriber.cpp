@@ -0,0 +1,180 @@
+#include "replication/replication_subscriber.hpp"
+#include "replication/replication_stream.hpp"
+#include "network/protocol.hpp"
+#include "network/reactor.hpp"
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace banking {
+namespace replication {
+
+namespace {
+
+constexpr network::protocol::FramingVersion kFraming = network::protocol::FramingVersion::V2_BINARY;
+constexpr size_t kReadChunkSize = 64 * 1024;
+
+}  // namespace
+
+ReplicationSubscriber::ReplicationSubscriber(const Config& config, Handler handler)
+    : config_(config), handler_(std::move(handler)) {
+}
+
+ReplicationSubscriber::~ReplicationSubscriber() {
+  stop();
+}
+
+void ReplicationSubscriber::start(uint64_t applied_sequence, uint64_t log_id) {
+  if (running_) return;
+  applied_sequence_ = applied_sequence;
+  log_id_ = log_id;
+  running_ = true;
+  receive_thread_ = std::make_unique<std::thread>(&ReplicationSubscriber::receiveLoop, this);
+}
+
+void ReplicationSubscriber::stop() {
+  if (!running_) return;
+  {
+    std::lock_guard<std::mutex> lock(socket_mutex_);
+    running_ = false;
+    if (socket_ >= 0) {
+      shutdown(socket_, SHUT_RDWR);
+    }
+  }
+  stopped_.notify_all();
+  if (receive_thread_ && receive_thread_->joinable()) {
+    receive_thread_->join();
+  }
+}
+
+void ReplicationSubscriber::receiveLoop() {
+  while (running_) {
+    int socket = connectToPrimary();
+    if (socket >= 0) {
+      connected_ = true;
+      follow(socket);
+      connected_ = false;
+      {
+        std::lock_guard<std::mutex> lock(socket_mutex_);
+        socket_ = -1;
+      }
+      close(socket);
+    }
+
+    std::unique_lock<std::mutex> lock(socket_mutex_);
+    stopped_.wait_for(lock, config_.reconnect_interval, [this] { return !running_; });
+  }
+}
+
+int ReplicationSubscriber::connectToPrimary() {
+  int socket = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (socket < 0) {
+    std::cerr << "Failed to create replication socket" << std::endl;
+    return -1;
+  }
+
+  struct sockaddr_in primary_address;
+  std::memset(&primary_address, 0, sizeof(primary_address));
+  primary_address.sin_family = AF_INET;
+  primary_address.sin_port = htons(config_.primary_port);
+  if (inet_pton(AF_INET, config_.primary_host.c_str(), &primary_address.sin_addr) <= 0 ||
+      ::connect(socket, (struct sockaddr*)&primary_address, sizeof(primary_address)) < 0) {
+    close(socket);
+    return -1;
+  }
+
+  const uint64_t resume[] = {applied_sequence_.load(), log_id_.load()};
+  static_assert(sizeof(resume) == kHelloSize, "hello layout");
+  std::string hello;
+  network::protocol::MessageFramer::appendFrame(
+      hello, std::string_view(reinterpret_cast<const char*>(resume), sizeof(resume)), kFraming);
+  if (!network::detail::sendAll(socket, hello)) {
+    close(socket);
+    return -1;
+  }
+
+  std::lock_guard<std::mutex> lock(socket_mutex_);
+  if (!running_) {
+    close(socket);
+    return -1;
+  }
+  socket_ = socket;
+  return socket;
+}
+
+void ReplicationSubscriber::follow(int socket) {
+  network::protocol::FrameBuffer input(kReadChunkSize);
+  std::string snapshot;  // Chunks of the snapshot being received
+  uint64_t stream_log = 0;  // The log this connection streams, once the primary says
+
+  while (running_) {
+    char* buffer = input.prepareWrite(kReadChunkSize);
+    const ssize_t bytes_read = read(socket, buffer, kReadChunkSize);
+    if (bytes_read <= 0) return;
+    input.commitWrite(static_cast<size_t>(bytes_read));
+
+    std::string_view frame;
+    try {
+      while (network::protocol::MessageFramer::nextFrame(input, kFraming, frame)) {
+        FrameKind kind;
+        uint64_t sequence;
+        std::string_view payload;
+        bool accepted = parseMessage(frame, kind, sequence, payload);
+        const uint64_t applied = applied_sequence_.load();
+
+        if (accepted) {
+          switch (kind) {
+            case FrameKind::LOG_ID:
+              stream_log = sequence;
+              break;
+            case FrameKind::RECORD:
+              // A record only follows what was applied if both come from the same log
+              accepted = stream_log != 0 && stream_log == log_id_.load() && sequence == applied + 1 &&
+                         handler_.record(sequence, payload);
+              if (accepted) applied_sequence_ = sequence;
+              break;
+            case FrameKind::SNAPSHOT_CHUNK:
+              snapshot.append(payload.data(), payload.size());
+              break;
+            case FrameKind::SNAPSHOT_END:
+              accepted = stream_log != 0 && handler_.snapshot(sequence, snapshot);
+              snapshot.clear();
+              snapshot.shrink_to_fit();
+              if (accepted) {
+                applied_sequence_ = sequence;
+                log_id_ = stream_log;
+              }
+              break;
+            case FrameKind::HEARTBEAT:
+              if (sequence == applied && stream_log == log_id_.load() && handler_.caught_up) {
+                handler_.caught_up(sequence);
+              }
+              break;
+            default:
+              accepted = false;
+              break;
+          }
+        }
+
+        if (!accepted) {
+          // Whatever was applied may now disagree with the primary; start over from a snapshot
+          std::cerr << "Replication stream from " << config_.primary_host << ":" << config_.primary_port
+                    << " did not apply after sequence " << applied << "; resynchronizing" << std::endl;
+          applied_sequence_ = 0;
+          log_id_ = 0;
+          return;
+        }
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Malformed replication frame: " << e.what() << std::endl;
+      return;
+    }
+  }
+}
+
+}  // namespace replication
+}  // namespace banking
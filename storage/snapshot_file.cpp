@@ -0,0 +1,163 @@
+#include "snapshot_file.hpp"
+#include "file_io.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace banking {
+namespace storage {
+
+namespace {
+
+const char kSnapshotPrefix[] = "snapshot-";
+const char kSnapshotSuffix[] = ".snap";
+const char kTemporarySuffix[] = ".snap.tmp";
+
+constexpr char kMagic[8] = {'B', 'N', 'K', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t kVersion = 1;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t body_crc;
+  uint64_t wal_sequence;
+  uint64_t body_size;
+  uint8_t reserved[32];
+};
+static_assert(sizeof(FileHeader) == 64, "snapshot bodies start 64-byte aligned");
+
+}  // namespace
+
+SnapshotFile::~SnapshotFile() {
+  if (mapping_) {
+    ::munmap(mapping_, mapping_size_);
+  }
+}
+
+SnapshotFile::SnapshotFile(SnapshotFile&& other) noexcept
+    : mapping_(other.mapping_),
+      mapping_size_(other.mapping_size_),
+      body_size_(other.body_size_),
+      wal_sequence_(other.wal_sequence_),
+      path_(std::move(other.path_)) {
+  other.mapping_ = nullptr;
+}
+
+SnapshotFile& SnapshotFile::operator=(SnapshotFile&& other) noexcept {
+  if (this != &other) {
+    if (mapping_) {
+      ::munmap(mapping_, mapping_size_);
+    }
+    mapping_ = other.mapping_;
+    mapping_size_ = other.mapping_size_;
+    body_size_ = other.body_size_;
+    wal_sequence_ = other.wal_sequence_;
+    path_ = std::move(other.path_);
+    other.mapping_ = nullptr;
+  }
+  return *this;
+}
+
+const char* SnapshotFile::data() const {
+  return static_cast<const char*>(mapping_) + sizeof(FileHeader);
+}
+
+bool SnapshotFile::write(const std::string& directory, uint64_t wal_sequence, const std::string& body) {
+  if (!ensureDirectory(directory)) {
+    return false;
+  }
+  const std::string path = directory + "/" + numberedFileName(kSnapshotPrefix, wal_sequence, kSnapshotSuffix);
+  const std::string temporary = directory + "/" + numberedFileName(kSnapshotPrefix, wal_sequence, kTemporarySuffix);
+
+  FileHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.body_crc = crc32(body.data(), body.size());
+  header.wal_sequence = wal_sequence;
+  header.body_size = body.size();
+
+  const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    std::cerr << "Cannot create snapshot " << temporary << ": " << std::strerror(errno) << std::endl;
+    return false;
+  }
+  const bool written = writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header)) &&
+                       writeAll(fd, body.data(), body.size()) && ::fsync(fd) == 0;
+  ::close(fd);
+  if (!written || ::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::cerr << "Cannot write snapshot " << path << ": " << std::strerror(errno) << std::endl;
+    ::unlink(temporary.c_str());
+    return false;
+  }
+  return syncDirectory(directory);
+}
+
+std::optional<SnapshotFile> SnapshotFile::latest(const std::string& directory) {
+  const auto snapshots = listNumberedFiles(directory, kSnapshotPrefix, kSnapshotSuffix);
+  for (auto it = snapshots.rbegin(); it != snapshots.rend(); ++it) {
+    if (std::optional<SnapshotFile> snapshot = map(it->second)) {
+      return snapshot;
+    }
+    std::cerr << "Skipping unreadable snapshot " << it->second << std::endl;
+  }
+  return std::nullopt;
+}
+
+void SnapshotFile::removeOlderThan(const std::string& directory, uint64_t wal_sequence) {
+  for (const auto& [sequence, path] : listNumberedFiles(directory, kSnapshotPrefix, kTemporarySuffix)) {
+    ::unlink(path.c_str());
+  }
+  for (const auto& [sequence, path] : listNumberedFiles(directory, kSnapshotPrefix, kSnapshotSuffix)) {
+    if (sequence < wal_sequence) {
+      ::unlink(path.c_str());
+    }
+  }
+  syncDirectory(directory);
+}
+
+std::optional<SnapshotFile> SnapshotFile::map(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+    ::close(fd);
+    return std::nullopt;
+  }
+  const auto size = static_cast<size_t>(info.st_size);
+  void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return std::nullopt;
+  }
+
+  SnapshotFile snapshot;
+  snapshot.mapping_ = mapping;
+  snapshot.mapping_size_ = size;
+  snapshot.path_ = path;
+
+  FileHeader header;
+  std::memcpy(&header, mapping, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+      header.body_size != size - sizeof(FileHeader)) {
+    return std::nullopt;
+  }
+  snapshot.body_size_ = header.body_size;
+  snapshot.wal_sequence_ = header.wal_sequence;
+
+  // Checksumming reads the whole file once; tell the kernel to fetch it ahead
+  ::madvise(mapping, size, MADV_SEQUENTIAL);
+  if (crc32(snapshot.data(), snapshot.body_size_) != header.body_crc) {
+    return std::nullopt;
+  }
+  return snapshot;
+}
+
+}  // namespace storage
+}  // namespace banking
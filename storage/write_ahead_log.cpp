@@ -0,0 +1,290 @@
+#include "write_ahead_log.hpp"
+#include "file_io.hpp"
+#include "observability/metrics.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace banking {
+namespace storage {
+
+namespace {
+
+const char kSegmentPrefix[] = "wal-";
+const char kSegmentSuffix[] = ".log";
+
+// [uint32 payload length][uint32 crc32 of sequence + payload][uint64 sequence]
+constexpr size_t kFrameHeader = 16;
+constexpr uint32_t kMaxPayload = 64 * 1024 * 1024;
+
+}  // namespace
+
+WriteAheadLog::WriteAheadLog(const Config& config) : config_(config) {
+}
+
+WriteAheadLog::~WriteAheadLog() {
+  close();
+}
+
+std::optional<uint64_t> WriteAheadLog::replay(uint64_t after_sequence, const RecordCallback& apply) {
+  if (!ensureDirectory(config_.directory)) {
+    std::cerr << "Cannot create WAL directory " << config_.directory << std::endl;
+    return std::nullopt;
+  }
+
+  const auto segments = listNumberedFiles(config_.directory, kSegmentPrefix, kSegmentSuffix);
+  uint64_t last = after_sequence;
+  std::string payload;
+  for (size_t i = 0; i < segments.size(); ++i) {
+    const std::string& path = segments[i].second;
+    std::ifstream in(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!in.good() && !in.eof()) {
+      std::cerr << "Cannot read WAL segment " << path << std::endl;
+      return std::nullopt;
+    }
+
+    size_t pos = 0;
+    while (pos + kFrameHeader <= data.size()) {
+      uint32_t length, crc;
+      uint64_t sequence;
+      std::memcpy(&length, data.data() + pos, 4);
+      std::memcpy(&crc, data.data() + pos + 4, 4);
+      std::memcpy(&sequence, data.data() + pos + 8, 8);
+      if (length > kMaxPayload || pos + kFrameHeader + length > data.size() ||
+          crc32(data.data() + pos + 8, 8 + length) != crc) {
+        break;
+      }
+
+      if (sequence > after_sequence) {
+        if (sequence != last + 1) {
+          std::cerr << "WAL record " << last + 1 << " is missing (found " << sequence << " in " << path << ")"
+                    << std::endl;
+          return std::nullopt;
+        }
+        payload.assign(data.data() + pos + kFrameHeader, length);
+        apply(sequence, payload);
+        last = sequence;
+      }
+      pos += kFrameHeader + length;
+    }
+
+    if (pos < data.size()) {
+      // Only the segment being written when the process died can end mid-record
+      if (i + 1 < segments.size()) {
+        std::cerr << "Corrupt record in WAL segment " << path << " at offset " << pos << std::endl;
+        return std::nullopt;
+      }
+      std::cerr << "Discarding " << data.size() - pos << " bytes of torn WAL tail in " << path << std::endl;
+      if (::truncate(path.c_str(), static_cast<off_t>(pos)) != 0) {
+        return std::nullopt;
+      }
+    }
+  }
+  return last;
+}
+
+bool WriteAheadLog::open(uint64_t next_sequence) {
+  std::lock_guard<std::mutex> io_lock(io_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return true;
+  }
+  if (!ensureDirectory(config_.directory)) {
+    return false;
+  }
+  fd_ = openSegment(next_sequence);
+  if (fd_ < 0) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  next_sequence_ = next_sequence;
+  stats_.durable_sequence = next_sequence - 1;
+  stats_.failed = false;
+  running_ = true;
+  stopping_ = false;
+  syncer_ = std::thread(&WriteAheadLog::syncerLoop, this);
+  return true;
+}
+
+void WriteAheadLog::close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) return;
+    stopping_ = true;
+  }
+  work_cv_.notify_one();
+  syncer_.join();
+
+  std::lock_guard<std::mutex> io_lock(io_mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  ::close(fd_);
+  fd_ = -1;
+  running_ = false;
+  stopping_ = false;
+  durable_cv_.notify_all();
+}
+
+uint64_t WriteAheadLog::append(const std::string& payload) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!running_ || stats_.failed || payload.size() > kMaxPayload) {
+    return 0;
+  }
+  const uint64_t sequence = next_sequence_++;
+  const auto length = static_cast<uint32_t>(payload.size());
+
+  const size_t start = buffer_.size();
+  buffer_.resize(start + kFrameHeader + length);
+  char* frame = &buffer_[start];
+  std::memcpy(frame, &length, 4);
+  std::memcpy(frame + 8, &sequence, 8);
+  std::memcpy(frame + kFrameHeader, payload.data(), length);
+  const uint32_t crc = crc32(frame + 8, 8 + length);
+  std::memcpy(frame + 4, &crc, 4);
+
+  ++stats_.records_appended;
+  stats_.bytes_appended += kFrameHeader + length;
+  if (start == 0) {
+    oldest_buffered_ = Clock::now();
+    work_cv_.notify_one();
+  } else if (buffer_.size() >= config_.max_buffered_bytes) {
+    work_cv_.notify_one();
+  }
+  return sequence;
+}
+
+bool WriteAheadLog::waitDurable(uint64_t sequence) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  durable_cv_.wait(lock, [&] { return stats_.durable_sequence >= sequence || stats_.failed || !running_; });
+  return stats_.durable_sequence >= sequence;
+}
+
+bool WriteAheadLog::sync() {
+  std::lock_guard<std::mutex> io_lock(io_mutex_);
+  return writeBuffered();
+}
+
+bool WriteAheadLog::rotate() {
+  std::lock_guard<std::mutex> io_lock(io_mutex_);
+  uint64_t first_sequence = 0;
+  if (fd_ < 0 || !writeBuffered(&first_sequence)) {
+    return false;
+  }
+  const int fd = openSegment(first_sequence);
+  if (fd < 0) {
+    return false;
+  }
+  ::close(fd_);
+  fd_ = fd;
+  return true;
+}
+
+void WriteAheadLog::removeSegmentsThrough(uint64_t sequence) {
+  const auto segments = listNumberedFiles(config_.directory, kSegmentPrefix, kSegmentSuffix);
+  bool removed = false;
+  for (size_t i = 0; i + 1 < segments.size(); ++i) {
+    // A segment ends where the next one starts
+    if (segments[i + 1].first > sequence + 1) break;
+    removed |= ::unlink(segments[i].second.c_str()) == 0;
+  }
+  if (removed) {
+    syncDirectory(config_.directory);
+  }
+}
+
+uint64_t WriteAheadLog::lastSequence() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return next_sequence_ - 1;
+}
+
+WriteAheadLog::Stats WriteAheadLog::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void WriteAheadLog::syncerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this] { return stopping_ || !buffer_.empty(); });
+
+    // Let appends pile up until the oldest has waited one interval, then pay for one sync
+    if (!stopping_ && buffer_.size() < config_.max_buffered_bytes) {
+      work_cv_.wait_until(lock, oldest_buffered_ + config_.sync_interval, [this] {
+        return stopping_ || buffer_.size() >= config_.max_buffered_bytes;
+      });
+    }
+
+    if (buffer_.empty()) {
+      if (stopping_) break;
+      continue;
+    }
+    lock.unlock();
+    {
+      std::lock_guard<std::mutex> io_lock(io_mutex_);
+      writeBuffered();
+    }
+    lock.lock();
+  }
+}
+
+bool WriteAheadLog::writeBuffered(uint64_t* next_sequence) {
+  std::string data;
+  uint64_t through;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stats_.failed) return false;
+    data.swap(buffer_);
+    through = next_sequence_ - 1;
+    if (next_sequence) *next_sequence = next_sequence_;
+  }
+  if (data.empty()) {
+    return true;
+  }
+
+  const Clock::time_point started = Clock::now();
+  const bool written = writeAll(fd_, data.data(), data.size()) && ::fdatasync(fd_) == 0;
+  const int error = written ? 0 : errno;
+  const Clock::time_point finished = Clock::now();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.syncs;
+    stats_.last_sync_duration = std::chrono::duration_cast<std::chrono::microseconds>(finished - started);
+    if (written) {
+      stats_.durable_sequence = through;
+    } else {
+      // After a failed fsync the kernel may have dropped the dirty pages, so retrying proves nothing
+      stats_.failed = true;
+    }
+  }
+  durable_cv_.notify_all();
+
+  auto& metrics = observability::getGlobalMetrics();
+  metrics.observeHistogram("wal_sync_duration_seconds", std::chrono::duration<double>(finished - started).count());
+  metrics.incrementCounter("wal_synced_bytes_total", static_cast<double>(data.size()));
+  if (!written) {
+    metrics.incrementCounter("wal_sync_failures_total");
+    std::cerr << "WAL write to " << config_.directory << " failed: " << std::strerror(error) << std::endl;
+  }
+  return written;
+}
+
+int WriteAheadLog::openSegment(uint64_t first_sequence) {
+  const std::string path =
+      config_.directory + "/" + numberedFileName(kSegmentPrefix, first_sequence, kSegmentSuffix);
+  const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    std::cerr << "Cannot open WAL segment " << path << ": " << std::strerror(errno) << std::endl;
+    return -1;
+  }
+  syncDirectory(config_.directory);
+  return fd;
+}
+
+}  // namespace storage
+}  // namespace banking
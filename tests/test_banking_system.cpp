@@ -1,12 +1,48 @@
 #include "../include/banking_system_thread_safe.hpp"
-#include "../include/banking_core_impl.hpp"
+#include "../include/banking_system_sharded.hpp"
+#include "../include/banking_system_durable.hpp"
+#include "../include/banking_system_primary.hpp"
+#include "../include/banking_system_replica.hpp"
+#include "../include/banking_system_persistent.hpp"
+#include "../include/banking_server.hpp"
+#include "../include/idempotency_cache.hpp"
+#include "../banking_core_impl.hpp"
+#include "../payment_scheduler.hpp"
+#include "../balance_log.hpp"
+#include "../engine_allocator.hpp"
 #include "../include/concurrent/lockfree_queue.hpp"
+#include "../include/concurrent/bounded_queue.hpp"
+#include "../include/concurrent/transaction_processor.hpp"
+#include "../include/concurrent/thread_placement.hpp"
+#include "../include/concurrent/operation_table.hpp"
 #include "../include/ai/fraud_detection_agent.hpp"
+#include "../include/network/protocol.hpp"
+#include "../include/network/binary_codec.hpp"
+#include "../include/network/tcp_client.hpp"
+#include "../include/network/tcp_server.hpp"
+#include "../include/database/binary_copy.hpp"
+#include "../include/database/connection_pool.hpp"
+#include "../include/database/param_buffer.hpp"
+#include "../include/database/read_cache.hpp"
+#include "../include/database/write_behind_pipeline.hpp"
+#include "../include/observability/metrics.hpp"
+#include "../include/observability/logger.hpp"
 
 #include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <mutex>
+
+using namespace banking;
 
 // Test fixture for banking system tests
 class BankingSystemTest : public ::testing::Test {
@@ -90,6 +126,484 @@ TEST_F(BankingSystemTest, TopSpenders) {
   EXPECT_EQ(spenders[1], "acc2(50)");   // acc2 spent 50 total
 }
 
+TEST_F(BankingSystemTest, TopSpendersTracksPaymentsAndMerges) {
+  banking_system_->CreateAccount(1000, "acc1");
+  banking_system_->CreateAccount(1001, "acc2");
+  banking_system_->CreateAccount(1002, "acc3");
+  banking_system_->Deposit(1003, "acc1", 1000);
+  banking_system_->Deposit(1004, "acc2", 1000);
+
+  banking_system_->Transfer(1005, "acc1", "acc3", 100);
+  banking_system_->SchedulePayment(1006, "acc2", 150, 4);  // Due at 1010
+
+  auto spenders = banking_system_->TopSpenders(1009, 3);
+  ASSERT_EQ(spenders.size(), 3u);
+  EXPECT_EQ(spenders[0], "acc1(100)");
+  EXPECT_EQ(spenders[1], "acc2(0)");
+  EXPECT_EQ(spenders[2], "acc3(0)");
+
+  spenders = banking_system_->TopSpenders(1010, 1);
+  ASSERT_EQ(spenders.size(), 1u);
+  EXPECT_EQ(spenders[0], "acc2(150)");
+
+  // A merged account's spending moves to the survivor and the account drops out.
+  banking_system_->MergeAccounts(1011, "acc3", "acc1");
+  spenders = banking_system_->TopSpenders(1012, 5);
+  ASSERT_EQ(spenders.size(), 2u);
+  EXPECT_EQ(spenders[0], "acc2(150)");
+  EXPECT_EQ(spenders[1], "acc3(100)");
+}
+
+TEST(BankingSystemImplTest, HistoricalBalanceAndCompaction) {
+  BankingSystemImpl system;
+  system.CreateAccount(1000, "acc1");
+  system.Deposit(1010, "acc1", 500);
+  system.Deposit(1010, "acc1", 100);  // Same timestamp as the previous change
+  system.Deposit(1020, "acc1", 50);
+
+  EXPECT_FALSE(system.GetBalance(1030, "acc1", 999).has_value());
+  EXPECT_EQ(system.GetBalance(1030, "acc1", 1000), 0);
+  EXPECT_EQ(system.GetBalance(1030, "acc1", 1015), 600);
+  EXPECT_EQ(system.GetBalance(1030, "acc1", 1020), 650);
+
+  // Compaction keeps the balance at the horizon and forgets what came before.
+  system.CompactHistory(1015);
+  EXPECT_FALSE(system.GetBalance(1031, "acc1", 1010).has_value());
+  EXPECT_EQ(system.GetBalance(1031, "acc1", 1015), 600);
+  EXPECT_EQ(system.GetBalance(1031, "acc1", 1025), 650);
+}
+
+TEST(EngineMemoryTest, CountsAllocationsAndReclaimsDeadState) {
+  // Counting allocators charge their structure's gauge for exactly what they hold
+  const AllocationMeters& meters = allocationMeters(EngineStructure::SPENDER_INDEX);
+  const double bytes_before = meters.bytes->value();
+  const double allocations_before = meters.allocations->value();
+  {
+    std::vector<int, CountingAllocator<int, EngineStructure::SPENDER_INDEX>> counted;
+    counted.reserve(100);
+    EXPECT_EQ(meters.bytes->value(), bytes_before + 100 * sizeof(int));
+    EXPECT_EQ(meters.allocations->value(), allocations_before + 1);
+  }
+  EXPECT_EQ(meters.bytes->value(), bytes_before);
+
+  BankingSystemImpl system;
+  system.CreateAccount(1, "acc1");
+  system.CreateAccount(2, "acc2");
+  system.Deposit(3, "acc1", 50);
+  system.Deposit(4, "acc2", 100);
+  system.MergeAccounts(5, "acc1", "acc2");
+  const size_t history_before = system.memoryUsage().history_resident_bytes;
+
+  // acc2 was merged away before the horizon, so its history goes; answers stay the same
+  system.CompactHistory(10);
+  EXPECT_LT(system.memoryUsage().history_resident_bytes, history_before);
+  EXPECT_EQ(system.GetBalance(11, "acc1", 10), 150);
+  EXPECT_FALSE(system.GetBalance(11, "acc2", 10).has_value());
+
+  // Canceled payments and ones fired by settling one account take their scheduler entries along
+  for (int i = 0; i < 10; ++i) {
+    auto payment = system.SchedulePayment(12, "acc1", 1, 1 << 26);
+    ASSERT_TRUE(payment.has_value());
+    EXPECT_TRUE(system.CancelPayment(12, "acc1", *payment));
+  }
+  EXPECT_TRUE(system.SchedulePayment(12, "acc1", 5, 1).has_value());
+  auto kept = system.SchedulePayment(13, "acc1", 20, 100);
+  EXPECT_EQ(system.Deposit(13, "acc1", 5), 150);
+  EXPECT_EQ(system.memoryUsage().payment_entries, 1u);
+
+  // Every engine reclaims through the interface and publishes what it holds
+  BankingSystemThreadSafe wrapped(std::make_unique<BankingSystemImpl>());
+  wrapped.CreateAccount(1, "a_rather_long_account_identifier_0001");
+  static_cast<BankingSystem&>(wrapped).ReclaimMemory();
+  auto& metrics = observability::getGlobalMetrics();
+  EXPECT_EQ(metrics.gauge("engine_accounts").value(), 1);
+  EXPECT_GT(metrics.gauge("engine_account_id_heap_bytes").value(), 0);
+  system.ReclaimMemory();
+  EXPECT_EQ(metrics.gauge("engine_accounts").value(), 2);
+
+  const BankingSystemImpl::MemoryUsage usage = system.memoryUsage();
+  EXPECT_EQ(usage.accounts, 2u);
+  EXPECT_EQ(usage.live_accounts, 1u);
+  EXPECT_EQ(usage.pending_payments, 1u);
+  EXPECT_EQ(usage.payment_entries, 1u);
+  EXPECT_FALSE(system.CancelPayment(14, "acc1", "payment1"));
+  EXPECT_EQ(system.GetBalance(113, "acc1", 113), 130);
+  EXPECT_TRUE(kept.has_value());
+}
+
+TEST(BankingSystemImplTest, RestoreRebuildsSavedState) {
+  BankingSystemImpl::SavedState state;
+  state.accounts.push_back({"acc1", 1, true, 40, 30, "", 0});
+  state.accounts.push_back({"acc2", 2, false, 0, 0, "acc1", 5});
+  state.history = {{"acc1", 3, 50}, {"acc1", 1, 0}, {"acc2", 2, 20}, {"acc1", 4, -30},
+                   {"acc2", 5, -20}, {"acc1", 5, 20}};
+  state.pendingPayments.push_back({"acc1", 7, 10, 20});
+  state.nextPaymentOrdinal = 8;
+  state.latestTimestamp = 10;
+
+  BankingSystemImpl system;
+  system.Restore(state);
+
+  EXPECT_EQ(system.GetBalance(11, "acc1", 11), 40);
+  EXPECT_EQ(system.GetBalance(11, "acc1", 3), 50);
+  EXPECT_EQ(system.GetBalance(11, "acc2", 4), 20);
+  EXPECT_FALSE(system.GetBalance(11, "acc2", 6).has_value());
+  EXPECT_EQ(system.TopSpenders(11, 1), std::vector<std::string>{"acc1(30)"});
+
+  // The restored payment is still cancelable, and new ids continue after it
+  EXPECT_EQ(system.SchedulePayment(12, "acc1", 5, 100), "payment8");
+  EXPECT_TRUE(system.CancelPayment(12, "acc1", "payment7"));
+  EXPECT_TRUE(system.CreateAccount(13, "acc2"));
+}
+
+TEST(BalanceLogTest, SpillsColdChunksPastBudget) {
+  BalanceLog::Config config;
+  config.memory_budget_bytes = 4 * 1024;
+  BalanceLog log(config);
+
+  // Two accounts, 1000 changes each: far more chunks than the budget holds
+  for (int ts = 1; ts <= 1000; ++ts) {
+    log.record(0, ts * 2, 1);
+    log.record(1, ts * 2, 2);
+  }
+  EXPECT_LE(log.residentBytes(), config.memory_budget_bytes);
+  EXPECT_GT(log.spilledChunks(), 0u);
+  EXPECT_EQ(log.balanceAt(0, 1), 0);
+  EXPECT_EQ(log.balanceAt(0, 101), 50);
+  EXPECT_EQ(log.balanceAt(1, 2000), 2000);
+
+  // A late change lands in a spilled chunk and shifts everything after it
+  log.record(0, 11, 100);
+  EXPECT_EQ(log.balanceAt(0, 10), 5);
+  EXPECT_EQ(log.balanceAt(0, 11), 105);
+  EXPECT_EQ(log.balanceAt(0, 2000), 1100);
+
+  log.compact(1001);
+  EXPECT_EQ(log.balanceAt(0, 1001), 600);
+  EXPECT_EQ(log.balanceAt(0, 1002), 601);
+}
+
+TEST(PaymentSchedulerTest, FiresInDueOrderAcrossWheelLevels) {
+  PaymentScheduler scheduler;
+  scheduler.schedule({0, 10, 1 << 26, 1});  // Beyond the wheel, in overflow
+  scheduler.schedule({0, 20, 5000, 2});
+  scheduler.schedule({1, 30, 70, 3});
+  scheduler.schedule({1, 40, 70, 4});
+  scheduler.schedule({1, 50, 300, 5});
+
+  std::vector<int> fired;
+  auto record = [&fired](const PaymentScheduler::Payment& payment) { fired.push_back(payment.ordinal); };
+
+  EXPECT_TRUE(scheduler.cancel(5));
+  EXPECT_FALSE(scheduler.cancel(5));
+  EXPECT_EQ(scheduler.entryCount(), 4u);  // A canceled payment's entry goes with it
+  scheduler.advance(100, record);
+  EXPECT_EQ(fired, (std::vector<int>{3, 4}));
+
+  // Settling one account leaves the other's due payments pending
+  scheduler.schedule({1, 60, 200, 6});
+  scheduler.advanceAccount(0, 6000, record);
+  EXPECT_EQ(fired, (std::vector<int>{3, 4, 2}));
+  ASSERT_NE(scheduler.findPending(6), nullptr);
+  EXPECT_EQ(scheduler.entryCount(), 2u);
+
+  scheduler.reassign(0, 1);
+  EXPECT_EQ(scheduler.findPending(1)->account, 1u);
+  scheduler.advance(1 << 27, record);
+  EXPECT_EQ(fired, (std::vector<int>{3, 4, 2, 6, 1}));
+  EXPECT_EQ(scheduler.pendingCount(), 0u);
+}
+
+TEST_F(BankingSystemTest, ApplyBatch) {
+  banking_system_->CreateAccount(1000, "acc1");
+
+  std::vector<BatchOperation> ops(4);
+  ops[0].type = BatchOperation::Type::CREATE_ACCOUNT;
+  ops[0].account_id = "acc2";
+  ops[1].type = BatchOperation::Type::DEPOSIT;
+  ops[1].account_id = "acc1";
+  ops[1].amount = 500;
+  ops[2].type = BatchOperation::Type::TRANSFER;
+  ops[2].account_id = "acc1";
+  ops[2].target_account_id = "acc2";
+  ops[2].amount = 200;
+  ops[3].type = BatchOperation::Type::DEPOSIT;
+  ops[3].account_id = "nonexistent";
+  ops[3].amount = 100;
+
+  // Later operations see the effects of earlier ones; failures stay local.
+  auto results = banking_system_->ApplyBatch(1001, ops);
+  ASSERT_EQ(results.size(), ops.size());
+  EXPECT_TRUE(results[0].success);
+  EXPECT_EQ(results[1].balance, 500);
+  EXPECT_EQ(results[2].balance, 300);
+  EXPECT_FALSE(results[3].success);
+
+  auto balance = banking_system_->GetBalance(1002, "acc2", 1002);
+  ASSERT_TRUE(balance.has_value());
+  EXPECT_EQ(*balance, 200);
+}
+
+// Sharded engine tests; with 64 shards acc1 and acc2 land in different shards
+TEST(ShardedBankingSystemTest, CrossShardTransferAndMerge) {
+  ShardedBankingSystem::Config config;
+  config.num_shards = 64;
+  ShardedBankingSystem system(config);
+
+  system.CreateAccount(1000, "acc1");
+  system.CreateAccount(1001, "acc2");
+  system.Deposit(1002, "acc1", 1000);
+  system.Deposit(1003, "acc2", 100);
+
+  auto result = system.Transfer(1004, "acc1", "acc2", 300);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(*result, 700);
+  EXPECT_FALSE(system.Transfer(1005, "acc1", "nonexistent", 100).has_value());
+  EXPECT_EQ(system.GetBalance(1006, "acc1", 1006), 700);
+
+  // Pending payments follow the merged account into the survivor's shard.
+  auto payment = system.SchedulePayment(1007, "acc2", 50, 10);
+  ASSERT_TRUE(payment.has_value());
+  EXPECT_TRUE(system.MergeAccounts(1008, "acc1", "acc2"));
+  EXPECT_FALSE(system.CancelPayment(1009, "acc2", *payment));
+  EXPECT_EQ(system.GetBalance(1010, "acc1", 1010), 1100);
+  EXPECT_EQ(system.GetBalance(1020, "acc1", 1020), 1050);
+  EXPECT_EQ(system.GetBalance(1021, "acc2", 1007), 400);
+  EXPECT_FALSE(system.GetBalance(1022, "acc2", 1022).has_value());
+
+  auto spenders = system.TopSpenders(1023, 2);
+  ASSERT_EQ(spenders.size(), 1u);
+  EXPECT_EQ(spenders[0], "acc1(350)");
+}
+
+TEST(ShardedBankingSystemTest, ConcurrentTransfersConserveMoney) {
+  ShardedBankingSystem system;
+  const int num_accounts = 32;
+  for (int i = 0; i < num_accounts; ++i) {
+    system.CreateAccount(1, "acc" + std::to_string(i));
+    system.Deposit(1, "acc" + std::to_string(i), 1000);
+  }
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&system, t]() {
+      for (int i = 0; i < 2000; ++i) {
+        system.Transfer(2, "acc" + std::to_string((i + t) % num_accounts),
+                        "acc" + std::to_string((i * 7 + t + 1) % num_accounts), 5);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  int total = 0;
+  for (int i = 0; i < num_accounts; ++i) {
+    total += system.GetBalance(3, "acc" + std::to_string(i), 3).value_or(0);
+  }
+  EXPECT_EQ(total, num_accounts * 1000);
+}
+
+// Durability tests
+
+// A mixed workload over timestamps [from, to). Includes a query stamped ahead of
+// the operations after it, which fires a payment early for everyone who follows.
+void runDurabilityWorkload(BankingSystem& system, int from, int to) {
+  for (int ts = from; ts < to; ++ts) {
+    const std::string account = "acc" + std::to_string(ts % 5);
+    const std::string other = "acc" + std::to_string((ts + 2) % 5);
+    system.CreateAccount(ts, account);
+    system.Deposit(ts, account, ts * 3);
+    system.Transfer(ts, account, other, ts);
+    if (ts % 7 == 0) system.SchedulePayment(ts, other, 20, 15);
+    if (ts % 11 == 0) system.CancelPayment(ts, other, "payment" + std::to_string(ts / 7));
+    if (ts == 30) system.GetBalance(45, account, 30);
+    if (ts == 60) system.MergeAccounts(ts, "acc1", "acc4");
+    if (ts == 70) {
+      system.ApplyBatch(ts, {{BatchOperation::Type::DEPOSIT, "acc2", "", "", 7, 0},
+                             {BatchOperation::Type::TRANSFER, "acc2", "acc3", "", 5, 0},
+                             {BatchOperation::Type::DEPOSIT, "missing", "", "", 1, 0}});
+    }
+  }
+}
+
+std::string freshDataDirectory(const std::string& name) {
+  const std::filesystem::path path = std::filesystem::temp_directory_path() / ("banking_" + name);
+  std::filesystem::remove_all(path);
+  return path.string();
+}
+
+TEST(BankingSystemDurableTest, RecoversSnapshotPlusWalTail) {
+  BankingSystemDurable::Config config;
+  config.data_directory = freshDataDirectory("durable_recovery");
+  config.snapshot_every_operations = 0;
+
+  BankingSystemImpl reference;
+  runDurabilityWorkload(reference, 1, 50);
+  runDurabilityWorkload(reference, 50, 100);
+  {
+    BankingSystemDurable system(config);
+    ASSERT_TRUE(system.open());
+    runDurabilityWorkload(system, 1, 50);
+    ASSERT_TRUE(system.Checkpoint());
+    runDurabilityWorkload(system, 50, 100);
+    EXPECT_GT(system.getWalStats().durable_sequence, 0u);
+  }
+
+  BankingSystemDurable recovered(config);
+  ASSERT_TRUE(recovered.open());
+  const BankingSystemDurable::RecoveryStats stats = recovered.getRecoveryStats();
+  EXPECT_GT(stats.snapshot_sequence, 0u);
+  EXPECT_GT(stats.replayed_operations, 0u);
+
+  EXPECT_EQ(recovered.TopSpenders(200, 5), reference.TopSpenders(200, 5));
+  for (int i = 0; i < 5; ++i) {
+    const std::string account = "acc" + std::to_string(i);
+    for (int time_at = 1; time_at <= 200; time_at += 7) {
+      EXPECT_EQ(recovered.GetBalance(200, account, time_at), reference.GetBalance(200, account, time_at))
+          << account << " at " << time_at;
+    }
+  }
+  // Payment ids continue where the log left off
+  EXPECT_EQ(recovered.SchedulePayment(201, "acc0", 1, 1), reference.SchedulePayment(201, "acc0", 1, 1));
+  std::filesystem::remove_all(config.data_directory);
+}
+
+TEST(BankingSystemDurableTest, TornWalTailIsDiscarded) {
+  BankingSystemDurable::Config config;
+  config.data_directory = freshDataDirectory("durable_torn_tail");
+  config.snapshot_every_operations = 0;
+  {
+    BankingSystemDurable system(config);
+    ASSERT_TRUE(system.open());
+    ASSERT_TRUE(system.CreateAccount(1, "acc1"));
+    ASSERT_EQ(system.Deposit(2, "acc1", 100), 100);
+  }
+
+  // A crash in the middle of a write leaves half a record behind
+  std::filesystem::path segment;
+  for (const auto& entry : std::filesystem::directory_iterator(config.data_directory)) {
+    segment = entry.path();
+  }
+  std::ofstream(segment, std::ios::binary | std::ios::app).write("\x10\x00\x00\x00torn", 8);
+
+  {
+    BankingSystemDurable system(config);
+    ASSERT_TRUE(system.open());
+    EXPECT_EQ(system.getRecoveryStats().replayed_operations, 2u);
+    EXPECT_EQ(system.Deposit(3, "acc1", 5), 105);
+  }
+  BankingSystemDurable system(config);
+  ASSERT_TRUE(system.open());
+  EXPECT_EQ(system.getRecoveryStats().replayed_operations, 3u);
+  EXPECT_EQ(system.GetBalance(4, "acc1", 4), 105);
+  std::filesystem::remove_all(config.data_directory);
+}
+
+TEST(BankingSystemReplicaTest, FollowsPrimaryFromSnapshotThenStream) {
+  replication::ReplicationPublisher::Config publisher_config;
+  publisher_config.port = 19300;
+  publisher_config.heartbeat_interval = std::chrono::milliseconds(10);
+  BankingSystemPrimary primary(publisher_config);
+  ASSERT_TRUE(primary.start());
+
+  BankingSystemImpl reference;
+  runDurabilityWorkload(reference, 1, 50);
+  runDurabilityWorkload(primary, 1, 50);
+
+  // Joins late, so it starts from a snapshot and then replays the stream
+  BankingSystemReplica::Config replica_config;
+  replica_config.primary.primary_port = publisher_config.port;
+  replica_config.max_staleness = std::chrono::milliseconds(200);
+  BankingSystemReplica replica(replica_config);
+  EXPECT_FALSE(replica.isFresh());
+  replica.start();
+
+  runDurabilityWorkload(reference, 50, 100);
+  runDurabilityWorkload(primary, 50, 100);
+  ASSERT_TRUE(reference.Deposit(200, "acc0", 1).has_value());
+  ASSERT_TRUE(primary.Deposit(200, "acc0", 1).has_value());
+
+  const uint64_t last_sequence = primary.getReplicationStats().last_sequence;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while ((replica.getStats().applied_sequence != last_sequence || !replica.isFresh()) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_EQ(replica.getStats().applied_sequence, last_sequence);
+  EXPECT_EQ(replica.getStats().snapshots_loaded, 1u);
+
+  EXPECT_EQ(replica.TopSpenders(200, 5), reference.TopSpenders(200, 5));
+  for (int i = 0; i < 5; ++i) {
+    const std::string account = "acc" + std::to_string(i);
+    for (int time_at = 1; time_at <= 200; time_at += 7) {
+      EXPECT_EQ(replica.GetBalance(200, account, time_at), reference.GetBalance(200, account, time_at))
+          << account << " at " << time_at;
+    }
+  }
+  EXPECT_FALSE(replica.CreateAccount(201, "acc9"));
+  EXPECT_FALSE(replica.Deposit(201, "acc0", 5).has_value());
+
+  // Without the primary, reads stop once the staleness bound passes
+  primary.stop();
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_FALSE(replica.isFresh());
+  EXPECT_FALSE(replica.GetBalance(200, "acc0", 200).has_value());
+  replica.stop();
+}
+
+TEST(BankingSystemReplicaTest, RestartedPrimaryResendsASnapshot) {
+  replication::ReplicationPublisher::Config publisher_config;
+  publisher_config.port = 19301;
+  publisher_config.heartbeat_interval = std::chrono::milliseconds(10);
+  BankingSystemReplica::Config replica_config;
+  replica_config.primary.primary_port = publisher_config.port;
+  replica_config.primary.reconnect_interval = std::chrono::milliseconds(20);
+  BankingSystemReplica replica(replica_config);
+
+  auto waitFor = [&replica](uint64_t sequence) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((replica.getStats().applied_sequence != sequence || !replica.isFresh()) &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return replica.getStats().applied_sequence == sequence;
+  };
+
+  uint64_t first_log = 0;
+  uint64_t first_sequence = 0;
+  {
+    BankingSystemPrimary primary(publisher_config);
+    ASSERT_TRUE(primary.start());
+    runDurabilityWorkload(primary, 1, 20);
+    replica.start();
+    first_log = primary.getReplicationStats().log_id;
+    first_sequence = primary.getReplicationStats().last_sequence;
+    ASSERT_TRUE(waitFor(first_sequence));
+    primary.stop();
+  }
+
+  // The new run numbers its own records from 1, past where the replica stopped;
+  // resuming by sequence alone would graft them onto the old run's state
+  BankingSystemPrimary primary(publisher_config);
+  BankingSystemImpl reference;
+  runDurabilityWorkload(reference, 1, 60);
+  runDurabilityWorkload(primary, 1, 60);
+  ASSERT_TRUE(primary.start());
+  EXPECT_NE(primary.getReplicationStats().log_id, first_log);
+  ASSERT_GT(primary.getReplicationStats().last_sequence, first_sequence);
+
+  ASSERT_TRUE(waitFor(primary.getReplicationStats().last_sequence));
+  EXPECT_EQ(replica.getStats().snapshots_loaded, 2u);
+  EXPECT_EQ(primary.getReplicationStats().snapshots_sent, 1u);
+  for (int i = 0; i < 5; ++i) {
+    const std::string account = "acc" + std::to_string(i);
+    EXPECT_EQ(replica.GetBalance(60, account, 59), reference.GetBalance(60, account, 59)) << account;
+  }
+  replica.stop();
+  primary.stop();
+}
+
 // Lock-free queue tests
 TEST(LockFreeQueueTest, BasicOperations) {
   concurrent::LockFreeQueue<int> queue;
@@ -155,6 +669,561 @@ TEST(LockFreeQueueTest, ConcurrentAccess) {
   EXPECT_TRUE(queue.empty());
 }
 
+TEST(BoundedQueueTest, BackpressureAndBulkOperations) {
+  concurrent::BoundedQueue<std::string> queue(3);
+  EXPECT_EQ(queue.capacity(), 4u);  // Rounded up to a power of two
+
+  std::vector<std::string> items = {"a", "b", "c", "d", "e"};
+  EXPECT_EQ(queue.enqueueBulk(items.begin(), items.end()), 4u);
+  EXPECT_TRUE(queue.full());
+
+  // A rejected item is left with the caller.
+  EXPECT_FALSE(queue.tryEnqueue(std::move(items[4])));
+  EXPECT_EQ(items[4], "e");
+
+  auto first = queue.tryDequeue();
+  ASSERT_TRUE(first.has_value());
+  EXPECT_EQ(*first, "a");
+  EXPECT_TRUE(queue.tryEnqueue(std::move(items[4])));
+
+  std::vector<std::string> drained;
+  EXPECT_EQ(queue.dequeueBulk(std::back_inserter(drained), 10), 4u);
+  EXPECT_EQ(drained, (std::vector<std::string>{"b", "c", "d", "e"}));
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.tryDequeue().has_value());
+}
+
+// Transaction processor tests
+TEST(TransactionProcessorTest, AccountAffinityPreservesPerAccountOrder) {
+  namespace protocol = network::protocol;
+
+  ShardedBankingSystem system;
+  concurrent::TransactionProcessor::Config config;
+  config.num_workers = 4;
+  config.dispatch_mode = concurrent::TransactionProcessor::DispatchMode::ACCOUNT_AFFINITY;
+  concurrent::TransactionProcessor processor(&system, config);
+  ASSERT_TRUE(processor.start());
+
+  for (int a = 0; a < 8; ++a) {
+    system.CreateAccount(1, "acc" + std::to_string(a));
+  }
+
+  // Deposits of 1 to one account must observe balances 1, 2, 3, ... in submission order.
+  std::vector<std::vector<std::future<protocol::Response>>> results(8);
+  for (int i = 0; i < 500; ++i) {
+    for (int a = 0; a < 8; ++a) {
+      results[a].push_back(processor.submitRequest(
+          protocol::Request::deposit(2, "client", "token", "acc" + std::to_string(a), 1)));
+    }
+  }
+  for (auto& account_results : results) {
+    for (size_t i = 0; i < account_results.size(); ++i) {
+      auto response = account_results[i].get();
+      ASSERT_TRUE(response.balance.has_value());
+      EXPECT_EQ(*response.balance, static_cast<int>(i) + 1);
+    }
+  }
+
+  processor.stop();
+  EXPECT_EQ(processor.getQueueSize(), 0u);
+
+  // Every deposit was timed in the queue and in execution
+  auto stats = processor.getStats();
+  auto deposits = std::find_if(stats.latency.begin(), stats.latency.end(),
+                               [](const auto& l) { return l.type == protocol::MessageType::DEPOSIT; });
+  ASSERT_NE(deposits, stats.latency.end());
+  EXPECT_GE(deposits->execute.count, 4000u);
+  EXPECT_EQ(deposits->queue.count, deposits->execute.count);
+  EXPECT_LE(deposits->execute.p50_us, deposits->execute.max_us);
+}
+
+TEST(TransactionProcessorTest, AccountAffinityOrdersEveryAccountOfATransfer) {
+  namespace protocol = network::protocol;
+
+  ShardedBankingSystem system;
+  concurrent::TransactionProcessor::Config config;
+  config.num_workers = 4;
+  config.dispatch_mode = concurrent::TransactionProcessor::DispatchMode::ACCOUNT_AFFINITY;
+  concurrent::TransactionProcessor processor(&system, config);
+  ASSERT_TRUE(processor.start());
+
+  system.CreateAccount(1, "source");
+  system.Deposit(1, "source", 1000000);
+  for (int a = 0; a < 8; ++a) {
+    system.CreateAccount(1, "acc" + std::to_string(a));
+  }
+
+  // Each account alternates a deposit of 1 with a transfer of 1 into it, so its
+  // i-th deposit must see 2i + 1 whichever lanes the source and target hash to
+  std::vector<std::vector<std::future<protocol::Response>>> deposits(8);
+  std::vector<std::future<protocol::Response>> transfers;
+  for (int i = 0; i < 200; ++i) {
+    for (int a = 0; a < 8; ++a) {
+      const std::string account = "acc" + std::to_string(a);
+      deposits[a].push_back(processor.submitRequest(
+          protocol::Request::deposit(2, "client", "token", account, 1)));
+      transfers.push_back(processor.submitRequest(
+          protocol::Request::transfer(2, "client", "token", "source", account, 1)));
+    }
+  }
+  // A batch spanning every lane runs after all of the above
+  std::vector<protocol::Request> operations;
+  for (int a = 0; a < 8; ++a) {
+    operations.push_back(protocol::Request::deposit(2, "client", "token", "acc" + std::to_string(a), 1));
+  }
+  auto batch = processor.submitRequest(protocol::Request::batch(2, "client", "token", operations));
+
+  for (auto& account_deposits : deposits) {
+    for (size_t i = 0; i < account_deposits.size(); ++i) {
+      auto response = account_deposits[i].get();
+      ASSERT_TRUE(response.balance.has_value());
+      EXPECT_EQ(*response.balance, 2 * static_cast<int>(i) + 1);
+    }
+  }
+  for (auto& transfer : transfers) {
+    EXPECT_EQ(transfer.get().status, protocol::Status::SUCCESS);
+  }
+  auto batch_response = batch.get();
+  ASSERT_TRUE(batch_response.results.has_value());
+  ASSERT_EQ(batch_response.results->size(), 8u);
+  for (const auto& result : *batch_response.results) {
+    EXPECT_EQ(result.balance, 401);
+  }
+
+  processor.stop();
+  EXPECT_EQ(processor.getQueueSize(), 0u);
+}
+
+TEST(OperationTableTest, DescribesEachMessageType) {
+  namespace protocol = network::protocol;
+  using concurrent::operationFor;
+
+  // The table is a compile-time constant
+  static_assert(concurrent::kOperationTable[static_cast<size_t>(protocol::MessageType::GET_BALANCE)].read_only);
+  static_assert(!concurrent::kOperationTable[static_cast<size_t>(protocol::MessageType::BATCH)].execute);
+
+  EXPECT_FALSE(operationFor(protocol::MessageType::AUTHENTICATE).execute);
+  EXPECT_FALSE(operationFor(protocol::MessageType::HEARTBEAT).execute);
+  EXPECT_TRUE(operationFor(protocol::MessageType::TOP_SPENDERS).read_only);
+  EXPECT_FALSE(operationFor(protocol::MessageType::DEPOSIT).read_only);
+  EXPECT_FALSE(operationFor(protocol::MessageType::MERGE_ACCOUNTS).to_batch);
+  EXPECT_EQ(operationFor(protocol::MessageType::TRANSFER).screened_account,
+            &protocol::Request::source_account);
+  EXPECT_STREQ(operationFor(protocol::MessageType::SCHEDULE_PAYMENT).screened_as, "PAYMENT");
+
+  // Direct execution and the batch round trip encode the same response
+  BankingSystemImpl system;
+  auto create = protocol::Request::createAccount(1, "client", "token", "acc1");
+  EXPECT_EQ(operationFor(create.type).execute(system, create).account_id, "acc1");
+
+  auto deposit = protocol::Request::deposit(2, "client", "token", "acc1", 300);
+  auto direct = operationFor(deposit.type).execute(system, deposit);
+  ASSERT_TRUE(direct.balance.has_value());
+  EXPECT_EQ(*direct.balance, 300);
+
+  BatchOperation op;
+  operationFor(deposit.type).to_batch(deposit, op);
+  auto results = system.ApplyBatch(3, {op});
+  auto batched = operationFor(deposit.type).from_batch(results[0], deposit, 3);
+  EXPECT_EQ(batched.status, protocol::Status::SUCCESS);
+  ASSERT_TRUE(batched.balance.has_value());
+  EXPECT_EQ(*batched.balance, 600);
+
+  auto missing = protocol::Request::getBalance(4, "client", "token", "nobody", 4);
+  EXPECT_EQ(operationFor(missing.type).execute(system, missing).status, protocol::Status::ACCOUNT_NOT_FOUND);
+}
+
+TEST(ThreadPlacementTest, ShardPerCoreSpreadsEachKindAcrossNodes) {
+  concurrent::CpuTopology topology;
+  topology.nodes = {{0, {0, 1, 2, 3}}, {1, {4, 5, 6, 7}}};
+  EXPECT_EQ(topology.cpuCount(), 8u);
+  EXPECT_EQ(topology.nodeOf(5), 1);
+  EXPECT_EQ(topology.nodeOf(9), -1);
+  EXPECT_EQ(topology.describe(), "node0: 0-3; node1: 4-7");
+
+  auto placement = concurrent::ThreadPlacement::shardPerCore(topology, 2, 2);
+  EXPECT_EQ(placement.reactor_cpus, (std::vector<int>{0, 4}));
+  EXPECT_EQ(placement.fraud_cpus, (std::vector<int>{1, 5}));
+  EXPECT_EQ(placement.worker_cpus, (std::vector<int>{2, 6, 3, 7}));
+
+  // Too few CPUs to set any aside: everything shares them
+  concurrent::CpuTopology single;
+  single.nodes = {{0, {0}}};
+  placement = concurrent::ThreadPlacement::shardPerCore(single, 1, 1);
+  EXPECT_EQ(placement.reactor_cpus, (std::vector<int>{0}));
+  EXPECT_EQ(placement.fraud_cpus, (std::vector<int>{0}));
+  EXPECT_EQ(placement.worker_cpus, (std::vector<int>{0}));
+
+  // A pinned server reports what it detected and what it was given
+  BankingServer::Config config;
+  config.port = 19310;
+  config.placement = concurrent::ThreadPlacement::shardPerCore(concurrent::CpuTopology::detect(), 1, 1);
+  BankingServer server(config);
+  ASSERT_TRUE(server.start());
+  auto stats = server.getStats();
+  EXPECT_GE(stats.topology.cpuCount(), 1u);
+  EXPECT_EQ(stats.placement.worker_cpus, config.placement.worker_cpus);
+  EXPECT_EQ(stats.placement.reactor_cpus, config.placement.reactor_cpus);
+  server.stop();
+}
+
+TEST(LatencyHistogramTest, PercentilesStayWithinPrecisionAndMerge) {
+  using observability::LatencyHistogram;
+
+  // Bucket bounds are monotonic and every value lands in a bucket that holds it
+  for (uint64_t value : {uint64_t{0}, uint64_t{63}, uint64_t{64}, uint64_t{1000}, uint64_t{123456789},
+                         LatencyHistogram::kMaxValue}) {
+    const size_t index = LatencyHistogram::bucketIndex(value);
+    ASSERT_LT(index, LatencyHistogram::kBucketCount);
+    EXPECT_GE(LatencyHistogram::bucketUpperBound(index), value);
+    EXPECT_LE(LatencyHistogram::bucketUpperBound(index), value + value / 32 + 1);
+    if (index > 0) {
+      EXPECT_LT(LatencyHistogram::bucketUpperBound(index - 1), value);
+    }
+  }
+
+  // 1..10000 us split across two recorders' worth of histograms
+  LatencyHistogram even;
+  LatencyHistogram odd;
+  for (uint64_t us = 1; us <= 10000; ++us) {
+    (us % 2 == 0 ? even : odd).record(us * 1000);
+  }
+  even.merge(odd);
+  EXPECT_EQ(even.count(), 10000u);
+  EXPECT_EQ(even.max(), 10000u * 1000);
+  auto summary = even.summary();
+  EXPECT_NEAR(summary.p50_us, 5000.0, 5000.0 / 32);
+  EXPECT_NEAR(summary.p99_us, 9900.0, 9900.0 / 32);
+  EXPECT_NEAR(summary.p999_us, 9990.0, 9990.0 / 32);
+  EXPECT_DOUBLE_EQ(summary.max_us, 10000.0);
+  EXPECT_NEAR(summary.mean_us, 5000.5, 1e-6);
+
+  // The concurrent recorder merges its per-thread cells into the same answer
+  observability::LatencyRecorder recorder;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&recorder, t] {
+      for (int us = 1 + t; us <= 10000; us += 4) {
+        recorder.record(std::chrono::microseconds(us));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  auto recorded = recorder.snapshot();
+  EXPECT_EQ(recorded.count(), 10000u);
+  EXPECT_EQ(recorded.valueAtPercentile(99.0), even.valueAtPercentile(99.0));
+}
+
+// Write-behind pipeline tests
+class RecordingPersistence : public database::BankingPersistence {
+ public:
+  RecordingPersistence() : BankingPersistence(nullptr) {}
+
+  bool saveBatch(const database::WriteBatch& batch) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch_sizes_.push_back(batch.size());
+    for (const auto& record : batch.transactions) {
+      if (record.account_id == rejected_account_) return false;
+    }
+    return true;
+  }
+
+  // Fail every batch holding a transaction of `account_id`, as a bad row would
+  void rejectAccount(const std::string& account_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rejected_account_ = account_id;
+  }
+
+  std::vector<size_t> batchSizes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return batch_sizes_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<size_t> batch_sizes_;
+  std::string rejected_account_;
+};
+
+database::WriteBatch transferBatch(int timestamp, const std::string& source = "acc1") {
+  database::WriteBatch batch;
+  batch.transactions.emplace_back(source, "TRANSFER_SEND", 10, 100, 90, timestamp);
+  batch.transactions.emplace_back("acc2", "TRANSFER_RECEIVE", 10, 0, 10, timestamp);
+  return batch;
+}
+
+TEST(WriteBehindPipelineTest, GroupCommitCoalescesConcurrentSubmits) {
+  RecordingPersistence persistence;
+  database::WriteBehindPipeline::Config config;
+  config.mode = database::DurabilityMode::GROUP_COMMIT;
+  config.flush_interval = std::chrono::milliseconds(50);
+  database::WriteBehindPipeline pipeline(persistence, config);
+  pipeline.start();
+
+  std::vector<std::thread> threads;
+  std::atomic<int> committed{0};
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t] {
+      if (pipeline.submit(transferBatch(t))) {
+        ++committed;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Every submit returned only once its records were written, in fewer transactions than submits
+  EXPECT_EQ(committed.load(), 8);
+  auto stats = pipeline.getStats();
+  EXPECT_EQ(stats.records_flushed, 16u);
+  EXPECT_EQ(stats.queued_records, 0u);
+  EXPECT_LT(persistence.batchSizes().size(), 8u);
+}
+
+TEST(WriteBehindPipelineTest, AsyncFlushesOnBatchSizeAndOnDemand) {
+  RecordingPersistence persistence;
+  database::WriteBehindPipeline::Config config;
+  config.mode = database::DurabilityMode::ASYNC;
+  config.flush_interval = std::chrono::seconds(60);
+  config.max_batch_records = 4;
+  database::WriteBehindPipeline pipeline(persistence, config);
+  pipeline.start();
+
+  // A full batch goes out without waiting for the interval
+  pipeline.submit(transferBatch(1));
+  pipeline.submit(transferBatch(2));
+  for (int i = 0; i < 1000 && persistence.batchSizes().empty(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(persistence.batchSizes(), std::vector<size_t>{4});
+
+  // A partial one waits and shows up as lag until flushed
+  pipeline.submit(transferBatch(3));
+  auto stats = pipeline.getStats();
+  EXPECT_EQ(stats.queued_records, 2u);
+  EXPECT_GE(stats.flush_lag.count(), 0);
+  EXPECT_TRUE(pipeline.flush());
+  EXPECT_EQ(persistence.batchSizes(), (std::vector<size_t>{4, 2}));
+  EXPECT_EQ(pipeline.getStats().queued_records, 0u);
+  EXPECT_EQ(pipeline.getStats().records_submitted, 6u);
+}
+
+TEST(WriteBehindPipelineTest, FailedBatchIsRetriedOneSubmissionAtATime) {
+  RecordingPersistence persistence;
+  persistence.rejectAccount("bad");
+  database::WriteBehindPipeline::Config config;
+  config.mode = database::DurabilityMode::GROUP_COMMIT;
+  config.flush_interval = std::chrono::seconds(60);
+  config.max_batch_records = 8;  // All four submissions go out together
+  database::WriteBehindPipeline pipeline(persistence, config);
+  pipeline.start();
+
+  std::vector<std::future<bool>> results;
+  results.push_back(pipeline.enqueue(transferBatch(1)));
+  results.push_back(pipeline.enqueue(transferBatch(2, "bad")));
+  results.push_back(pipeline.enqueue(transferBatch(3)));
+  results.push_back(pipeline.enqueue(transferBatch(4)));
+
+  // Only the submission holding the bad row fails; the rest land on the retry
+  EXPECT_TRUE(results[0].get());
+  EXPECT_FALSE(results[1].get());
+  EXPECT_TRUE(results[2].get());
+  EXPECT_TRUE(results[3].get());
+  EXPECT_EQ(persistence.batchSizes(), (std::vector<size_t>{8, 2, 2, 2, 2}));
+  auto stats = pipeline.getStats();
+  EXPECT_EQ(stats.records_flushed, 6u);
+  EXPECT_EQ(stats.flushes, 1u);
+  EXPECT_EQ(stats.retried_flushes, 1u);
+  EXPECT_EQ(stats.failed_flushes, 1u);
+}
+
+TEST(WriteBehindPipelineTest, StopAnswersSubmitsThatRaceIt) {
+  RecordingPersistence persistence;
+  database::WriteBehindPipeline::Config config;
+  config.mode = database::DurabilityMode::GROUP_COMMIT;
+  config.flush_interval = std::chrono::milliseconds(1);
+  config.max_queued_records = 2;  // Most submitters wait for room while stop() runs
+
+  for (int round = 0; round < 200; ++round) {
+    database::WriteBehindPipeline pipeline(persistence, config);
+    pipeline.start();
+    std::vector<std::future<bool>> results(4);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < results.size(); ++t) {
+      threads.emplace_back([&, t] { results[t] = pipeline.enqueue(transferBatch(round)); });
+    }
+    pipeline.stop();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (auto& result : results) {
+      ASSERT_EQ(result.wait_for(std::chrono::seconds(5)), std::future_status::ready) << "round " << round;
+      EXPECT_TRUE(result.get());
+    }
+  }
+}
+
+TEST(WriteBehindPipelineTest, GroupCommitSharesCommitsThroughTheThreadSafeWrapper) {
+  auto recording = std::make_unique<RecordingPersistence>();
+  RecordingPersistence& persistence = *recording;
+  BankingSystemPersistent::Config config;
+  config.enable_audit_logging = false;
+  config.persistence.mode = database::DurabilityMode::GROUP_COMMIT;
+  config.persistence.flush_interval = std::chrono::milliseconds(20);
+  BankingSystemThreadSafe wrapped(std::make_unique<BankingSystemPersistent>(config, std::move(recording)));
+
+  constexpr int kThreads = 8;
+  std::atomic<int> committed{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      const std::string account = "acc" + std::to_string(t);
+      if (wrapped.CreateAccount(1, account) && wrapped.Deposit(2, account, 100) == 100) {
+        ++committed;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Waiting outside the wrapper's lock lets concurrent operations join one batch
+  EXPECT_EQ(committed.load(), kThreads);
+  EXPECT_LT(persistence.batchSizes().size(), static_cast<size_t>(kThreads));
+
+  // A write that cannot be persisted fails its own operation only
+  persistence.rejectAccount("acc0");
+  std::optional<int> rejected;
+  std::optional<int> accepted;
+  std::thread other([&] { accepted = wrapped.Deposit(3, "acc1", 5); });
+  rejected = wrapped.Deposit(3, "acc0", 5);
+  other.join();
+  EXPECT_FALSE(rejected.has_value());
+  EXPECT_EQ(accepted, 105);
+}
+
+TEST(ConnectionPoolTest, CheckoutBlocksAtCapacityAndHandlesReturn) {
+  database::PostgresConnection::Config config;
+  config.host = "127.0.0.1";
+  config.port = 1;  // Nothing listens: checkouts work, connecting does not
+  config.max_connections = 2;
+  config.connection_timeout = 0;
+  database::ConnectionPool pool(config);
+  EXPECT_EQ(pool.size(), 2u);
+
+  {
+    database::PooledConnection first = pool.acquire();
+    database::PooledConnection second = pool.acquire();
+    EXPECT_TRUE(first && second);
+    EXPECT_EQ(pool.idleCount(), 0u);
+    EXPECT_THROW(pool.acquire(), std::runtime_error);
+
+    second.release();
+    EXPECT_EQ(pool.idleCount(), 1u);
+    database::PooledConnection moved = std::move(first);
+    EXPECT_FALSE(first);
+    EXPECT_EQ(pool.idleCount(), 1u);
+  }
+  EXPECT_EQ(pool.idleCount(), 2u);
+}
+
+TEST(ParamBufferTest, FormatsValuesInPlaceAndReuses) {
+  database::ParamBuffer params;
+  params.add("acc1").add(-42).add(int64_t{1} << 40).addOrNull("").addNull().add(std::string("x"));
+  ASSERT_EQ(params.count(), 6);
+  const char* const* values = params.values();
+  EXPECT_STREQ(values[0], "acc1");
+  EXPECT_STREQ(values[1], "-42");
+  EXPECT_STREQ(values[2], "1099511627776");
+  EXPECT_EQ(values[3], nullptr);
+  EXPECT_EQ(values[4], nullptr);
+  EXPECT_STREQ(values[5], "x");
+
+  // Values added after values() was taken may move the arena; a fresh call sees them all
+  params.clear();
+  for (int i = 0; i < 1000; ++i) {
+    params.add(i);
+  }
+  values = params.values();
+  EXPECT_STREQ(values[0], "0");
+  EXPECT_STREQ(values[999], "999");
+}
+
+TEST(ReadCacheTest, InvalidatesPreciselyAndBoundsSize) {
+  database::ReadCache cache({4, 1});
+  int loads = 0;
+  auto balanceOf = [&](const std::string& account, int time_at, int value) {
+    return cache.balance(account, time_at, [&] { ++loads; return std::optional<int>(value); });
+  };
+
+  EXPECT_EQ(balanceOf("acc1", 10, 100), 100);
+  EXPECT_EQ(balanceOf("acc1", 20, 200), 200);
+  EXPECT_EQ(balanceOf("acc1", 10, -1), 100);  // Served from the cache
+  EXPECT_EQ(loads, 2);
+
+  // A write at 15 leaves the balance at 10 alone but drops the one at 20
+  cache.invalidateBalances("acc1", 15);
+  EXPECT_EQ(balanceOf("acc1", 10, -1), 100);
+  EXPECT_EQ(balanceOf("acc1", 20, 250), 250);
+  EXPECT_EQ(loads, 3);
+
+  // A load overlapping an invalidation answers its caller but is not kept
+  EXPECT_EQ(cache.balance("acc2", 5, [&] {
+    cache.invalidateBalances("acc2", 0);
+    return std::optional<int>(1);
+  }), 1);
+  EXPECT_EQ(balanceOf("acc2", 5, 2), 2);
+
+  for (int t = 100; t < 110; ++t) {
+    balanceOf("acc3", t, t);
+  }
+  EXPECT_EQ(cache.getStats().entries, 4u);
+  EXPECT_GT(cache.getStats().evictions, 0u);
+
+  int spender_loads = 0;
+  auto spenders = [&] { ++spender_loads; return std::vector<std::string>{"acc1(5)"}; };
+  cache.topSpenders(3, spenders);
+  cache.topSpenders(3, spenders);
+  cache.invalidateTopSpenders();
+  cache.topSpenders(3, spenders);
+  EXPECT_EQ(spender_loads, 2);
+}
+
+TEST(BinaryCopyBufferTest, IndexesTuplesAcrossChunks) {
+  auto int16 = [](int16_t v) { return std::string{static_cast<char>(v >> 8), static_cast<char>(v)}; };
+  auto int32 = [](int32_t v) {
+    return std::string{static_cast<char>(v >> 24), static_cast<char>(v >> 16),
+                       static_cast<char>(v >> 8), static_cast<char>(v)};
+  };
+  std::string stream("PGCOPY\n\377\r\n\0", 11);
+  stream += int32(0) + int32(0);  // Flags, no header extension
+  stream += int16(3) + int32(4) + "acc1" + int32(4) + int32(-25) + int32(1) + std::string(1, '\1');
+  stream += int16(3) + int32(-1) + int32(4) + int32(70000) + int32(1) + std::string(1, '\0');
+  stream += int16(-1);
+
+  database::BinaryCopyBuffer buffer;
+  buffer.append(stream.data(), 20);
+  buffer.append(stream.data() + 20, stream.size() - 20);
+  ASSERT_TRUE(buffer.index(3));
+  ASSERT_EQ(buffer.rowCount(), 2u);
+
+  auto first = buffer.row(0);
+  EXPECT_EQ(first.text(0), "acc1");
+  EXPECT_EQ(first.int32(1), -25);
+  EXPECT_TRUE(first.boolean(2));
+  auto second = buffer.row(1);
+  EXPECT_TRUE(second.isNull(0));
+  EXPECT_EQ(second.int32(1), 70000);
+  EXPECT_FALSE(second.boolean(2));
+
+  // Wrong column count or a missing trailer is rejected
+  EXPECT_FALSE(buffer.index(2));
+  database::BinaryCopyBuffer truncated;
+  truncated.append(stream.data(), stream.size() - 2);
+  EXPECT_FALSE(truncated.index(3));
+}
+
 // Fraud detection agent tests
 TEST(FraudDetectionAgentTest, BasicAnalysis) {
   ai::FraudDetectionAgent agent;
@@ -185,6 +1254,646 @@ TEST(FraudDetectionAgentTest, AnomalyDetection) {
   EXPECT_TRUE(result.risk_factors.size() > 0);
 }
 
+TEST(FraudDetectionAgentTest, FirstHourCountsEachTransactionOnce) {
+  ai::FraudDetectionAgent agent;
+
+  // Small logical timestamps: the window reaches back into buckets before 0
+  for (int timestamp = 1; timestamp <= 5; ++timestamp) {
+    auto result = agent.analyzeTransaction(ai::TransactionData("acc1", "TRANSFER", 100, timestamp));
+    EXPECT_EQ(result.risk_score, 0.0) << "timestamp " << timestamp;
+    EXPECT_TRUE(result.risk_factors.empty()) << "timestamp " << timestamp;
+  }
+}
+
+TEST(FraudDetectionAgentTest, AnalyzeBatchMatchesSequentialAnalysis) {
+  ai::FraudDetectionAgent sequential(3600, 1000, 0, 3);
+  ai::FraudDetectionAgent batched(3600, 1000, 0, 3);
+
+  std::vector<ai::TransactionData> transactions;
+  for (int i = 0; i < 200; ++i) {
+    const int amount = (i % 17 == 0) ? 20000 : 100 + (i % 7) * 10;
+    transactions.emplace_back("acc" + std::to_string(i % 5), "TRANSFER", amount, 1000 + i * 30, "",
+                              i % 11 == 0 ? "LA" : "NY");
+  }
+
+  std::vector<ai::FraudResult> results = batched.analyzeBatch(transactions);
+  ASSERT_EQ(results.size(), transactions.size());
+  int flagged = 0;
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    ai::FraudResult expected = sequential.analyzeTransaction(transactions[i]);
+    EXPECT_DOUBLE_EQ(results[i].risk_score, expected.risk_score) << "transaction " << i;
+    EXPECT_EQ(results[i].recommendation, expected.recommendation);
+    EXPECT_EQ(results[i].risk_factors, expected.risk_factors);
+    flagged += expected.risk_score > 0.5 ? 1 : 0;
+  }
+  EXPECT_GT(flagged, 0);  // The spikes stand out against the steady amounts
+}
+
+TEST(FraudDetectionAgentTest, WorkersAnalyzeEverySubmittedTransaction) {
+  ai::FraudDetectionAgent agent(3600, 16, 0, 4);
+  std::atomic<int> alerts{0};
+  agent.setAlertCallback([&](const ai::TransactionData&, const ai::FraudResult&) { alerts++; });
+  ASSERT_TRUE(agent.start());
+
+  // Steady traffic on many accounts, then one spike on an account with history
+  constexpr int kAccounts = 64;
+  constexpr int kPerAccount = 20;
+  for (int i = 0; i < kPerAccount; ++i) {
+    for (int a = 0; a < kAccounts; ++a) {
+      EXPECT_TRUE(agent.submitTransaction(ai::TransactionData("acc" + std::to_string(a), "TRANSFER", 100,
+                                                              1000 + i * 600)));
+    }
+  }
+  EXPECT_TRUE(agent.submitTransaction(ai::TransactionData("acc7", "TRANSFER", 50000, 1000 + kPerAccount * 600)));
+  agent.stop();  // Drains the queues
+
+  auto stats = agent.getStats();
+  EXPECT_EQ(stats.transactions_analyzed, static_cast<size_t>(kAccounts * kPerAccount + 1));
+  EXPECT_EQ(stats.analysis_queue_size, 0u);
+  EXPECT_GE(alerts.load(), 1);
+}
+
+TEST(FraudDetectionAgentTest, QuickScoreReadsPublishedSnapshot) {
+  ai::FraudDetectionAgent agent(3600, 1000, 0, 2);
+  EXPECT_EQ(agent.quickScore("acc1", 100000, 1000), 0.0);  // Nothing published yet
+
+  for (int i = 0; i < 10; ++i) {
+    agent.analyzeTransaction(ai::TransactionData("acc1", "TRANSFER", 100, 1000 + i * 60));
+  }
+  auto usual = agent.quickScore("acc1", 100, 1600);
+  auto spike = agent.quickScore("acc1", 100000, 1600);
+  ASSERT_TRUE(usual.has_value());
+  ASSERT_TRUE(spike.has_value());
+  EXPECT_LT(*usual, 0.4);
+  EXPECT_GT(*spike, 0.8);
+
+  // Scoring records nothing, and a day later the burst has aged out
+  auto later = agent.quickScore("acc1", 100, 1600 + 86400);
+  ASSERT_TRUE(later.has_value());
+  EXPECT_LT(*later, *usual + 1e-9);
+  EXPECT_EQ(agent.quickScore("acc2", 100000, 1600), 0.0);
+}
+
+TEST(FraudDetectionAgentTest, QuickScoreFallsBackWhenAnotherAccountHoldsTheSlot) {
+  // With one slot every account collides
+  ai::FraudDetectionAgent agent(3600, 1000, 0, 2, {}, 1);
+  EXPECT_EQ(agent.quickScore("acc1", 100000, 1000), 0.0);  // Empty slot
+
+  for (int i = 0; i < 10; ++i) {
+    agent.analyzeTransaction(ai::TransactionData("acc1", "TRANSFER", 100, 1000 + i * 60));
+  }
+  ASSERT_TRUE(agent.quickScore("acc1", 100000, 1600).has_value());
+  EXPECT_FALSE(agent.quickScore("acc2", 100000, 1600).has_value());
+
+  agent.analyzeTransaction(ai::TransactionData("acc2", "TRANSFER", 100, 1700));
+  EXPECT_TRUE(agent.quickScore("acc2", 100, 1800).has_value());
+  EXPECT_FALSE(agent.quickScore("acc1", 100000, 1800).has_value());
+}
+
+// Observability tests
+TEST(MetricsCollectorTest, HandlesAggregateAcrossThreadsAndExportLabels) {
+  observability::MetricsCollector metrics;
+  auto& transfers = metrics.counter("requests_total", {{"operation", "TRANSFER"}});
+  auto& deposits = metrics.counter("requests_total", {{"operation", "DEPOSIT"}});
+  auto& latency = metrics.histogram("latency_seconds", {}, {0.001, 0.01, 0.1});
+  EXPECT_EQ(&transfers, &metrics.counter("requests_total", {{"operation", "TRANSFER"}}));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 24; ++t) {  // More threads than cells, so some share one
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; ++i) {
+        transfers.increment();
+        latency.observe(i % 2 == 0 ? 0.0005 : 0.05);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  deposits.increment(2.5);
+
+  EXPECT_DOUBLE_EQ(transfers.value(), 24000.0);
+  auto snapshot = latency.snapshot();
+  ASSERT_EQ(snapshot.counts.size(), 4u);
+  EXPECT_EQ(snapshot.counts[0], 12000u);
+  EXPECT_EQ(snapshot.counts[1], 0u);
+  EXPECT_EQ(snapshot.counts[2], 12000u);
+  EXPECT_EQ(snapshot.count, 24000u);
+
+  const std::string text = metrics.exportMetrics();
+  EXPECT_NE(text.find("requests_total{operation=\"TRANSFER\"} 24000\n"), std::string::npos);
+  EXPECT_NE(text.find("requests_total{operation=\"DEPOSIT\"} 2.5\n"), std::string::npos);
+  EXPECT_NE(text.find("latency_seconds_bucket{le=\"0.01\"} 12000\n"), std::string::npos);  // Cumulative
+  EXPECT_NE(text.find("latency_seconds_bucket{le=\"+Inf\"} 24000\n"), std::string::npos);
+  EXPECT_EQ(text.find("# TYPE requests_total counter"), text.rfind("# TYPE requests_total counter"));
+
+  metrics.reset();
+  EXPECT_EQ(transfers.value(), 0.0);
+  transfers.increment();  // Handles survive a reset
+  EXPECT_EQ(metrics.counter("requests_total", {{"operation", "TRANSFER"}}).value(), 1.0);
+}
+
+TEST(LoggerTest, BackgroundThreadFormatsRecordsAndCountsDrops) {
+  auto& logger = observability::Logger::getInstance();
+  std::ostringstream out;
+  logger.setOutputStream(out);
+  logger.flush();
+  const auto before = logger.getStats();
+
+  std::thread([] {
+    LOG_INFO_FMT("test", "Loaded {}: {} rows, ok={}", "accounts", 42, true);
+    LOG_WARN("quote \" in message", "test", "req-7");
+    observability::Logger::LogBuilder(observability::LogLevel::INFO, "built", "test").field("amount", 250);
+    LOG_DEBUG("below the runtime level", "test");
+  }).join();
+  logger.flush();
+
+  const std::string text = out.str();
+  EXPECT_NE(text.find("\"message\":\"Loaded accounts: 42 rows, ok=true\",\"component\":\"test\"}"),
+            std::string::npos);
+  EXPECT_NE(text.find("\"message\":\"quote \\\" in message\",\"component\":\"test\",\"correlation_id\":\"req-7\""),
+            std::string::npos);
+  EXPECT_NE(text.find("\"message\":\"built\",\"component\":\"test\",\"amount\":250}"), std::string::npos);
+  EXPECT_EQ(text.find("below the runtime level"), std::string::npos);
+  EXPECT_EQ(logger.getStats().records_written - before.records_written, 3u);
+
+  // A tiny ring fills before the background thread's next interval
+  observability::Logger::Config config;
+  config.ring_bytes = 256;
+  config.flush_interval = std::chrono::milliseconds(1000);
+  logger.configure(config);
+  std::thread([] {
+    for (int i = 0; i < 200; ++i) {
+      LOG_INFO_FMT("test", "record {}", i);
+    }
+  }).join();
+  logger.flush();
+
+  const auto after = logger.getStats();
+  EXPECT_GT(after.records_dropped, before.records_dropped);
+  EXPECT_EQ(after.records_written - before.records_written + after.records_dropped - before.records_dropped, 203u);
+
+  logger.configure(observability::Logger::Config{});
+  logger.setOutputStream(std::cout);
+}
+
+TEST(LoggerTest, BlockingRingTakesRecordsUpToItsSizeAndDropsLarger) {
+  auto& logger = observability::Logger::getInstance();
+  std::ostringstream out;
+  logger.setOutputStream(out);
+  logger.flush();
+  const auto before = logger.getStats();
+
+  observability::Logger::Config config;
+  config.ring_bytes = 256;
+  config.overflow = observability::Logger::OverflowPolicy::BLOCK;
+  logger.configure(config);
+  const std::string near_full(200, 'x');  // A 232-byte record
+  const std::string too_large(300, 'y');
+  std::thread([&] {
+    // The small record leaves the cursor mid-ring; the large one only fits from the front
+    LOG_INFO_FMT("test", "small {}", 1);
+    logger.flush();
+    LOG_INFO_FMT("test", "{}", near_full);
+    LOG_INFO_FMT("test", "{}", too_large);
+  }).join();
+  logger.flush();
+
+  const auto after = logger.getStats();
+  EXPECT_EQ(after.records_written - before.records_written, 2u);
+  EXPECT_EQ(after.records_dropped - before.records_dropped, 1u);
+  EXPECT_NE(out.str().find(near_full), std::string::npos);
+  EXPECT_EQ(out.str().find(too_large), std::string::npos);
+
+  logger.configure(observability::Logger::Config{});
+  logger.setOutputStream(std::cout);
+}
+
+// Protocol framing tests
+TEST(MessageFramerTest, BinaryFramesSurvivePartialReads) {
+  using network::protocol::FrameBuffer;
+  using network::protocol::FramingVersion;
+  using network::protocol::MessageFramer;
+
+  std::string wire;
+  MessageFramer::appendFrame(wire, "first", FramingVersion::V2_BINARY);
+  MessageFramer::appendFrame(wire, "", FramingVersion::V2_BINARY);
+  MessageFramer::appendFrame(wire, "third", FramingVersion::V2_BINARY);
+
+  // Feed one byte at a time, as a slow socket would.
+  FrameBuffer buffer(8);
+  std::vector<std::string> frames;
+  std::string_view frame;
+  for (char c : wire) {
+    buffer.append(&c, 1);
+    while (MessageFramer::nextFrame(buffer, FramingVersion::V2_BINARY, frame)) {
+      frames.emplace_back(frame);
+    }
+  }
+
+  ASSERT_EQ(frames.size(), 3u);
+  EXPECT_EQ(frames[0], "first");
+  EXPECT_EQ(frames[1], "");
+  EXPECT_EQ(frames[2], "third");
+  EXPECT_TRUE(buffer.empty());
+}
+
+TEST(MessageFramerTest, HandshakeFallsBackToLegacyFraming) {
+  using network::protocol::FrameBuffer;
+  using network::protocol::FramingVersion;
+  using network::protocol::MessageFramer;
+
+  // A v1 client sends a double hex frame with no hello.
+  std::string legacy = MessageFramer::frameMessage(MessageFramer::frameMessage("{}"));
+  FrameBuffer legacy_buffer;
+  legacy_buffer.append(legacy.data(), legacy.size());
+
+  FramingVersion version = FramingVersion::V2_BINARY;
+  std::string reply;
+  EXPECT_EQ(MessageFramer::acceptHandshake(legacy_buffer, version, reply),
+            MessageFramer::HandshakeState::LEGACY);
+  EXPECT_EQ(version, FramingVersion::V1_HEX);
+
+  std::string_view frame;
+  ASSERT_TRUE(MessageFramer::nextFrame(legacy_buffer, version, frame));
+  EXPECT_EQ(frame, "{}");
+
+  // A v2 client is acknowledged with the negotiated version.
+  std::string hello = MessageFramer::encodeHandshake(FramingVersion::V2_BINARY);
+  FrameBuffer server_buffer;
+  server_buffer.append(hello.data(), hello.size());
+  EXPECT_EQ(MessageFramer::acceptHandshake(server_buffer, version, reply),
+            MessageFramer::HandshakeState::NEGOTIATED);
+  EXPECT_EQ(version, FramingVersion::V2_BINARY);
+
+  FrameBuffer client_buffer;
+  client_buffer.append(reply.data(), reply.size());
+  FramingVersion client_version = FramingVersion::V1_HEX;
+  EXPECT_EQ(MessageFramer::readHandshakeAck(client_buffer, client_version),
+            MessageFramer::HandshakeState::NEGOTIATED);
+  EXPECT_EQ(client_version, FramingVersion::V2_BINARY);
+}
+
+TEST(MessageFramerTest, MultiplexedFramesCarryRequestId) {
+  using network::protocol::FrameBuffer;
+  using network::protocol::FramingVersion;
+  using network::protocol::MessageFramer;
+
+  std::string wire;
+  MessageFramer::appendFrame(wire, "late", FramingVersion::V3_MULTIPLEXED, 7);
+  MessageFramer::appendFrame(wire, "early", FramingVersion::V3_MULTIPLEXED, 3);
+
+  FrameBuffer buffer;
+  buffer.append(wire.data(), wire.size());
+
+  std::string_view frame;
+  uint32_t request_id = 0;
+  ASSERT_TRUE(MessageFramer::nextFrame(buffer, FramingVersion::V3_MULTIPLEXED, frame, request_id));
+  EXPECT_EQ(frame, "late");
+  EXPECT_EQ(request_id, 7u);
+  ASSERT_TRUE(MessageFramer::nextFrame(buffer, FramingVersion::V3_MULTIPLEXED, frame, request_id));
+  EXPECT_EQ(frame, "early");
+  EXPECT_EQ(request_id, 3u);
+  EXPECT_FALSE(MessageFramer::nextFrame(buffer, FramingVersion::V3_MULTIPLEXED, frame, request_id));
+}
+
+TEST(MessageFramerTest, InPlaceFramesMatchAppendFrame) {
+  using network::protocol::FramingVersion;
+  using network::protocol::MessageFramer;
+
+  for (auto version : {FramingVersion::V1_HEX, FramingVersion::V2_BINARY, FramingVersion::V3_MULTIPLEXED}) {
+    std::string appended = "prefix";
+    MessageFramer::appendFrame(appended, "payload", version, 9);
+
+    std::string in_place = "prefix";
+    const size_t frame_start = MessageFramer::beginFrame(in_place, version);
+    EXPECT_EQ(in_place.size(), frame_start + MessageFramer::headerSize(version));
+    in_place += "payload";
+    MessageFramer::finishFrame(in_place, frame_start, version, 9);
+    EXPECT_EQ(in_place, appended);
+  }
+}
+
+TEST(TCPServerTest, PipelinedResponsesAreEncodedInPlace) {
+  using network::TCPServer;
+
+  int port = 19191;
+  for (auto io_model : {TCPServer::IoModel::THREAD_PER_CONNECTION, TCPServer::IoModel::EVENT_LOOP}) {
+    TCPServer::Config config;
+    config.io_model = io_model;
+    config.num_reactors = 1;
+    TCPServer server(port, [](std::string_view request, std::string& out) {
+      if (request == "large") {
+        out.append(4 * 1024 * 1024, 'x');  // Far beyond one socket buffer, so writes come back short
+      } else {
+        out += "echo:";
+        out += request;
+      }
+    }, config);
+    ASSERT_TRUE(server.start());
+
+    network::TCPClient client("127.0.0.1", port);
+    ASSERT_TRUE(client.connect());
+    std::vector<std::future<std::string>> responses;
+    for (int i = 0; i < 32; ++i) {
+      responses.push_back(client.sendRequestAsync(i == 16 ? "large" : std::to_string(i)));
+    }
+    for (int i = 0; i < 32; ++i) {
+      const std::string response = responses[i].get();
+      if (i == 16) {
+        EXPECT_EQ(response.size(), 4u * 1024 * 1024);
+      } else {
+        EXPECT_EQ(response, "echo:" + std::to_string(i));
+      }
+    }
+
+    client.disconnect();
+    server.stop();
+    ++port;
+  }
+}
+
+TEST(TCPServerTest, EventLoopKeepsServingWhileAnAnswerIsPending) {
+  using network::TCPServer;
+
+  TCPServer::Config config;
+  config.io_model = TCPServer::IoModel::EVENT_LOOP;
+  config.num_reactors = 1;
+  const int port = 19194;
+  std::mutex held_mutex;
+  TCPServer::Responder held;
+  std::vector<std::thread> answering;
+  TCPServer server(port, TCPServer::AsyncHandler([&](std::string_view request, TCPServer::Responder respond) {
+    std::lock_guard<std::mutex> lock(held_mutex);
+    if (request == "hold") {
+      held = std::move(respond);  // Answered only once "release" has been handled
+    } else if (request == "release") {
+      respond("released");
+      answering.emplace_back([&held] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        held("held");
+      });
+    } else {
+      respond("echo:" + std::string(request));
+    }
+  }), config);
+  ASSERT_TRUE(server.start());
+
+  // A reactor that waited for "hold" would never read "release"; responses
+  // still come back in request order though answered out of it
+  network::TCPClient client("127.0.0.1", port);
+  ASSERT_TRUE(client.connect());
+  auto hold = client.sendRequestAsync("hold");
+  auto release = client.sendRequestAsync("release");
+  auto echo = client.sendRequestAsync("after");
+  ASSERT_EQ(release.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+  EXPECT_EQ(hold.get(), "held");
+  EXPECT_EQ(release.get(), "released");
+  EXPECT_EQ(echo.get(), "echo:after");
+
+  client.disconnect();
+  server.stop();
+  for (auto& thread : answering) {
+    thread.join();
+  }
+}
+
+TEST(TCPServerTest, EventLoopAnswersEverythingBeforeClosingAHalfClosedPeer) {
+  using network::TCPServer;
+  using network::protocol::FramingVersion;
+  using network::protocol::MessageFramer;
+
+  TCPServer::Config config;
+  config.io_model = TCPServer::IoModel::EVENT_LOOP;
+  config.num_reactors = 1;
+  const int port = 19195;
+  constexpr size_t kResponseSize = 512 * 1024;
+  TCPServer server(port, [](std::string_view request, std::string& out) {
+    out.append(kResponseSize, request.empty() ? '?' : request[0]);
+  }, config);
+  ASSERT_TRUE(server.start());
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+  struct sockaddr_in address {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+  ASSERT_EQ(connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)), 0);
+  struct timeval timeout {10, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  // Far more output than the high-water mark, requested before reading any of
+  // it, then the peer stops sending while the reactor is still throttled
+  constexpr int kRequests = 32;
+  std::string requests;
+  for (int i = 0; i < kRequests; ++i) {
+    MessageFramer::appendFrame(requests, std::string(1, static_cast<char>('a' + i % 26)),
+                               FramingVersion::V1_HEX);
+  }
+  ASSERT_EQ(send(fd, requests.data(), requests.size(), 0), static_cast<ssize_t>(requests.size()));
+  ASSERT_EQ(shutdown(fd, SHUT_WR), 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  network::protocol::FrameBuffer input;
+  bool closed = false;
+  while (!closed) {
+    char* buffer = input.prepareWrite(64 * 1024);
+    ssize_t bytes_read = recv(fd, buffer, 64 * 1024, 0);
+    ASSERT_GE(bytes_read, 0) << "timed out waiting for the server";
+    input.commitWrite(static_cast<size_t>(bytes_read));
+    closed = bytes_read == 0;
+  }
+  close(fd);
+
+  std::string_view payload;
+  int responses = 0;
+  while (MessageFramer::nextFrame(input, FramingVersion::V1_HEX, payload)) {
+    ASSERT_EQ(payload.size(), kResponseSize);
+    EXPECT_EQ(payload[0], static_cast<char>('a' + responses % 26));
+    ++responses;
+  }
+  EXPECT_EQ(responses, kRequests);
+  EXPECT_TRUE(input.empty());
+  server.stop();
+}
+
+TEST(IdempotencyCacheTest, RetriedRequestIsAppliedOnce) {
+  namespace protocol = network::protocol;
+
+  // The key survives both encodings
+  auto deposit = protocol::Request::deposit(2, "client_1", "", "acc1", 100);
+  deposit.idempotency_key = "deposit-1";
+  for (auto encoding : {protocol::Encoding::JSON, protocol::Encoding::BINARY}) {
+    EXPECT_EQ(protocol::decodeRequest(protocol::encodeRequest(deposit, encoding)).idempotency_key, "deposit-1");
+  }
+
+  // Concurrent duplicates run once; a response marked not cacheable is not kept
+  IdempotencyCache cache(IdempotencyCache::Config{});
+  std::atomic<int> runs{0};
+  auto run = [&runs] {
+    ++runs;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return protocol::Response::depositResult(runs.load(), 1);
+  };
+  auto keep = [](const protocol::Response&) { return true; };
+  std::vector<std::thread> retries;
+  for (int i = 0; i < 4; ++i) {
+    retries.emplace_back([&] { EXPECT_EQ(cache.execute("client_1", "k", run, keep).balance, 1); });
+  }
+  for (auto& retry : retries) {
+    retry.join();
+  }
+  EXPECT_EQ(runs.load(), 1);
+  cache.execute("client_2", "k", run, [](const protocol::Response&) { return false; });
+  cache.execute("client_2", "k", run, keep);
+  EXPECT_EQ(runs.load(), 3);
+  auto cache_stats = cache.getStats();
+  EXPECT_EQ(cache_stats.misses, 3u);
+  EXPECT_EQ(cache_stats.hits + cache_stats.waits, 3u);
+  EXPECT_EQ(cache_stats.entries, 2u);
+
+  // Without blocking, a duplicate of an attempt in flight is answered when it finishes
+  IdempotencyCache::Finish finish_first;
+  std::vector<int> answers;
+  auto record = [&answers](const protocol::Response* response) { answers.push_back(response->balance.value_or(-1)); };
+  cache.executeAsync("client_3", "k", [&](IdempotencyCache::Finish finish) { finish_first = std::move(finish); },
+                     keep, record);
+  cache.executeAsync("client_3", "k", [](IdempotencyCache::Finish) { ADD_FAILURE() << "ran twice"; },
+                     keep, record);
+  EXPECT_TRUE(answers.empty());
+  finish_first(protocol::Response::depositResult(7, 1));
+  EXPECT_EQ(answers, (std::vector<int>{7, 7}));
+
+  // Through the server, a retried deposit is answered without depositing again
+  BankingServer::Config config;
+  config.port = 19320;
+  BankingServer server(config);
+  ASSERT_TRUE(server.start());
+  network::TCPClient client("127.0.0.1", config.port);
+  ASSERT_TRUE(client.connect());
+  auto send = [&client](const protocol::Request& request) {
+    return protocol::decodeResponse(client.sendRequest(protocol::encodeRequest(request, protocol::Encoding::BINARY)));
+  };
+  auto login = protocol::Request::authenticate(1, "client_1", "secret");
+  login.client_id = "client_1";
+  auto session = send(login).session_token.value_or("");
+  deposit.session_token = session;
+  send(protocol::Request::createAccount(1, "client_1", session, "acc1"));
+  EXPECT_EQ(send(deposit).balance, 100);
+  EXPECT_EQ(send(deposit).balance, 100);
+  EXPECT_EQ(send(protocol::Request::getBalance(3, "client_1", session, "acc1", 3)).balance, 100);
+  EXPECT_EQ(server.getStats().idempotency_stats.hits, 1u);
+
+  client.disconnect();
+  server.stop();
+}
+
+TEST(BankingServerTest, ReactorAppliesPipelinedRequestsInPlace) {
+  namespace protocol = network::protocol;
+
+  BankingServer::Config config;
+  config.port = 19321;
+  config.placement.reactor_cpus = {0};  // Serve from one event-loop reactor
+  BankingServer server(config);
+  ASSERT_TRUE(server.start());
+  network::TCPClient client("127.0.0.1", config.port);
+  ASSERT_TRUE(client.connect());
+  auto encode = [](const protocol::Request& request) {
+    return protocol::encodeRequest(request, protocol::Encoding::BINARY);
+  };
+  auto login = protocol::Request::authenticate(1, "client_1", "secret");
+  login.client_id = "client_1";
+  auto session = protocol::decodeResponse(client.sendRequest(encode(login))).session_token.value_or("");
+  client.sendRequest(encode(protocol::Request::createAccount(1, "client_1", session, "acc1")));
+
+  // Pipelined on one connection, the deposits are applied in the order sent
+  constexpr int kDeposits = 64;
+  std::vector<std::future<std::string>> responses;
+  for (int i = 0; i < kDeposits; ++i) {
+    responses.push_back(client.sendRequestAsync(
+        encode(protocol::Request::deposit(2 + i, "client_1", session, "acc1", 100))));
+  }
+  for (int i = 0; i < kDeposits; ++i) {
+    EXPECT_EQ(protocol::decodeResponse(responses[i].get()).balance, 100 * (i + 1));
+  }
+
+  // Answered straight from the frame, without reaching the processor
+  auto stale = protocol::Request::deposit(99, "client_1", "not-the-session", "acc1", 100);
+  EXPECT_EQ(protocol::decodeResponse(client.sendRequest(encode(stale))).status, protocol::Status::UNAUTHORIZED);
+  auto heartbeat = protocol::Request::heartbeat(99, "client_1");
+  EXPECT_EQ(protocol::decodeResponse(client.sendRequest(encode(heartbeat))).status, protocol::Status::SUCCESS);
+  auto stats = server.getStats().transaction_stats;
+  EXPECT_EQ(stats.transactions_processed, static_cast<size_t>(kDeposits + 1));
+  EXPECT_EQ(stats.transactions_queued, 0u);
+
+  client.disconnect();
+  server.stop();
+}
+
+// Binary codec tests
+TEST(BinaryCodecTest, RequestAndResponseRoundTrip) {
+  namespace protocol = network::protocol;
+
+  auto request = protocol::Request::transfer(1234, "client_1", "token", "alice", "bob", -75);
+  std::string encoded = protocol::encodeRequest(request, protocol::Encoding::BINARY);
+  ASSERT_EQ(protocol::detectEncoding(encoded), protocol::Encoding::BINARY);
+
+  // Decoding in place must not copy: views point into the encoded buffer.
+  auto view = protocol::BinaryCodec::decodeRequest(encoded);
+  EXPECT_EQ(view.type, protocol::MessageType::TRANSFER);
+  EXPECT_EQ(view.timestamp, 1234);
+  EXPECT_EQ(view.source_account, "alice");
+  EXPECT_EQ(view.target_account, "bob");
+  EXPECT_EQ(view.amount, -75);
+  EXPECT_GE(view.source_account.data(), encoded.data());
+  EXPECT_LT(view.source_account.data(), encoded.data() + encoded.size());
+
+  // Truncated input is rejected rather than read past the end.
+  EXPECT_THROW(protocol::BinaryCodec::decodeRequest(
+                   std::string_view(encoded).substr(0, encoded.size() - 1)),
+               std::runtime_error);
+
+  auto response = protocol::Response::topSpendersResult({"alice(75)", "bob(0)"}, 1234);
+  auto decoded = protocol::decodeResponse(
+      protocol::encodeResponse(response, protocol::Encoding::BINARY));
+  EXPECT_EQ(decoded.status, protocol::Status::SUCCESS);
+  EXPECT_EQ(decoded.message, response.message);
+  ASSERT_TRUE(decoded.spenders.has_value());
+  EXPECT_EQ(*decoded.spenders, *response.spenders);
+  EXPECT_FALSE(decoded.balance.has_value());
+}
+
+TEST(BinaryCodecTest, BatchRoundTrip) {
+  namespace protocol = network::protocol;
+
+  auto request = protocol::Request::batch(
+      2000, "client_1", "token",
+      {protocol::Request::deposit(0, "client_1", "token", "alice", 50),
+       protocol::Request::transfer(0, "client_1", "token", "alice", "bob", 20)});
+  for (auto encoding : {protocol::Encoding::BINARY, protocol::Encoding::JSON}) {
+    auto decoded = protocol::decodeRequest(protocol::encodeRequest(request, encoding));
+    EXPECT_EQ(decoded.type, protocol::MessageType::BATCH);
+    ASSERT_EQ(decoded.operations.size(), 2u);
+    EXPECT_EQ(decoded.operations[0].type, protocol::MessageType::DEPOSIT);
+    EXPECT_EQ(decoded.operations[0].amount, 50);
+    EXPECT_EQ(decoded.operations[1].target_account, "bob");
+  }
+
+  // Batches do not nest.
+  auto nested = protocol::Request::batch(2000, "client_1", "token", {request});
+  EXPECT_THROW(protocol::encodeRequest(nested, protocol::Encoding::BINARY), std::runtime_error);
+
+  auto response = protocol::Response::batchResult(
+      {protocol::Response::depositResult(50, 2000),
+       protocol::Response::error(protocol::Status::INSUFFICIENT_FUNDS, "Transfer failed", 2000)},
+      2000);
+  auto decoded = protocol::decodeResponse(
+      protocol::encodeResponse(response, protocol::Encoding::BINARY));
+  ASSERT_TRUE(decoded.results.has_value());
+  ASSERT_EQ(decoded.results->size(), 2u);
+  EXPECT_EQ((*decoded.results)[0].balance, 50);
+  EXPECT_EQ((*decoded.results)[1].status, protocol::Status::INSUFFICIENT_FUNDS);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();